@@ -26,38 +26,62 @@
 #include "kiss_fftr.h"
 #include "signalsifter_config.h"
 
-#define KISSFFT_SUBSIZE   (272 + sizeof(kiss_fft_cpx)*((FFT_SIZE>>1) - 1))
-#define KISSFFT_MEMNEEDED KISSFFT_SUBSIZE + 24 + sizeof(kiss_fft_cpx)*((FFT_SIZE>>1) * 3/2)
+// Largest FFT size create_stft_geometry() accepts (the default geometry must fit)
+#ifndef STFT_MAX_FFT_SIZE
+#define STFT_MAX_FFT_SIZE FFT_SIZE
+#endif
+#define STFT_MAX_NUM_BINS ((STFT_MAX_FFT_SIZE >> 1) + 1)
+#define STFT_MAX_PLANS 4    // distinct geometries per process
 
+#define KISSFFT_SUBSIZE   (272 + sizeof(kiss_fft_cpx)*((STFT_MAX_FFT_SIZE>>1) - 1))
+#define KISSFFT_MEMNEEDED KISSFFT_SUBSIZE + 24 + sizeof(kiss_fft_cpx)*((STFT_MAX_FFT_SIZE>>1) * 3/2)
 
-typedef struct STFT {
+// FFT plans and window of one geometry, shared (read-only, also across threads) by all STFTs using it
+typedef struct STFTPlan {
     unsigned int NFFT;
-    unsigned int NFFT_by_2;
     unsigned int numBins;
-//    unsigned int R;    // Hop-length
     float FFTscale;
     float IFFTscale;
     //KISS_FFT
     kiss_fftr_cfg kissFFT_cfg;
     kiss_fftr_cfg kissIFFT_cfg;
-    kiss_fft_cpx Xk[NUM_BINS] __attribute__((aligned(16)));
-    kiss_fft_cpx Yk[NUM_BINS] __attribute__((aligned(16)));
-
-    float window[FFT_SIZE] __attribute__((aligned(16)));
-    float inputAux[FFT_SIZE] __attribute__((aligned(16)));
-    float outputAux[FFT_SIZE] __attribute__((aligned(16)));
-    float Xmag[NUM_BINS] __attribute__((aligned(16)));
+    float window[STFT_MAX_FFT_SIZE] __attribute__((aligned(16)));
 
     char kissFFTmem[KISSFFT_MEMNEEDED] __attribute__((aligned(16)));
     char kissIFFTmem[KISSFFT_MEMNEEDED] __attribute__((aligned(16)));
+} STFTPlan;
+
+typedef struct STFT {
+    unsigned int NFFT;
+    unsigned int NFFT_by_2;
+    unsigned int numBins;
+    unsigned int R;    // Hop-length
+    const STFTPlan *plan;
+    kiss_fft_cpx Xk[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));   // masked in place by mask_process
+
+    float inputAux[STFT_MAX_FFT_SIZE] __attribute__((aligned(16)));
+    float outputAux[STFT_MAX_FFT_SIZE] __attribute__((aligned(16)));
+    float Xmag[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));    // numBins used, the rest stays 0
+    float energy;   // mean |X|^2 over the bins of the last frame (before the log)
 
   } STFTStruct;
 
+// Geometries with a sqrt-Hann analysis/synthesis pair: an even NFFT of at most
+// STFT_MAX_FFT_SIZE and 50% overlap (hop = NFFT/2)
+int stft_geometry_supported(unsigned int nfft, unsigned int hop);
+/* The plan of an NFFT, built on first use and kept for the lifetime of the process;
+   thread safe (concurrent first calls build it once). NULL if the geometry is
+   unsupported or STFT_MAX_PLANS are in use.
+ */
+const STFTPlan *get_stft_plan(unsigned int nfft);
+// create_stft() is the compiled-in geometry (FFT_SIZE, HOP_LENGTH); -1: unsupported
+int create_stft_geometry(STFTStruct *stft, unsigned int nfft, unsigned int hop);
 void create_stft(STFTStruct *stft);
 void destroy_stft(STFTStruct *stft);
 void stft_process(STFTStruct *stft, const float *input, unsigned int R);
 void mask_process(STFTStruct *stft, float *mask);
 void istft_process(STFTStruct *stft, float *output, unsigned int R);
+void stft_zero_frame(STFTStruct *stft, float *output, unsigned int R);
 
 /*
  Perform windowing and FFT on input buffer. (STFT)
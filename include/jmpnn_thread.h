@@ -0,0 +1,108 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  jmpnn_thread.h
+//
+//  Internal helpers shared by the threaded paths (layer team and pipeline, NN worker,
+//  stream engine, chunked offline processing): thread pinning, a monotonic clock, a
+//  spin/yield/sleep backoff and the indices of a single-producer/single-consumer ring.
+//
+#ifndef JMPNN_THREAD_H_
+#define JMPNN_THREAD_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JMPNN_PAUSE() _mm_pause()
+#elif defined(__aarch64__)
+#define JMPNN_PAUSE() __asm__ __volatile__("yield")
+#else
+#define JMPNN_PAUSE()
+#endif
+
+#define JMPNN_CACHE_LINE 64
+#define JMPNN_BACKOFF_SPINS 2000    // pause iterations, then JMPNN_BACKOFF_YIELDS sched_yield()s, then 100 us sleeps
+#define JMPNN_BACKOFF_YIELDS 1000
+
+// Pins thread to cpu, best effort (Linux only); cpu < 0 leaves it where it is
+void jmpnn_pin_thread(pthread_t thread, int cpu);
+// CLOCK_MONOTONIC in ns
+uint64_t jmpnn_now_ns(void);
+
+// One step of waiting; *waits counts the steps so far (start at 0)
+static inline void jmpnn_backoff(int *waits)
+{
+    if (*waits < JMPNN_BACKOFF_SPINS)
+        JMPNN_PAUSE();
+    else if (*waits < JMPNN_BACKOFF_SPINS + JMPNN_BACKOFF_YIELDS)
+        sched_yield();
+    else
+    {
+        struct timespec ts = { 0, 100000 };
+        nanosleep(&ts, NULL);
+        return;
+    }
+    (*waits)++;
+}
+
+// Indices of a ring of slots the owner keeps next to it; tail and head on their own cache lines
+typedef struct {
+    atomic_uint tail __attribute__((aligned(JMPNN_CACHE_LINE)));  // slots written by the producer
+    atomic_uint head __attribute__((aligned(JMPNN_CACHE_LINE)));  // slots released by the consumer
+} JMPNN_SPSCRing;
+
+static inline void jmpnn_spsc_init(JMPNN_SPSCRing *q)
+{
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+}
+
+// Producer: index of the slot to fill, or -1 if all num_slots are written
+static inline int jmpnn_spsc_space(JMPNN_SPSCRing *q, unsigned int num_slots)
+{
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&q->head, memory_order_acquire) >= num_slots)
+        return -1;
+    return tail % num_slots;
+}
+
+// Consumer: index of the oldest slot written, or -1 if the ring is empty
+static inline int jmpnn_spsc_data(JMPNN_SPSCRing *q, unsigned int num_slots)
+{
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    if (atomic_load_explicit(&q->tail, memory_order_acquire) == head)
+        return -1;
+    return head % num_slots;
+}
+
+// Producer: publishes the slot returned by jmpnn_spsc_space()
+static inline void jmpnn_spsc_push(JMPNN_SPSCRing *q)
+{
+    atomic_store_explicit(&q->tail, atomic_load_explicit(&q->tail, memory_order_relaxed) + 1, memory_order_release);
+}
+
+// Consumer: releases the slot returned by jmpnn_spsc_data()
+static inline void jmpnn_spsc_pop(JMPNN_SPSCRing *q)
+{
+    atomic_store_explicit(&q->head, atomic_load_explicit(&q->head, memory_order_relaxed) + 1, memory_order_release);
+}
+
+#endif /* JMPNN_THREAD_H_ */
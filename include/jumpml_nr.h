@@ -20,16 +20,25 @@
 #define _JUMPML_NR_H_
 
 #include "noise_reduction.h"
+#include "noise_reduction_worker.h"
 #include <stdint.h>
 #include "signalsifter_config.h"
 #include "biquad.h"
 
-#define JUMPML_NR_FRAME_SIZE HOP_LENGTH   // Do not change.
+#define JUMPML_NR_FRAME_SIZE HOP_LENGTH   // Do not change. Frame size of jumpml_nr_init instances
+#define JUMPML_NR_MAX_FRAME_SIZE (STFT_MAX_FFT_SIZE >> 1)
+
+// Sample formats of jumpml_nr_proc_multi
+#define JUMPML_NR_FORMAT_S16 0   // int16_t, full scale 32768
+#define JUMPML_NR_FORMAT_F32 1   // float, full scale 1.0
+#define JUMPML_NR_MAX_LINKED JMPNN_MAX_BATCH   // channels of jumpml_nr_proc_linked
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Per-stream (mutable) state. Instances of a context are jumpml_nr_state_size() bytes:
+// this struct followed by the NN state of the context's graph.
 typedef struct stru_dsp_jmpnr_st
 {
     int NRState_buf[((NR_STATE_SIZE_BYTES)>>2)] __attribute__((aligned(16)));
@@ -38,12 +47,117 @@ typedef struct stru_dsp_jmpnr_st
     BiquadFilter hsfilter;
     BiquadParams hsparams;
     NoiseReductionStatePtr NR_Ptr;
+    void *ctx;              // jumpml_nr_init_context(), else NULL
+    // jumpml_nr_proc_stream() re-framing: a partial input frame and a ring of output samples
+    int16_t streamIn[JUMPML_NR_MAX_FRAME_SIZE];
+    int16_t streamOut[2 * JUMPML_NR_MAX_FRAME_SIZE];
+    int streamInFill;
+    int streamOutRead;
+    int streamOutCount;
+    int streamLatency;
 } DSP_JMPNR_ST_STRU;
 
+/* Engine context: the read-only data shared by all streams of one model, i.e. its STFT
+   geometry (the FFT plans and window are built once per geometry, see get_stft_plan) and
+   NN (model or graph, or a model file the context loaded and owns). Reference counted:
+   created with one reference, and each stream initialized from it holds another one until
+   jumpml_nr_release(). Streams of a context hold no copy of anything read-only, so
+   jumpml_nr_init_context() only clears state.
+ */
+// model/graph (both NULL: the compiled-in model) must outlive the context. Returns 1 if
+// the geometry is unsupported or the NN does not fit it (e.g. a graph in the int8 build).
+uint32_t jumpml_nr_context_create(void **jmpnr_ctx_ptr, unsigned int fft_size, unsigned int hop_length,
+                                  const SignalSifterModel *model, const NNGraph *graph);
+// Loads a model file (loadSignalSifterModelFile flags) with its geometry; its graph runs,
+// or its SignalSifter model in builds without a graph executor. Returns 1 on error.
+uint32_t jumpml_nr_context_load(void **jmpnr_ctx_ptr, const char *model_path, int flags);
+void jumpml_nr_context_retain(void *jmpnr_ctx_ptr);
+void jumpml_nr_context_release(void *jmpnr_ctx_ptr);
+// Bytes of a stream of the context (16-byte aligned memory); NULL: a jumpml_nr_init instance
+size_t jumpml_nr_state_size(const void *jmpnr_ctx_ptr);
+uint32_t jumpml_nr_init_context(void *jmpnr_st_ptr, void *jmpnr_ctx_ptr, float naturalness, float min_gain);
+// Frees what the stream holds (its reference to the context, a jumpml_nr_set_graph state)
+void jumpml_nr_release(void *jmpnr_st_ptr);
+
 uint32_t jumpml_nr_init(void *jmpnr_st_ptr, float naturalness, float min_gain);
+// Instance with the STFT geometry of a model (e.g. a SignalSifterModelFile's fft_size and
+// hop_length); frames are then hop_length samples (jumpml_nr_frame_size). Returns 1 if the
+// geometry is not supported (create_noise_reduction_geometry) or, in the delta build, if
+// its model could not be allocated (jumpml_nr_init() too).
+uint32_t jumpml_nr_init_geometry(void *jmpnr_st_ptr, float naturalness, float min_gain,
+                                 unsigned int fft_size, unsigned int hop_length);
+// Samples per jumpml_nr_proc call (per frame of the batch/stream calls), at either sample rate
+int jumpml_nr_frame_size(const void *jmpnr_st_ptr);
 uint32_t jumpml_nr_proc(int16_t *output, int16_t *input, void *jmpnr_st_ptr, int sr);
+// Energy gate (NR_GATE_* in noise_reduction.h): frames below threshold_db bypass the NN;
+// state_decay scales the GRU states on bypassed frames (1: keep). Off after jumpml_nr_init.
+uint32_t jumpml_nr_set_gate(void *jmpnr_st_ptr, int enable, float threshold_db, float state_decay);
+// Delta build (-DUSE_DELTA_SIGNALSIFTER=ON): skip thresholds of the NN, input in Q9 and
+// GRU states in Q15 (DELTA_*_THRESHOLD_* after init; 0/0: dense output). Returns 1 in other builds.
+uint32_t jumpml_nr_set_delta_thresholds(void *jmpnr_st_ptr, int input_threshold, int state_threshold);
+// NN weights, e.g. a SignalSifterModelFile's model (signalsifter_model_file.h); NULL: the
+// compiled-in model. Resets the NN state; the model must outlive the instance. Returns 1
+// if this build cannot run the model (delta build).
+uint32_t jumpml_nr_set_model(void *jmpnr_st_ptr, const SignalSifterModel *model);
+// Any GRU/linear chain instead of the model, e.g. a SignalSifterModelFile's graph
+// (noise_reduction_set_graph); NULL: back to the model. Returns 1 if this build cannot
+// run graphs (int8-activation and delta builds) or the graph does not fit.
+uint32_t jumpml_nr_set_graph(void *jmpnr_st_ptr, const NNGraph *graph);
+// Intra-frame parallel NN for a single low-latency stream (nn_team.h): num_threads threads
+// including the one calling jumpml_nr_proc; the num_threads - 1 helpers spin between frames
+// and are pinned to cpus (NULL: not pinned). Returns 1 if the threads could not be created.
+uint32_t jumpml_nr_team_create(void **team_ptr, int num_threads, const int *cpus);
+void jumpml_nr_team_destroy(void *team_ptr);
+// jumpml_nr_proc of the instance splits its GRU layers across team (NULL: off), same output.
+// A team serves one instance at a time. Returns 1 in the int8-activation and delta builds.
+uint32_t jumpml_nr_set_team(void *jmpnr_st_ptr, void *team_ptr);
+// Layer pipeline for offline/long-latency processing (signalsifter_pipeline.h): gru1..gru3 on
+// SSPIPE_STAGES threads pinned to cpus (NULL: not pinned). Returns 1 if the threads could not be created.
+uint32_t jumpml_nr_pipeline_create(void **pipeline_ptr, const int *cpus);
+void jumpml_nr_pipeline_destroy(void *pipeline_ptr);
+// jumpml_nr_proc_batch of the instance runs its NN on pipeline (NULL: off), same output.
+// A pipeline serves one instance at a time. Returns 1 except in the fixed-point build.
+uint32_t jumpml_nr_set_pipeline(void *jmpnr_st_ptr, void *pipeline_ptr);
+// Decoupled NN (noise_reduction_worker.h): jumpml_nr_proc of the instance only runs the STFT,
+// masking and ISTFT while the NN runs on a worker thread pinned to cpu (-1: not pinned); the
+// gains are applied one frame late. Returns 1 if a worker runs or the thread could not start.
+uint32_t jumpml_nr_worker_start(void *jmpnr_st_ptr, int cpu);
+void jumpml_nr_worker_stop(void *jmpnr_st_ptr);
+void jumpml_nr_worker_stats(const void *jmpnr_st_ptr, NRWorkerStats *stats);
 void run_jumpml_nr_prediction(int16_t *output, int16_t *input, NoiseReductionStatePtr NRst_Ptr, BiquadFilter* hsf);
 
+/* Streaming with any block length: num_samples input samples in, num_samples output samples
+   out, delayed by jumpml_nr_stream_latency() samples. Whole frames are processed as soon as
+   they are complete, straight from input and into output when aligned, otherwise through a
+   one-frame input buffer and an output ring (no memmoves). Do not mix with jumpml_nr_proc
+   on the same instance without jumpml_nr_stream_reset().
+ */
+uint32_t jumpml_nr_proc_stream(int16_t *output, const int16_t *input, int num_samples, void *jmpnr_st_ptr, int sr);
+// Empties the buffers and sets the latency for blocks of block_size samples: frame_size -
+// gcd(block_size, frame_size), e.g. 0 for multiples of the frame size; block_size 0 (any
+// length, the default after init): frame_size - 1. A block that would run the output dry
+// grows the latency (zeros are inserted).
+uint32_t jumpml_nr_stream_reset(void *jmpnr_st_ptr, int block_size);
+// Samples the output of jumpml_nr_proc_stream lags its input by (at the caller's rate)
+int jumpml_nr_stream_latency(const void *jmpnr_st_ptr);
+
+// num_frames consecutive frames of one instance per call (same semantics as jumpml_nr_proc)
+uint32_t jumpml_nr_proc_batch(int16_t *output, const int16_t *input, int num_frames, void *jmpnr_st_ptr, int sr);
+
+// Processes one frame of each of num_streams independently initialized instances
+// (output[k]/input[k]/jmpnr_st_ptrs[k]) of the same frame size; the NN runs batched across streams.
+uint32_t jumpml_nr_proc_streams(int16_t * const *output, int16_t * const *input, void * const *jmpnr_st_ptrs,
+                                int num_streams, int sr);
+// One frame of num_channels interleaved channels (sample i of channel k at i*stride + k) of
+// int16_t or float (JUMPML_NR_FORMAT_*), channel k on instance jmpnr_st_ptrs[k]; output may be input.
+uint32_t jumpml_nr_proc_multi(void *output, const void *input, int format, int num_channels, int stride,
+                              void * const *jmpnr_st_ptrs, int sr);
+// Same layout, linked gains: the NN of jmpnr_st_ptrs[0] runs once on a combined channel
+// (link_mode NR_LINK_MID or NR_LINK_MAX) and its gains mask every channel (up to JUMPML_NR_MAX_LINKED).
+// Returns 1 if jmpnr_st_ptrs[0] runs a graph or an NN worker.
+uint32_t jumpml_nr_proc_linked(void *output, const void *input, int format, int num_channels, int stride,
+                               void * const *jmpnr_st_ptrs, int link_mode, int sr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,70 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  jumpml_nr_chunked.h
+//
+//  Time-chunked offline denoising: a recording is split into chunks of consecutive
+//  frames that are processed in parallel, each by a fresh instance. A chunk first runs
+//  over the warm-up frames before its start (output discarded) so the GRU states, filters
+//  and overlap buffers approach those of the sequential run; the chunk outputs are
+//  stitched at frame boundaries. The first chunk, and any chunk whose warm-up reaches
+//  back to frame 0, is exact; the others deviate until their states have converged.
+//
+#ifndef _JUMPML_NR_CHUNKED_H_
+#define _JUMPML_NR_CHUNKED_H_
+
+#include <stdint.h>
+#include "jumpml_nr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JMPNR_CHUNKED_MAX_THREADS 256
+
+typedef struct {
+    int num_threads;            // threads including the caller (0: one per online CPU)
+    int num_chunks;             // 0: num_threads
+    int warmup_frames;          // frames run before each chunk start, output discarded
+    int verify;                 // 1: also run the sequential pass and report the deviation from it
+    int pin_workers;            // 1: thread i >= 1 runs on CPU cpus[i] (i if cpus is NULL); Linux only
+    const int *cpus;
+} JMPNR_ChunkedConfig;
+
+typedef struct {
+    int num_chunks;
+    int num_threads;
+    uint64_t chunked_ns;        // wall time of the chunked pass
+    uint64_t sequential_ns;     // wall time of the sequential pass (verify)
+    // deviation of the chunked output from the sequential one (verify), in LSB
+    int max_abs_error;
+    double rms_error;           // over all samples
+    uint64_t mismatched_samples;
+    int settle_frames;          // most frames after a chunk start before its output matches for good
+} JMPNR_ChunkedReport;
+
+/* Denoises num_frames frames (jumpml_nr_frame_size() samples each) of input into output
+   with instances of jmpnr_ctx_ptr (jumpml_nr_init_context; NULL: jumpml_nr_init) created
+   with naturalness and min_gain, processed at sample rate sr. report may be NULL. Returns
+   1 if an instance, thread or buffer could not be created.
+ */
+uint32_t jumpml_nr_proc_chunked(int16_t *output, const int16_t *input, int num_frames, void *jmpnr_ctx_ptr,
+                                float naturalness, float min_gain, int sr,
+                                const JMPNR_ChunkedConfig *cfg, JMPNR_ChunkedReport *report);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _JUMPML_NR_CHUNKED_H_ */
@@ -0,0 +1,115 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  jumpml_nr_engine.h
+//
+//  Multi-stream engine: a pool of worker threads processes the frames of many
+//  registered jumpml_nr instances. Frames of one stream run in submission order and
+//  never concurrently. A stream with pending frames is queued on the deque of the
+//  worker that last ran it (its state stays in that core's cache); idle workers steal
+//  streams from the other deques.
+//
+//  Completions are reported through the per-stream done callback and, if configured,
+//  a bounded completion queue that an event loop drains with jumpml_nr_engine_poll()
+//  (optionally woken by an eventfd) instead of blocking on the frames it submitted.
+//
+#ifndef _JUMPML_NR_ENGINE_H_
+#define _JUMPML_NR_ENGINE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "jumpml_nr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JMPNR_ENGINE_MAX_WORKERS 256
+#define JMPNR_ENGINE_QUEUE_FRAMES 8     // default frames a stream can have pending
+
+// Called by the worker after a frame of stream_id was written to its output buffer
+typedef void (*JMPNR_EngineFrameDone)(void *user, int stream_id, int16_t *output);
+
+typedef struct {
+    int num_workers;            // 0: one per online CPU
+    int max_streams;
+    int queue_frames;           // pending frames per stream (0: JMPNR_ENGINE_QUEUE_FRAMES)
+    int pin_workers;            // 1: worker i runs on CPU cpus[i] (i if cpus is NULL); Linux only
+    const int *cpus;
+    int completion_slots;       // completions queued for jumpml_nr_engine_poll (0: none, done callbacks only)
+    int use_eventfd;            // 1: jumpml_nr_engine_eventfd() signals queued completions; Linux only
+} JMPNR_EngineConfig;
+
+typedef struct {
+    int stream_id;
+    int16_t *output;
+    uint64_t tag;               // jumpml_nr_engine_submit_tagged(), 0 for jumpml_nr_engine_submit()
+} JMPNR_Completion;
+
+typedef struct {
+    uint64_t frames;            // frames processed
+    uint64_t busy_ns;           // time spent processing them
+    uint64_t steals;            // streams this worker took from another worker's deque
+} JMPNR_WorkerStats;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t busy_ns;
+    uint64_t dropped;           // jumpml_nr_engine_submit() calls refused (queue full)
+    int last_worker;
+} JMPNR_StreamStats;
+
+// Returns 1 if the threads or memory could not be created
+uint32_t jumpml_nr_engine_create(void **engine_ptr, const JMPNR_EngineConfig *cfg);
+// Waits for the pending frames, stops the workers and frees the engine (not the streams)
+void jumpml_nr_engine_destroy(void *engine_ptr);
+
+// Registers an initialized instance (jumpml_nr_init*) processed at sample rate sr;
+// returns its stream id, or -1 if max_streams are registered. done may be NULL.
+int jumpml_nr_engine_add_stream(void *engine_ptr, void *jmpnr_st_ptr, int sr, JMPNR_EngineFrameDone done, void *user);
+// Waits for the stream's pending frames and unregisters it (the instance is the caller's)
+void jumpml_nr_engine_remove_stream(void *engine_ptr, int stream_id);
+
+/* Queues one frame (jumpml_nr_frame_size() samples, copied) of a stream; output is
+   written by a worker, then done() is called. Several producer threads may submit, but
+   the frames of one stream must come from one thread at a time. Returns 1 (frame
+   dropped) if the stream already has queue_frames pending.
+ */
+uint32_t jumpml_nr_engine_submit(void *engine_ptr, int stream_id, const int16_t *input, int16_t *output);
+// Same, tag is returned with the frame's completion. With a completion queue a frame also
+// counts against completion_slots until it is polled: 1 (dropped) if they are all taken.
+uint32_t jumpml_nr_engine_submit_tagged(void *engine_ptr, int stream_id, const int16_t *input, int16_t *output,
+                                        uint64_t tag);
+// Returns when every frame submitted so far has been processed
+void jumpml_nr_engine_wait(void *engine_ptr);
+
+/* Moves up to max queued completions to completions and returns their number (0: none).
+   Completions of a stream come in submission order. Non-blocking; one polling thread.
+ */
+int jumpml_nr_engine_poll(void *engine_ptr, JMPNR_Completion *completions, int max);
+// Same, but first waits up to timeout_ms (-1: no limit) for a completion
+int jumpml_nr_engine_wait_completions(void *engine_ptr, JMPNR_Completion *completions, int max, int timeout_ms);
+// Non-blocking eventfd, readable while completions are queued (add it to an epoll/poll set
+// and call jumpml_nr_engine_poll() when it fires); -1 without use_eventfd
+int jumpml_nr_engine_eventfd(const void *engine_ptr);
+
+int jumpml_nr_engine_num_workers(const void *engine_ptr);
+void jumpml_nr_engine_worker_stats(const void *engine_ptr, int worker, JMPNR_WorkerStats *stats);
+void jumpml_nr_engine_stream_stats(const void *engine_ptr, int stream_id, JMPNR_StreamStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _JUMPML_NR_ENGINE_H_ */
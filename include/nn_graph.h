@@ -0,0 +1,91 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  nn_graph.h
+//
+//  Generic executor for a chain of GRU and linear layers of any count and width
+//  (up to NNGRAPH_MAX_LAYERS layers of at most JMPNN_MAX_WIDTH units), e.g. a model
+//  loaded at run time. Per-stream state is sized from the graph and lives in caller
+//  memory. The SignalSifter chain (gru1, gru2, gru3, linear1) is one such graph.
+//
+#ifndef NN_GRAPH_H
+#define NN_GRAPH_H
+
+#include <stddef.h>
+#include "nn_layers.h"
+#include "nnlib_fixedpt.h"
+#include "nnlib_float.h"
+#include "signalsifter.h"
+
+#define NNGRAPH_MAX_LAYERS 8
+
+#define NNGRAPH_LAYER_GRU     0
+#define NNGRAPH_LAYER_LINEAR  1
+
+typedef struct {
+    int type;                           // NNGRAPH_LAYER_xxx
+    const GRULayer *gru;                // NNGRAPH_LAYER_GRU
+    const LinearLayer *linear;          // NNGRAPH_LAYER_LINEAR
+    int input_size;
+    int output_size;
+    uint16_t bias_left_shift;           // fixed point: from the Q format of the layer input
+    uint16_t output_right_shift;
+    int state_offset;                   // GRU: first element of its state in the stream state, else -1
+    JMPNN_ActivationFn_S16 activation_S16;  // linear layers, resolved when the layer is added
+    JMPNN_ActivationFn_F32 activation_F32;
+} NNGraphLayer;
+
+// Layer l reads the output of layer l-1 (layer 0: the graph input, Q INPUT_NUM_FRAC_BITS
+// in fixed point); the output of the last layer is the graph output. GRU outputs are
+// Q GRU_NUM_FRAC_BITS, linear outputs Q LIN_NUM_FRAC_BITS.
+typedef struct {
+    int num_layers;
+    NNGraphLayer layers[NNGRAPH_MAX_LAYERS];
+    int input_size;
+    int output_size;
+    int state_len;                      // recurrent state elements per stream
+} NNGraph;
+
+// Per-stream state; state points to caller memory of getNNGraphStateSize[_S16]() bytes
+typedef struct {
+    const NNGraph *graph;
+    int16_t *state;
+} NNGraphState_S16;
+
+typedef struct {
+    const NNGraph *graph;
+    float *state;
+} NNGraphState;
+
+// Builds a graph by appending layers; the layers must outlive it. The add functions
+// return -1 (graph unchanged) if the layer does not fit: too many layers, input size
+// different from the previous output size, wider than JMPNN_MAX_WIDTH or an unknown
+// activation.
+void initNNGraph(NNGraph *g);
+int addNNGraphGRULayer(NNGraph *g, const GRULayer *gru);
+int addNNGraphLinearLayer(NNGraph *g, const LinearLayer *layer);
+int createNNGraphFromSignalSifterModel(NNGraph *g, const SignalSifterModel *model);
+
+size_t getNNGraphStateSize_S16(const NNGraph *g);
+void createNNGraphState_S16(NNGraphState_S16 *st, const NNGraph *g, void *mem);
+void resetNNGraphState_S16(NNGraphState_S16 *st);
+void computeNNGraph_S16(NNGraphState_S16 *st, int16_t *output, const int16_t *input);
+
+size_t getNNGraphStateSize(const NNGraph *g);
+void createNNGraphState(NNGraphState *st, const NNGraph *g, void *mem);
+void resetNNGraphState(NNGraphState *st);
+void computeNNGraph(NNGraphState *st, float *output, const float *input);
+
+#endif /* NN_GRAPH_H */
@@ -20,8 +20,10 @@
 #ifndef NN_LAYERS_H_
 #define NN_LAYERS_H_
 
+#include <stddef.h>
 #include "signalsifter_config.h"
 #include "dsplib.h"
+#include "nnlib_types.h"
 
 typedef struct {
     const nnBias *bias;
@@ -29,6 +31,8 @@ typedef struct {
     int input_size;
     int hidden_size;
     int activation;
+    int layout;          // WEIGHTS_LAYOUT_xxx (0 = row-major)
+    const uint16_t *weights_index;   // BSR4x16 tile index, NULL for dense layouts
 } LinearLayer;
 
 typedef struct {
@@ -39,13 +43,87 @@ typedef struct {
     int input_size;
     int hidden_size;
     int activation;
+    int layout;          // WEIGHTS_LAYOUT_xxx, applies to both weight matrices
+    const uint16_t *input_weights_index;       // BSR4x16 tile indices, NULL for dense layouts
+    const uint16_t *recurrent_weights_index;
 } GRULayer;
 
+// Delta (temporal-difference) inference, fixed-point: column-pair interleaved copies of the
+// weights (packWeightsColumnPairs()), shared by all streams. Row-major layers only.
+typedef struct {
+    const LinearLayer *layer;
+    nnWeight *weights_t;            // COLPAIR [hidden_size x input_size]
+} DeltaLinearLayer;
+
+typedef struct {
+    const GRULayer *gru;
+    nnWeight *input_weights_t;      // COLPAIR [3*hidden_size x input_size]
+    nnWeight *recurrent_weights_t;  // COLPAIR [3*hidden_size x hidden_size]
+} DeltaGRULayer;
+
+// Per-stream delta state: the last propagated input (and state) values, the matching raw
+// products, and the number of weight columns applied out of the total seen.
+typedef struct {
+    int16_t input_ref[MAX_NEURONS];
+    int32_t acc[MAX_NEURONS];
+    uint64_t cols_total;
+    uint64_t cols_applied;
+} DeltaLinearState_S16;
+
+typedef struct {
+    int16_t input_ref[MAX_NEURONS];
+    int16_t state_ref[MAX_NEURONS];
+    int32_t acci[3*MAX_NEURONS];
+    int32_t acch[3*MAX_NEURONS];
+    uint64_t cols_total;
+    uint64_t cols_applied;
+} DeltaGRUState_S16;
+
 void computeLinearLayer(const LinearLayer *layer, float *output, const float *input);
 void computeLinearLayer_S16(const LinearLayer *layer, int16_t *output, const int16_t *input,
                             uint16_t bias_left_shift, uint16_t output_right_shift);
+void computeLinearLayerPreact(const LinearLayer *layer, float *output, const float *input);
+void computeLinearLayerPreact_S16(const LinearLayer *layer, int32_t *output, const int16_t *input,
+                                  uint16_t bias_left_shift, uint16_t output_right_shift);
 void computeGRULayer(const GRULayer *gru, float *state, const float *input);
 void computeGRULayer_S16(const GRULayer *gru, int16_t *state, const int16_t *input,
                          uint16_t Bi_left_shift, uint16_t outi_right_shift,
                          uint16_t Bh_left_shift, uint16_t outh_right_shift);
+
+// Batched (num_streams vectors, stream k at k*stride) fixed-point layers
+void computeLinearLayerBatch_S16(const LinearLayer *layer, int16_t *output, JMPDSP_Stride output_stride,
+                                 const int16_t *input, JMPDSP_Stride input_stride, int num_streams,
+                                 uint16_t bias_left_shift, uint16_t output_right_shift);
+void computeGRULayerBatch_S16(const GRULayer *gru, int16_t *state, JMPDSP_Stride state_stride,
+                              const int16_t *input, JMPDSP_Stride input_stride, int num_streams,
+                              uint16_t Bi_left_shift, uint16_t outi_right_shift,
+                              uint16_t Bh_left_shift, uint16_t outh_right_shift);
+
+// Sequence (one stream, num_frames inputs at t*input_stride, offline/layer-major) fixed-point GRU;
+// the linear layer over a sequence is computeLinearLayerBatch_S16 with frames as streams
+void computeGRULayerSeq_S16(const GRULayer *gru, int16_t *state, int16_t *output, JMPDSP_Stride output_stride,
+                            const int16_t *input, JMPDSP_Stride input_stride, int num_frames,
+                            uint16_t Bi_left_shift, uint16_t outi_right_shift,
+                            uint16_t Bh_left_shift, uint16_t outh_right_shift);
+
+// Int8-activation fixed-point layers (int8 inputs/states with per-layer frac bits)
+void computeLinearLayer_S8(const LinearLayer *layer, int16_t *output, const int8_t *input, uint16_t input_frac_bits);
+void computeGRULayer_S8(const GRULayer *gru, int8_t *state, const int8_t *input,
+                        uint16_t input_frac_bits, uint16_t state_frac_bits);
+
+// Delta fixed-point layers: only the weight columns whose input (state) element moved by more
+// than input_threshold (state_threshold) since it was last propagated are applied. Thresholds
+// of 0 give the same output as computeLinearLayer_S16/computeGRULayer_S16.
+int createDeltaLinearLayer(DeltaLinearLayer *dl, const LinearLayer *layer);
+void destroyDeltaLinearLayer(DeltaLinearLayer *dl);
+int createDeltaGRULayer(DeltaGRULayer *dl, const GRULayer *gru);
+void destroyDeltaGRULayer(DeltaGRULayer *dl);
+void resetDeltaLinearState_S16(DeltaLinearState_S16 *ds);
+void resetDeltaGRUState_S16(DeltaGRUState_S16 *ds);
+void computeDeltaLinearLayer_S16(const DeltaLinearLayer *dl, DeltaLinearState_S16 *ds, int16_t *output, const int16_t *input,
+                                 int16_t input_threshold, uint16_t bias_left_shift, uint16_t output_right_shift);
+void computeDeltaGRULayer_S16(const DeltaGRULayer *dl, DeltaGRUState_S16 *ds, int16_t *state, const int16_t *input,
+                              int16_t input_threshold, int16_t state_threshold,
+                              uint16_t Bi_left_shift, uint16_t outi_right_shift,
+                              uint16_t Bh_left_shift, uint16_t outh_right_shift);
 #endif /* NN_LAYERS_H_ */
@@ -22,6 +22,7 @@
 
 #include "signalsifter_config.h"
 #include "dsplib.h"
+#include "nnlib_types.h"
 
 typedef struct {
     unsigned int m;
@@ -55,4 +56,23 @@ void initLayerQParams(LayerQParams *lqp, int numFracBits, int numBits, int round
 void applyLayerQuantization(LayerQParams *lqp, float *A, JMPDSP_Stride iA, JMPDSP_Length N);
 void computeLayerStats(LayerStats *ls, const float *A, JMPDSP_Stride iA, JMPDSP_Length N);
 
+// Repacks a row-major [rows x cols] weight matrix into WEIGHTS_LAYOUT_TILED4x16.
+// dst must hold JMPNN_TILED4x16_ROWS(rows)*JMPNN_TILED4x16_COLS(cols) weights.
+// For GRU weights (3 stacked gates) rows = 3*hidden_size, with hidden_size a multiple of 4.
+void packWeightsTiled4x16(nnWeight *dst, const nnWeight *src, int rows, int cols);
+
+// Packs the non-zero 4x16 tiles of a row-major [rows x cols] matrix into WEIGHTS_LAYOUT_BSR4x16.
+// dst must hold 64 weights per non-zero tile (at most the TILED4x16 size) and index
+// JMPNN_BSR4x16_INDEX_LEN(rows, num_tiles) entries. Returns the number of stored tiles.
+int packWeightsBSR4x16(nnWeight *dst, uint16_t *index, const nnWeight *src, int rows, int cols);
+
+// Magnitude-based block pruning (in place): zeroes the fraction sparsity of the 4x16
+// tiles with the smallest L1 norm. Returns the number of pruned tiles. convert_model.py
+// does the same on the float weights when generating a BSR4x16 model.
+int pruneWeightsBlocks4x16(nnWeight *W, int rows, int cols, float sparsity);
+
+// Column-pair interleaved copy (WEIGHTS COLPAIR, see nnlib_types.h) of a row-major
+// [rows x cols] matrix, used by the delta kernels. dst holds rows*JMPNN_COLPAIR_COLS(cols).
+void packWeightsColumnPairs(nnWeight *dst, const nnWeight *src, int rows, int cols);
+
 #endif /* NN_LAYERS_TOOLS_H_ */
@@ -0,0 +1,50 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  nn_team.h
+//
+//  Intra-frame parallelism for one stream: a team of helper threads that splits the
+//  rows of a GRU cell with the calling thread. The helpers spin (then yield) between
+//  tasks so a frame does not pay a wake-up; give them dedicated cores.
+//
+#ifndef NN_TEAM_H_
+#define NN_TEAM_H_
+
+#define NNTEAM_MAX_THREADS 64
+#define NNTEAM_UNIT_ALIGN  8    // hidden units per chunk are a multiple of this (8-lane kernels stay bit-exact)
+
+typedef struct NNTeam NNTeam;
+
+// Runs on every member; the calling thread of runNNTeam() is member 0
+typedef void (*NNTeamTask)(void *arg, int member, int num_members);
+
+// num_threads members including the caller (2..NNTEAM_MAX_THREADS), so num_threads - 1
+// helper threads; cpus (NULL: not pinned) has one CPU per helper. Returns 0, or -1.
+int createNNTeam(NNTeam **team, int num_threads, const int *cpus);
+void destroyNNTeam(NNTeam *team);
+int getNNTeamSize(const NNTeam *team);
+
+// Runs task on all members and returns when every member is done. One caller at a time.
+void runNNTeam(NNTeam *team, NNTeamTask task, void *arg);
+
+// Units [begin, end) of member out of n units, in chunks of NNTEAM_UNIT_ALIGN; may be empty
+void getNNTeamRange(int n, int member, int num_members, int *begin, int *end);
+
+// GRU layers computed on the calling thread use team (NULL: serial). Row-major layers whose
+// hidden size is a multiple of NNTEAM_UNIT_ALIGN are split; the result is bit-exact.
+void setNNLayerTeam(NNTeam *team);
+NNTeam *getNNLayerTeam(void);
+
+#endif /* NN_TEAM_H_ */
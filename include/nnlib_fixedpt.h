@@ -23,6 +23,7 @@
 
 #include "nnlib_types.h"
 #include "tanh_table_S16.h"
+#include "tanh_rational.h"
 #include <math.h>
 #include "common_def.h"
 #include "fixed_point_math.h"
@@ -34,16 +35,66 @@
 #define JMPNN_gru_matXvec_S8xS16_S16_act JMPNN_gru_matXvec_S8xS16_S16_act_hifi5
 #define JMPNN_gru_newGate_S8xS16_S16_act JMPNN_gru_newGate_S8xS16_S16_act_hifi5
 #define JMPNN_apply_activation_S16       JMPNN_apply_activation_S16_generic
+#define JMPNN_get_activation_S16         JMPNN_get_activation_S16_generic
 #define JMPNN_vec_interpolation_S16      JMPNN_vec_interpolation_S16_generic
+#define JMPNN_gru_cell_S8xS16_S16        JMPNN_gru_cell_S8xS16_S16_generic
+#define JMPNN_gru_gates_S8xS16_S16       JMPNN_gru_gates_S8xS16_S16_generic
+#define JMPNN_linear_matXvec_S8xS16_S32_tiled JMPNN_linear_matXvec_S8xS16_S32_tiled_generic
+#define JMPNN_gru_cell_S8xS16_S16_tiled       JMPNN_gru_cell_S8xS16_S16_tiled_generic
+#define JMPNN_linear_matXmat_S8xS16_S32       JMPNN_linear_matXmat_S8xS16_S32_generic
+#define JMPNN_gru_cell_batch_S8xS16_S16       JMPNN_gru_cell_batch_S8xS16_S16_generic
+#define JMPNN_gru_seq_S8xS16_S16              JMPNN_gru_seq_S8xS16_S16_generic
+#define JMPNN_linear_matXvec_S8xS8_S32        JMPNN_linear_matXvec_S8xS8_S32_generic
+#define JMPNN_gru_cell_S8xS8_S8               JMPNN_gru_cell_S8xS8_S8_generic
+#define JMPNN_linear_matXvec_S8xS16_S32_bsr   JMPNN_linear_matXvec_S8xS16_S32_bsr_generic
+#define JMPNN_gru_cell_S8xS16_S16_bsr         JMPNN_gru_cell_S8xS16_S16_bsr_generic
+#define JMPNN_linear_matXvec_delta_S8xS16_S32 JMPNN_linear_matXvec_delta_S8xS16_S32_generic
+#define JMPNN_gru_cell_delta_S8xS16_S16       JMPNN_gru_cell_delta_S8xS16_S16_generic
+#elif JMPNN_USE_X86_DISPATCH
+#define JMPNN_linear_matXvec_S8xS16_S32  (*JMPNN_linear_matXvec_S8xS16_S32_ptr)
+#define JMPNN_gru_matXvec_S8xS16_S16_act (*JMPNN_gru_matXvec_S8xS16_S16_act_ptr)
+#define JMPNN_gru_newGate_S8xS16_S16_act (*JMPNN_gru_newGate_S8xS16_S16_act_ptr)
+#define JMPNN_apply_activation_S16       (*JMPNN_apply_activation_S16_ptr)
+#define JMPNN_get_activation_S16         (*JMPNN_get_activation_S16_ptr)
+#define JMPNN_vec_interpolation_S16      (*JMPNN_vec_interpolation_S16_ptr)
+#define JMPNN_gru_cell_S8xS16_S16        (*JMPNN_gru_cell_S8xS16_S16_ptr)
+#define JMPNN_gru_gates_S8xS16_S16       (*JMPNN_gru_gates_S8xS16_S16_ptr)
+#define JMPNN_linear_matXvec_S8xS16_S32_tiled (*JMPNN_linear_matXvec_S8xS16_S32_tiled_ptr)
+#define JMPNN_gru_cell_S8xS16_S16_tiled       (*JMPNN_gru_cell_S8xS16_S16_tiled_ptr)
+#define JMPNN_linear_matXmat_S8xS16_S32       (*JMPNN_linear_matXmat_S8xS16_S32_ptr)
+#define JMPNN_gru_cell_batch_S8xS16_S16       (*JMPNN_gru_cell_batch_S8xS16_S16_ptr)
+#define JMPNN_gru_seq_S8xS16_S16              (*JMPNN_gru_seq_S8xS16_S16_ptr)
+#define JMPNN_linear_matXvec_S8xS8_S32        (*JMPNN_linear_matXvec_S8xS8_S32_ptr)
+#define JMPNN_gru_cell_S8xS8_S8               (*JMPNN_gru_cell_S8xS8_S8_ptr)
+#define JMPNN_linear_matXvec_S8xS16_S32_bsr   (*JMPNN_linear_matXvec_S8xS16_S32_bsr_ptr)
+#define JMPNN_gru_cell_S8xS16_S16_bsr         (*JMPNN_gru_cell_S8xS16_S16_bsr_ptr)
+#define JMPNN_linear_matXvec_delta_S8xS16_S32 (*JMPNN_linear_matXvec_delta_S8xS16_S32_ptr)
+#define JMPNN_gru_cell_delta_S8xS16_S16       (*JMPNN_gru_cell_delta_S8xS16_S16_ptr)
 #else
 #define JMPNN_linear_matXvec_S8xS16_S32  JMPNN_linear_matXvec_S8xS16_S32_generic
 #define JMPNN_gru_matXvec_S8xS16_S16_act JMPNN_gru_matXvec_S8xS16_S16_act_generic
 #define JMPNN_gru_newGate_S8xS16_S16_act JMPNN_gru_newGate_S8xS16_S16_act_generic
 #define JMPNN_apply_activation_S16       JMPNN_apply_activation_S16_generic
+#define JMPNN_get_activation_S16         JMPNN_get_activation_S16_generic
 #define JMPNN_vec_interpolation_S16      JMPNN_vec_interpolation_S16_generic
+#define JMPNN_gru_cell_S8xS16_S16        JMPNN_gru_cell_S8xS16_S16_generic
+#define JMPNN_gru_gates_S8xS16_S16       JMPNN_gru_gates_S8xS16_S16_generic
+#define JMPNN_linear_matXvec_S8xS16_S32_tiled JMPNN_linear_matXvec_S8xS16_S32_tiled_generic
+#define JMPNN_gru_cell_S8xS16_S16_tiled       JMPNN_gru_cell_S8xS16_S16_tiled_generic
+#define JMPNN_linear_matXmat_S8xS16_S32       JMPNN_linear_matXmat_S8xS16_S32_generic
+#define JMPNN_gru_cell_batch_S8xS16_S16       JMPNN_gru_cell_batch_S8xS16_S16_generic
+#define JMPNN_gru_seq_S8xS16_S16              JMPNN_gru_seq_S8xS16_S16_generic
+#define JMPNN_linear_matXvec_S8xS8_S32        JMPNN_linear_matXvec_S8xS8_S32_generic
+#define JMPNN_gru_cell_S8xS8_S8               JMPNN_gru_cell_S8xS8_S8_generic
+#define JMPNN_linear_matXvec_S8xS16_S32_bsr   JMPNN_linear_matXvec_S8xS16_S32_bsr_generic
+#define JMPNN_gru_cell_S8xS16_S16_bsr         JMPNN_gru_cell_S8xS16_S16_bsr_generic
+#define JMPNN_linear_matXvec_delta_S8xS16_S32 JMPNN_linear_matXvec_delta_S8xS16_S32_generic
+#define JMPNN_gru_cell_delta_S8xS16_S16       JMPNN_gru_cell_delta_S8xS16_S16_generic
 #endif
 
-static inline int16_t tanh_approx_S16(int32_t x_Q16_15)
+// Table-based tanh, Q3.15 in / Q15 out. The bit-exact reference (matches the HiFi and
+// Python fixed-point models), used unless USE_FAST_ACTIVATIONS is defined.
+static inline int16_t tanh_table_approx_S16(int32_t x_Q16_15)
 {
     int i;
     int32_t x = x_Q16_15; // Actually Q3.15
@@ -73,11 +124,38 @@ static inline int16_t tanh_approx_S16(int32_t x_Q16_15)
     return sign * y;
 }
 
+// Branch-free tanh, Q3.15 in / Q15 out: tanh_rational() on the float value, rounded with
+// floor(y*2^15 + 0.5) and saturated to 32767. Max error vs tanh is < 1 LSB (the table version
+// is ~3.5 LSB). The AVX2 kernel does the same float operations and matches it bit-exactly as
+// long as neither is compiled with FMA contraction (e.g. -march=native).
+static inline int16_t tanh_rational_S16(int32_t x_Q3_15)
+{
+    float y = tanh_rational((float)x_Q3_15 * (1.0f / 32768));
+    int32_t v = (int32_t)(y * 32768.0f + 32768.5f) - 32768;  // y >= -1, so the sum is positive
+    return (int16_t)MIN(32767, v);
+}
+
+static inline int16_t tanh_approx_S16(int32_t x_Q16_15)
+{
+#ifdef USE_FAST_ACTIVATIONS
+    return tanh_rational_S16(x_Q16_15);
+#else
+    return tanh_table_approx_S16(x_Q16_15);
+#endif
+}
+
 static inline int16_t sigmoid_approx_S16(int32_t x_Q15_16)
 {
     return (0x4000 + (tanh_approx_S16(x_Q15_16>>1) >> 1));
 }
 
+// Q15 value to int8 with round-to-nearest and symmetric saturation to [-127, 127]
+static inline int8_t quantize_S15toS8(int32_t x, uint16_t frac_bits)
+{
+    int shift = 15 - frac_bits;
+    return (int8_t) MAX(-127, SLIMIT((x + (1 << (shift - 1))) >> shift, 8));
+}
+
 static inline int16_t relu_S16(int32_t x)
 {
     return x < 0 ? 0 : x;
@@ -111,6 +189,19 @@ static inline void vec_relu_S16(int16_t *output, const int32_t *input, JMPDSP_Le
     }
 }
 
+static inline void vec_linear_S16(int16_t *output, const int32_t *input, JMPDSP_Length N)
+{
+    int i;
+    for (i=0;i<N;i++)
+    {
+        output[i] = SLIMIT(input[i], 16);
+    }
+}
+
+// Activation of a layer, resolved once from its ACTIVATION_xxx by JMPNN_get_activation_S16()
+// (NULL for an unknown type) instead of on every call as JMPNN_apply_activation_S16() does
+typedef void (*JMPNN_ActivationFn_S16)(int16_t *output, const int32_t *input, JMPDSP_Length N);
+
 void JMPNN_linear_matXvec_S8xS16_S32_generic(const int8_t *W, const int16_t *input, const int8_t *bias,
                                      int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
                                      uint16_t bias_left_shift, uint16_t output_right_shift);
@@ -131,11 +222,99 @@ void JMPNN_gru_newGate_S8xS16_S16_act_generic(const int8_t *Wi, const int16_t *i
 
 
 void JMPNN_apply_activation_S16_generic(int16_t *output, int32_t *input, JMPDSP_Length N, JMPNN_ActivationType actType);
+JMPNN_ActivationFn_S16 JMPNN_get_activation_S16_generic(JMPNN_ActivationType actType);
 
 void JMPNN_vec_interpolation_S16_generic(int16_t *output, const int16_t *interp_vec,
                                  const int16_t *input1, const int16_t *input2,
                                  JMPDSP_Length len);
 
+// Fused GRU cell (r, z, n gates and state update in one sweep over the stacked weights)
+void JMPNN_gru_cell_S8xS16_S16_generic(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+// Gates of the fused GRU cell for hidden units [unit_begin, unit_end) only: writes z[i] and
+// the new gate n[i]; state is not updated (JMPNN_vec_interpolation_S16(state, z, state, n, N)
+// completes the cell once every unit range is done). Used to split a cell across threads.
+void JMPNN_gru_gates_S8xS16_S16_generic(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, const int16_t *state, const int8_t *Bh,
+                                       int16_t *z, int16_t *n,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+
+// Same as above for weights in the WEIGHTS_LAYOUT_TILED4x16 layout
+void JMPNN_linear_matXvec_S8xS16_S32_tiled_generic(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+void JMPNN_gru_cell_S8xS16_S16_tiled_generic(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+
+// Same as above for weights in the WEIGHTS_LAYOUT_BSR4x16 (block-sparse) layout; zero tiles are skipped
+void JMPNN_linear_matXvec_S8xS16_S32_bsr_generic(const int8_t *W, const uint16_t *W_index, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+void JMPNN_gru_cell_S8xS16_S16_bsr_generic(const int8_t *Wi, const uint16_t *Wi_index, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, const uint16_t *Wh_index, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+
+// Delta (temporal-difference) inference on column-pair interleaved weights (COLPAIR,
+// see packWeightsColumnPairs()). acc/acci/acch hold the raw products W*input_ref of the last
+// propagated inputs; only the columns whose input moved by more than threshold since are
+// applied (acc += Wt[j]*(input[j] - input_ref[j]), input_ref[j] = input[j]). With threshold 0
+// the result is bit-exact with the dense kernels. Return the number of applied columns.
+int JMPNN_linear_matXvec_delta_S8xS16_S32_generic(const int8_t *Wt, const int16_t *input, int16_t *input_ref, int32_t *acc,
+                                     const int8_t *bias, int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     int16_t threshold, uint16_t bias_left_shift, uint16_t output_right_shift);
+int JMPNN_gru_cell_delta_S8xS16_S16_generic(const int8_t *Wi_t, const int16_t *input, int16_t *input_ref, int32_t *acci, const int8_t *Bi,
+                                       const int8_t *Wh_t, int16_t *state, int16_t *state_ref, int32_t *acch, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       int16_t input_threshold, int16_t state_threshold,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+
+// Batched versions: num_streams input/state vectors (stream k at k*stride) share one pass over the weights
+void JMPNN_linear_matXmat_S8xS16_S32_generic(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                     JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+void JMPNN_gru_cell_batch_S8xS16_S16_generic(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_streams,
+                                       JMPDSP_Stride input_stride, JMPDSP_Stride state_stride,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+
+// Sequence (one stream, num_frames consecutive inputs at t*input_stride): the input
+// projections Wi*x_t are computed JMPNN_SEQ_BLOCK frames at a time as one GEMM and only
+// Wh*h_{t-1} runs frame by frame. h_t is written to output[t*output_stride]; state holds
+// h_{-1} on entry and the last h_t on return. Bit-exact with num_frames GRU cell calls.
+void JMPNN_gru_seq_S8xS16_S16_generic(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh, int16_t *output,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_frames,
+                                       JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+
+// Int8 activations (optional USE_INT8_SIGNALSIFTER mode): int8 inputs/states with per-layer
+// frac bits (input_frac_bits, state_frac_bits <= 8) against Q7 weights. Gate and linear outputs
+// are produced in the Q15 domain of the S16 path (SLIMIT 19-bit); states saturate to [-127, 127].
+void JMPNN_linear_matXvec_S8xS8_S32_generic(const int8_t *W, const int8_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t input_frac_bits);
+void JMPNN_gru_cell_S8xS8_S8_generic(const int8_t *Wi, const int8_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int8_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t input_frac_bits, uint16_t state_frac_bits,
+                                       JMPNN_ActivationType actType);
+
 #if XCHAL_HAVE_HIFI5 
 void JMPNN_linear_matXvec_S8xS16_S32_hifi5(const int8_t *W, const int16_t *input, const int8_t *bias,
                                      int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
@@ -155,4 +334,184 @@ void JMPNN_gru_newGate_S8xS16_S16_act_hifi5(const int8_t *Wi, const int16_t *inp
                                       JMPNN_ActivationType actType);
 #endif
 
+#if JMPNN_USE_X86_DISPATCH
+void JMPNN_linear_matXvec_S8xS16_S32_avx2(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+
+
+void JMPNN_gru_matXvec_S8xS16_S16_act_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                      const int8_t *Wh, const int16_t *prev_state, const int8_t *Bh,
+                                      int16_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                      JMPNN_ActivationType actType); // used for reset/update gates
+
+void JMPNN_gru_newGate_S8xS16_S16_act_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                      const int8_t *Wh, const int16_t *prev_state, const int8_t *Bh, const int16_t *r,
+                                      int16_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                      JMPNN_ActivationType actType);
+
+void JMPNN_apply_activation_S16_avx2(int16_t *output, int32_t *input, JMPDSP_Length N, JMPNN_ActivationType actType);
+JMPNN_ActivationFn_S16 JMPNN_get_activation_S16_avx2(JMPNN_ActivationType actType);
+
+void JMPNN_vec_interpolation_S16_avx2(int16_t *output, const int16_t *interp_vec,
+                                 const int16_t *input1, const int16_t *input2,
+                                 JMPDSP_Length len);
+
+void JMPNN_gru_cell_S8xS16_S16_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+void JMPNN_gru_gates_S8xS16_S16_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, const int16_t *state, const int8_t *Bh,
+                                       int16_t *z, int16_t *n,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+void JMPNN_linear_matXvec_S8xS16_S32_tiled_avx2(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+void JMPNN_gru_cell_S8xS16_S16_tiled_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+void JMPNN_linear_matXvec_S8xS16_S32_bsr_avx2(const int8_t *W, const uint16_t *W_index, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+void JMPNN_gru_cell_S8xS16_S16_bsr_avx2(const int8_t *Wi, const uint16_t *Wi_index, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, const uint16_t *Wh_index, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+int JMPNN_linear_matXvec_delta_S8xS16_S32_avx2(const int8_t *Wt, const int16_t *input, int16_t *input_ref, int32_t *acc,
+                                     const int8_t *bias, int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     int16_t threshold, uint16_t bias_left_shift, uint16_t output_right_shift);
+int JMPNN_gru_cell_delta_S8xS16_S16_avx2(const int8_t *Wi_t, const int16_t *input, int16_t *input_ref, int32_t *acci, const int8_t *Bi,
+                                       const int8_t *Wh_t, int16_t *state, int16_t *state_ref, int32_t *acch, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       int16_t input_threshold, int16_t state_threshold,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+void JMPNN_linear_matXmat_S8xS16_S32_avx2(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                     JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+void JMPNN_gru_cell_batch_S8xS16_S16_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_streams,
+                                       JMPDSP_Stride input_stride, JMPDSP_Stride state_stride,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+void JMPNN_gru_seq_S8xS16_S16_avx2(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh, int16_t *output,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_frames,
+                                       JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+void JMPNN_linear_matXvec_S8xS8_S32_avx2(const int8_t *W, const int8_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t input_frac_bits);
+void JMPNN_gru_cell_S8xS8_S8_avx2(const int8_t *Wi, const int8_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int8_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t input_frac_bits, uint16_t state_frac_bits,
+                                       JMPNN_ActivationType actType);
+
+// Runtime kernel selection. JMPNN_select_kernels_S16() checks CPUID once (it
+// runs at load time); the pointers start out on a resolver that calls it, in
+// case a kernel is needed before that.
+extern void (*JMPNN_linear_matXvec_S8xS16_S32_ptr)(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+
+extern void (*JMPNN_gru_matXvec_S8xS16_S16_act_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                      const int8_t *Wh, const int16_t *prev_state, const int8_t *Bh,
+                                      int16_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                      JMPNN_ActivationType actType);
+
+extern void (*JMPNN_gru_newGate_S8xS16_S16_act_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                      const int8_t *Wh, const int16_t *prev_state, const int8_t *Bh, const int16_t *r,
+                                      int16_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                      JMPNN_ActivationType actType);
+
+extern void (*JMPNN_apply_activation_S16_ptr)(int16_t *output, int32_t *input, JMPDSP_Length N, JMPNN_ActivationType actType);
+extern JMPNN_ActivationFn_S16 (*JMPNN_get_activation_S16_ptr)(JMPNN_ActivationType actType);
+
+extern void (*JMPNN_vec_interpolation_S16_ptr)(int16_t *output, const int16_t *interp_vec,
+                                 const int16_t *input1, const int16_t *input2,
+                                 JMPDSP_Length len);
+
+extern void (*JMPNN_gru_cell_S8xS16_S16_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern void (*JMPNN_gru_gates_S8xS16_S16_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, const int16_t *state, const int8_t *Bh,
+                                       int16_t *z, int16_t *n,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern void (*JMPNN_linear_matXvec_S8xS16_S32_tiled_ptr)(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+extern void (*JMPNN_gru_cell_S8xS16_S16_tiled_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern void (*JMPNN_linear_matXvec_S8xS16_S32_bsr_ptr)(const int8_t *W, const uint16_t *W_index, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+extern void (*JMPNN_gru_cell_S8xS16_S16_bsr_ptr)(const int8_t *Wi, const uint16_t *Wi_index, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, const uint16_t *Wh_index, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern int (*JMPNN_linear_matXvec_delta_S8xS16_S32_ptr)(const int8_t *Wt, const int16_t *input, int16_t *input_ref, int32_t *acc,
+                                     const int8_t *bias, int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     int16_t threshold, uint16_t bias_left_shift, uint16_t output_right_shift);
+extern int (*JMPNN_gru_cell_delta_S8xS16_S16_ptr)(const int8_t *Wi_t, const int16_t *input, int16_t *input_ref, int32_t *acci, const int8_t *Bi,
+                                       const int8_t *Wh_t, int16_t *state, int16_t *state_ref, int32_t *acch, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       int16_t input_threshold, int16_t state_threshold,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern void (*JMPNN_linear_matXmat_S8xS16_S32_ptr)(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                     JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                     uint16_t bias_left_shift, uint16_t output_right_shift);
+extern void (*JMPNN_gru_cell_batch_S8xS16_S16_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_streams,
+                                       JMPDSP_Stride input_stride, JMPDSP_Stride state_stride,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern void (*JMPNN_gru_seq_S8xS16_S16_ptr)(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int16_t *state, const int8_t *Bh, int16_t *output,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_frames,
+                                       JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType);
+extern void (*JMPNN_linear_matXvec_S8xS8_S32_ptr)(const int8_t *W, const int8_t *input, const int8_t *bias,
+                                     int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     uint16_t input_frac_bits);
+extern void (*JMPNN_gru_cell_S8xS8_S8_ptr)(const int8_t *Wi, const int8_t *input, const int8_t *Bi,
+                                       const int8_t *Wh, int8_t *state, const int8_t *Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t input_frac_bits, uint16_t state_frac_bits,
+                                       JMPNN_ActivationType actType);
+
+int JMPNN_cpu_has_avx2(void);
+int JMPNN_cpu_has_avxvnni(void);
+void JMPNN_select_kernels_S16(void);
+#endif
+
 #endif /* NNLIB_FIXEDPT_H */
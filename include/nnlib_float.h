@@ -23,10 +23,54 @@
 
 #include "nnlib_types.h"
 #include "tanh_table.h"
+#include "tanh_rational.h"
 #include <math.h>
 #include "common_def.h"
 
-static inline float tanh_approx(float x)
+#ifdef USE_NEON
+#define JMPNN_linear_matXvec_S8xF32_F32  JMPNN_linear_matXvec_S8xF32_F32_neon
+#define JMPNN_gru_matXvec_S8xF32_F32_act JMPNN_gru_matXvec_S8xF32_F32_act_neon
+#define JMPNN_gru_newGate_S8xF32_F32_act JMPNN_gru_newGate_S8xF32_F32_act_neon
+#define JMPNN_apply_activation_F32       JMPNN_apply_activation_F32_generic
+#define JMPNN_get_activation_F32         JMPNN_get_activation_F32_generic
+#define JMPNN_vec_interpolation_F32      JMPNN_vec_interpolation_F32_generic
+#define JMPNN_gru_cell_S8xF32_F32        JMPNN_gru_cell_S8xF32_F32_generic
+#define JMPNN_gru_gates_S8xF32_F32       JMPNN_gru_gates_S8xF32_F32_generic
+#define JMPNN_linear_matXvec_S8xF32_F32_tiled JMPNN_linear_matXvec_S8xF32_F32_tiled_generic
+#define JMPNN_gru_cell_S8xF32_F32_tiled       JMPNN_gru_cell_S8xF32_F32_tiled_generic
+#define JMPNN_linear_matXvec_S8xF32_F32_bsr   JMPNN_linear_matXvec_S8xF32_F32_bsr_generic
+#define JMPNN_gru_cell_S8xF32_F32_bsr         JMPNN_gru_cell_S8xF32_F32_bsr_generic
+#elif JMPNN_USE_X86_DISPATCH
+#define JMPNN_linear_matXvec_S8xF32_F32  (*JMPNN_linear_matXvec_S8xF32_F32_ptr)
+#define JMPNN_gru_matXvec_S8xF32_F32_act (*JMPNN_gru_matXvec_S8xF32_F32_act_ptr)
+#define JMPNN_gru_newGate_S8xF32_F32_act (*JMPNN_gru_newGate_S8xF32_F32_act_ptr)
+#define JMPNN_apply_activation_F32       (*JMPNN_apply_activation_F32_ptr)
+#define JMPNN_get_activation_F32         (*JMPNN_get_activation_F32_ptr)
+#define JMPNN_vec_interpolation_F32      (*JMPNN_vec_interpolation_F32_ptr)
+#define JMPNN_gru_cell_S8xF32_F32        (*JMPNN_gru_cell_S8xF32_F32_ptr)
+#define JMPNN_gru_gates_S8xF32_F32       (*JMPNN_gru_gates_S8xF32_F32_ptr)
+#define JMPNN_linear_matXvec_S8xF32_F32_tiled (*JMPNN_linear_matXvec_S8xF32_F32_tiled_ptr)
+#define JMPNN_gru_cell_S8xF32_F32_tiled       (*JMPNN_gru_cell_S8xF32_F32_tiled_ptr)
+#define JMPNN_linear_matXvec_S8xF32_F32_bsr   (*JMPNN_linear_matXvec_S8xF32_F32_bsr_ptr)
+#define JMPNN_gru_cell_S8xF32_F32_bsr         (*JMPNN_gru_cell_S8xF32_F32_bsr_ptr)
+#else
+#define JMPNN_linear_matXvec_S8xF32_F32  JMPNN_linear_matXvec_S8xF32_F32_generic
+#define JMPNN_gru_matXvec_S8xF32_F32_act JMPNN_gru_matXvec_S8xF32_F32_act_generic
+#define JMPNN_gru_newGate_S8xF32_F32_act JMPNN_gru_newGate_S8xF32_F32_act_generic
+#define JMPNN_apply_activation_F32       JMPNN_apply_activation_F32_generic
+#define JMPNN_get_activation_F32         JMPNN_get_activation_F32_generic
+#define JMPNN_vec_interpolation_F32      JMPNN_vec_interpolation_F32_generic
+#define JMPNN_gru_cell_S8xF32_F32        JMPNN_gru_cell_S8xF32_F32_generic
+#define JMPNN_gru_gates_S8xF32_F32       JMPNN_gru_gates_S8xF32_F32_generic
+#define JMPNN_linear_matXvec_S8xF32_F32_tiled JMPNN_linear_matXvec_S8xF32_F32_tiled_generic
+#define JMPNN_gru_cell_S8xF32_F32_tiled       JMPNN_gru_cell_S8xF32_F32_tiled_generic
+#define JMPNN_linear_matXvec_S8xF32_F32_bsr   JMPNN_linear_matXvec_S8xF32_F32_bsr_generic
+#define JMPNN_gru_cell_S8xF32_F32_bsr         JMPNN_gru_cell_S8xF32_F32_bsr_generic
+#endif
+
+// Table-based tanh (tanh_table.h, 2nd-order correction between entries). The default;
+// USE_FAST_ACTIVATIONS switches the kernels to tanh_rational().
+static inline float tanh_table_approx(float x)
 {
     int i;
     float y, dy;
@@ -48,6 +92,15 @@ static inline float tanh_approx(float x)
     return sign*y;
 }
 
+static inline float tanh_approx(float x)
+{
+#ifdef USE_FAST_ACTIVATIONS
+    return tanh_rational(x);
+#else
+    return tanh_table_approx(x);
+#endif
+}
+
 static inline float sigmoid_approx(float x)
 {
     return 0.5f + 0.5f * tanh_approx(0.5f*x);
@@ -85,26 +138,190 @@ static inline void vec_relu_F32(float *output, const float *input, JMPDSP_Length
     }
 }
 
+static inline void vec_linear_F32(float *output, const float *input, JMPDSP_Length N)
+{
+    int i;
+    if (output == input)
+        return;
+    for (i=0;i<N;i++)
+    {
+        output[i] = input[i];
+    }
+}
+
+// Activation of a layer, resolved once from its ACTIVATION_xxx by JMPNN_get_activation_F32()
+// (NULL for an unknown type); output may be input
+typedef void (*JMPNN_ActivationFn_F32)(float *output, const float *input, JMPDSP_Length N);
+
 // FLOATING-POINT ARITHMETIC (FIXED-POINT PARAMETERS)
-void JMPNN_linear_matXvec_S8xF32_F32(const int8_t *W, const float *input, const int8_t *bias,
+void JMPNN_linear_matXvec_S8xF32_F32_generic(const int8_t *W, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+
+
+void JMPNN_gru_matXvec_S8xF32_F32_act_generic(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *prev_state, const int8_t *Bh,
+                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType); // used for reset/update gates
+
+void JMPNN_gru_newGate_S8xF32_F32_act_generic(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *prev_state, const int8_t *Bh, const float *r,
+                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len, 
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+void JMPNN_apply_activation_F32_generic(float *data, JMPDSP_Length N, JMPNN_ActivationType actType);
+JMPNN_ActivationFn_F32 JMPNN_get_activation_F32_generic(JMPNN_ActivationType actType);
+void JMPNN_vec_interpolation_F32_generic(float *output, const float *interp_vec,
+                                 const float *input1, const float *input2,
+                                 JMPDSP_Length N);
+
+// Fused GRU cell (r, z, n gates and state update in one sweep over the stacked weights)
+void JMPNN_gru_cell_S8xF32_F32_generic(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+// Gates z and n of hidden units [unit_begin, unit_end) of the fused cell, state not updated
+// (see JMPNN_gru_gates_S8xS16_S16). Bit-exact with the fused cell when hidden_len, unit_begin
+// and unit_end are multiples of 8.
+void JMPNN_gru_gates_S8xF32_F32_generic(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *state, const int8_t *Bh,
+                                      float *z, float *n,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+// Same as above for weights in the WEIGHTS_LAYOUT_TILED4x16 layout
+void JMPNN_linear_matXvec_S8xF32_F32_tiled_generic(const int8_t *W, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+void JMPNN_gru_cell_S8xF32_F32_tiled_generic(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+// Same as above for weights in the WEIGHTS_LAYOUT_BSR4x16 (block-sparse) layout; zero tiles are skipped
+void JMPNN_linear_matXvec_S8xF32_F32_bsr_generic(const int8_t *W, const uint16_t *W_index, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+void JMPNN_gru_cell_S8xF32_F32_bsr_generic(const int8_t *Wi, const uint16_t *Wi_index, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const uint16_t *Wh_index, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+
+#ifdef USE_NEON
+void JMPNN_linear_matXvec_S8xF32_F32_neon(const int8_t *W, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+
+
+void JMPNN_gru_matXvec_S8xF32_F32_act_neon(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *prev_state, const int8_t *Bh,
+                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType); // used for reset/update gates
+
+void JMPNN_gru_newGate_S8xF32_F32_act_neon(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *prev_state, const int8_t *Bh, const float *r,
+                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len, 
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+#endif
+
+#if JMPNN_USE_X86_DISPATCH
+void JMPNN_linear_matXvec_S8xF32_F32_avx2(const int8_t *W, const float *input, const int8_t *bias,
                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
                                      float weightScale, float biasScale);
 
 
-void JMPNN_gru_matXvec_S8xF32_F32_act(const int8_t *Wi, const float *input, const int8_t *Bi,
+void JMPNN_gru_matXvec_S8xF32_F32_act_avx2(const int8_t *Wi, const float *input, const int8_t *Bi,
                                       const int8_t *Wh, const float *prev_state, const int8_t *Bh,
                                       float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
                                       float weightScale, float biasScale, JMPNN_ActivationType actType); // used for reset/update gates
 
-void JMPNN_gru_newGate_S8xF32_F32_act(const int8_t *Wi, const float *input, const int8_t *Bi,
+void JMPNN_gru_newGate_S8xF32_F32_act_avx2(const int8_t *Wi, const float *input, const int8_t *Bi,
                                       const int8_t *Wh, const float *prev_state, const int8_t *Bh, const float *r,
                                       float *output, JMPDSP_Length input_len, JMPDSP_Length output_len, 
                                       float weightScale, float biasScale, JMPNN_ActivationType actType);
 
-void JMPNN_apply_activation_F32(float *data, JMPDSP_Length N, JMPNN_ActivationType actType);
-void JMPNN_vec_interpolation_F32(float *output, const float *interp_vec,
+void JMPNN_apply_activation_F32_avx2(float *data, JMPDSP_Length N, JMPNN_ActivationType actType);
+JMPNN_ActivationFn_F32 JMPNN_get_activation_F32_avx2(JMPNN_ActivationType actType);
+void JMPNN_vec_interpolation_F32_avx2(float *output, const float *interp_vec,
                                  const float *input1, const float *input2,
                                  JMPDSP_Length N);
+void JMPNN_gru_cell_S8xF32_F32_avx2(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+void JMPNN_gru_gates_S8xF32_F32_avx2(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *state, const int8_t *Bh,
+                                      float *z, float *n,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+void JMPNN_linear_matXvec_S8xF32_F32_tiled_avx2(const int8_t *W, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+void JMPNN_gru_cell_S8xF32_F32_tiled_avx2(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+void JMPNN_linear_matXvec_S8xF32_F32_bsr_avx2(const int8_t *W, const uint16_t *W_index, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+void JMPNN_gru_cell_S8xF32_F32_bsr_avx2(const int8_t *Wi, const uint16_t *Wi_index, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const uint16_t *Wh_index, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+// Runtime kernel selection, see JMPNN_select_kernels_S16()
+extern void (*JMPNN_linear_matXvec_S8xF32_F32_ptr)(const int8_t *W, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+
+
+extern void (*JMPNN_gru_matXvec_S8xF32_F32_act_ptr)(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *prev_state, const int8_t *Bh,
+                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType); // used for reset/update gates
+
+extern void (*JMPNN_gru_newGate_S8xF32_F32_act_ptr)(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *prev_state, const int8_t *Bh, const float *r,
+                                      float *output, JMPDSP_Length input_len, JMPDSP_Length output_len, 
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+extern void (*JMPNN_apply_activation_F32_ptr)(float *data, JMPDSP_Length N, JMPNN_ActivationType actType);
+extern JMPNN_ActivationFn_F32 (*JMPNN_get_activation_F32_ptr)(JMPNN_ActivationType actType);
+extern void (*JMPNN_vec_interpolation_F32_ptr)(float *output, const float *interp_vec,
+                                 const float *input1, const float *input2,
+                                 JMPDSP_Length N);
+extern void (*JMPNN_gru_cell_S8xF32_F32_ptr)(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+extern void (*JMPNN_gru_gates_S8xF32_F32_ptr)(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const float *state, const int8_t *Bh,
+                                      float *z, float *n,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+extern void (*JMPNN_linear_matXvec_S8xF32_F32_tiled_ptr)(const int8_t *W, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+extern void (*JMPNN_gru_cell_S8xF32_F32_tiled_ptr)(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
+
+extern void (*JMPNN_linear_matXvec_S8xF32_F32_bsr_ptr)(const int8_t *W, const uint16_t *W_index, const float *input, const int8_t *bias,
+                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                     float weightScale, float biasScale);
+extern void (*JMPNN_gru_cell_S8xF32_F32_bsr_ptr)(const int8_t *Wi, const uint16_t *Wi_index, const float *input, const int8_t *Bi,
+                                      const int8_t *Wh, const uint16_t *Wh_index, float *state, const int8_t *Bh,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                      float weightScale, float biasScale, JMPNN_ActivationType actType);
 
+int JMPNN_cpu_has_avx2_fma(void);
+void JMPNN_select_kernels_F32(void);
+#endif
 
 #endif /* NNLIB_FLOAT_H */
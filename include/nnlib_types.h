@@ -28,4 +28,51 @@
 
 typedef int JMPNN_ActivationType;
 
+// Weight matrix layouts (GRULayer/LinearLayer .layout)
+#define WEIGHTS_LAYOUT_ROWMAJOR   0   // W[i*cols + j]
+#define WEIGHTS_LAYOUT_TILED4x16  1   // 4 rows interleaved per 16-column block, zero padded
+#define WEIGHTS_LAYOUT_BSR4x16    2   // block-sparse TILED4x16: only non-zero 4x16 tiles are stored
+
+typedef int JMPNN_WeightLayout;
+
+// TILED4x16: rows are padded to a multiple of 4 and columns to a multiple of 16.
+// Each group of 4 rows is stored as consecutive 64-byte tiles, one per 16-column
+// block, holding 16 weights of row 0, then row 1, row 2 and row 3.
+#define JMPNN_TILED4x16_ROWS(rows)  (((rows) + 3) & ~3)
+#define JMPNN_TILED4x16_COLS(cols)  (((cols) + 15) & ~15)
+#define JMPNN_TILED4x16_INDEX(i, j, cols) \
+    ((((i) & ~3) * JMPNN_TILED4x16_COLS(cols)) + (((j) & ~15) << 2) + (((i) & 3) << 4) + ((j) & 15))
+
+// BSR4x16: the non-zero tiles of the TILED4x16 matrix, 64 weights each, in row group
+// then column block order. The uint16_t index array is CSR-like: index[g]..index[g+1]-1
+// are the tiles of row group g (rows 4g..4g+3), for g < JMPNN_BSR4x16_GROUPS(rows), and
+// index[JMPNN_BSR4x16_GROUPS(rows) + 1 + t] is the 16-column block of tile t.
+#define JMPNN_BSR4x16_GROUPS(rows)  (((rows) + 3) >> 2)
+#define JMPNN_BSR4x16_INDEX_LEN(rows, num_tiles)  (JMPNN_BSR4x16_GROUPS(rows) + 1 + (num_tiles))
+
+// COLPAIR (delta kernels only, built at run time): column-major with columns 2p and 2p+1
+// interleaved, W(i, j) at [(j >> 1)*2*rows + 2*i + (j & 1)]; an odd last column is zero padded.
+#define JMPNN_COLPAIR_COLS(cols)  (((cols) + 1) & ~1)
+#define JMPNN_COLPAIR_INDEX(i, j, rows)  ((((j) & ~1) * (rows)) + ((i) << 1) + ((j) & 1))
+
+// Widest layer (inputs or hidden units) the kernels accept: their scratch buffers are
+// stack arrays of this size. Defaults to the compiled-in model (MAX_NEURONS in
+// signalsifter_config.h); raise it (cmake -DJMPNN_MAX_WIDTH=n) to run wider models
+// loaded at run time.
+#ifndef JMPNN_MAX_WIDTH
+#define JMPNN_MAX_WIDTH MAX_NEURONS
+#endif
+
+// Streams per pass of the batched (matXmat) kernels; larger batches are split
+#define JMPNN_MAX_BATCH 8
+
+// Frames per input-projection GEMM of the sequence (offline) GRU kernels
+#define JMPNN_SEQ_BLOCK 16
+
+#if !XCHAL_HAVE_HIFI5 && (defined(__x86_64__) || defined(__i386__)) && !defined(JMPNN_DISABLE_X86_DISPATCH)
+#define JMPNN_USE_X86_DISPATCH 1   // AVX2 vs. generic kernels are selected at runtime (CPUID)
+#else
+#define JMPNN_USE_X86_DISPATCH 0
+#endif
+
 #endif /* NNLIB_TYPES_H */
@@ -23,6 +23,9 @@
 #include "signalsifter_config.h"
 #include "dsp_processing.h"
 #include "signalsifter.h"
+#include "nn_graph.h"
+#include "nn_team.h"
+#include "signalsifter_pipeline.h"
 
 // #define USE_FLOAT32_SIGNALSIFTER
 
@@ -35,14 +38,55 @@
 #define SPEECH_BAND_END 3800
 #define ENABLE_SPEECH_BOOST 0
 
+// Energy gate: frames whose level (10*log10 of the mean |X|^2 over the bins, the same
+// scale as the NN input; a full-scale white noise is about +20 dB) stays below the
+// threshold for NR_GATE_HANGOVER frames bypass the NN until the level rises above
+// threshold + NR_GATE_HYSTERESIS_DB. Bypassed frames decay the previous gains toward
+// minGain (and optionally the GRU states toward zero). Once the whole analysis buffer is
+// digital zero, the FFT/IFFT are skipped as well (the output is the same).
+#define NR_GATE_ENABLE 0
+#define NR_GATE_THRESHOLD_DB -30.0f
+#define NR_GATE_HYSTERESIS_DB 3.0f
+#define NR_GATE_HANGOVER 10
+#define NR_GATE_GAIN_DECAY 0.9f
+#define NR_GATE_STATE_DECAY 1.0f   // per bypassed frame; 1: keep the GRU states
+
+// Combined channel of noise_reduction_process_linked: the NN input of a channel group
+#define NR_LINK_MID 0   // spectrum of the mean of the channels
+#define NR_LINK_MAX 1   // largest power of any channel, per bin
+
 #define NR_STATE_SIZE_BYTES sizeof(struct NoiseReduction)
 
-#ifdef USE_FLOAT32_SIGNALSIFTER
+#if defined(USE_FLOAT32_SIGNALSIFTER)
 #define NRSignalSifterState SignalSifterState
+#elif defined(USE_INT8_SIGNALSIFTER)
+#define NRSignalSifterState SignalSifterState_S8
+#elif defined(USE_DELTA_SIGNALSIFTER)
+#define NRSignalSifterState SignalSifterDeltaState_S16
 #else
 #define NRSignalSifterState SignalSifterState_S16
 #endif
 
+#if defined(USE_FLOAT32_SIGNALSIFTER)
+#define NRGraphState NNGraphState
+#else
+#define NRGraphState NNGraphState_S16
+#endif
+
+struct NRWorker;
+
+typedef struct NRGate {
+    int enabled;
+    float thresholdDb;
+    float stateDecay;
+    int belowCount;         // consecutive frames below the threshold
+    int closed;             // 1: the NN is bypassed
+    unsigned int zeroRun;   // consecutive digital-zero input frames
+    uint64_t framesTotal;
+    uint64_t framesBypassed;    // NN skipped (includes framesZero)
+    uint64_t framesZero;        // NN and FFT/IFFT skipped
+} NRGate;
+
 struct NoiseReduction {
     // Tuning parameters
     float alphaReverb;
@@ -53,16 +97,41 @@ struct NoiseReduction {
     int speechBandEndBin;
     STFTStruct STFT;
     NRSignalSifterState SS;
-    float gains[IO_SIZE] __attribute__((aligned(16)));
+    const NNGraph *graph;           // noise_reduction_set_graph(): runs instead of SS if set
+    NRGraphState graphState;        // state of graph: heap or caller memory
+    int graphStateOwned;            // 1: graphState.state is on the heap
+    float gains[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    NRGate gate;
+    NNTeam *team;                   // noise_reduction_set_team(): splits the GRU layers of a frame
+    SignalSifterPipeline_S16 *pipeline; // noise_reduction_set_pipeline(): layer pipeline of noise_reduction_process_frames
+    struct NRWorker *worker;        // noise_reduction_start_worker(): the NN runs on its own thread
 };
 
 typedef struct NoiseReduction NoiseReductionState;
 typedef struct NoiseReduction* NoiseReductionStatePtr;
 
 void create_noise_reduction(NoiseReductionState *nr, float naturalness, float min_gain);
+int create_noise_reduction_geometry(NoiseReductionState *nr, float naturalness, float min_gain,
+                                    unsigned int fft_size, unsigned int hop_length);
 void destroy_noise_reduction(NoiseReductionState *nr);
 void postprocess_gains(float *gainsIn, float *gainsState, int numBins, NoiseReductionState *nr);
+void noise_reduction_nn(NoiseReductionState *nr, const float *features, float *gains);
 void noise_reduction_process(NoiseReductionState *nr, const float *input, float *output, unsigned int R);
+void noise_reduction_process_batch(NoiseReductionState * const *nr, const float * const *input, float * const *output,
+                                   int num_streams, unsigned int R);
+void noise_reduction_process_frames(NoiseReductionState *nr, const float *input, float *output,
+                                    int num_frames, unsigned int R);
+int noise_reduction_linked_supported(const NoiseReductionState *nr);
+int noise_reduction_process_linked(NoiseReductionState * const *nr, const float * const *input, float * const *output,
+                                   int num_channels, int link_mode, unsigned int R);
+void noise_reduction_set_gate(NoiseReductionState *nr, int enable, float threshold_db, float state_decay);
+int noise_reduction_set_delta_thresholds(NoiseReductionState *nr, int input_threshold, int state_threshold);
+int noise_reduction_set_team(NoiseReductionState *nr, NNTeam *team);
+int noise_reduction_set_pipeline(NoiseReductionState *nr, SignalSifterPipeline_S16 *pipeline);
+int noise_reduction_set_model(NoiseReductionState *nr, const SignalSifterModel *model);
+int noise_reduction_set_graph(NoiseReductionState *nr, const NNGraph *graph);
+size_t noise_reduction_graph_state_size(const NNGraph *graph);
+int noise_reduction_set_graph_state(NoiseReductionState *nr, const NNGraph *graph, void *mem);
 void noise_reduction_monitor(NoiseReductionState *nr);
 
 #endif /* NOISE_REDUCTION_H */
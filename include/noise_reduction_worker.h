@@ -0,0 +1,57 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  noise_reduction_worker.h
+//
+//  Decoupled NN worker: with a worker started, noise_reduction_process() on the audio
+//  thread only runs the STFT, the masking and the ISTFT. The features of each frame go
+//  to a dedicated thread through a lock-free single-producer/single-consumer queue; the
+//  thread runs the NN and the gain post-processing and returns the gains through a second
+//  queue. Frame t is masked with the gains of frame t-1; if they are not back in time
+//  (a deadline miss) the newest gains received so far are reused. The audio thread never
+//  waits on the worker, so its cost per frame is bounded by the DSP part.
+//
+#ifndef NOISE_REDUCTION_WORKER_H
+#define NOISE_REDUCTION_WORKER_H
+
+#include "noise_reduction.h"
+#include <stdint.h>
+
+#define NRWORKER_QUEUE_SLOTS 4      // frames of features (and of gains) in flight
+
+typedef struct {
+    uint64_t frames;            // frames processed with the worker
+    uint64_t nn_frames;         // frames whose NN ran on the worker
+    uint64_t late;              // deadline misses: frames masked with older gains than the previous frame's
+    uint64_t dropped;           // frames not handed to the worker (its queue was full); the NN skipped them
+    uint64_t max_nn_ns;         // slowest NN and gain post-processing of a frame on the worker
+} NRWorkerStats;
+
+/* Starts the worker of nr, pinned to cpu (-1: not pinned). The energy gate is not applied
+   while it runs; the model, graph and team must not change until it is stopped. Returns
+   0, or -1 if a worker is running or the thread could not be created.
+ */
+int noise_reduction_start_worker(NoiseReductionState *nr, int cpu);
+// Stops the worker (gains still queued are discarded); destroy_noise_reduction() calls it
+void noise_reduction_stop_worker(NoiseReductionState *nr);
+// Returns when the worker has processed every queued frame (offline use and tests, not the audio thread)
+void noise_reduction_worker_wait(NoiseReductionState *nr);
+// Counters since the start; may be called from any thread. Zero without a worker.
+void noise_reduction_worker_stats(const NoiseReductionState *nr, NRWorkerStats *stats);
+
+// Audio-thread part of noise_reduction_process() with a worker
+void noise_reduction_process_decoupled(NoiseReductionState *nr, const float *input, float *output, unsigned int R);
+
+#endif /* NOISE_REDUCTION_WORKER_H */
@@ -70,6 +70,56 @@ struct SignalSifterState_S16 {
 };
 typedef struct SignalSifterState_S16 SignalSifterState_S16;
 
+// Int8 activations: GRU states quantized with GRUx_S8_FRAC_BITS (half the S16 state memory)
+struct SignalSifterState_S8 {
+    const SignalSifterModel *model;
+    int8_t gru1_gru_state[GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int8_t gru2_gru_state[GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int8_t gru3_gru_state[GRU_STATE_SIZE] __attribute__((aligned(16)));
+};
+typedef struct SignalSifterState_S8 SignalSifterState_S8;
+
+// Up to JMPNN_MAX_BATCH streams evaluated together. The GRU states are kept
+// structure-of-arrays: one array per layer, stream k at [k*GRU_STATE_SIZE].
+struct SignalSifterBatchState_S16 {
+    const SignalSifterModel *model;
+    int num_streams;
+    int16_t gru1_gru_state[JMPNN_MAX_BATCH * GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int16_t gru2_gru_state[JMPNN_MAX_BATCH * GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int16_t gru3_gru_state[JMPNN_MAX_BATCH * GRU_STATE_SIZE] __attribute__((aligned(16)));
+};
+typedef struct SignalSifterBatchState_S16 SignalSifterBatchState_S16;
+
+// Delta inference (USE_DELTA_SIGNALSIFTER): default thresholds, in the units of the layer
+// inputs (Q9 log-magnitude spectrum, Q15 GRU states). On data/outdoor_mix.wav they skip
+// ~35% of the weight MACs with the output 61 dB SNR from the dense model.
+#define DELTA_INPUT_THRESHOLD_Q9   16
+#define DELTA_STATE_THRESHOLD_Q15  128
+
+// Column-pair weight copies for the delta mode, shared by all delta streams
+struct SignalSifterDeltaModel {
+    const SignalSifterModel *model;
+    DeltaGRULayer gru1_gru;
+    DeltaGRULayer gru2_gru;
+    DeltaGRULayer gru3_gru;
+    DeltaLinearLayer linear1_linear;
+};
+typedef struct SignalSifterDeltaModel SignalSifterDeltaModel;
+
+struct SignalSifterDeltaState_S16 {
+    const SignalSifterDeltaModel *dmodel;
+    int16_t gru1_gru_state[GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int16_t gru2_gru_state[GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int16_t gru3_gru_state[GRU_STATE_SIZE] __attribute__((aligned(16)));
+    DeltaGRUState_S16 gru1_delta;
+    DeltaGRUState_S16 gru2_delta;
+    DeltaGRUState_S16 gru3_delta;
+    DeltaLinearState_S16 linear1_delta;
+    int16_t input_threshold;    // Q9, applies to gru1 input columns
+    int16_t state_threshold;    // Q15, applies to all GRU state / layer-to-layer columns
+};
+typedef struct SignalSifterDeltaState_S16 SignalSifterDeltaState_S16;
+
 void createSignalSifterModel(SignalSifterState *ss);
 void destroySignalSifterModel(SignalSifterState *ss);
 void computeSignalSifterModel(SignalSifterState *ss, float *gains, const float *input);
@@ -81,6 +131,29 @@ void createSignalSifterModel_S16(SignalSifterState_S16 *ss);
 void destroySignalSifterModel_S16(SignalSifterState_S16 *ss);
 void computeSignalSifterModel_S16(SignalSifterState_S16 *ss, int16_t *gains, const int16_t *input);
 
+//INT8-ACTIVATION QUANTIZED INFERENCE (input quantized with INPUT_S8_FRAC_BITS, Q15 gains)
+void createSignalSifterModel_S8(SignalSifterState_S8 *ss);
+void destroySignalSifterModel_S8(SignalSifterState_S8 *ss);
+void computeSignalSifterModel_S8(SignalSifterState_S8 *ss, int16_t *gains, const int8_t *input);
+
+//DELTA (TEMPORAL-DIFFERENCE) QUANTIZED INFERENCE (same input/gains as computeSignalSifterModel_S16)
+const SignalSifterDeltaModel *getSignalSifterDeltaModel(void);
+int createSignalSifterModelDelta_S16(SignalSifterDeltaState_S16 *ss);
+void destroySignalSifterModelDelta_S16(SignalSifterDeltaState_S16 *ss);
+void computeSignalSifterModelDelta_S16(SignalSifterDeltaState_S16 *ss, int16_t *gains, const int16_t *input);
+float getSignalSifterDeltaSkipRatio(const SignalSifterDeltaState_S16 *ss);
+
+//BATCHED (CROSS-STREAM) QUANTIZED INFERENCE
+void createSignalSifterBatch_S16(SignalSifterBatchState_S16 *sb, int num_streams);
+void gatherSignalSifterBatch_S16(SignalSifterBatchState_S16 *sb, SignalSifterState_S16 * const *ss, int num_streams);
+void scatterSignalSifterBatch_S16(const SignalSifterBatchState_S16 *sb, SignalSifterState_S16 * const *ss);
+void computeSignalSifterModelBatch_S16(SignalSifterBatchState_S16 *sb, int16_t *gains, JMPDSP_Stride gains_stride,
+                                       const int16_t *input, JMPDSP_Stride input_stride);
+
+//OFFLINE (LAYER-MAJOR, ONE STREAM) QUANTIZED INFERENCE
+void computeSignalSifterModelSeq_S16(SignalSifterState_S16 *ss, int16_t *gains, JMPDSP_Stride gains_stride,
+                                     const int16_t *input, JMPDSP_Stride input_stride, int num_frames);
+
 #if ENABLE_SS_MONITOR
 void printSignalSifterStats(SignalSifterMonitor *sm);
 void printSignalSifterStats_S16(SignalSifterMonitor_S16 *sm);
@@ -13,6 +13,14 @@
 #define GRU_NUM_FRAC_BITS  (15)
 #define LIN_NUM_FRAC_BITS  (15)
 #define INPUTLAYER_SHIFT_RIGHT  ((INPUT_NUM_FRAC_BITS) + WAB_FRAC_BITS - (GRU_NUM_FRAC_BITS))
+#define INPUT_S8_FRAC_BITS  (1)
+#define GRU1_S8_FRAC_BITS  (7)
+#define GRU2_S8_FRAC_BITS  (7)
+#define GRU3_S8_FRAC_BITS  (7)
+_Static_assert(INPUT_S8_FRAC_BITS >= 0 && INPUT_S8_FRAC_BITS <= 8, "int8 frac bits must be in [0, 8]");
+_Static_assert(GRU1_S8_FRAC_BITS >= 0 && GRU1_S8_FRAC_BITS <= 8, "int8 frac bits must be in [0, 8]");
+_Static_assert(GRU2_S8_FRAC_BITS >= 0 && GRU2_S8_FRAC_BITS <= 8, "int8 frac bits must be in [0, 8]");
+_Static_assert(GRU3_S8_FRAC_BITS >= 0 && GRU3_S8_FRAC_BITS <= 8, "int8 frac bits must be in [0, 8]");
 typedef int8_t nnWeight;
 #define WEIGHTS_SCALE (1.f/128)
 typedef int8_t nnBias;
@@ -0,0 +1,140 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  signalsifter_model_file.h
+//
+//  Binary SignalSifter weight files (.jmpnn), loaded at runtime instead of the
+//  compiled-in signalsifter_weights.c. Written by models/convert_model.py -b,
+//  writeSignalSifterModelFile() or writeNNGraphFile().
+//
+#ifndef SIGNALSIFTER_MODEL_FILE_H
+#define SIGNALSIFTER_MODEL_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "signalsifter.h"
+#include "nn_graph.h"
+#include "dsp_processing.h"
+
+// File layout (little-endian):
+//   JMPNN_ModelFileHeader
+//   JMPNN_ModelFileLayer[num_layers]     chain of GRU/linear layers (gru1, gru2, gru3, linear1
+//                                        for SignalSifter), at most NNGRAPH_MAX_LAYERS
+//   weight/bias/index arrays, each at a JMPNN_MODEL_FILE_ALIGN aligned file offset,
+//   stored exactly as the arrays of signalsifter_weights.c (nnWeight, nnBias, uint16_t)
+// The checksum is the CRC-32 (zlib) of the whole file with the checksum field set to 0.
+#define JMPNN_MODEL_FILE_MAGIC       "JMPNNMDL"
+#define JMPNN_MODEL_FILE_VERSION     1
+#define JMPNN_MODEL_FILE_BYTE_ORDER  0x01020304
+#define JMPNN_MODEL_FILE_ALIGN       64
+
+#define JMPNN_MODEL_LAYER_GRU     NNGRAPH_LAYER_GRU
+#define JMPNN_MODEL_LAYER_LINEAR  NNGRAPH_LAYER_LINEAR
+
+// Arrays of a layer record (GRU layers use all of them, linear layers the
+// non-recurrent ones); size 0: absent
+#define JMPNN_MODEL_ARRAY_WEIGHTS                  0
+#define JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS        1
+#define JMPNN_MODEL_ARRAY_BIAS                     2
+#define JMPNN_MODEL_ARRAY_RECURRENT_BIAS           3
+#define JMPNN_MODEL_ARRAY_WEIGHTS_INDEX            4    // WEIGHTS_LAYOUT_BSR4x16 only
+#define JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS_INDEX  5
+#define JMPNN_MODEL_NUM_ARRAYS                     6
+
+typedef struct {
+    char magic[8];                  // JMPNN_MODEL_FILE_MAGIC, not NUL terminated
+    uint32_t version;               // JMPNN_MODEL_FILE_VERSION
+    uint32_t header_size;           // bytes of the header and the layer records
+    uint32_t byte_order;            // JMPNN_MODEL_FILE_BYTE_ORDER
+    uint32_t num_layers;
+    uint32_t weight_bits;           // 8 * sizeof(nnWeight)
+    uint32_t bias_bits;             // 8 * sizeof(nnBias)
+    int32_t wab_frac_bits;          // Q formats the model was quantized for (signalsifter_config.h)
+    int32_t input_num_frac_bits;
+    int32_t gru_num_frac_bits;
+    int32_t lin_num_frac_bits;
+    int32_t s8_frac_bits[4];        // INPUT_S8_FRAC_BITS, GRU1..3_S8_FRAC_BITS (checked by the int8 build only)
+    uint32_t io_size;
+    uint32_t fft_size;
+    uint32_t hop_length;
+    uint32_t checksum;
+    uint64_t file_size;
+    uint32_t reserved[2];
+} JMPNN_ModelFileHeader;
+
+typedef struct {
+    uint64_t offset;                // from the start of the file
+    uint64_t size;                  // bytes
+} JMPNN_ModelFileArray;
+
+typedef struct {
+    uint32_t type;                  // JMPNN_MODEL_LAYER_xxx
+    uint32_t activation;            // ACTIVATION_xxx
+    uint32_t layout;                // WEIGHTS_LAYOUT_xxx
+    uint32_t input_size;
+    uint32_t hidden_size;
+    uint32_t reserved;
+    JMPNN_ModelFileArray arrays[JMPNN_MODEL_NUM_ARRAYS];
+} JMPNN_ModelFileLayer;
+
+// loadSignalSifterModelFile() flags
+#define JMPNN_MODEL_PREFAULT    1   // populate the page tables at load time (no page faults in the first frames)
+#define JMPNN_MODEL_HUGEPAGES   2   // ask for transparent huge pages for the mapping (best effort)
+#define JMPNN_MODEL_VERIFY      4   // check the CRC-32 (reads the whole file)
+
+// Error codes (negative) of the functions below
+#define JMPNN_MODEL_ERR_IO        (-1)   // open/stat/mmap/write failed
+#define JMPNN_MODEL_ERR_FORMAT    (-2)   // not a model file, unsupported version or inconsistent records
+#define JMPNN_MODEL_ERR_CONFIG    (-3)   // Q formats or sizes do not match this build (signalsifter_config.h,
+                                         // JMPNN_MAX_WIDTH, STFT_MAX_FFT_SIZE)
+#define JMPNN_MODEL_ERR_CHECKSUM  (-4)
+
+#define JMPNN_MODEL_STORAGE_BUFFER  0   // caller-owned memory (openSignalSifterModelBuffer)
+#define JMPNN_MODEL_STORAGE_MMAP    1   // read-only mapping of the file
+#define JMPNN_MODEL_STORAGE_HEAP    2   // heap copy of the file, on platforms without mmap()
+
+// A loaded model. The layers point into the file data, which stays mapped (read-only,
+// shared by every process using the same file) until unloadSignalSifterModelFile().
+// graph runs any file; model is only set up for the SignalSifter shape (three GRUs of at
+// most GRU_STATE_SIZE units and a linear layer, IO_SIZE inputs and outputs), which the
+// fixed-layer kernels need. The STFT geometry the model was trained for is
+// stft_geometry_supported() and has at least io_size bins (see jumpml_nr_init_geometry).
+typedef struct {
+    NNGraph graph;
+    SignalSifterModel model;        // valid if has_model
+    int has_model;
+    unsigned int fft_size;
+    unsigned int hop_length;
+    unsigned int io_size;           // NN inputs and outputs: the first io_size bins
+    GRULayer grus[NNGRAPH_MAX_LAYERS];          // [l]: layer l, if it is a GRU
+    LinearLayer linears[NNGRAPH_MAX_LAYERS];    // [l]: layer l, if it is linear
+    const uint8_t *data;
+    size_t size;
+    int storage;                    // JMPNN_MODEL_STORAGE_xxx
+} SignalSifterModelFile;
+
+int loadSignalSifterModelFile(SignalSifterModelFile *mf, const char *path, int flags);
+// Same checks on a model file image already in memory (e.g. linked into the binary or in
+// flash); data must be 2-byte aligned and outlive mf. Only JMPNN_MODEL_VERIFY applies.
+int openSignalSifterModelBuffer(SignalSifterModelFile *mf, const void *data, size_t size, int flags);
+void unloadSignalSifterModelFile(SignalSifterModelFile *mf);
+
+// Writes model (e.g. the compiled-in one) or graph as a model file for this build's Q formats
+// and the compiled-in STFT geometry (FFT_SIZE, HOP_LENGTH), or the given one
+int writeSignalSifterModelFile(const SignalSifterModel *model, const char *path);
+int writeNNGraphFile(const NNGraph *graph, const char *path);
+int writeNNGraphFileGeometry(const NNGraph *graph, unsigned int fft_size, unsigned int hop_length, const char *path);
+
+#endif /* SIGNALSIFTER_MODEL_FILE_H */
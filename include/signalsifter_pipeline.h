@@ -0,0 +1,50 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  signalsifter_pipeline.h
+//
+//  Layer-wavefront pipelining of the fixed-point SignalSifter: gru1, gru2 and gru3 each
+//  run on their own thread, so gru1(t+1), gru2(t), gru3(t-1) and linear1(t-2) (on the
+//  caller) overlap. The layers are connected by single-producer/single-consumer queues
+//  of activation vectors. Every layer sees the same inputs in the same order as in
+//  computeSignalSifterModel_S16(), so the gains are bit-exact; they come out a few frames
+//  after their input went in, and throughput approaches the cost of the slowest layer.
+//
+#ifndef SIGNALSIFTER_PIPELINE_H
+#define SIGNALSIFTER_PIPELINE_H
+
+#include "signalsifter.h"
+
+#define SSPIPE_STAGES       3   // threads: gru1, gru2, gru3 (linear1 runs in popSignalSifterPipeline_S16)
+#define SSPIPE_QUEUE_SLOTS  4   // activation vectors per queue
+#define SSPIPE_DEPTH        8   // frames a caller keeps in flight (push t, then pop t - SSPIPE_DEPTH)
+
+typedef struct SignalSifterPipeline_S16 SignalSifterPipeline_S16;
+
+// Starts the stage threads, pinned to cpus[0..SSPIPE_STAGES-1] (NULL: not pinned). Returns 0, or -1.
+int createSignalSifterPipeline_S16(SignalSifterPipeline_S16 **pipe, const int *cpus);
+// Every pushed frame must have been popped
+void destroySignalSifterPipeline_S16(SignalSifterPipeline_S16 *pipe);
+
+/* Queues the NN input of the next frame of ss (copied). The stage threads update the
+   GRU states of ss, which must not be touched until its frames are popped. Blocks while
+   the first queue is full: at most 4 * SSPIPE_QUEUE_SLOTS frames can be in flight.
+   One producer/consumer thread per pipeline.
+ */
+void pushSignalSifterPipeline_S16(SignalSifterPipeline_S16 *pipe, SignalSifterState_S16 *ss, const int16_t *input);
+// Runs linear1 of the oldest pushed frame not popped yet into gains; blocks until gru3 is done with it
+void popSignalSifterPipeline_S16(SignalSifterPipeline_S16 *pipe, int16_t *gains);
+
+#endif /* SIGNALSIFTER_PIPELINE_H */
@@ -0,0 +1,61 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+// 
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// 
+//  tanh_rational.h
+//
+
+#ifndef TANH_RATIONAL_H
+#define TANH_RATIONAL_H
+
+#include "common_def.h"
+
+// Branch-free rational approximation of tanh (odd 13/6 minimax fit, same coefficients as
+// Eigen's fast tanh). No table gather and no sign branch, so it maps directly onto SIMD.
+// |error| < 4e-7 over all x, vs ~1e-4 for the tanh_table.h interpolation.
+#define TANH_RATIONAL_MAXX  7.90531110763549805f  // tanh(x) rounds to +-1.0f beyond
+#define TANH_RATIONAL_A1    4.89352455891786e-03f
+#define TANH_RATIONAL_A3    6.37261928875436e-04f
+#define TANH_RATIONAL_A5    1.48572235717979e-05f
+#define TANH_RATIONAL_A7    5.12229709037114e-08f
+#define TANH_RATIONAL_A9   -8.60467152213735e-11f
+#define TANH_RATIONAL_A11   2.00018790482477e-13f
+#define TANH_RATIONAL_A13  -2.76076847742355e-16f
+#define TANH_RATIONAL_B0    4.89352518554385e-03f
+#define TANH_RATIONAL_B2    2.26843463243900e-03f
+#define TANH_RATIONAL_B4    1.18534705686654e-04f
+#define TANH_RATIONAL_B6    1.19825839466702e-06f
+
+// The SIMD versions must follow the same operation order to stay bit-exact with this one
+// (only guaranteed when neither side is built with FMA contraction, see tanh_rational_S16()).
+static inline float tanh_rational(float x)
+{
+    float x2, p, q;
+    x = MAX(-TANH_RATIONAL_MAXX, MIN(TANH_RATIONAL_MAXX, x));
+    x2 = x*x;
+    p = TANH_RATIONAL_A13;
+    p = p*x2 + TANH_RATIONAL_A11;
+    p = p*x2 + TANH_RATIONAL_A9;
+    p = p*x2 + TANH_RATIONAL_A7;
+    p = p*x2 + TANH_RATIONAL_A5;
+    p = p*x2 + TANH_RATIONAL_A3;
+    p = p*x2 + TANH_RATIONAL_A1;
+    q = TANH_RATIONAL_B6;
+    q = q*x2 + TANH_RATIONAL_B4;
+    q = q*x2 + TANH_RATIONAL_B2;
+    q = q*x2 + TANH_RATIONAL_B0;
+    return x*p / q;
+}
+
+#endif /* TANH_RATIONAL_H */
@@ -24,6 +24,7 @@ void gen_cpxvec(kiss_fft_cpx *vec, unsigned int N, int numFracBits);
 void convert_F32toS16(const float *A, int16_t *B, unsigned int N, int numFracBits);
 void convert_F32toS32(const float *A, int32_t *B, unsigned int N, int Qm, int Qn);
 void convert_F32toS8(const float *A, int8_t *B, unsigned int N);
+void convert_F32toS8_Q(const float *A, int8_t *B, unsigned int N, int numFracBits);
 void convert_S16toF32(const int16_t *A, float *B, unsigned int N, int numFracBits);
 void convert_C32toC16(const kiss_fft_cpx *A, kiss_fft_cpx_S16 *B, unsigned int N);
 void convert_C16toC32(const kiss_fft_cpx_S16 *A, kiss_fft_cpx_F32 *B, unsigned int N, int numFracBits);
@@ -37,6 +38,7 @@ void print_cpxvec_S16(kiss_fft_cpx_S16 *vec, unsigned int N, char *vec_name, int
 
 float check_vectors(float *x, float *ref, int N);
 float check_vec_S16(int16_t *x, float *ref, int N, int Qn);
+float check_vec_S8(int8_t *x, float *ref, int N, int Qn);
 float check_vec_S32(int32_t *x, float *ref, int N, int Qn);
 float check_vec_S16_S16(int16_t *x, int16_t *ref, int N);
 
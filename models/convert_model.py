@@ -19,6 +19,7 @@
 #  1. NN inference & Preprocessing config header: /include/signalsifter_config.h
 #  2. NN weights src file: /src/signalsifter_weights.c
 #  3. Float vs. fixed-point NN inference testvector: test/testss/signalsifter_testvector.h (Unit Test)
+#  4. Optionally (-b), a binary model file loaded at runtime: include/signalsifter_model_file.h
 #
 
 import argparse
@@ -26,6 +27,8 @@ import torch
 import torch.nn as nn
 import numpy as np
 import re
+import struct
+import zlib
 
 # import librosa
 from model.simple_gru import GRU3
@@ -71,11 +74,11 @@ def find_activation(named_module_list, module_name):
         the activation function is defined in module_name_activation
 
     Supported activation functions:
-        Tanh, ReLU, Sigmoid, Linear/Unknown
+        Tanh, ReLU, Sigmoid, Linear (no module_name_activation), Unknown
 
     Called by ModuleInfoGen.
     """
-    activation_name = "UNKNOWN"
+    activation_name = "LINEAR"
     for name, module in named_module_list:
         if module_name + "_activation" == name:
             if isinstance(module, nn.Tanh):
@@ -155,25 +158,29 @@ def print_system_info_header(text):
     print(f"{header_text}")
 
 
-def printModuleStructs(f, model):
+def printModuleStructs(f, model, weight_layout="rowmajor"):
     """
-    input: file handle f, pytorch model object
+    input: file handle f, pytorch model object, weight layout
     output: None
 
     Prints module data structures (GRU and Linear) that are part of the model.
     The module data structure includes names of parameter arrays such as
-    bias, weights and activation function type
+    bias, weights, activation function type and weight layout
     """
+    layout = f"WEIGHTS_LAYOUT_{weight_layout.upper()}"
+    sparse = weight_layout == "bsr4x16"
     print_system_info_header("Neural Network Architecture")
     for name, module_type, act_type, input_size, output_size in ModuleInfoGen(model):
         print(f"{name}, {module_type}, {act_type}, {input_size} x {output_size}")
+        idx_i = f"{name}_weights_index" if sparse else "NULL"
+        idx_h = f"{name}_recurrent_weights_index" if sparse else "NULL"
         if module_type == "GRU":
             f.write(
-                f"static const GRULayer {name} = {{\n   {name}_bias, \n   {name}_recurrent_bias, \n   {name}_weights, \n   {name}_recurrent_weights, \n   {input_size}, {output_size}, ACTIVATION_{act_type}\n}};\n\n"
+                f"static const GRULayer {name} = {{\n   {name}_bias, \n   {name}_recurrent_bias, \n   {name}_weights, \n   {name}_recurrent_weights, \n   {input_size}, {output_size}, ACTIVATION_{act_type}, {layout},\n   {idx_i}, {idx_h}\n}};\n\n"
             )
         elif module_type == "Linear":
             f.write(
-                f"static const LinearLayer {name} = {{\n   {name}_bias,\n   {name}_weights,\n   {input_size}, {output_size}, ACTIVATION_{act_type}\n}};\n\n"
+                f"static const LinearLayer {name} = {{\n   {name}_bias,\n   {name}_weights,\n   {input_size}, {output_size}, ACTIVATION_{act_type}, {layout},\n   {idx_i}\n}};\n\n"
             )
         else:
             print(f"Unknown layer: {name} with type: {module_type}")
@@ -219,6 +226,87 @@ def printVector(f, vector, name, datatype="float", nFracBits=7):
     return
 
 
+def pack_tiled4x16(w):
+    """
+    Repacks a 2-D row-major weight matrix into the WEIGHTS_LAYOUT_TILED4x16
+    layout (see include/nnlib_types.h): rows padded to a multiple of 4 and
+    columns to a multiple of 16, each group of 4 rows stored as 64-element
+    tiles (16 columns of row 0, then rows 1, 2 and 3) in column block order.
+    Stacked GRU weights keep their gate offsets as long as hidden_size % 4 == 0.
+    """
+    rows, cols = w.shape
+    rows_p = (rows + 3) // 4 * 4
+    cols_p = (cols + 15) // 16 * 16
+    wp = np.zeros((rows_p, cols_p), dtype=w.dtype)
+    wp[:rows, :cols] = w
+    # (row block, row in block, col block, col in block) -> (row block, col block, row, col)
+    wp = wp.reshape(rows_p // 4, 4, cols_p // 16, 16).transpose(0, 2, 1, 3)
+    return wp.reshape(-1)
+
+
+def prune_blocks4x16(w, sparsity):
+    """
+    Magnitude-based block pruning: zeroes the fraction `sparsity` of the 4x16
+    tiles (TILED4x16 grid, see include/nnlib_types.h) with the smallest L1 norm.
+    Same rule as pruneWeightsBlocks4x16() in src/nn_layers_tools.c. The model
+    should be fine-tuned with the pruning mask held fixed afterwards.
+    """
+    rows, cols = w.shape
+    G, B = (rows + 3) // 4, (cols + 15) // 16
+    wp = np.zeros((4 * G, 16 * B), dtype=w.dtype)
+    wp[:rows, :cols] = w
+    norms = np.abs(wp).reshape(G, 4, B, 16).sum(axis=(1, 3)).reshape(-1)
+    num_prune = int(round(sparsity * G * B))
+    mask = np.ones(G * B, dtype=w.dtype)
+    mask[np.argsort(norms, kind="stable")[:num_prune]] = 0
+    mask = np.repeat(np.repeat(mask.reshape(G, B), 4, axis=0), 16, axis=1)
+    return w * mask[:rows, :cols]
+
+
+def pack_bsr4x16(w, datatype="int8_t"):
+    """
+    Packs a 2-D row-major weight matrix into the WEIGHTS_LAYOUT_BSR4x16 layout:
+    the TILED4x16 tiles that are not all zero after quantization, plus the
+    CSR-like uint16 index (row group pointers, then the column block of each
+    stored tile). Returns (tiles, index).
+    """
+    rows, cols = w.shape
+    G, B = (rows + 3) // 4, (cols + 15) // 16
+    tiles = pack_tiled4x16(w).reshape(G, B, 64)
+    keep = np.any(convert_datatype(tiles, datatype) != 0, axis=2)
+    row_ptr = np.concatenate(([0], np.cumsum(keep.sum(axis=1))))
+    col = np.nonzero(keep)[1]
+    index = np.concatenate((row_ptr, col)).astype(int)
+    assert index.max() < 65536
+    return tiles[keep].reshape(-1), index
+
+
+def parse_sparsity(text):
+    """
+    "0.5" -> {"default": 0.5}; "gru1=0.6,gru2=0.5,linear1=0" -> per layer, where
+    the layer name is the prefix of the C parameter name (gru1, linear1, ...).
+    """
+    sparsity = {}
+    for item in text.split(","):
+        if "=" in item:
+            name, value = item.split("=")
+            sparsity[name.strip()] = float(value)
+        else:
+            sparsity["default"] = float(item)
+    return sparsity
+
+
+def apply_block_pruning(model, sparsity):
+    for name, param in model.named_parameters():
+        mod_name = modify_param_name(name)
+        if mod_name and "weight" in mod_name:
+            s = sparsity.get(mod_name.split("_")[0], sparsity.get("default", 0.0))
+            if s > 0:
+                w = prune_blocks4x16(param.data.numpy(), s)
+                param.data = torch.from_numpy(w)
+                print(f"{mod_name}: pruned {s:.0%} of the 4x16 blocks")
+
+
 def modify_param_name(name):
     # Step 1: Replace all . with _
     modified_name = name.replace(".", "_")
@@ -251,6 +339,7 @@ def create_model_header_file(
     logmag_epsilon=1e-4,
     act_wordlen=16,
     input_intBits=6,
+    s8_fracBits=(1, 7, 7, 7),
 ):
     header_name = fname.split(".h")[0]
     header_name = os.path.basename(header_name)
@@ -268,6 +357,18 @@ def create_model_header_file(
     f.write(
         f"\n#define INPUTLAYER_SHIFT_RIGHT  ((INPUT_NUM_FRAC_BITS) + WAB_FRAC_BITS - (GRU_NUM_FRAC_BITS))"
     )
+    # int8-activation mode (USE_INT8_SIGNALSIFTER): calibrated per-layer scales
+    f.write(f"\n#define INPUT_S8_FRAC_BITS  ({s8_fracBits[0]})")
+    for idx in range(1, len(s8_fracBits)):
+        f.write(f"\n#define GRU{idx}_S8_FRAC_BITS  ({s8_fracBits[idx]})")
+    # the int8 kernels shift by 8 - frac_bits
+    f.write(
+        "\n_Static_assert(INPUT_S8_FRAC_BITS >= 0 && INPUT_S8_FRAC_BITS <= 8, \"int8 frac bits must be in [0, 8]\");"
+    )
+    for idx in range(1, len(s8_fracBits)):
+        f.write(
+            f"\n_Static_assert(GRU{idx}_S8_FRAC_BITS >= 0 && GRU{idx}_S8_FRAC_BITS <= 8, \"int8 frac bits must be in [0, 8]\");"
+        )
     f.write(
         f"\ntypedef {w_datatype} nnWeight;\n#define WEIGHTS_SCALE (1.f/{2**w_fracBits})"
     )
@@ -321,6 +422,8 @@ def dump_model_to_Cfile(
     hop_length=160,
     logmag_epsilon=1e-4,
     input_intBits=0,
+    weight_layout="rowmajor",
+    s8_fracBits=(1, 7, 7, 7),
 ):
     f = open(src_fname, "w")
     printHeader(f)
@@ -340,6 +443,7 @@ def dump_model_to_Cfile(
         hop_length=hop_length,
         logmag_epsilon=logmag_epsilon,
         input_intBits=input_intBits,
+        s8_fracBits=s8_fracBits,
     )
 
     for name, param in model.named_parameters():
@@ -349,7 +453,17 @@ def dump_model_to_Cfile(
             if mod_name and "bias" in mod_name:
                 printVector(f, param.data.numpy(), mod_name, b_datatype)
             elif mod_name and "weight" in mod_name:
-                printVector(f, param.data.numpy(), mod_name, w_datatype)
+                w = param.data.numpy()
+                if weight_layout != "rowmajor" and "gru" in mod_name:
+                    assert (
+                        w.shape[0] % 12 == 0
+                    ), f"{mod_name}: GRU hidden_size must be a multiple of 4 for {weight_layout}"
+                if weight_layout == "tiled4x16":
+                    w = pack_tiled4x16(w)
+                elif weight_layout == "bsr4x16":
+                    w, index = pack_bsr4x16(w, w_datatype)
+                    printVector(f, index, f"{mod_name}_index", "uint16_t")
+                printVector(f, w, mod_name, w_datatype)
             else:
                 print("oops")
 
@@ -358,11 +472,130 @@ def dump_model_to_Cfile(
         f"{hop_length} samples --> logMagSpec(FFT{fft_size}) --> NN Masker(IO={io_size}) --> ISTFT(FFT{fft_size}) --> {hop_length} samples"
     )
 
-    printModuleStructs(f, model)
+    printModuleStructs(f, model, weight_layout=weight_layout)
     printModelStruct(f, model, structType="SignalSifterModel", instanceName="ss_model")
     f.close()
 
 
+# Binary model file, see include/signalsifter_model_file.h for the layout
+MODEL_FILE_MAGIC = b"JMPNNMDL"
+MODEL_FILE_VERSION = 1
+MODEL_FILE_BYTE_ORDER = 0x01020304
+MODEL_FILE_ALIGN = 64
+MODEL_FILE_HEADER = struct.Struct("<8s6I4i4i3IIQ2I")  # JMPNN_ModelFileHeader
+MODEL_FILE_LAYER = struct.Struct("<6I12Q")  # JMPNN_ModelFileLayer
+MODEL_FILE_CHECKSUM_OFFSET = 76
+MODEL_FILE_LAYER_TYPES = {"GRU": 0, "Linear": 1}
+MODEL_FILE_ACTIVATIONS = {"TANH": 0, "SIGMOID": 1, "RELU": 2, "LINEAR": 3}
+MODEL_FILE_LAYOUTS = {"rowmajor": 0, "tiled4x16": 1, "bsr4x16": 2}
+MODEL_FILE_DTYPES = {"int8_t": "<i1", "int16_t": "<i2", "float": "<f4"}
+
+
+def dump_model_to_binfile(
+    model,
+    fname,
+    w_datatype="int8_t",
+    b_datatype="int8_t",
+    io_size=161,
+    fft_size=320,
+    hop_length=160,
+    input_intBits=0,
+    weight_layout="rowmajor",
+    s8_fracBits=(1, 7, 7, 7),
+    act_wordlen=16,
+):
+    """
+    Writes the model as a binary model file, loaded at runtime with
+    loadSignalSifterModelFile() (or testnr -w) instead of the compiled
+    src/signalsifter_weights.c. The arrays are quantized and packed as in
+    dump_model_to_Cfile(); the Q formats and sizes are recorded in the header
+    and must match signalsifter_config.h of the C build, which the loader checks.
+    """
+    params = {
+        modify_param_name(name): param.data.numpy()
+        for name, param in model.named_parameters()
+        if param.requires_grad
+    }
+    modules = list(ModuleInfoGen(model))
+    header_size = MODEL_FILE_HEADER.size + len(modules) * MODEL_FILE_LAYER.size
+    blobs = []
+    records = []
+    pos = header_size
+
+    def add_array(data):
+        nonlocal pos
+        if data is None:
+            return (0, 0)
+        offset = (pos + MODEL_FILE_ALIGN - 1) // MODEL_FILE_ALIGN * MODEL_FILE_ALIGN
+        blobs.append((offset, data))
+        pos = offset + len(data)
+        return (offset, len(data))
+
+    for name, module_type, act_type, input_size, output_size in modules:
+        # weights, recurrent_weights, bias, recurrent_bias, weights_index, recurrent_weights_index
+        arrays = [None] * 6
+        for k, suffix in enumerate(("weights", "recurrent_weights")):
+            if f"{name}_{suffix}" not in params:
+                continue
+            w = params[f"{name}_{suffix}"]
+            if weight_layout == "tiled4x16":
+                w = pack_tiled4x16(w)
+            elif weight_layout == "bsr4x16":
+                w, index = pack_bsr4x16(w, w_datatype)
+                arrays[4 + k] = np.asarray(index).astype("<u2").tobytes()
+            w = convert_datatype(np.reshape(w, (-1)), w_datatype)
+            arrays[k] = w.astype(MODEL_FILE_DTYPES[w_datatype]).tobytes()
+        for k, suffix in ((2, "bias"), (3, "recurrent_bias")):
+            if f"{name}_{suffix}" not in params:
+                continue
+            b = convert_datatype(np.reshape(params[f"{name}_{suffix}"], (-1)), b_datatype)
+            arrays[k] = b.astype(MODEL_FILE_DTYPES[b_datatype]).tobytes()
+        fields = [
+            MODEL_FILE_LAYER_TYPES[module_type],
+            MODEL_FILE_ACTIVATIONS[act_type],
+            MODEL_FILE_LAYOUTS[weight_layout],
+            input_size,
+            output_size,
+            0,
+        ]
+        for data in arrays:
+            fields.extend(add_array(data))
+        records.append(fields)
+
+    image = bytearray(pos)
+    MODEL_FILE_HEADER.pack_into(
+        image,
+        0,
+        MODEL_FILE_MAGIC,
+        MODEL_FILE_VERSION,
+        header_size,
+        MODEL_FILE_BYTE_ORDER,
+        len(modules),
+        8 * np.dtype(MODEL_FILE_DTYPES[w_datatype]).itemsize,
+        8 * np.dtype(MODEL_FILE_DTYPES[b_datatype]).itemsize,
+        get_fracBits(w_datatype),
+        act_wordlen - input_intBits - 1,
+        act_wordlen - 1,
+        act_wordlen - 1,
+        *s8_fracBits,
+        io_size,
+        fft_size,
+        hop_length,
+        0,
+        len(image),
+        0,
+        0,
+    )
+    for i, fields in enumerate(records):
+        MODEL_FILE_LAYER.pack_into(image, MODEL_FILE_HEADER.size + i * MODEL_FILE_LAYER.size, *fields)
+    for offset, data in blobs:
+        image[offset : offset + len(data)] = data
+    struct.pack_into("<I", image, MODEL_FILE_CHECKSUM_OFFSET, zlib.crc32(image))
+    with open(fname, "wb") as f:
+        f.write(image)
+    print(f"Binary model file: {fname} ({len(image)} bytes)")
+
+
 def dump_testvectors_Cfile(
     input,
     output,
@@ -450,6 +683,31 @@ def inference(model, nn_features, N, io_size=128):
     return ipt, out, state_in, state_out
 
 
+def calibrate_s8_frac_bits(model, config, io_size=128, fname="data/outdoor_mix.wav"):
+    """Runs the float model over fname and returns the int8 fractional bits of the
+    NN input and of each GRU state: 7 - ceil(log2(max |x|)), so that the largest
+    value seen fits in int8 without saturation, clamped to [0, 8] (the int8 kernels
+    shift by 8 - frac_bits)."""
+    y, _ = librosa.load(fname, sr=16000)
+    preproc = initialize_config(config["preprocessing"])
+    (_, _, nn_features) = preproc.process(y)
+    B, T, F = nn_features.shape
+    h0 = torch.zeros(1, model.hidden_size[0], dtype=torch.float32)
+    state_ = [h0, h0, h0]
+    max_abs = [torch.max(torch.abs(nn_features[:, :, :io_size])).item(), 0.0, 0.0, 0.0]
+    with torch.no_grad():
+        for idx in range(T):
+            _, state_ = model(nn_features[:, idx, :io_size], state_)
+            for k in range(3):
+                max_abs[k + 1] = max(max_abs[k + 1], torch.max(torch.abs(state_[k])).item())
+
+    fracBits = [min(max(int(7 - math.ceil(math.log2(max(m, 2**-7)))), 0), 8) for m in max_abs]
+    print_system_info_header(
+        f"Int8 calibration ({fname}): max |x| = {max_abs} --> frac bits = {fracBits}"
+    )
+    return fracBits
+
+
 def generate_test_vectors(model, config, enable_testvector=True):
     if enable_testvector:
         y, _ = librosa.load("data/outdoor_mix.wav", sr=16000)
@@ -652,10 +910,38 @@ if __name__ == "__main__":
         help="Pytorch JumpML model (.ptj) file",
         default="models/pretrained_models/jumpmlnr_pro.ptj",
     )
+    parser.add_argument(
+        "-l",
+        "--weight_layout",
+        required=False,
+        type=str,
+        choices=["rowmajor", "tiled4x16", "bsr4x16"],
+        help="Weight matrix layout in the C file (tiled4x16: 4 rows x 16 columns interleaved, padded, for the SIMD kernels; bsr4x16: tiled4x16 without the all-zero tiles)",
+        default="rowmajor",
+    )
+    parser.add_argument(
+        "-s",
+        "--sparsity",
+        required=False,
+        type=str,
+        help='Magnitude-based 4x16 block pruning before export, e.g. "0.5" or "gru1=0.6,gru2=0.6,gru3=0.5,linear1=0" (use with -l bsr4x16)',
+        default=None,
+    )
+    parser.add_argument(
+        "-b",
+        "--bin_file",
+        required=False,
+        type=str,
+        help="Also write the quantized model as a binary model file (.jmpnn) loaded at runtime (testnr -w)",
+        default=None,
+    )
     args = parser.parse_args()
 
     model, configuration = load_model_and_config(args.model_file)
 
+    if args.sparsity is not None:
+        apply_block_pruning(model, parse_sparsity(args.sparsity))
+
     torch.manual_seed(configuration["seed"])
     np.random.seed(configuration["seed"])
 
@@ -669,6 +955,7 @@ if __name__ == "__main__":
 
     (ipt, out, state_in, state_out) = generate_test_vectors(model, configuration)
     dump_testvectors_Cfile(ipt, out, state_in, state_out, input_intBits=input_intBits)
+    s8_fracBits = calibrate_s8_frac_bits(model, configuration, io_size=io_size)
     # dump_model_to_Cfile(model, fname='./src/signalsifter_weights.c', datatype='float')
     # dump_model_to_Cfile(model, fname='./src/signalsifter_weights.c', datatype='int16_t')
 
@@ -684,5 +971,20 @@ if __name__ == "__main__":
         hop_length=hop_length,
         logmag_epsilon=logmag_epsilon,
         input_intBits=input_intBits,
+        weight_layout=args.weight_layout,
+        s8_fracBits=s8_fracBits,
     )
+    if args.bin_file is not None:
+        dump_model_to_binfile(
+            model,
+            args.bin_file,
+            w_datatype="int8_t",
+            b_datatype="int8_t",
+            io_size=io_size,
+            fft_size=fft_size,
+            hop_length=hop_length,
+            input_intBits=input_intBits,
+            weight_layout=args.weight_layout,
+            s8_fracBits=s8_fracBits,
+        )
     # dump_model_to_Cfile(model, fname='./src/signalsifter_weights.c', w_datatype='float', b_datatype='float')
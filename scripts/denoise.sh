@@ -39,7 +39,7 @@ process_file() {
     fi
 
     # Run denoising algorithm
-    "$TESTNR" -n "$naturalness" -m "$mingain" -i "$RAW_INPUT_FNAME" -o "$RAW_OUTPUT_FNAME" -r "$process_sample_rate"
+    "$TESTNR" -O -n "$naturalness" -m "$mingain" -i "$RAW_INPUT_FNAME" -o "$RAW_OUTPUT_FNAME" -r "$process_sample_rate"
 
     # Convert output to desired format and sample rate
     sox -r "$process_sample_rate" -b 16 -e signed-integer -L "$RAW_OUTPUT_FNAME" -r "$output_sample_rate" -b 16 -e signed-integer "$output_file"
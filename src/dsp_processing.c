@@ -22,40 +22,104 @@
 #include "fixed_point_math.h"
 #include "common_def.h"
 #include "dsplib.h"
+#include <pthread.h>
+#include <stdatomic.h>
 //#include "utils.h"
 
-#define IFFT_SCALE_FACTOR 1.0f/FFT_SIZE
-#define TWO_PI_BY_N 2.0f * M_PI/FFT_SIZE
+_Static_assert(STFT_MAX_FFT_SIZE >= FFT_SIZE, "STFT_MAX_FFT_SIZE must fit the compiled-in geometry");
+_Static_assert(STFT_MAX_NUM_BINS >= IO_SIZE, "the NN features are the first IO_SIZE bins");
 
-void create_stft(STFTStruct *stft)
+// Plans are only appended: a plan is complete before num_stft_plans (release) covers it,
+// so lookups need no lock; creation is serialized by stft_plans_lock.
+static STFTPlan stft_plans[STFT_MAX_PLANS];
+static atomic_int num_stft_plans;
+static pthread_mutex_t stft_plans_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int stft_geometry_supported(unsigned int nfft, unsigned int hop)
+{
+    return nfft >= 4 && nfft <= STFT_MAX_FFT_SIZE && (nfft & 1) == 0 && hop == (nfft >> 1);
+}
+
+static void create_stft_plan(STFTPlan *plan, unsigned int nfft)
 {
     int i;
     size_t memneeded;
-    stft->NFFT = FFT_SIZE;
-//    stft->R = R;
-    stft->NFFT_by_2 = FFT_SIZE >> 1;
-    stft->numBins = stft->NFFT_by_2 + 1;
-    
-    stft->FFTscale = 0.5f;
-    stft->IFFTscale = IFFT_SCALE_FACTOR;
+    plan->NFFT = nfft;
+    plan->numBins = (nfft >> 1) + 1;
+
+    plan->FFTscale = 0.5f;
+    plan->IFFTscale = 1.0f/nfft;
     //KISS_FFT
     memneeded = KISSFFT_MEMNEEDED;
-    stft->kissFFT_cfg = kiss_fftr_alloc(FFT_SIZE, 0, stft->kissFFTmem, &memneeded);
+    plan->kissFFT_cfg = kiss_fftr_alloc(nfft, 0, plan->kissFFTmem, &memneeded);
     memneeded = KISSFFT_MEMNEEDED;
-    stft->kissIFFT_cfg = kiss_fftr_alloc(FFT_SIZE, 1, stft->kissIFFTmem, &memneeded);
-    for (i=0; i<FFT_SIZE; i++)
+    plan->kissIFFT_cfg = kiss_fftr_alloc(nfft, 1, plan->kissIFFTmem, &memneeded);
+    for (i=0; i<nfft; i++)
     {
 #if XCHAL_HAVE_HIFI5
-        stft->window[i] = SQRT_S(0.5f - 0.5f * cosf(TWO_PI_BY_N * i));
+        plan->window[i] = SQRT_S(0.5f - 0.5f * cosf(2.0f * M_PI/nfft * i));
 #else
-        stft->window[i] = sqrtf(0.5f - 0.5f * cosf(TWO_PI_BY_N * i));
+        plan->window[i] = sqrtf(0.5f - 0.5f * cosf(2.0f * M_PI/nfft * i));
 #endif
     }
     //vDSP_hamm_window(stft->window, NFFT, 0);
     //vDSP_vfill(&temp, stft->window, 1, NFFT);
-    JMPDSP_vclr(stft->inputAux, 1, FFT_SIZE);
-    JMPDSP_vclr(stft->outputAux, 1, FFT_SIZE);
-    JMPDSP_vclr(stft->Xmag, 1, stft->numBins);
+}
+
+static const STFTPlan *find_stft_plan(unsigned int nfft, int num_plans)
+{
+    int i;
+
+    for (i=0; i<num_plans; i++)
+        if (stft_plans[i].NFFT == nfft)
+            return &stft_plans[i];
+    return NULL;
+}
+
+const STFTPlan *get_stft_plan(unsigned int nfft)
+{
+    const STFTPlan *plan;
+    int n;
+
+    if (!stft_geometry_supported(nfft, nfft >> 1))
+        return NULL;
+    plan = find_stft_plan(nfft, atomic_load_explicit(&num_stft_plans, memory_order_acquire));
+    if (plan)
+        return plan;
+    pthread_mutex_lock(&stft_plans_lock);
+    n = atomic_load_explicit(&num_stft_plans, memory_order_relaxed);
+    plan = find_stft_plan(nfft, n);     // built by another thread meanwhile
+    if (plan == NULL && n < STFT_MAX_PLANS)
+    {
+        create_stft_plan(&stft_plans[n], nfft);
+        plan = &stft_plans[n];
+        atomic_store_explicit(&num_stft_plans, n + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&stft_plans_lock);
+    return plan;
+}
+
+void create_stft(STFTStruct *stft)
+{
+    create_stft_geometry(stft, FFT_SIZE, HOP_LENGTH);
+}
+
+int create_stft_geometry(STFTStruct *stft, unsigned int nfft, unsigned int hop)
+{
+    const STFTPlan *plan = stft_geometry_supported(nfft, hop) ? get_stft_plan(nfft) : NULL;
+
+    if (plan == NULL)
+        return -1;
+    stft->plan = plan;
+    stft->NFFT = nfft;
+    stft->R = hop;
+    stft->NFFT_by_2 = nfft >> 1;
+    stft->numBins = plan->numBins;
+    JMPDSP_vclr(stft->inputAux, 1, STFT_MAX_FFT_SIZE);
+    JMPDSP_vclr(stft->outputAux, 1, STFT_MAX_FFT_SIZE);
+    JMPDSP_vclr(stft->Xmag, 1, STFT_MAX_NUM_BINS);
+    stft->energy = 0.0f;
+    return 0;
 }
 
 void destroy_stft(STFTStruct *stft)
@@ -68,6 +132,7 @@ void stft_process(STFTStruct *stft, const float *input, unsigned int R)
     
     perform_windowed_FFT(stft, input, R);
     compute_magSquared(stft->Xk, stft->Xmag, stft->numBins);
+    stft->energy = calculate_mean(stft->Xmag, stft->numBins);
     compute_logMag(stft->Xmag, stft->Xmag, stft->numBins, 10.0f);
     
 }
@@ -77,27 +142,44 @@ void istft_process(STFTStruct *stft, float *output, unsigned int R)
     perform_OLA_IFFT(stft, output, R);
 }
 
+/* stft_process + mask_process + istft_process of an all-zero input frame when the
+   whole analysis buffer is already zero: the spectrum is zero, so only the buffers
+   are advanced (the output is the same as the full chain, without the FFTs).
+ */
+void stft_zero_frame(STFTStruct *stft, float *output, unsigned int R)
+{
+    float zeros[STFT_MAX_FFT_SIZE];
+    JMPDSP_vclr(zeros, 1, R);
+    update_buffer(stft->inputAux, zeros, stft->NFFT, R);
+    memset(stft->Xk, 0, stft->numBins * sizeof(kiss_fft_cpx));
+    stft->energy = 0.0f;
+    update_buffer(stft->outputAux, zeros, stft->NFFT, R);
+    memcpy(output, stft->outputAux, R * sizeof(float));
+}
+
 void mask_process(STFTStruct *stft, float *mask)
 {
-    apply_spectrum_mask(stft->Xk, mask, stft->Yk, stft->numBins);
+    apply_spectrum_mask(stft->Xk, mask, stft->Xk, stft->numBins);
 }
 
 void perform_windowed_FFT(STFTStruct *stft, const float *input, unsigned int R)
 {
-    float windowedInput[FFT_SIZE];
+    float windowedInput[STFT_MAX_FFT_SIZE];
+    kiss_fft_cpx fftTmp[STFT_MAX_FFT_SIZE >> 1];
     update_buffer(stft->inputAux, input, stft->NFFT, R);
-    JMPDSP_vmul(stft->inputAux, 1, stft->window, 1, windowedInput, 1, stft->NFFT);
-    kiss_fftr(stft->kissFFT_cfg, windowedInput, stft->Xk); //KISS_FFT
+    JMPDSP_vmul(stft->inputAux, 1, stft->plan->window, 1, windowedInput, 1, stft->NFFT);
+    kiss_fftr_tmp(stft->plan->kissFFT_cfg, windowedInput, stft->Xk, fftTmp); //KISS_FFT, plan shared across threads
 }
 
 void perform_OLA_IFFT(STFTStruct *stft, float *out, unsigned int R)
 {
-    float windowedOutput[FFT_SIZE];
+    float windowedOutput[STFT_MAX_FFT_SIZE];
+    kiss_fft_cpx fftTmp[STFT_MAX_FFT_SIZE >> 1];
     JMPDSP_vclr(windowedOutput, 1, stft->NFFT);
     update_buffer(stft->outputAux, windowedOutput, stft->NFFT, R);
-    kiss_fftri(stft->kissIFFT_cfg, stft->Yk, windowedOutput);  //KISS_FFT
-    JMPDSP_vmul(windowedOutput, 1, stft->window, 1, windowedOutput, 1, stft->NFFT); //Since we are not using sqrt(hann), we don't need to apply window in synthesis
-    JMPDSP_vsmul(windowedOutput, 1, &stft->IFFTscale, windowedOutput, 1, stft->NFFT);
+    kiss_fftri_tmp(stft->plan->kissIFFT_cfg, stft->Xk, windowedOutput, fftTmp);  //KISS_FFT
+    JMPDSP_vmul(windowedOutput, 1, stft->plan->window, 1, windowedOutput, 1, stft->NFFT); //Since we are not using sqrt(hann), we don't need to apply window in synthesis
+    JMPDSP_vsmul(windowedOutput, 1, &stft->plan->IFFTscale, windowedOutput, 1, stft->NFFT);
     JMPDSP_vadd(stft->outputAux, 1, windowedOutput, 1, stft->outputAux, 1, stft->NFFT);
     memcpy(out, stft->outputAux, R * sizeof(float));
 }
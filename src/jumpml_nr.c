@@ -22,13 +22,40 @@
 #include "common_def.h"
 #include "resample.h"
 #include "biquad.h"
+#include "signalsifter_model_file.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+extern const SignalSifterModel ss_model;
+
+typedef struct stru_dsp_jmpnr_ctx
+{
+    atomic_int refcount;
+    unsigned int fft_size;
+    unsigned int hop_length;
+    const STFTPlan *plan;               // keeps the geometry's plan built
+    const SignalSifterModel *model;     // NULL: compiled-in
+    const NNGraph *graph;               // runs instead of model if set
+    size_t graph_state_size;
+    SignalSifterModelFile *model_file;  // jumpml_nr_context_load(), else NULL
+} DSP_JMPNR_CTX_STRU;
+
+// The graph state of a context's stream follows DSP_JMPNR_ST_STRU
+#define JMPNR_GRAPH_STATE_OFFSET ((sizeof(DSP_JMPNR_ST_STRU) + 15) & ~(size_t)15)
 
 uint32_t jumpml_nr_init(void *jmpnr_st_ptr, float naturalness, float min_gain)
+{
+    return jumpml_nr_init_geometry(jmpnr_st_ptr, naturalness, min_gain, FFT_SIZE, HOP_LENGTH);
+}
+
+uint32_t jumpml_nr_init_geometry(void *jmpnr_st_ptr, float naturalness, float min_gain,
+                                 unsigned int fft_size, unsigned int hop_length)
 {
     DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
     NRst->frameCount = 0;
     NRst->last_sample = 0.0f;
     NRst->NR_Ptr = (NoiseReductionStatePtr) NRst->NRState_buf;
+    NRst->ctx = NULL;
 
     NRst->hsparams.fc = JUMPML_NR_OUTPUT_HIGHSHELF_FC;
     NRst->hsparams.fs = JUMPML_NR_OUTPUT_HIGHSHELF_FS;  
@@ -37,50 +64,695 @@ uint32_t jumpml_nr_init(void *jmpnr_st_ptr, float naturalness, float min_gain)
     NRst->hsparams.type = HIGHSHELF;
     biquad_init(&NRst->hsfilter, &NRst->hsparams);
 
-    create_noise_reduction(NRst->NR_Ptr, naturalness, min_gain);
+    if (create_noise_reduction_geometry(NRst->NR_Ptr, naturalness, min_gain, fft_size, hop_length))
+        return 1;
+    jumpml_nr_stream_reset(jmpnr_st_ptr, 0);
     return 0;
 }
 
-void run_jumpml_nr_prediction(int16_t *output, int16_t *input, NoiseReductionStatePtr NRst_Ptr, BiquadFilter* hsf)
+uint32_t jumpml_nr_context_create(void **jmpnr_ctx_ptr, unsigned int fft_size, unsigned int hop_length,
+                                  const SignalSifterModel *model, const NNGraph *graph)
+{
+    DSP_JMPNR_CTX_STRU *ctx;
+    const STFTPlan *plan = stft_geometry_supported(fft_size, hop_length) ? get_stft_plan(fft_size) : NULL;
+
+    *jmpnr_ctx_ptr = NULL;
+    if (plan == NULL)
+        return 1;
+    if (graph)
+    {
+#if defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+        return 1;
+#endif
+        if (graph->input_size > plan->numBins || graph->output_size > plan->numBins)
+            return 1;
+    }
+    else if ((model ? model : &ss_model)->gru1_gru->input_size > plan->numBins)
+        return 1;
+    ctx = (DSP_JMPNR_CTX_STRU *) calloc(1, sizeof(DSP_JMPNR_CTX_STRU));
+    if (ctx == NULL)
+        return 1;
+    atomic_init(&ctx->refcount, 1);
+    ctx->fft_size = fft_size;
+    ctx->hop_length = hop_length;
+    ctx->plan = plan;
+    ctx->model = model;
+    ctx->graph = graph;
+    ctx->graph_state_size = graph ? (noise_reduction_graph_state_size(graph) + 15) & ~(size_t)15 : 0;
+    *jmpnr_ctx_ptr = ctx;
+    return 0;
+}
+
+uint32_t jumpml_nr_context_load(void **jmpnr_ctx_ptr, const char *model_path, int flags)
+{
+    SignalSifterModelFile *mf = (SignalSifterModelFile *) malloc(sizeof(SignalSifterModelFile));
+    uint32_t ret;
+
+    *jmpnr_ctx_ptr = NULL;
+    if (mf == NULL)
+        return 1;
+    if (loadSignalSifterModelFile(mf, model_path, flags))
+    {
+        free(mf);
+        return 1;
+    }
+#if defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    ret = mf->has_model ? jumpml_nr_context_create(jmpnr_ctx_ptr, mf->fft_size, mf->hop_length, &mf->model, NULL) : 1;
+#else
+    ret = jumpml_nr_context_create(jmpnr_ctx_ptr, mf->fft_size, mf->hop_length, NULL, &mf->graph);
+#endif
+    if (ret)
+    {
+        unloadSignalSifterModelFile(mf);
+        free(mf);
+        return 1;
+    }
+    ((DSP_JMPNR_CTX_STRU *) *jmpnr_ctx_ptr)->model_file = mf;
+    return 0;
+}
+
+void jumpml_nr_context_retain(void *jmpnr_ctx_ptr)
+{
+    DSP_JMPNR_CTX_STRU *ctx = (DSP_JMPNR_CTX_STRU *) jmpnr_ctx_ptr;
+    atomic_fetch_add_explicit(&ctx->refcount, 1, memory_order_relaxed);
+}
+
+void jumpml_nr_context_release(void *jmpnr_ctx_ptr)
+{
+    DSP_JMPNR_CTX_STRU *ctx = (DSP_JMPNR_CTX_STRU *) jmpnr_ctx_ptr;
+    if (ctx == NULL || atomic_fetch_sub_explicit(&ctx->refcount, 1, memory_order_acq_rel) != 1)
+        return;
+    if (ctx->model_file)
+    {
+        unloadSignalSifterModelFile(ctx->model_file);
+        free(ctx->model_file);
+    }
+    free(ctx);
+}
+
+size_t jumpml_nr_state_size(const void *jmpnr_ctx_ptr)
+{
+    const DSP_JMPNR_CTX_STRU *ctx = (const DSP_JMPNR_CTX_STRU *) jmpnr_ctx_ptr;
+    if (ctx == NULL)
+        return sizeof(DSP_JMPNR_ST_STRU);
+    return JMPNR_GRAPH_STATE_OFFSET + ctx->graph_state_size;
+}
+
+uint32_t jumpml_nr_init_context(void *jmpnr_st_ptr, void *jmpnr_ctx_ptr, float naturalness, float min_gain)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    DSP_JMPNR_CTX_STRU *ctx = (DSP_JMPNR_CTX_STRU *) jmpnr_ctx_ptr;
+    int ret = 0;
+
+    if (jumpml_nr_init_geometry(jmpnr_st_ptr, naturalness, min_gain, ctx->fft_size, ctx->hop_length))
+        return 1;
+    if (ctx->graph)
+        ret = noise_reduction_set_graph_state(NRst->NR_Ptr, ctx->graph, (char *) jmpnr_st_ptr + JMPNR_GRAPH_STATE_OFFSET);
+    else if (ctx->model)
+        ret = noise_reduction_set_model(NRst->NR_Ptr, ctx->model);
+    if (ret)
+    {
+        destroy_noise_reduction(NRst->NR_Ptr);
+        return 1;
+    }
+    jumpml_nr_context_retain(ctx);
+    NRst->ctx = ctx;
+    return 0;
+}
+
+void jumpml_nr_release(void *jmpnr_st_ptr)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    destroy_noise_reduction(NRst->NR_Ptr);
+    jumpml_nr_context_release(NRst->ctx);
+    NRst->ctx = NULL;
+}
+
+int jumpml_nr_frame_size(const void *jmpnr_st_ptr)
+{
+    const DSP_JMPNR_ST_STRU *NRst = (const DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return NRst->NR_Ptr->STFT.R;
+}
+
+uint32_t jumpml_nr_set_gate(void *jmpnr_st_ptr, int enable, float threshold_db, float state_decay)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    noise_reduction_set_gate(NRst->NR_Ptr, enable, threshold_db, state_decay);
+    return 0;
+}
+
+uint32_t jumpml_nr_set_delta_thresholds(void *jmpnr_st_ptr, int input_threshold, int state_threshold)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return noise_reduction_set_delta_thresholds(NRst->NR_Ptr, input_threshold, state_threshold) ? 1 : 0;
+}
+
+uint32_t jumpml_nr_set_model(void *jmpnr_st_ptr, const SignalSifterModel *model)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return noise_reduction_set_model(NRst->NR_Ptr, model) ? 1 : 0;
+}
+
+uint32_t jumpml_nr_set_graph(void *jmpnr_st_ptr, const NNGraph *graph)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return noise_reduction_set_graph(NRst->NR_Ptr, graph) ? 1 : 0;
+}
+
+uint32_t jumpml_nr_team_create(void **team_ptr, int num_threads, const int *cpus)
+{
+    return createNNTeam((NNTeam **) team_ptr, num_threads, cpus) ? 1 : 0;
+}
+
+void jumpml_nr_team_destroy(void *team_ptr)
+{
+    destroyNNTeam((NNTeam *) team_ptr);
+}
+
+uint32_t jumpml_nr_set_team(void *jmpnr_st_ptr, void *team_ptr)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return noise_reduction_set_team(NRst->NR_Ptr, (NNTeam *) team_ptr) ? 1 : 0;
+}
+
+uint32_t jumpml_nr_pipeline_create(void **pipeline_ptr, const int *cpus)
+{
+    return createSignalSifterPipeline_S16((SignalSifterPipeline_S16 **) pipeline_ptr, cpus) ? 1 : 0;
+}
+
+void jumpml_nr_pipeline_destroy(void *pipeline_ptr)
+{
+    destroySignalSifterPipeline_S16((SignalSifterPipeline_S16 *) pipeline_ptr);
+}
+
+uint32_t jumpml_nr_set_pipeline(void *jmpnr_st_ptr, void *pipeline_ptr)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return noise_reduction_set_pipeline(NRst->NR_Ptr, (SignalSifterPipeline_S16 *) pipeline_ptr) ? 1 : 0;
+}
+
+uint32_t jumpml_nr_worker_start(void *jmpnr_st_ptr, int cpu)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    return noise_reduction_start_worker(NRst->NR_Ptr, cpu) ? 1 : 0;
+}
+
+void jumpml_nr_worker_stop(void *jmpnr_st_ptr)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    noise_reduction_stop_worker(NRst->NR_Ptr);
+}
+
+void jumpml_nr_worker_stats(const void *jmpnr_st_ptr, NRWorkerStats *stats)
+{
+    const DSP_JMPNR_ST_STRU *NRst = (const DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    noise_reduction_worker_stats(NRst->NR_Ptr, stats);
+}
+
+static void jumpml_nr_input_frame(float *input_frame, const int16_t *input, int N)
 {
-    float input_frame[JUMPML_NR_FRAME_SIZE] __attribute__((aligned(16)));
-    float output_frame[JUMPML_NR_FRAME_SIZE] __attribute__((aligned(16)));
     int i;
-    for (i=0;i<JUMPML_NR_FRAME_SIZE;i++)
+    for (i=0;i<N;i++)
     {
         input_frame[i] = ((float) input[i]) / 32768.0f;
 #if JUMPML_NR_APPLY_INPUT_GAIN
         input_frame[i] = MAX(MIN(input_frame[i] * JUMPML_NR_INPUT_MIC_GAIN, 0.9999),-1.0);
 #endif
     }
-    noise_reduction_process(NRst_Ptr, input_frame, output_frame, JUMPML_NR_FRAME_SIZE);
+}
+
+// Interleaved frame of K channels (stride elements apart) to per-channel float frames
+static void jumpml_nr_input_channels(float (*input_frames)[JUMPML_NR_MAX_FRAME_SIZE], const void *input,
+                                     int format, int K, int stride, int N)
+{
+    const int16_t *in_S16 = (const int16_t *) input;
+    const float *in_F32 = (const float *) input;
+    int i, k;
+
+    for (i=0;i<N;i++)
+        for (k=0;k<K;k++)
+        {
+            input_frames[k][i] = format == JUMPML_NR_FORMAT_F32 ? in_F32[i*stride + k]
+                                                                : ((float) in_S16[i*stride + k]) / 32768.0f;
+#if JUMPML_NR_APPLY_INPUT_GAIN
+            input_frames[k][i] = MAX(MIN(input_frames[k][i] * JUMPML_NR_INPUT_MIC_GAIN, 0.9999),-1.0);
+#endif
+        }
+}
+
+static void jumpml_nr_output_frame(int16_t *output, float *output_frame, BiquadFilter* hsf, int N)
+{
+    int i;
 #if JUMPML_NR_APPLY_HIGHSHELF
-    biquad_process(hsf, output_frame, output_frame, JUMPML_NR_FRAME_SIZE);
+    biquad_process(hsf, output_frame, output_frame, N);
 #endif
-    for (i=0;i<JUMPML_NR_FRAME_SIZE;i++)
+    for (i=0;i<N;i++)
     {
 #if JUMPML_NR_APPLY_OUTPUT_GAIN
         output_frame[i] = MAX(MIN(output_frame[i] * JUMPML_NR_OUTPUT_GAIN, 0.9999),-1.0);
 #endif
         output[i] = ((short)(output_frame[i] * INT16_MAX));
     }
-    
+}
+
+static void jumpml_nr_output_channels(void *output, float (*output_frames)[JUMPML_NR_MAX_FRAME_SIZE],
+                                      DSP_JMPNR_ST_STRU * const *NRst, int format, int K, int stride, int N)
+{
+    int16_t *out_S16 = (int16_t *) output;
+    float *out_F32 = (float *) output;
+    int i, k;
+
+#if JUMPML_NR_APPLY_HIGHSHELF
+    for (k=0;k<K;k++)
+        biquad_process(&NRst[k]->hsfilter, output_frames[k], output_frames[k], N);
+#else
+    (void) NRst;
+#endif
+    for (i=0;i<N;i++)
+        for (k=0;k<K;k++)
+        {
+#if JUMPML_NR_APPLY_OUTPUT_GAIN
+            output_frames[k][i] = MAX(MIN(output_frames[k][i] * JUMPML_NR_OUTPUT_GAIN, 0.9999),-1.0);
+#endif
+            if (format == JUMPML_NR_FORMAT_F32)
+                out_F32[i*stride + k] = output_frames[k][i];
+            else
+                out_S16[i*stride + k] = ((short)(output_frames[k][i] * INT16_MAX));
+        }
+}
+
+void run_jumpml_nr_prediction(int16_t *output, int16_t *input, NoiseReductionStatePtr NRst_Ptr, BiquadFilter* hsf)
+{
+    float input_frame[JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    float output_frame[JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    int N = NRst_Ptr->STFT.R;
+    if (N <= 0)  // uninitialized instance
+        return;
+    jumpml_nr_input_frame(input_frame, input, N);
+    noise_reduction_process(NRst_Ptr, input_frame, output_frame, N);
+    jumpml_nr_output_frame(output, output_frame, hsf, N);
 }
 
 uint32_t jumpml_nr_proc(int16_t *output, int16_t *input, void *jmpnr_st_ptr, int sr)
 {
     DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
-    int16_t resampled_input[JUMPML_NR_FRAME_SIZE*2];
-    int16_t resampled_output[JUMPML_NR_FRAME_SIZE*2];
+    int16_t resampled_input[JUMPML_NR_MAX_FRAME_SIZE*2];
+    int16_t resampled_output[JUMPML_NR_MAX_FRAME_SIZE*2];
+    int N = jumpml_nr_frame_size(jmpnr_st_ptr);
 
     if (sr == 8000){
-        upsample_S16(input, resampled_input, JUMPML_NR_FRAME_SIZE, &(NRst->last_sample));
+        upsample_S16(input, resampled_input, N, &(NRst->last_sample));
         run_jumpml_nr_prediction(&resampled_output[0], &resampled_input[0], NRst->NR_Ptr, &NRst->hsfilter);
-        run_jumpml_nr_prediction(&resampled_output[JUMPML_NR_FRAME_SIZE], &resampled_input[JUMPML_NR_FRAME_SIZE], NRst->NR_Ptr, &NRst->hsfilter);
-        downsample_S16(resampled_output, output, JUMPML_NR_FRAME_SIZE);
+        run_jumpml_nr_prediction(&resampled_output[N], &resampled_input[N], NRst->NR_Ptr, &NRst->hsfilter);
+        downsample_S16(resampled_output, output, N);
     }
     else{
         run_jumpml_nr_prediction(output, input, NRst->NR_Ptr, &NRst->hsfilter);
     }
     return 0;
 }
+
+uint32_t jumpml_nr_stream_reset(void *jmpnr_st_ptr, int block_size)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    int N = jumpml_nr_frame_size(jmpnr_st_ptr);
+    int a = block_size > 0 ? block_size : 1, b = N, r;
+
+    while (b)           // gcd(block_size, N)
+    {
+        r = a % b;
+        a = b;
+        b = r;
+    }
+    NRst->streamInFill = 0;
+    NRst->streamOutRead = 0;
+    NRst->streamLatency = N - a;
+    // the latency is served as leading zeros
+    NRst->streamOutCount = NRst->streamLatency;
+    memset(NRst->streamOut, 0, NRst->streamLatency * sizeof(int16_t));
+    return 0;
+}
+
+int jumpml_nr_stream_latency(const void *jmpnr_st_ptr)
+{
+    return ((const DSP_JMPNR_ST_STRU *) jmpnr_st_ptr)->streamLatency;
+}
+
+// Moves up to n samples from the output ring to output; returns their number
+static int stream_ring_read(DSP_JMPNR_ST_STRU *NRst, int16_t *output, int n)
+{
+    int size = 2 * JUMPML_NR_MAX_FRAME_SIZE;
+    int first;
+
+    n = MIN(n, NRst->streamOutCount);
+    first = MIN(n, size - NRst->streamOutRead);
+    memcpy(output, &NRst->streamOut[NRst->streamOutRead], first * sizeof(int16_t));
+    memcpy(&output[first], NRst->streamOut, (n - first) * sizeof(int16_t));
+    NRst->streamOutRead = (NRst->streamOutRead + n) % size;
+    NRst->streamOutCount -= n;
+    return n;
+}
+
+static void stream_ring_write(DSP_JMPNR_ST_STRU *NRst, const int16_t *frame, int n)
+{
+    int size = 2 * JUMPML_NR_MAX_FRAME_SIZE;
+    int pos = (NRst->streamOutRead + NRst->streamOutCount) % size;
+    int first = MIN(n, size - pos);
+
+    memcpy(&NRst->streamOut[pos], frame, first * sizeof(int16_t));
+    memcpy(NRst->streamOut, &frame[first], (n - first) * sizeof(int16_t));
+    NRst->streamOutCount += n;
+}
+
+/* The ring holds the latency minus the partial input frame (at most 2N - 1 samples while a
+   frame is produced before the output is due), so a frame goes straight into output when the
+   ring is empty and it fits.
+ */
+uint32_t jumpml_nr_proc_stream(int16_t *output, const int16_t *input, int num_samples, void *jmpnr_st_ptr, int sr)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    int16_t frame[JUMPML_NR_MAX_FRAME_SIZE];
+    int N = jumpml_nr_frame_size(jmpnr_st_ptr);
+    int in_pos = 0, out_pos = 0, n;
+    int16_t *src;
+
+    while (in_pos < num_samples)
+    {
+        if (NRst->streamInFill == 0 && num_samples - in_pos >= N)
+        {
+            src = (int16_t *) &input[in_pos];
+            in_pos += N;
+        }
+        else
+        {
+            n = MIN(N - NRst->streamInFill, num_samples - in_pos);
+            memcpy(&NRst->streamIn[NRst->streamInFill], &input[in_pos], n * sizeof(int16_t));
+            NRst->streamInFill += n;
+            in_pos += n;
+            if (NRst->streamInFill < N)
+                break;
+            NRst->streamInFill = 0;
+            src = NRst->streamIn;
+        }
+        out_pos += stream_ring_read(NRst, &output[out_pos], num_samples - out_pos);
+        if (NRst->streamOutCount == 0 && num_samples - out_pos >= N)
+        {
+            jumpml_nr_proc(&output[out_pos], src, NRst, sr);
+            out_pos += N;
+        }
+        else
+        {
+            jumpml_nr_proc(frame, src, NRst, sr);
+            stream_ring_write(NRst, frame, N);
+        }
+    }
+    out_pos += stream_ring_read(NRst, &output[out_pos], num_samples - out_pos);
+    if (out_pos < num_samples)
+    {
+        // underrun: the output falls behind by the missing samples for good
+        memset(&output[out_pos], 0, (num_samples - out_pos) * sizeof(int16_t));
+        NRst->streamLatency += num_samples - out_pos;
+    }
+    return 0;
+}
+
+/* Processes num_frames consecutive frames of one instance in one call
+   (input/output hold num_frames*jumpml_nr_frame_size() samples) with the same
+   streaming semantics and output as num_frames calls of jumpml_nr_proc().
+   Each stage runs over a whole block of frames before the next: resampling
+   and int16->float conversion, the windowed FFTs, the NN (layer-major, input
+   projections as GEMMs, see noise_reduction_process_frames), ISTFT/OLA, the
+   output high-shelf and float->int16 conversion. Suited to callers that buffer
+   audio (file processing, recording pipelines, jitter buffers).
+ */
+uint32_t jumpml_nr_proc_batch(int16_t *output, const int16_t *input, int num_frames, void *jmpnr_st_ptr, int sr)
+{
+    DSP_JMPNR_ST_STRU *NRst = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptr;
+    float input_frames[JMPNN_SEQ_BLOCK * JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    float output_frames[JMPNN_SEQ_BLOCK * JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    int16_t resampled_input[JMPNN_SEQ_BLOCK * JUMPML_NR_MAX_FRAME_SIZE];
+    int16_t resampled_output[JMPNN_SEQ_BLOCK * JUMPML_NR_MAX_FRAME_SIZE];
+    int frame_size = jumpml_nr_frame_size(jmpnr_st_ptr);
+    int upsample = (sr == 8000) ? 2 : 1;
+    int block = JMPNN_SEQ_BLOCK / upsample;  // input frames per block
+    int t0, T, N;
+    const int16_t *in;
+    int16_t *out;
+
+    for (t0 = 0; t0 < num_frames; t0 += block)
+    {
+        T = MIN(block, num_frames - t0);
+        N = upsample * T * frame_size;  // samples at 16 kHz
+        in = &input[t0 * frame_size];
+        out = &output[t0 * frame_size];
+        if (upsample == 2)
+        {
+            upsample_S16(in, resampled_input, T * frame_size, &(NRst->last_sample));
+            in = resampled_input;
+            out = resampled_output;
+        }
+        jumpml_nr_input_frame(input_frames, in, N);
+        noise_reduction_process_frames(NRst->NR_Ptr, input_frames, output_frames, upsample * T, frame_size);
+        jumpml_nr_output_frame(out, output_frames, &NRst->hsfilter, N);
+        if (upsample == 2)
+            downsample_S16(resampled_output, &output[t0 * frame_size], T * frame_size);
+    }
+    return 0;
+}
+
+// One frame (frame_size samples) of num_streams (<= JMPNN_MAX_BATCH) instances at 16 kHz
+static void run_jumpml_nr_prediction_batch(int16_t * const *output, int16_t * const *input,
+                                           DSP_JMPNR_ST_STRU * const *NRst, int num_streams, int frame_size)
+{
+    float input_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    float output_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    // cleared: -Wmaybe-uninitialized cannot see num_streams >= 1 in the out-of-line copy
+    const float *in_ptrs[JMPNN_MAX_BATCH] = { NULL };
+    float *out_ptrs[JMPNN_MAX_BATCH] = { NULL };
+    NoiseReductionStatePtr nr[JMPNN_MAX_BATCH] = { NULL };
+    int k;
+
+    for (k=0;k<num_streams;k++)
+    {
+        jumpml_nr_input_frame(input_frames[k], input[k], frame_size);
+        in_ptrs[k] = input_frames[k];
+        out_ptrs[k] = output_frames[k];
+        nr[k] = NRst[k]->NR_Ptr;
+    }
+    noise_reduction_process_batch(nr, in_ptrs, out_ptrs, num_streams, frame_size);
+    for (k=0;k<num_streams;k++)
+        jumpml_nr_output_frame(output[k], output_frames[k], &NRst[k]->hsfilter, frame_size);
+}
+
+/* Same as calling jumpml_nr_proc() on every stream, with bit-exact results, but
+   the NN of up to JMPNN_MAX_BATCH streams is evaluated as one batched pass over
+   the weights. All streams use the same sample rate and frame size.
+ */
+uint32_t jumpml_nr_proc_streams(int16_t * const *output, int16_t * const *input, void * const *jmpnr_st_ptrs,
+                                int num_streams, int sr)
+{
+    DSP_JMPNR_ST_STRU *NRst[JMPNN_MAX_BATCH];
+    int16_t resampled_input[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE*2];
+    int16_t resampled_output[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE*2];
+    int16_t *in_ptrs[JMPNN_MAX_BATCH], *out_ptrs[JMPNN_MAX_BATCH];
+    int k, k0, K, half, N;
+
+    if (num_streams <= 0)
+        return 0;
+    N = jumpml_nr_frame_size(jmpnr_st_ptrs[0]);
+    for (k0=0;k0<num_streams;k0+=JMPNN_MAX_BATCH)
+    {
+        K = MIN(JMPNN_MAX_BATCH, num_streams - k0);
+        for (k=0;k<K;k++)
+            NRst[k] = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptrs[k0 + k];
+
+        if (sr == 8000){
+            for (k=0;k<K;k++)
+                upsample_S16(input[k0 + k], resampled_input[k], N, &(NRst[k]->last_sample));
+            for (half=0;half<2;half++)
+            {
+                for (k=0;k<K;k++)
+                {
+                    in_ptrs[k] = &resampled_input[k][half*N];
+                    out_ptrs[k] = &resampled_output[k][half*N];
+                }
+                run_jumpml_nr_prediction_batch(out_ptrs, in_ptrs, NRst, K, N);
+            }
+            for (k=0;k<K;k++)
+                downsample_S16(resampled_output[k], output[k0 + k], N);
+        }
+        else{
+            run_jumpml_nr_prediction_batch(&output[k0], &input[k0], NRst, K, N);
+        }
+    }
+    return 0;
+}
+
+// One frame of K (<= JMPNN_MAX_BATCH) interleaved channels at 16 kHz
+static void run_jumpml_nr_prediction_multi(void *output, const void *input, DSP_JMPNR_ST_STRU * const *NRst,
+                                           int format, int K, int stride, int frame_size)
+{
+    float input_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    float output_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    const float *in_ptrs[JMPNN_MAX_BATCH];
+    float *out_ptrs[JMPNN_MAX_BATCH];
+    NoiseReductionStatePtr nr[JMPNN_MAX_BATCH];
+    int k;
+
+    jumpml_nr_input_channels(input_frames, input, format, K, stride, frame_size);
+    for (k=0;k<K;k++)
+    {
+        in_ptrs[k] = input_frames[k];
+        out_ptrs[k] = output_frames[k];
+        nr[k] = NRst[k]->NR_Ptr;
+    }
+    noise_reduction_process_batch(nr, in_ptrs, out_ptrs, K, frame_size);
+    jumpml_nr_output_channels(output, output_frames, NRst, format, K, stride, frame_size);
+}
+
+// One frame of K (<= JUMPML_NR_MAX_LINKED) linked channels at 16 kHz, contiguous int16 per channel
+static void run_jumpml_nr_prediction_linked(int16_t * const *output, int16_t * const *input,
+                                            DSP_JMPNR_ST_STRU * const *NRst, int K, int link_mode, int frame_size)
+{
+    float input_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    float output_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    const float *in_ptrs[JMPNN_MAX_BATCH];
+    float *out_ptrs[JMPNN_MAX_BATCH];
+    NoiseReductionStatePtr nr[JMPNN_MAX_BATCH];
+    int k;
+
+    for (k=0;k<K;k++)
+    {
+        jumpml_nr_input_frame(input_frames[k], input[k], frame_size);
+        in_ptrs[k] = input_frames[k];
+        out_ptrs[k] = output_frames[k];
+        nr[k] = NRst[k]->NR_Ptr;
+    }
+    noise_reduction_process_linked(nr, in_ptrs, out_ptrs, K, link_mode, frame_size);
+    for (k=0;k<K;k++)
+        jumpml_nr_output_frame(output[k], output_frames[k], &NRst[k]->hsfilter, frame_size);
+}
+
+/* One frame of K (<= JMPNN_MAX_BATCH) interleaved channels at 8 kHz: each channel is
+   gathered into the int16 resamplers, the two 16 kHz halves run independently (link_mode
+   < 0) or linked, and the channels are scattered back.
+ */
+static void run_jumpml_nr_channels_8k(void *output, const void *input, DSP_JMPNR_ST_STRU * const *NRst,
+                                      int format, int K, int stride, int link_mode, int N)
+{
+    int16_t channel[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE];
+    int16_t resampled_input[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE*2];
+    int16_t resampled_output[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE*2];
+    int16_t *in_ptrs[JMPNN_MAX_BATCH], *out_ptrs[JMPNN_MAX_BATCH];
+    int i, k, half;
+
+    for (k=0;k<K;k++)
+    {
+        for (i=0;i<N;i++)
+            channel[k][i] = format == JUMPML_NR_FORMAT_F32
+                ? (int16_t) MAX(MIN(((const float *) input)[i*stride + k] * 32768.0f, INT16_MAX), INT16_MIN)
+                : ((const int16_t *) input)[i*stride + k];
+        upsample_S16(channel[k], resampled_input[k], N, &(NRst[k]->last_sample));
+    }
+    for (half=0;half<2;half++)
+    {
+        for (k=0;k<K;k++)
+        {
+            in_ptrs[k] = &resampled_input[k][half*N];
+            out_ptrs[k] = &resampled_output[k][half*N];
+        }
+        if (link_mode < 0)
+            run_jumpml_nr_prediction_batch(out_ptrs, in_ptrs, NRst, K, N);
+        else
+            run_jumpml_nr_prediction_linked(out_ptrs, in_ptrs, NRst, K, link_mode, N);
+    }
+    for (k=0;k<K;k++)
+    {
+        downsample_S16(resampled_output[k], channel[k], N);
+        for (i=0;i<N;i++)
+            if (format == JUMPML_NR_FORMAT_F32)
+                ((float *) output)[i*stride + k] = channel[k][i] / 32768.0f;
+            else
+                ((int16_t *) output)[i*stride + k] = channel[k][i];
+    }
+}
+
+/* One frame of num_channels interleaved channels: sample i of channel k is element
+   i*stride + k of input/output (int16_t or float, see JUMPML_NR_FORMAT_*), channel k runs
+   on instance jmpnr_st_ptrs[k]. Output may be input (in place). At 16 kHz the channels are
+   converted straight from and to the interleaved buffers and the NN runs batched across
+   them; the output matches jumpml_nr_proc() per channel. At 8 kHz each channel goes through
+   the int16 resamplers. Returns 1 for a bad format or stride.
+ */
+uint32_t jumpml_nr_proc_multi(void *output, const void *input, int format, int num_channels, int stride,
+                              void * const *jmpnr_st_ptrs, int sr)
+{
+    DSP_JMPNR_ST_STRU *NRst[JMPNN_MAX_BATCH];
+    size_t size = format == JUMPML_NR_FORMAT_F32 ? sizeof(float) : sizeof(int16_t);
+    int k, k0, K, N;
+
+    if ((format != JUMPML_NR_FORMAT_S16 && format != JUMPML_NR_FORMAT_F32) || stride < num_channels)
+        return 1;
+    if (num_channels <= 0)
+        return 0;
+    N = jumpml_nr_frame_size(jmpnr_st_ptrs[0]);
+    for (k0=0;k0<num_channels;k0+=JMPNN_MAX_BATCH)
+    {
+        const char *in = (const char *) input + k0 * size;
+        char *out = (char *) output + k0 * size;
+
+        K = MIN(JMPNN_MAX_BATCH, num_channels - k0);
+        for (k=0;k<K;k++)
+            NRst[k] = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptrs[k0 + k];
+        if (sr == 8000)
+            run_jumpml_nr_channels_8k(out, in, NRst, format, K, stride, -1, N);
+        else
+            run_jumpml_nr_prediction_multi(out, in, NRst, format, K, stride, N);
+    }
+    return 0;
+}
+
+/* jumpml_nr_proc_multi() with linked gains (noise_reduction_process_linked): the NN of
+   jmpnr_st_ptrs[0] runs once per frame on the combined channel (link_mode NR_LINK_MID or
+   NR_LINK_MAX) and the same gains are applied to every channel, which keeps the stereo
+   image. The instances of the other channels only hold their STFT buffers. Returns 1 for
+   a bad format or stride, more than JUMPML_NR_MAX_LINKED channels, or if the instance of
+   channel 0 runs a graph or a decoupled NN worker (nothing is processed then).
+ */
+uint32_t jumpml_nr_proc_linked(void *output, const void *input, int format, int num_channels, int stride,
+                               void * const *jmpnr_st_ptrs, int link_mode, int sr)
+{
+    DSP_JMPNR_ST_STRU *NRst[JMPNN_MAX_BATCH];
+    float input_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    float output_frames[JMPNN_MAX_BATCH][JUMPML_NR_MAX_FRAME_SIZE] __attribute__((aligned(16)));
+    const float *in_ptrs[JMPNN_MAX_BATCH];
+    float *out_ptrs[JMPNN_MAX_BATCH];
+    NoiseReductionStatePtr nr[JMPNN_MAX_BATCH];
+    int k, N;
+
+    if ((format != JUMPML_NR_FORMAT_S16 && format != JUMPML_NR_FORMAT_F32) || stride < num_channels ||
+        num_channels > JUMPML_NR_MAX_LINKED)
+        return 1;
+    if (num_channels <= 0)
+        return 0;
+    if (!noise_reduction_linked_supported(((DSP_JMPNR_ST_STRU *) jmpnr_st_ptrs[0])->NR_Ptr))
+        return 1;
+    N = jumpml_nr_frame_size(jmpnr_st_ptrs[0]);
+    for (k=0;k<num_channels;k++)
+    {
+        NRst[k] = (DSP_JMPNR_ST_STRU *) jmpnr_st_ptrs[k];
+        nr[k] = NRst[k]->NR_Ptr;
+        in_ptrs[k] = input_frames[k];
+        out_ptrs[k] = output_frames[k];
+    }
+
+    if (sr == 8000){
+        run_jumpml_nr_channels_8k(output, input, NRst, format, num_channels, stride, link_mode, N);
+    }
+    else{
+        jumpml_nr_input_channels(input_frames, input, format, num_channels, stride, N);
+        noise_reduction_process_linked(nr, in_ptrs, out_ptrs, num_channels, link_mode, N);
+        jumpml_nr_output_channels(output, output_frames, NRst, format, num_channels, stride, N);
+    }
+    return 0;
+}
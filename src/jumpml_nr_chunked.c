@@ -0,0 +1,223 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  jumpml_nr_chunked.c
+//
+//  Each thread (the caller is thread 0) owns one instance buffer and claims chunks from
+//  a shared counter; a chunk re-initializes the instance, runs its warm-up and its own
+//  frames with jumpml_nr_proc_batch, and writes straight into its part of the output.
+//
+#include "jumpml_nr_chunked.h"
+#include "jmpnn_thread.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    int16_t *output;
+    const int16_t *input;
+    int num_frames;
+    int num_chunks;
+    int warmup_frames;
+    void *ctx;
+    float naturalness;
+    float min_gain;
+    int sr;
+    size_t state_size;
+    atomic_int next_chunk;
+    atomic_int failed;
+} JMPNR_ChunkedJob;
+
+typedef struct {
+    JMPNR_ChunkedJob *job;
+    pthread_t thread;
+} JMPNR_ChunkedThread;
+
+static int chunk_begin(const JMPNR_ChunkedJob *job, int chunk)
+{
+    return (int)((int64_t)job->num_frames * chunk / job->num_chunks);
+}
+
+static uint32_t init_instance(void *st, void *ctx, float naturalness, float min_gain)
+{
+    if (ctx)
+        return jumpml_nr_init_context(st, ctx, naturalness, min_gain);
+    return jumpml_nr_init(st, naturalness, min_gain);
+}
+
+static void *chunked_thread(void *arg)
+{
+    JMPNR_ChunkedJob *job = ((JMPNR_ChunkedThread *)arg)->job;
+    int16_t *scratch = NULL;
+    void *st = NULL;
+    int chunk, N, begin, end, warmup;
+
+    if (posix_memalign(&st, 16, job->state_size))
+    {
+        atomic_store(&job->failed, 1);
+        return NULL;
+    }
+    while ((chunk = atomic_fetch_add(&job->next_chunk, 1)) < job->num_chunks)
+    {
+        if (init_instance(st, job->ctx, job->naturalness, job->min_gain))
+        {
+            atomic_store(&job->failed, 1);
+            break;
+        }
+        N = jumpml_nr_frame_size(st);
+        begin = chunk_begin(job, chunk);
+        end = chunk_begin(job, chunk + 1);
+        warmup = begin < job->warmup_frames ? begin : job->warmup_frames;
+        if (warmup > 0)
+        {
+            if (scratch == NULL)
+                scratch = (int16_t *)malloc((size_t)job->warmup_frames * N * sizeof(int16_t));
+            if (scratch == NULL)
+            {
+                atomic_store(&job->failed, 1);
+                jumpml_nr_release(st);
+                break;
+            }
+            jumpml_nr_proc_batch(scratch, &job->input[(size_t)(begin - warmup) * N], warmup, st, job->sr);
+        }
+        if (end > begin)
+            jumpml_nr_proc_batch(&job->output[(size_t)begin * N], &job->input[(size_t)begin * N],
+                                 end - begin, st, job->sr);
+        jumpml_nr_release(st);
+    }
+    free(scratch);
+    free(st);
+    return NULL;
+}
+
+// Deviation of the chunked output from the sequential one, per sample and per chunk start
+static void measure_deviation(const JMPNR_ChunkedJob *job, const int16_t *reference, int N,
+                              JMPNR_ChunkedReport *report)
+{
+    double sum_sq = 0.0;
+    int c, t, i, d, begin, end, settle;
+
+    report->max_abs_error = 0;
+    report->mismatched_samples = 0;
+    report->settle_frames = 0;
+    for (c = 0; c < job->num_chunks; c++)
+    {
+        begin = chunk_begin(job, c);
+        end = chunk_begin(job, c + 1);
+        settle = 0;
+        for (t = begin; t < end; t++)
+            for (i = 0; i < N; i++)
+            {
+                d = abs(job->output[(size_t)t * N + i] - reference[(size_t)t * N + i]);
+                if (d == 0)
+                    continue;
+                sum_sq += (double)d * d;
+                report->mismatched_samples++;
+                report->max_abs_error = d > report->max_abs_error ? d : report->max_abs_error;
+                settle = t - begin + 1;
+            }
+        report->settle_frames = settle > report->settle_frames ? settle : report->settle_frames;
+    }
+    report->rms_error = job->num_frames > 0 ? sqrt(sum_sq / ((double)job->num_frames * N)) : 0.0;
+}
+
+uint32_t jumpml_nr_proc_chunked(int16_t *output, const int16_t *input, int num_frames, void *jmpnr_ctx_ptr,
+                                float naturalness, float min_gain, int sr,
+                                const JMPNR_ChunkedConfig *cfg, JMPNR_ChunkedReport *report)
+{
+    JMPNR_ChunkedJob job;
+    JMPNR_ChunkedThread threads[JMPNR_CHUNKED_MAX_THREADS];
+    int16_t *reference;
+    void *st;
+    int i, num_threads = cfg->num_threads, num_started = 0, N;
+    uint64_t t0;
+
+    if (num_frames < 0 || num_threads < 0 || num_threads > JMPNR_CHUNKED_MAX_THREADS ||
+        cfg->num_chunks < 0 || cfg->warmup_frames < 0)
+        return 1;
+    if (num_threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus < 1 ? 1 : cpus > JMPNR_CHUNKED_MAX_THREADS ? JMPNR_CHUNKED_MAX_THREADS : (int)cpus;
+    }
+    job.output = output;
+    job.input = input;
+    job.num_frames = num_frames;
+    job.num_chunks = cfg->num_chunks > 0 ? cfg->num_chunks : num_threads;
+    job.warmup_frames = cfg->warmup_frames;
+    job.ctx = jmpnr_ctx_ptr;
+    job.naturalness = naturalness;
+    job.min_gain = min_gain;
+    job.sr = sr;
+    job.state_size = jumpml_nr_state_size(jmpnr_ctx_ptr);
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.failed, 0);
+    if (num_threads > job.num_chunks)
+        num_threads = job.num_chunks;
+
+    t0 = jmpnn_now_ns();
+    for (i = 1; i < num_threads; i++)
+    {
+        threads[i].job = &job;
+        if (pthread_create(&threads[i].thread, NULL, chunked_thread, &threads[i]))
+            break;
+        num_started++;
+        if (cfg->pin_workers)
+            jmpnn_pin_thread(threads[i].thread, cfg->cpus ? cfg->cpus[i] : i);
+    }
+    // the caller is thread 0; the chunks of a thread that did not start go to the others
+    threads[0].job = &job;
+    chunked_thread(&threads[0]);
+    for (i = 1; i <= num_started; i++)
+        pthread_join(threads[i].thread, NULL);
+    if (atomic_load(&job.failed))
+        return 1;
+    if (report == NULL)
+        return 0;
+    memset(report, 0, sizeof(JMPNR_ChunkedReport));
+    report->num_chunks = job.num_chunks;
+    report->num_threads = num_started + 1;
+    report->chunked_ns = jmpnn_now_ns() - t0;
+    if (!cfg->verify)
+        return 0;
+
+    st = NULL;
+    if (posix_memalign(&st, 16, job.state_size))
+        return 1;
+    if (init_instance(st, jmpnr_ctx_ptr, naturalness, min_gain))
+    {
+        free(st);
+        return 1;
+    }
+    N = jumpml_nr_frame_size(st);
+    reference = (int16_t *)malloc((size_t)(num_frames > 0 ? num_frames : 1) * N * sizeof(int16_t));
+    if (reference == NULL)
+    {
+        jumpml_nr_release(st);
+        free(st);
+        return 1;
+    }
+    t0 = jmpnn_now_ns();
+    jumpml_nr_proc_batch(reference, input, num_frames, st, sr);
+    report->sequential_ns = jmpnn_now_ns() - t0;
+    measure_deviation(&job, reference, N, report);
+    free(reference);
+    jumpml_nr_release(st);
+    free(st);
+    return 0;
+}
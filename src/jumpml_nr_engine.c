@@ -0,0 +1,592 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  jumpml_nr_engine.c
+//
+//  The scheduling unit is a stream, not a frame: a stream is in at most one deque
+//  (its scheduled flag), and the worker that pops it runs its pending frames in order.
+//  That keeps the per-stream ordering without locks on the stream state. Producers
+//  fill a per-stream single-producer/single-consumer ring of frames.
+//
+//  The completion queue is a mutex-protected ring the workers append to. Each submit
+//  takes a credit that the poll of its completion returns, so the ring (completion_slots
+//  entries, one credit each) cannot overflow and a caller that stops polling is refused
+//  further frames instead of growing it.
+//
+#include "jumpml_nr_engine.h"
+#include "jmpnn_thread.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+typedef struct {
+    void *st;                       // jumpml_nr instance, NULL: free slot
+    int sr;
+    int frame_size;
+    JMPNR_EngineFrameDone done;
+    void *user;
+    int16_t *input;                 // queue_frames ring of frame_size samples
+    int16_t **output;               // queue_frames ring
+    uint64_t *tags;                 // queue_frames ring
+    atomic_uint head;               // frames taken by workers
+    atomic_uint tail;               // frames submitted
+    atomic_int scheduled;           // in a deque or being run
+    atomic_int home;                // worker that ran it last
+    uint64_t frames;
+    uint64_t busy_ns;
+    atomic_ullong dropped;          // bumped by any submitting thread
+} __attribute__((aligned(JMPNN_CACHE_LINE))) JMPNR_Stream;
+
+// Mutex-protected ring of stream ids: the owner pops the front, thieves take the back
+typedef struct {
+    pthread_mutex_t lock;
+    int *ids;
+    int front;
+    int count;
+    pthread_t thread;
+    int index;
+    uint64_t frames;
+    uint64_t busy_ns;
+    uint64_t steals;
+    struct stru_jmpnr_engine *engine;
+} __attribute__((aligned(JMPNN_CACHE_LINE))) JMPNR_Worker;
+
+typedef struct stru_jmpnr_engine {
+    int num_workers;
+    int num_inited;                 // workers whose lock is initialized
+    int num_started;                // worker threads running
+    int max_streams;
+    int queue_frames;
+    JMPNR_Worker *workers;
+    JMPNR_Stream *streams;
+    atomic_int queued;              // streams in the deques
+    atomic_int pending;             // frames submitted, not yet processed
+    atomic_int sleepers;            // workers waiting on work_cv
+    atomic_int waiters;             // threads waiting on idle_cv
+    atomic_int stop;
+    pthread_mutex_t lock;           // sleeping, waiting and stream slots
+    pthread_cond_t work_cv;
+    pthread_cond_t idle_cv;
+    JMPNR_Completion *completions;  // completion queue (completion_slots ring), NULL: none
+    int completion_slots;
+    int cq_front;                   // under cq_lock
+    int cq_count;
+    int cq_waiters;
+    atomic_int cq_credits;          // frames submitted whose completion has not been polled
+    int efd;                        // eventfd, -1: none
+    pthread_mutex_t cq_lock;
+    pthread_cond_t cq_cv;           // CLOCK_MONOTONIC
+} JMPNR_Engine;
+
+static void deque_push(JMPNR_Worker *w, int id, int capacity)
+{
+    pthread_mutex_lock(&w->lock);
+    w->ids[(w->front + w->count) % capacity] = id;
+    w->count++;
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Front (owner) or back (thief) of the deque; -1 if empty
+static int deque_take(JMPNR_Worker *w, int back, int capacity)
+{
+    int id = -1;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->count)
+    {
+        w->count--;
+        if (back)
+            id = w->ids[(w->front + w->count) % capacity];
+        else
+        {
+            id = w->ids[w->front];
+            w->front = (w->front + 1) % capacity;
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+    return id;
+}
+
+static void schedule_stream(JMPNR_Engine *e, int id, int worker)
+{
+    deque_push(&e->workers[worker], id, e->max_streams);
+    atomic_fetch_add(&e->queued, 1);
+    if (atomic_load(&e->sleepers))
+    {
+        pthread_mutex_lock(&e->lock);
+        pthread_cond_signal(&e->work_cv);
+        pthread_mutex_unlock(&e->lock);
+    }
+}
+
+static void notify_waiters(JMPNR_Engine *e)
+{
+    if (atomic_load(&e->waiters))
+    {
+        pthread_mutex_lock(&e->lock);
+        pthread_cond_broadcast(&e->idle_cv);
+        pthread_mutex_unlock(&e->lock);
+    }
+}
+
+// Own deque first, then the others starting after this worker (spreads the thieves)
+static int find_stream(JMPNR_Engine *e, JMPNR_Worker *w)
+{
+    int id = deque_take(w, 0, e->max_streams);
+    int k;
+
+    for (k = 1; id < 0 && k < e->num_workers; k++)
+    {
+        id = deque_take(&e->workers[(w->index + k) % e->num_workers], 1, e->max_streams);
+        if (id >= 0)
+            w->steals++;
+    }
+    if (id >= 0)
+        atomic_fetch_sub(&e->queued, 1);
+    return id;
+}
+
+static void push_completion(JMPNR_Engine *e, int id, int16_t *output, uint64_t tag)
+{
+    JMPNR_Completion *c;
+
+    pthread_mutex_lock(&e->cq_lock);
+    c = &e->completions[(e->cq_front + e->cq_count) % e->completion_slots];
+    c->stream_id = id;
+    c->output = output;
+    c->tag = tag;
+#ifdef __linux__
+    if (e->cq_count == 0 && e->efd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ret = write(e->efd, &one, sizeof(one));     // cannot block: read back to 0 whenever the queue empties
+        (void)ret;
+    }
+#endif
+    e->cq_count++;
+    if (e->cq_waiters)
+        pthread_cond_signal(&e->cq_cv);
+    pthread_mutex_unlock(&e->cq_lock);
+}
+
+// Frames that were pending when the stream was taken; a stream fed faster than it is
+// processed goes back to the deque so it cannot starve the others
+static void run_stream(JMPNR_Engine *e, JMPNR_Worker *w, int id)
+{
+    JMPNR_Stream *s = &e->streams[id];
+    unsigned int head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+    uint64_t t0 = jmpnn_now_ns(), dt;
+    int n = tail - head;
+
+    atomic_store_explicit(&s->home, w->index, memory_order_relaxed);
+    for (; head != tail; head++)
+    {
+        int slot = head % e->queue_frames;
+        int16_t *output = s->output[slot];
+        uint64_t tag = s->tags[slot];
+
+        jumpml_nr_proc(output, &s->input[slot * s->frame_size], s->st, s->sr);
+        atomic_store_explicit(&s->head, head + 1, memory_order_release);
+        if (s->done)
+            s->done(s->user, id, output);
+        if (e->completions)
+            push_completion(e, id, output, tag);
+    }
+    dt = jmpnn_now_ns() - t0;
+    s->frames += n;
+    s->busy_ns += dt;
+    w->frames += n;
+    w->busy_ns += dt;
+
+    if (atomic_load_explicit(&s->tail, memory_order_acquire) != head)
+        schedule_stream(e, id, w->index);
+    else
+    {
+        atomic_store(&s->scheduled, 0);
+        // a submit between the tail check and the store saw scheduled set
+        if (atomic_load(&s->tail) != head && atomic_exchange(&s->scheduled, 1) == 0)
+            schedule_stream(e, id, w->index);
+    }
+    if (atomic_fetch_sub(&e->pending, n) == n || !atomic_load(&s->scheduled))
+        notify_waiters(e);
+}
+
+static void *worker_main(void *arg)
+{
+    JMPNR_Worker *w = (JMPNR_Worker *)arg;
+    JMPNR_Engine *e = w->engine;
+
+    for (;;)
+    {
+        int id = find_stream(e, w);
+
+        if (id >= 0)
+        {
+            run_stream(e, w, id);
+            continue;
+        }
+        pthread_mutex_lock(&e->lock);
+        atomic_fetch_add(&e->sleepers, 1);
+        while (atomic_load(&e->queued) == 0 && !atomic_load(&e->stop))
+            pthread_cond_wait(&e->work_cv, &e->lock);
+        atomic_fetch_sub(&e->sleepers, 1);
+        pthread_mutex_unlock(&e->lock);
+        if (atomic_load(&e->stop) && atomic_load(&e->queued) == 0)
+            break;
+    }
+    return NULL;
+}
+
+static void free_stream(JMPNR_Stream *s)
+{
+    free(s->input);
+    free(s->output);
+    free(s->tags);
+    s->input = NULL;
+    s->output = NULL;
+    s->tags = NULL;
+    s->st = NULL;
+}
+
+uint32_t jumpml_nr_engine_create(void **engine_ptr, const JMPNR_EngineConfig *cfg)
+{
+    JMPNR_Engine *e;
+    pthread_condattr_t cq_attr;
+    int i, ok = 1;
+
+    *engine_ptr = NULL;
+    if (cfg->max_streams <= 0 || cfg->num_workers < 0 || cfg->num_workers > JMPNR_ENGINE_MAX_WORKERS ||
+        cfg->completion_slots < 0)
+        return 1;
+    e = (JMPNR_Engine *)calloc(1, sizeof(JMPNR_Engine));
+    if (e == NULL)
+        return 1;
+    e->efd = -1;
+    pthread_mutex_init(&e->cq_lock, NULL);
+    pthread_condattr_init(&cq_attr);
+    pthread_condattr_setclock(&cq_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&e->cq_cv, &cq_attr);
+    pthread_condattr_destroy(&cq_attr);
+    e->num_workers = cfg->num_workers;
+    if (e->num_workers == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        e->num_workers = cpus < 1 ? 1 : cpus > JMPNR_ENGINE_MAX_WORKERS ? JMPNR_ENGINE_MAX_WORKERS : (int)cpus;
+    }
+    e->max_streams = cfg->max_streams;
+    e->queue_frames = cfg->queue_frames > 0 ? cfg->queue_frames : JMPNR_ENGINE_QUEUE_FRAMES;
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->work_cv, NULL);
+    pthread_cond_init(&e->idle_cv, NULL);
+
+    if (posix_memalign((void **)&e->streams, JMPNN_CACHE_LINE, e->max_streams * sizeof(JMPNR_Stream)))
+    {
+        e->streams = NULL;
+        jumpml_nr_engine_destroy(e);
+        return 1;
+    }
+    memset(e->streams, 0, e->max_streams * sizeof(JMPNR_Stream));
+    if (posix_memalign((void **)&e->workers, JMPNN_CACHE_LINE, e->num_workers * sizeof(JMPNR_Worker)))
+    {
+        e->workers = NULL;
+        jumpml_nr_engine_destroy(e);
+        return 1;
+    }
+    memset(e->workers, 0, e->num_workers * sizeof(JMPNR_Worker));
+    if (cfg->completion_slots > 0)
+    {
+        e->completion_slots = cfg->completion_slots;
+        e->completions = (JMPNR_Completion *)malloc(e->completion_slots * sizeof(JMPNR_Completion));
+#ifdef __linux__
+        if (cfg->use_eventfd)
+            e->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+        if (e->completions == NULL || (cfg->use_eventfd && e->efd < 0))
+        {
+            jumpml_nr_engine_destroy(e);
+            return 1;
+        }
+    }
+    // every deque exists before the first thief looks at it
+    for (i = 0; i < e->num_workers; i++)
+    {
+        JMPNR_Worker *w = &e->workers[i];
+
+        w->index = i;
+        w->engine = e;
+        pthread_mutex_init(&w->lock, NULL);
+        e->num_inited++;
+        w->ids = (int *)malloc(e->max_streams * sizeof(int));
+        ok &= w->ids != NULL;
+    }
+    for (i = 0; ok && i < e->num_workers; i++)
+    {
+        ok = pthread_create(&e->workers[i].thread, NULL, worker_main, &e->workers[i]) == 0;
+        e->num_started += ok;
+        if (ok && cfg->pin_workers)
+            jmpnn_pin_thread(e->workers[i].thread, cfg->cpus ? cfg->cpus[i] : i);
+    }
+    if (!ok)
+    {
+        jumpml_nr_engine_destroy(e);
+        return 1;
+    }
+    *engine_ptr = e;
+    return 0;
+}
+
+void jumpml_nr_engine_destroy(void *engine_ptr)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+    int i;
+
+    if (e == NULL)
+        return;
+    if (e->workers)
+    {
+        jumpml_nr_engine_wait(e);
+        pthread_mutex_lock(&e->lock);
+        atomic_store(&e->stop, 1);
+        pthread_cond_broadcast(&e->work_cv);
+        pthread_mutex_unlock(&e->lock);
+        for (i = 0; i < e->num_started; i++)
+            pthread_join(e->workers[i].thread, NULL);
+        for (i = 0; i < e->num_inited; i++)
+        {
+            pthread_mutex_destroy(&e->workers[i].lock);
+            free(e->workers[i].ids);
+        }
+    }
+    if (e->streams)
+        for (i = 0; i < e->max_streams; i++)
+            free_stream(&e->streams[i]);
+    free(e->workers);
+    free(e->streams);
+    pthread_mutex_destroy(&e->lock);
+    pthread_cond_destroy(&e->work_cv);
+    pthread_cond_destroy(&e->idle_cv);
+    free(e->completions);
+    if (e->efd >= 0)
+        close(e->efd);
+    pthread_mutex_destroy(&e->cq_lock);
+    pthread_cond_destroy(&e->cq_cv);
+    free(e);
+}
+
+int jumpml_nr_engine_add_stream(void *engine_ptr, void *jmpnr_st_ptr, int sr, JMPNR_EngineFrameDone done, void *user)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+    int id;
+
+    pthread_mutex_lock(&e->lock);
+    for (id = 0; id < e->max_streams && e->streams[id].st; id++)
+        ;
+    if (id < e->max_streams)
+    {
+        JMPNR_Stream *s = &e->streams[id];
+
+        s->frame_size = jumpml_nr_frame_size(jmpnr_st_ptr);
+        s->input = (int16_t *)malloc(e->queue_frames * s->frame_size * sizeof(int16_t));
+        s->output = (int16_t **)malloc(e->queue_frames * sizeof(int16_t *));
+        s->tags = (uint64_t *)malloc(e->queue_frames * sizeof(uint64_t));
+        if (s->input && s->output && s->tags)
+        {
+            s->st = jmpnr_st_ptr;
+            s->sr = sr;
+            s->done = done;
+            s->user = user;
+            atomic_store(&s->head, 0);
+            atomic_store(&s->tail, 0);
+            atomic_store(&s->scheduled, 0);
+            atomic_store(&s->home, id % e->num_workers);
+            s->frames = s->busy_ns = 0;
+            atomic_store(&s->dropped, 0);
+        }
+        else
+        {
+            free_stream(s);
+            id = e->max_streams;
+        }
+    }
+    pthread_mutex_unlock(&e->lock);
+    return id < e->max_streams ? id : -1;
+}
+
+void jumpml_nr_engine_remove_stream(void *engine_ptr, int stream_id)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+    JMPNR_Stream *s = &e->streams[stream_id];
+
+    pthread_mutex_lock(&e->lock);
+    atomic_fetch_add(&e->waiters, 1);
+    while (atomic_load(&s->scheduled))
+        pthread_cond_wait(&e->idle_cv, &e->lock);
+    atomic_fetch_sub(&e->waiters, 1);
+    free_stream(s);
+    pthread_mutex_unlock(&e->lock);
+}
+
+uint32_t jumpml_nr_engine_submit(void *engine_ptr, int stream_id, const int16_t *input, int16_t *output)
+{
+    return jumpml_nr_engine_submit_tagged(engine_ptr, stream_id, input, output, 0);
+}
+
+uint32_t jumpml_nr_engine_submit_tagged(void *engine_ptr, int stream_id, const int16_t *input, int16_t *output,
+                                        uint64_t tag)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+    JMPNR_Stream *s = &e->streams[stream_id];
+    unsigned int tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    int slot = tail % e->queue_frames;
+
+    if (tail - atomic_load_explicit(&s->head, memory_order_acquire) >= (unsigned int)e->queue_frames)
+    {
+        atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+        return 1;
+    }
+    if (e->completions && atomic_fetch_add(&e->cq_credits, 1) >= e->completion_slots)
+    {
+        atomic_fetch_sub(&e->cq_credits, 1);
+        atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+        return 1;
+    }
+    memcpy(&s->input[slot * s->frame_size], input, s->frame_size * sizeof(int16_t));
+    s->output[slot] = output;
+    s->tags[slot] = tag;
+    atomic_fetch_add(&e->pending, 1);
+    atomic_store_explicit(&s->tail, tail + 1, memory_order_release);
+    if (atomic_exchange(&s->scheduled, 1) == 0)
+        schedule_stream(e, stream_id, atomic_load_explicit(&s->home, memory_order_relaxed));
+    return 0;
+}
+
+void jumpml_nr_engine_wait(void *engine_ptr)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+
+    pthread_mutex_lock(&e->lock);
+    atomic_fetch_add(&e->waiters, 1);
+    while (atomic_load(&e->pending))
+        pthread_cond_wait(&e->idle_cv, &e->lock);
+    atomic_fetch_sub(&e->waiters, 1);
+    pthread_mutex_unlock(&e->lock);
+}
+
+// Under cq_lock
+static int take_completions(JMPNR_Engine *e, JMPNR_Completion *completions, int max)
+{
+    int n = 0;
+
+    for (; n < max && e->cq_count; n++)
+    {
+        completions[n] = e->completions[e->cq_front];
+        e->cq_front = (e->cq_front + 1) % e->completion_slots;
+        e->cq_count--;
+    }
+#ifdef __linux__
+    if (n && e->cq_count == 0 && e->efd >= 0)
+    {
+        uint64_t count;
+        ssize_t ret = read(e->efd, &count, sizeof(count));
+        (void)ret;
+    }
+#endif
+    atomic_fetch_sub(&e->cq_credits, n);
+    return n;
+}
+
+int jumpml_nr_engine_poll(void *engine_ptr, JMPNR_Completion *completions, int max)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+    int n;
+
+    if (e->completions == NULL)
+        return 0;
+    pthread_mutex_lock(&e->cq_lock);
+    n = take_completions(e, completions, max);
+    pthread_mutex_unlock(&e->cq_lock);
+    return n;
+}
+
+int jumpml_nr_engine_wait_completions(void *engine_ptr, JMPNR_Completion *completions, int max, int timeout_ms)
+{
+    JMPNR_Engine *e = (JMPNR_Engine *)engine_ptr;
+    struct timespec deadline;
+    int n, timed_out = 0;
+
+    if (e->completions == NULL)
+        return 0;
+    if (timeout_ms >= 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    pthread_mutex_lock(&e->cq_lock);
+    e->cq_waiters++;
+    while (e->cq_count == 0 && !timed_out)
+    {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&e->cq_cv, &e->cq_lock);
+        else
+            timed_out = pthread_cond_timedwait(&e->cq_cv, &e->cq_lock, &deadline) != 0;
+    }
+    e->cq_waiters--;
+    n = take_completions(e, completions, max);
+    pthread_mutex_unlock(&e->cq_lock);
+    return n;
+}
+
+int jumpml_nr_engine_eventfd(const void *engine_ptr)
+{
+    return ((const JMPNR_Engine *)engine_ptr)->efd;
+}
+
+int jumpml_nr_engine_num_workers(const void *engine_ptr)
+{
+    return ((const JMPNR_Engine *)engine_ptr)->num_workers;
+}
+
+// Exact once jumpml_nr_engine_wait() returned; approximate while frames are running
+void jumpml_nr_engine_worker_stats(const void *engine_ptr, int worker, JMPNR_WorkerStats *stats)
+{
+    const JMPNR_Worker *w = &((const JMPNR_Engine *)engine_ptr)->workers[worker];
+
+    stats->frames = w->frames;
+    stats->busy_ns = w->busy_ns;
+    stats->steals = w->steals;
+}
+
+void jumpml_nr_engine_stream_stats(const void *engine_ptr, int stream_id, JMPNR_StreamStats *stats)
+{
+    const JMPNR_Stream *s = &((const JMPNR_Engine *)engine_ptr)->streams[stream_id];
+
+    stats->frames = s->frames;
+    stats->busy_ns = s->busy_ns;
+    stats->dropped = atomic_load_explicit(&s->dropped, memory_order_relaxed);
+    stats->last_worker = atomic_load_explicit(&s->home, memory_order_relaxed);
+}
@@ -0,0 +1,212 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  nn_graph.c
+//
+#include "nn_graph.h"
+#include <string.h>
+
+_Static_assert(JMPNN_MAX_WIDTH >= MAX_NEURONS, "JMPNN_MAX_WIDTH must fit the compiled-in model");
+
+// GRU states start on 16-element boundaries of the stream state
+#define NNGRAPH_STATE_ALIGN(n)  (((n) + 15) & ~15)
+
+void initNNGraph(NNGraph *g)
+{
+    memset(g, 0, sizeof(NNGraph));
+}
+
+// Next layer slot if a layer of the given sizes fits the chain, NULL otherwise
+static NNGraphLayer *next_layer(NNGraph *g, int input_size, int output_size)
+{
+    if (g->num_layers == NNGRAPH_MAX_LAYERS || input_size <= 0 || output_size <= 0 ||
+        input_size > JMPNN_MAX_WIDTH || output_size > JMPNN_MAX_WIDTH ||
+        (g->num_layers && input_size != g->output_size))
+        return NULL;
+    return &g->layers[g->num_layers];
+}
+
+// Q format (fraction bits) of the input of the next layer
+static int next_input_frac_bits(const NNGraph *g)
+{
+    if (g->num_layers == 0)
+        return INPUT_NUM_FRAC_BITS;
+    return g->layers[g->num_layers - 1].type == NNGRAPH_LAYER_GRU ? GRU_NUM_FRAC_BITS : LIN_NUM_FRAC_BITS;
+}
+
+static void append_layer(NNGraph *g, NNGraphLayer *L)
+{
+    if (g->num_layers == 0)
+        g->input_size = L->input_size;
+    g->output_size = L->output_size;
+    g->num_layers++;
+}
+
+int addNNGraphGRULayer(NNGraph *g, const GRULayer *gru)
+{
+    NNGraphLayer *L = next_layer(g, gru->input_size, gru->hidden_size);
+    int in_frac_bits = next_input_frac_bits(g);
+
+    if (L == NULL || JMPNN_get_activation_S16(gru->activation) == NULL)
+        return -1;
+    memset(L, 0, sizeof(NNGraphLayer));
+    L->type = NNGRAPH_LAYER_GRU;
+    L->gru = gru;
+    L->input_size = gru->input_size;
+    L->output_size = gru->hidden_size;
+    L->bias_left_shift = in_frac_bits;
+    L->output_right_shift = in_frac_bits + WAB_FRAC_BITS - GRU_NUM_FRAC_BITS;
+    L->state_offset = g->state_len;
+    g->state_len += NNGRAPH_STATE_ALIGN(gru->hidden_size);
+    append_layer(g, L);
+    return 0;
+}
+
+int addNNGraphLinearLayer(NNGraph *g, const LinearLayer *layer)
+{
+    NNGraphLayer *L = next_layer(g, layer->input_size, layer->hidden_size);
+    int in_frac_bits = next_input_frac_bits(g);
+    JMPNN_ActivationFn_S16 act_S16;
+    JMPNN_ActivationFn_F32 act_F32;
+
+    if (L == NULL)
+        return -1;
+    act_S16 = JMPNN_get_activation_S16(layer->activation);
+    act_F32 = JMPNN_get_activation_F32(layer->activation);
+    if (act_S16 == NULL || act_F32 == NULL)
+        return -1;
+    memset(L, 0, sizeof(NNGraphLayer));
+    L->type = NNGRAPH_LAYER_LINEAR;
+    L->linear = layer;
+    L->input_size = layer->input_size;
+    L->output_size = layer->hidden_size;
+    L->bias_left_shift = in_frac_bits;
+    L->output_right_shift = in_frac_bits + WAB_FRAC_BITS - LIN_NUM_FRAC_BITS;
+    L->state_offset = -1;
+    L->activation_S16 = act_S16;
+    L->activation_F32 = act_F32;
+    append_layer(g, L);
+    return 0;
+}
+
+int createNNGraphFromSignalSifterModel(NNGraph *g, const SignalSifterModel *model)
+{
+    initNNGraph(g);
+    if (addNNGraphGRULayer(g, model->gru1_gru) || addNNGraphGRULayer(g, model->gru2_gru) ||
+        addNNGraphGRULayer(g, model->gru3_gru) || addNNGraphLinearLayer(g, model->linear1_linear))
+    {
+        initNNGraph(g);
+        return -1;
+    }
+    return 0;
+}
+
+size_t getNNGraphStateSize_S16(const NNGraph *g)
+{
+    return g->state_len * sizeof(int16_t);
+}
+
+void createNNGraphState_S16(NNGraphState_S16 *st, const NNGraph *g, void *mem)
+{
+    st->graph = g;
+    st->state = (int16_t *)mem;
+    resetNNGraphState_S16(st);
+}
+
+void resetNNGraphState_S16(NNGraphState_S16 *st)
+{
+    memset(st->state, 0, getNNGraphStateSize_S16(st->graph));
+}
+
+/* One time step of all layers. Linear layers between (or after) GRUs write to two
+   ping-pong scratch vectors; GRU layers update their state in place, which is also
+   the input of the next layer.
+ */
+void computeNNGraph_S16(NNGraphState_S16 *st, int16_t *output, const int16_t *input)
+{
+    const NNGraph *g = st->graph;
+    int16_t scratch[2][JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t out_S32[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    const int16_t *x = input;
+    int16_t *y;
+    int l, last = g->num_layers - 1;
+
+    for (l = 0; l <= last; l++)
+    {
+        const NNGraphLayer *L = &g->layers[l];
+
+        if (L->type == NNGRAPH_LAYER_GRU)
+        {
+            y = &st->state[L->state_offset];
+            computeGRULayer_S16(L->gru, y, x, L->bias_left_shift, L->output_right_shift,
+                                GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+            if (l == last)
+                memcpy(output, y, L->output_size * sizeof(int16_t));
+        }
+        else
+        {
+            y = l == last ? output : scratch[l & 1];
+            computeLinearLayerPreact_S16(L->linear, out_S32, x, L->bias_left_shift, L->output_right_shift);
+            L->activation_S16(y, out_S32, L->output_size);
+        }
+        x = y;
+    }
+}
+
+size_t getNNGraphStateSize(const NNGraph *g)
+{
+    return g->state_len * sizeof(float);
+}
+
+void createNNGraphState(NNGraphState *st, const NNGraph *g, void *mem)
+{
+    st->graph = g;
+    st->state = (float *)mem;
+    resetNNGraphState(st);
+}
+
+void resetNNGraphState(NNGraphState *st)
+{
+    memset(st->state, 0, getNNGraphStateSize(st->graph));
+}
+
+void computeNNGraph(NNGraphState *st, float *output, const float *input)
+{
+    const NNGraph *g = st->graph;
+    float scratch[2][JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    const float *x = input;
+    float *y;
+    int l, last = g->num_layers - 1;
+
+    for (l = 0; l <= last; l++)
+    {
+        const NNGraphLayer *L = &g->layers[l];
+
+        if (L->type == NNGRAPH_LAYER_GRU)
+        {
+            y = &st->state[L->state_offset];
+            computeGRULayer(L->gru, y, x);
+            if (l == last)
+                memcpy(output, y, L->output_size * sizeof(float));
+        }
+        else
+        {
+            y = l == last ? output : scratch[l & 1];
+            computeLinearLayerPreact(L->linear, y, x);
+            L->activation_F32(y, y, L->output_size);
+        }
+        x = y;
+    }
+}
@@ -22,32 +22,94 @@
 #include <stdio.h>
 #include <float.h>
 #include <assert.h>
+#include <string.h>
+#include <stdlib.h>
 
 #include "nn_layers.h"
 #include "nnlib_fixedpt.h"
+#include "nn_layers_tools.h"
+#include "nn_team.h"
 #include "signalsifter_config.h"
 
+// Weights and bias only: the Q3.15 (SLIMIT 19-bit) pre-activation, to which
+// computeLinearLayer_S16() applies layer->activation
+void computeLinearLayerPreact_S16(const LinearLayer *layer, int32_t *out_S32, const int16_t *input,
+                                  uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    if (layer->layout == WEIGHTS_LAYOUT_TILED4x16)
+        JMPNN_linear_matXvec_S8xS16_S32_tiled(layer->weights, input, layer->bias, out_S32,
+                                              layer->input_size, layer->hidden_size,
+                                              bias_left_shift, output_right_shift);
+    else if (layer->layout == WEIGHTS_LAYOUT_BSR4x16)
+        JMPNN_linear_matXvec_S8xS16_S32_bsr(layer->weights, layer->weights_index, input, layer->bias, out_S32,
+                                            layer->input_size, layer->hidden_size,
+                                            bias_left_shift, output_right_shift);
+    else
+        JMPNN_linear_matXvec_S8xS16_S32(layer->weights, input, layer->bias, out_S32,
+                                        layer->input_size, layer->hidden_size,
+                                        bias_left_shift, output_right_shift);
+}
+
 void computeLinearLayer_S16(const LinearLayer *layer, int16_t *output, const int16_t *input,
                             uint16_t bias_left_shift, uint16_t output_right_shift)
 {
-    int32_t out_S32[MAX_NEURONS];
-    
-    JMPNN_linear_matXvec_S8xS16_S32(layer->weights, input, layer->bias, out_S32,
-                                    layer->input_size, layer->hidden_size,
-                                    bias_left_shift, output_right_shift);
-    
+    int32_t out_S32[JMPNN_MAX_WIDTH];
+
+    computeLinearLayerPreact_S16(layer, out_S32, input, bias_left_shift, output_right_shift);
     JMPNN_apply_activation_S16(output, out_S32, layer->hidden_size, layer->activation);
 }
 
+typedef struct {
+    const GRULayer *gru;
+    const int16_t *state;
+    const int16_t *input;
+    int16_t *z;
+    int16_t *n;
+    uint16_t Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift;
+} GRUTeamTask_S16;
+
+static void gru_gates_team_task_S16(void *arg, int member, int num_members)
+{
+    const GRUTeamTask_S16 *t = arg;
+    const GRULayer *gru = t->gru;
+    int begin, end;
+
+    getNNTeamRange(gru->hidden_size, member, num_members, &begin, &end);
+    if (begin < end)
+        JMPNN_gru_gates_S8xS16_S16(gru->input_weights, t->input, gru->bias,
+                                   gru->recurrent_weights, t->state, gru->recurrent_bias, t->z, t->n,
+                                   gru->input_size, gru->hidden_size, begin, end,
+                                   t->Bi_left_shift, t->outi_right_shift, t->Bh_left_shift, t->outh_right_shift,
+                                   gru->activation);
+}
+
 void computeGRULayer_S16(const GRULayer *gru, int16_t *state, const int16_t *input,
                          uint16_t Bi_left_shift, uint16_t outi_right_shift,
                          uint16_t Bh_left_shift, uint16_t outh_right_shift)
 {
-
+    if (gru->layout == WEIGHTS_LAYOUT_TILED4x16)
+    {
+        JMPNN_gru_cell_S8xS16_S16_tiled(gru->input_weights, input, gru->bias,
+                                        gru->recurrent_weights, state, gru->recurrent_bias,
+                                        gru->input_size, gru->hidden_size,
+                                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift,
+                                        gru->activation);
+        return;
+    }
+    if (gru->layout == WEIGHTS_LAYOUT_BSR4x16)
+    {
+        JMPNN_gru_cell_S8xS16_S16_bsr(gru->input_weights, gru->input_weights_index, input, gru->bias,
+                                      gru->recurrent_weights, gru->recurrent_weights_index, state, gru->recurrent_bias,
+                                      gru->input_size, gru->hidden_size,
+                                      Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift,
+                                      gru->activation);
+        return;
+    }
+#if XCHAL_HAVE_HIFI5
     int Ni = gru->hidden_size * gru->input_size;
     int Nh = gru->hidden_size * gru->hidden_size;
     int N = gru->hidden_size;
-    int16_t z[MAX_NEURONS]; int16_t r[MAX_NEURONS]; int16_t h[MAX_NEURONS];
+    int16_t z[JMPNN_MAX_WIDTH]; int16_t r[JMPNN_MAX_WIDTH]; int16_t h[JMPNN_MAX_WIDTH];
     
     JMPNN_gru_matXvec_S8xS16_S16_act(gru->input_weights, input, gru->bias,
                                      gru->recurrent_weights, state, gru->recurrent_bias,
@@ -68,4 +130,201 @@ void computeGRULayer_S16(const GRULayer *gru, int16_t *state, const int16_t *inp
                                      gru->activation);
     
     JMPNN_vec_interpolation_S16(state, z, state, h, gru->hidden_size);
+#else
+    NNTeam *team = getNNLayerTeam();
+    if (team && gru->hidden_size % NNTEAM_UNIT_ALIGN == 0 && gru->hidden_size > NNTEAM_UNIT_ALIGN)
+    {
+        // gates of unit ranges on the team, then the state update once all have read state
+        int16_t z[JMPNN_MAX_WIDTH], n[JMPNN_MAX_WIDTH];
+        GRUTeamTask_S16 t = { gru, state, input, z, n,
+                              Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift };
+        runNNTeam(team, gru_gates_team_task_S16, &t);
+        JMPNN_vec_interpolation_S16(state, z, state, n, gru->hidden_size);
+        return;
+    }
+    JMPNN_gru_cell_S8xS16_S16(gru->input_weights, input, gru->bias,
+                              gru->recurrent_weights, state, gru->recurrent_bias,
+                              gru->input_size, gru->hidden_size,
+                              Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift,
+                              gru->activation);
+#endif
  }
+
+// Batched layers: num_streams independent vectors (stream k at k*stride) share one
+// pass over the weights. Tiled and block-sparse weights fall back to one call per stream.
+void computeLinearLayerBatch_S16(const LinearLayer *layer, int16_t *output, JMPDSP_Stride output_stride,
+                                 const int16_t *input, JMPDSP_Stride input_stride, int num_streams,
+                                 uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int32_t out_S32[JMPNN_MAX_BATCH * JMPNN_MAX_WIDTH];
+    int k, k0, K;
+
+    if (layer->layout != WEIGHTS_LAYOUT_ROWMAJOR)
+    {
+        for (k = 0; k < num_streams; k++)
+            computeLinearLayer_S16(layer, &output[k * output_stride], &input[k * input_stride],
+                                   bias_left_shift, output_right_shift);
+        return;
+    }
+    for (k0 = 0; k0 < num_streams; k0 += JMPNN_MAX_BATCH)
+    {
+        K = MIN(JMPNN_MAX_BATCH, num_streams - k0);
+        JMPNN_linear_matXmat_S8xS16_S32(layer->weights, &input[k0 * input_stride], layer->bias, out_S32,
+                                        layer->input_size, layer->hidden_size, K, input_stride, JMPNN_MAX_WIDTH,
+                                        bias_left_shift, output_right_shift);
+        for (k = 0; k < K; k++)
+            JMPNN_apply_activation_S16(&output[(k0 + k) * output_stride], &out_S32[k * JMPNN_MAX_WIDTH],
+                                       layer->hidden_size, layer->activation);
+    }
+}
+
+void computeGRULayerBatch_S16(const GRULayer *gru, int16_t *state, JMPDSP_Stride state_stride,
+                              const int16_t *input, JMPDSP_Stride input_stride, int num_streams,
+                              uint16_t Bi_left_shift, uint16_t outi_right_shift,
+                              uint16_t Bh_left_shift, uint16_t outh_right_shift)
+{
+    int k;
+
+    if (gru->layout != WEIGHTS_LAYOUT_ROWMAJOR)
+    {
+        for (k = 0; k < num_streams; k++)
+            computeGRULayer_S16(gru, &state[k * state_stride], &input[k * input_stride],
+                                Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+        return;
+    }
+    JMPNN_gru_cell_batch_S8xS16_S16(gru->input_weights, input, gru->bias,
+                                    gru->recurrent_weights, state, gru->recurrent_bias,
+                                    gru->input_size, gru->hidden_size, num_streams, input_stride, state_stride,
+                                    Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift,
+                                    gru->activation);
+}
+
+// Runs the GRU over num_frames consecutive inputs of one stream; h_t goes to output[t*output_stride]
+void computeGRULayerSeq_S16(const GRULayer *gru, int16_t *state, int16_t *output, JMPDSP_Stride output_stride,
+                            const int16_t *input, JMPDSP_Stride input_stride, int num_frames,
+                            uint16_t Bi_left_shift, uint16_t outi_right_shift,
+                            uint16_t Bh_left_shift, uint16_t outh_right_shift)
+{
+    int t;
+
+    if (gru->layout != WEIGHTS_LAYOUT_ROWMAJOR)
+    {
+        for (t = 0; t < num_frames; t++)
+        {
+            computeGRULayer_S16(gru, state, &input[t * input_stride],
+                                Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+            memcpy(&output[t * output_stride], state, gru->hidden_size * sizeof(int16_t));
+        }
+        return;
+    }
+    JMPNN_gru_seq_S8xS16_S16(gru->input_weights, input, gru->bias,
+                             gru->recurrent_weights, state, gru->recurrent_bias, output,
+                             gru->input_size, gru->hidden_size, num_frames, input_stride, output_stride,
+                             Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift,
+                             gru->activation);
+}
+
+// Int8 activations (row-major weights only): Q15 int16 outputs from int8 inputs with input_frac_bits
+void computeLinearLayer_S8(const LinearLayer *layer, int16_t *output, const int8_t *input, uint16_t input_frac_bits)
+{
+    int32_t out_S32[JMPNN_MAX_WIDTH];
+
+    assert(layer->layout == WEIGHTS_LAYOUT_ROWMAJOR);
+    JMPNN_linear_matXvec_S8xS8_S32(layer->weights, input, layer->bias, out_S32,
+                                   layer->input_size, layer->hidden_size, input_frac_bits);
+    JMPNN_apply_activation_S16(output, out_S32, layer->hidden_size, layer->activation);
+}
+
+void computeGRULayer_S8(const GRULayer *gru, int8_t *state, const int8_t *input,
+                        uint16_t input_frac_bits, uint16_t state_frac_bits)
+{
+    assert(gru->layout == WEIGHTS_LAYOUT_ROWMAJOR);
+    JMPNN_gru_cell_S8xS8_S8(gru->input_weights, input, gru->bias,
+                            gru->recurrent_weights, state, gru->recurrent_bias,
+                            gru->input_size, gru->hidden_size,
+                            input_frac_bits, state_frac_bits, gru->activation);
+}
+
+// Delta inference: the column-pair weight copies are built once per layer and shared
+// by every stream. Returns 0, or -1 if the allocation failed.
+int createDeltaLinearLayer(DeltaLinearLayer *dl, const LinearLayer *layer)
+{
+    assert(layer->layout == WEIGHTS_LAYOUT_ROWMAJOR);
+    dl->layer = layer;
+    dl->weights_t = malloc(layer->hidden_size * JMPNN_COLPAIR_COLS(layer->input_size) * sizeof(nnWeight));
+    if (dl->weights_t == NULL)
+        return -1;
+    packWeightsColumnPairs(dl->weights_t, layer->weights, layer->hidden_size, layer->input_size);
+    return 0;
+}
+
+void destroyDeltaLinearLayer(DeltaLinearLayer *dl)
+{
+    free(dl->weights_t);
+    dl->weights_t = NULL;
+}
+
+int createDeltaGRULayer(DeltaGRULayer *dl, const GRULayer *gru)
+{
+    int N = gru->hidden_size;
+
+    assert(gru->layout == WEIGHTS_LAYOUT_ROWMAJOR);
+    dl->gru = gru;
+    dl->input_weights_t = malloc(3 * N * JMPNN_COLPAIR_COLS(gru->input_size) * sizeof(nnWeight));
+    dl->recurrent_weights_t = malloc(3 * N * JMPNN_COLPAIR_COLS(N) * sizeof(nnWeight));
+    if (dl->input_weights_t == NULL || dl->recurrent_weights_t == NULL)
+    {
+        destroyDeltaGRULayer(dl);
+        return -1;
+    }
+    packWeightsColumnPairs(dl->input_weights_t, gru->input_weights, 3 * N, gru->input_size);
+    packWeightsColumnPairs(dl->recurrent_weights_t, gru->recurrent_weights, 3 * N, N);
+    return 0;
+}
+
+void destroyDeltaGRULayer(DeltaGRULayer *dl)
+{
+    free(dl->input_weights_t);
+    free(dl->recurrent_weights_t);
+    dl->input_weights_t = NULL;
+    dl->recurrent_weights_t = NULL;
+}
+
+// All-zero references and products, consistent with a zero initial input/state
+void resetDeltaLinearState_S16(DeltaLinearState_S16 *ds)
+{
+    memset(ds, 0, sizeof(*ds));
+}
+
+void resetDeltaGRUState_S16(DeltaGRUState_S16 *ds)
+{
+    memset(ds, 0, sizeof(*ds));
+}
+
+void computeDeltaLinearLayer_S16(const DeltaLinearLayer *dl, DeltaLinearState_S16 *ds, int16_t *output, const int16_t *input,
+                                 int16_t input_threshold, uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    const LinearLayer *layer = dl->layer;
+    int32_t out_S32[JMPNN_MAX_WIDTH];
+
+    ds->cols_applied += JMPNN_linear_matXvec_delta_S8xS16_S32(dl->weights_t, input, ds->input_ref, ds->acc, layer->bias, out_S32,
+                                                              layer->input_size, layer->hidden_size,
+                                                              input_threshold, bias_left_shift, output_right_shift);
+    ds->cols_total += layer->input_size;
+    JMPNN_apply_activation_S16(output, out_S32, layer->hidden_size, layer->activation);
+}
+
+void computeDeltaGRULayer_S16(const DeltaGRULayer *dl, DeltaGRUState_S16 *ds, int16_t *state, const int16_t *input,
+                              int16_t input_threshold, int16_t state_threshold,
+                              uint16_t Bi_left_shift, uint16_t outi_right_shift,
+                              uint16_t Bh_left_shift, uint16_t outh_right_shift)
+{
+    const GRULayer *gru = dl->gru;
+
+    ds->cols_applied += JMPNN_gru_cell_delta_S8xS16_S16(dl->input_weights_t, input, ds->input_ref, ds->acci, gru->bias,
+                                                        dl->recurrent_weights_t, state, ds->state_ref, ds->acch, gru->recurrent_bias,
+                                                        gru->input_size, gru->hidden_size, input_threshold, state_threshold,
+                                                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift,
+                                                        gru->activation);
+    ds->cols_total += gru->input_size + gru->hidden_size;
+}
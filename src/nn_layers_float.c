@@ -25,19 +25,74 @@
 
 #include "nn_layers.h"
 #include "nnlib_float.h"
+#include "nn_team.h"
+
+// Weights and bias only; computeLinearLayer() applies layer->activation to it
+void computeLinearLayerPreact(const LinearLayer *layer, float *output, const float *input)
+{
+    if (layer->layout == WEIGHTS_LAYOUT_TILED4x16)
+        JMPNN_linear_matXvec_S8xF32_F32_tiled(layer->weights, input, layer->bias, output,
+                                              layer->input_size, layer->hidden_size,
+                                              WEIGHTS_SCALE, BIAS_SCALE);
+    else if (layer->layout == WEIGHTS_LAYOUT_BSR4x16)
+        JMPNN_linear_matXvec_S8xF32_F32_bsr(layer->weights, layer->weights_index, input, layer->bias, output,
+                                            layer->input_size, layer->hidden_size,
+                                            WEIGHTS_SCALE, BIAS_SCALE);
+    else
+        JMPNN_linear_matXvec_S8xF32_F32(layer->weights, input, layer->bias, output,
+                                        layer->input_size, layer->hidden_size,
+                                        WEIGHTS_SCALE, BIAS_SCALE);
+}
 
 void computeLinearLayer(const LinearLayer *layer, float *output, const float *input)
 {
-    JMPNN_linear_matXvec_S8xF32_F32(layer->weights, input, layer->bias, output,
-                                    layer->input_size, layer->hidden_size,
-                                    WEIGHTS_SCALE, BIAS_SCALE);
+    computeLinearLayerPreact(layer, output, input);
     JMPNN_apply_activation_F32(output, layer->hidden_size, layer->activation);
 }
 
 
+typedef struct {
+    const GRULayer *gru;
+    const float *state;
+    const float *input;
+    float *z;
+    float *n;
+} GRUTeamTask;
+
+static void gru_gates_team_task(void *arg, int member, int num_members)
+{
+    const GRUTeamTask *t = arg;
+    const GRULayer *gru = t->gru;
+    int begin, end;
+
+    getNNTeamRange(gru->hidden_size, member, num_members, &begin, &end);
+    if (begin < end)
+        JMPNN_gru_gates_S8xF32_F32(gru->input_weights, t->input, gru->bias,
+                                   gru->recurrent_weights, t->state, gru->recurrent_bias, t->z, t->n,
+                                   gru->input_size, gru->hidden_size, begin, end,
+                                   WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+}
+
 void computeGRULayer(const GRULayer *gru, float *state, const float *input)
 {
-    float z[MAX_NEURONS]; float r[MAX_NEURONS]; float h[MAX_NEURONS];
+    if (gru->layout == WEIGHTS_LAYOUT_TILED4x16)
+    {
+        JMPNN_gru_cell_S8xF32_F32_tiled(gru->input_weights, input, gru->bias,
+                                        gru->recurrent_weights, state, gru->recurrent_bias,
+                                        gru->input_size, gru->hidden_size,
+                                        WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+        return;
+    }
+    if (gru->layout == WEIGHTS_LAYOUT_BSR4x16)
+    {
+        JMPNN_gru_cell_S8xF32_F32_bsr(gru->input_weights, gru->input_weights_index, input, gru->bias,
+                                      gru->recurrent_weights, gru->recurrent_weights_index, state, gru->recurrent_bias,
+                                      gru->input_size, gru->hidden_size,
+                                      WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+        return;
+    }
+#ifdef USE_NEON
+    float z[JMPNN_MAX_WIDTH]; float r[JMPNN_MAX_WIDTH]; float h[JMPNN_MAX_WIDTH];
     
     int Ni = gru->hidden_size * gru->input_size;
     int Nh = gru->hidden_size * gru->hidden_size;
@@ -58,6 +113,20 @@ void computeGRULayer(const GRULayer *gru, float *state, const float *input)
                                      h, gru->input_size, gru->hidden_size,
                                      WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
     JMPNN_vec_interpolation_F32(state, z, state, h, gru->hidden_size);
-                                       
-
+#else
+    NNTeam *team = getNNLayerTeam();
+    if (team && gru->hidden_size % NNTEAM_UNIT_ALIGN == 0 && gru->hidden_size > NNTEAM_UNIT_ALIGN)
+    {
+        // gates of unit ranges on the team, then the state update once all have read state
+        float z[JMPNN_MAX_WIDTH], n[JMPNN_MAX_WIDTH];
+        GRUTeamTask t = { gru, state, input, z, n };
+        runNNTeam(team, gru_gates_team_task, &t);
+        JMPNN_vec_interpolation_F32(state, z, state, n, gru->hidden_size);
+        return;
+    }
+    JMPNN_gru_cell_S8xF32_F32(gru->input_weights, input, gru->bias,
+                              gru->recurrent_weights, state, gru->recurrent_bias,
+                              gru->input_size, gru->hidden_size,
+                              WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+#endif
 }
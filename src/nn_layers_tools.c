@@ -22,6 +22,8 @@
 #include <stdio.h>
 #include <float.h>
 #include <assert.h>
+#include <string.h>
+#include <stdlib.h>
 
 #include "nn_layers_tools.h"
 
@@ -112,3 +114,96 @@ void computeLayerStats(LayerStats *ls, const float *A, JMPDSP_Stride iA, JMPDSP_
     val = sqrtf(val - mean * mean);
     ls->std = 0.1f * val  + 0.9f * ls->std;
 }
+
+void packWeightsTiled4x16(nnWeight *dst, const nnWeight *src, int rows, int cols)
+{
+    int i, j;
+    memset(dst, 0, JMPNN_TILED4x16_ROWS(rows) * JMPNN_TILED4x16_COLS(cols) * sizeof(nnWeight));
+    for (i = 0; i < rows; i++)
+        for (j = 0; j < cols; j++)
+            dst[JMPNN_TILED4x16_INDEX(i, j, cols)] = src[i*cols + j];
+}
+
+void packWeightsColumnPairs(nnWeight *dst, const nnWeight *src, int rows, int cols)
+{
+    int i, j;
+    memset(dst, 0, rows * JMPNN_COLPAIR_COLS(cols) * sizeof(nnWeight));
+    for (i = 0; i < rows; i++)
+        for (j = 0; j < cols; j++)
+            dst[JMPNN_COLPAIR_INDEX(i, j, rows)] = src[i*cols + j];
+}
+
+int packWeightsBSR4x16(nnWeight *dst, uint16_t *index, const nnWeight *src, int rows, int cols)
+{
+    int g, b, i, j, k, nz;
+    int G = JMPNN_BSR4x16_GROUPS(rows);
+    int num_tiles = 0;
+    uint16_t *col = &index[G + 1];
+
+    for (g = 0; g < G; g++)
+    {
+        index[g] = num_tiles;
+        for (b = 0; b * 16 < cols; b++)
+        {
+            nnWeight *tile = &dst[num_tiles * 64];
+            nz = 0;
+            memset(tile, 0, 64 * sizeof(nnWeight));
+            for (i = 0; i < 4 && 4*g + i < rows; i++)
+                for (j = 0; j < 16 && 16*b + j < cols; j++)
+                {
+                    k = (4*g + i) * cols + 16*b + j;
+                    tile[16*i + j] = src[k];
+                    nz |= src[k] != 0;
+                }
+            if (nz)
+                col[num_tiles++] = b;
+        }
+    }
+    index[G] = num_tiles;
+    return num_tiles;
+}
+
+typedef struct {
+    int32_t norm;
+    int tile;
+} TileNorm;
+
+static int compareTileNorm(const void *a, const void *b)
+{
+    const TileNorm *x = a, *y = b;
+    if (x->norm != y->norm)
+        return x->norm < y->norm ? -1 : 1;
+    return x->tile - y->tile;
+}
+
+int pruneWeightsBlocks4x16(nnWeight *W, int rows, int cols, float sparsity)
+{
+    int G = JMPNN_BSR4x16_GROUPS(rows);
+    int B = (cols + 15) / 16;
+    int num_prune = (int)(sparsity * G * B + 0.5f);
+    TileNorm *tn = malloc(G * B * sizeof(TileNorm));
+    int t, i, j, g, b;
+
+    assert(tn != NULL);
+    for (t = 0; t < G * B; t++)
+    {
+        g = t / B;
+        b = t % B;
+        tn[t].tile = t;
+        tn[t].norm = 0;
+        for (i = 4*g; i < MIN(4*g + 4, rows); i++)
+            for (j = 16*b; j < MIN(16*b + 16, cols); j++)
+                tn[t].norm += abs(W[i*cols + j]);
+    }
+    qsort(tn, G * B, sizeof(TileNorm), compareTileNorm);
+    for (t = 0; t < num_prune; t++)
+    {
+        g = tn[t].tile / B;
+        b = tn[t].tile % B;
+        for (i = 4*g; i < MIN(4*g + 4, rows); i++)
+            for (j = 16*b; j < MIN(16*b + 16, cols); j++)
+                W[i*cols + j] = 0;
+    }
+    free(tn);
+    return num_prune;
+}
@@ -0,0 +1,163 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  nn_team.c
+//
+//  runNNTeam() publishes the task by bumping a generation counter the helpers spin on
+//  and waits for a countdown of the helpers still running: one cache line each way,
+//  no locks or condition variables on the per-frame path.
+//
+#include "nn_team.h"
+#include "jmpnn_thread.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NNTEAM_SPINS 20000      // pause iterations before a waiter starts yielding the CPU
+
+typedef struct {
+    NNTeam *team;
+    int index;
+    pthread_t thread;
+} NNTeamMember;
+
+struct NNTeam {
+    atomic_uint generation __attribute__((aligned(JMPNN_CACHE_LINE)));
+    atomic_int stop;
+    NNTeamTask task;
+    void *arg;
+    atomic_int remaining __attribute__((aligned(JMPNN_CACHE_LINE)));   // helpers still running the task
+    int num_threads __attribute__((aligned(JMPNN_CACHE_LINE)));
+    int num_started;
+    NNTeamMember members[NNTEAM_MAX_THREADS];
+};
+
+static _Thread_local NNTeam *layer_team;
+
+static inline void spin_wait(int *spins)
+{
+    if (*spins < NNTEAM_SPINS)
+    {
+        (*spins)++;
+        JMPNN_PAUSE();
+    }
+    else
+        sched_yield();
+}
+
+static void *team_thread(void *arg)
+{
+    NNTeamMember *m = arg;
+    NNTeam *t = m->team;
+    unsigned int seen = 0, g;
+
+    for (;;)
+    {
+        int spins = 0;
+        while ((g = atomic_load_explicit(&t->generation, memory_order_acquire)) == seen)
+            spin_wait(&spins);
+        seen = g;
+        if (atomic_load_explicit(&t->stop, memory_order_relaxed))
+            break;
+        t->task(t->arg, m->index, t->num_threads);
+        atomic_fetch_sub_explicit(&t->remaining, 1, memory_order_release);
+    }
+    return NULL;
+}
+
+int createNNTeam(NNTeam **team, int num_threads, const int *cpus)
+{
+    NNTeam *t;
+    int i;
+
+    *team = NULL;
+    if (num_threads < 2 || num_threads > NNTEAM_MAX_THREADS)
+        return -1;
+    if (posix_memalign((void **)&t, JMPNN_CACHE_LINE, sizeof(NNTeam)))
+        return -1;
+    memset(t, 0, sizeof(NNTeam));
+    atomic_init(&t->generation, 0);
+    atomic_init(&t->stop, 0);
+    atomic_init(&t->remaining, 0);
+    t->num_threads = num_threads;
+    for (i = 1; i < num_threads; i++)
+    {
+        NNTeamMember *m = &t->members[i];
+        m->team = t;
+        m->index = i;
+        if (pthread_create(&m->thread, NULL, team_thread, m))
+        {
+            destroyNNTeam(t);
+            return -1;
+        }
+        t->num_started = i;
+        if (cpus)
+            jmpnn_pin_thread(m->thread, cpus[i - 1]);
+    }
+    *team = t;
+    return 0;
+}
+
+void destroyNNTeam(NNTeam *team)
+{
+    int i;
+
+    if (!team)
+        return;
+    atomic_store_explicit(&team->stop, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&team->generation, 1, memory_order_release);
+    for (i = 1; i <= team->num_started; i++)
+        pthread_join(team->members[i].thread, NULL);
+    free(team);
+}
+
+int getNNTeamSize(const NNTeam *team)
+{
+    return team->num_threads;
+}
+
+void runNNTeam(NNTeam *team, NNTeamTask task, void *arg)
+{
+    int spins = 0;
+
+    team->task = task;
+    team->arg = arg;
+    atomic_store_explicit(&team->remaining, team->num_threads - 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&team->generation, 1, memory_order_release);
+    task(arg, 0, team->num_threads);
+    while (atomic_load_explicit(&team->remaining, memory_order_acquire) != 0)
+        spin_wait(&spins);
+}
+
+void getNNTeamRange(int n, int member, int num_members, int *begin, int *end)
+{
+    int chunks = (n + NNTEAM_UNIT_ALIGN - 1) / NNTEAM_UNIT_ALIGN;
+    int chunk = (chunks + num_members - 1) / num_members * NNTEAM_UNIT_ALIGN;
+
+    *begin = member * chunk < n ? member * chunk : n;
+    *end = *begin + chunk < n ? *begin + chunk : n;
+}
+
+void setNNLayerTeam(NNTeam *team)
+{
+    layer_team = team;
+}
+
+NNTeam *getNNLayerTeam(void)
+{
+    return layer_team;
+}
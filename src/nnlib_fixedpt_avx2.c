@@ -0,0 +1,1416 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  nnlib_fixedpt_avx2.c
+//
+//  AVX2 versions of the S8xS16 kernels. These are bit-exact with the generic
+//  kernels: all accumulation is done in int32 (no overflow for the layer sizes
+//  we use), and the Q-format shifts/saturation follow nnlib_fixedpt_generic.c.
+//  Each function carries its own target attribute so the library builds without
+//  -mavx2; the kernels are only called after JMPNN_select_kernels_S16() has
+//  confirmed AVX2 support via CPUID.
+//
+
+#include "nnlib_fixedpt.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if JMPNN_USE_X86_DISPATCH
+#include <immintrin.h>
+#include <pthread.h>
+
+#define JMPNN_TARGET_AVX2 __attribute__((target("avx2")))
+#define JMPNN_TARGET_AVXVNNI __attribute__((target("avx2,avxvnni")))
+
+// Sum of the 8 int32 lanes of v
+JMPNN_TARGET_AVX2 static inline int32_t hsum_epi32_avx2(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// Raw dot products acc[i] = sum_j W[i*input_len + j]*input[j] (Q7*Q15 = Q22).
+// Four rows are processed together so that each input load is reused 4 times.
+JMPNN_TARGET_AVX2 static void matXvec_S8xS16_S32_raw_avx2(const int8_t * __restrict__ W, const int16_t * __restrict__ input,
+                                                          int32_t * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    int i, j;
+    int nvec = input_len & ~15U;
+
+    for (i = 0; i + 4 <= (int)output_len; i += 4)
+    {
+        const int8_t *w0 = &W[(i + 0) * input_len];
+        const int8_t *w1 = &W[(i + 1) * input_len];
+        const int8_t *w2 = &W[(i + 2) * input_len];
+        const int8_t *w3 = &W[(i + 3) * input_len];
+        __m256i a0 = _mm256_setzero_si256();
+        __m256i a1 = _mm256_setzero_si256();
+        __m256i a2 = _mm256_setzero_si256();
+        __m256i a3 = _mm256_setzero_si256();
+
+        for (j = 0; j < nvec; j += 16)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)&input[j]);
+            a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w0[j])), x));
+            a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w1[j])), x));
+            a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w2[j])), x));
+            a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w3[j])), x));
+        }
+
+        // Transpose-reduce the 4 accumulators into [acc0 acc1 acc2 acc3]
+        __m256i s = _mm256_hadd_epi32(_mm256_hadd_epi32(a0, a1), _mm256_hadd_epi32(a2, a3));
+        __m128i r = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        _mm_storeu_si128((__m128i *)&acc[i], r);
+
+        for (; j < input_len; j++)
+        {
+            acc[i + 0] += w0[j] * input[j];
+            acc[i + 1] += w1[j] * input[j];
+            acc[i + 2] += w2[j] * input[j];
+            acc[i + 3] += w3[j] * input[j];
+        }
+    }
+
+    for (; i < output_len; i++)
+    {
+        const int8_t *w = &W[i * input_len];
+        __m256i a = _mm256_setzero_si256();
+        for (j = 0; j < nvec; j += 16)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)&input[j]);
+            a = _mm256_add_epi32(a, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[j])), x));
+        }
+        acc[i] = hsum_epi32_avx2(a);
+        for (; j < input_len; j++)
+            acc[i] += w[j] * input[j];
+    }
+}
+
+// Sign-extend the low 16 bits of every int32 lane, i.e. the (int16_t) cast of the generic code
+JMPNN_TARGET_AVX2 static inline __m256i trunc16_epi32_avx2(__m256i v)
+{
+    return _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+}
+
+// Store the 8 int32 lanes of v (already in int16 range) as int16
+JMPNN_TARGET_AVX2 static inline void store_epi32_as_S16_avx2(int16_t *output, __m256i v)
+{
+    __m256i p = _mm256_packs_epi32(v, v);
+    p = _mm256_permute4x64_epi64(p, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128((__m128i *)output, _mm256_castsi256_si128(p));
+}
+
+// (int32_t)(((int64_t)a * (int64_t)b) >> shift), lane-wise, for shift in [1, 31].
+// Only the low 32 bits of the shifted product are kept (as in the generic cast),
+// so a logical 64-bit shift gives the same bits as the arithmetic one.
+JMPNN_TARGET_AVX2 static inline __m256i mulhi_shift_epi32_avx2(__m256i a, __m256i b, int shift)
+{
+    __m256i even = _mm256_mul_epi32(a, b);
+    __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    even = _mm256_srl_epi64(even, _mm_cvtsi32_si128(shift));
+    odd = _mm256_sll_epi64(odd, _mm_cvtsi32_si128(32 - shift));
+    return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+// Vector version of tanh_table_approx_S16(): returns the int16 results sign-extended to int32 lanes
+JMPNN_TARGET_AVX2 static inline __m256i tanh_table_approx_S16_avx2(__m256i x)
+{
+    const __m256i one_Q31 = _mm256_set1_epi32(0x7FFFFFFF);
+    const __m256i half_one_Q31 = _mm256_set1_epi32(0x7FFFFFFF >> 1);
+    int32_t idx[8] __attribute__((aligned(32)));
+    __m256i neg = _mm256_cmpgt_epi32(_mm256_setzero_si256(), x);
+    __m256i i, y, dy, one_xy, temp;
+
+    x = _mm256_abs_epi32(x);
+    i = _mm256_srai_epi32(_mm256_add_epi32(_mm256_set1_epi32(1 << 14), _mm256_mullo_epi32(_mm256_set1_epi32(TANH_SCALEFAC_S16), x)), 15);
+    i = _mm256_max_epi32(_mm256_setzero_si256(), _mm256_min_epi32(_mm256_set1_epi32(TANH_TABLE_MAXINDEX_S16), i));
+    x = _mm256_sub_epi32(x, _mm256_mullo_epi32(_mm256_set1_epi32(TANH_DELTAX_S16), i));
+
+    _mm256_store_si256((__m256i *)idx, i);
+    y = _mm256_setr_epi32(tanh_table_S16[idx[0]], tanh_table_S16[idx[1]], tanh_table_S16[idx[2]], tanh_table_S16[idx[3]],
+                          tanh_table_S16[idx[4]], tanh_table_S16[idx[5]], tanh_table_S16[idx[6]], tanh_table_S16[idx[7]]);
+
+    dy = _mm256_sub_epi32(one_Q31, _mm256_slli_epi32(_mm256_mullo_epi32(y, y), 1));   // Q31
+    one_xy = _mm256_sub_epi32(half_one_Q31, _mm256_mullo_epi32(y, x));                // Q1.30
+    temp = mulhi_shift_epi32_avx2(x, dy, 15);                                         // Q31
+    one_xy = mulhi_shift_epi32_avx2(one_xy, temp, 31);
+    y = _mm256_add_epi32(y, _mm256_srai_epi32(one_xy, 15));                           // Q15
+
+    y = _mm256_sub_epi32(_mm256_xor_si256(y, neg), neg);
+    return trunc16_epi32_avx2(y);
+}
+
+// Vector version of tanh_rational_S16() (mul + add, no FMA, to stay bit-exact with it)
+JMPNN_TARGET_AVX2 static inline __m256i tanh_rational_S16_avx2(__m256i x)
+{
+    __m256 xf, x2, p, q, y;
+
+    xf = _mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(1.0f / 32768));
+    xf = _mm256_max_ps(_mm256_set1_ps(-TANH_RATIONAL_MAXX), _mm256_min_ps(_mm256_set1_ps(TANH_RATIONAL_MAXX), xf));
+    x2 = _mm256_mul_ps(xf, xf);
+    p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TANH_RATIONAL_A13), x2), _mm256_set1_ps(TANH_RATIONAL_A11));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(TANH_RATIONAL_A9));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(TANH_RATIONAL_A7));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(TANH_RATIONAL_A5));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(TANH_RATIONAL_A3));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(TANH_RATIONAL_A1));
+    q = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TANH_RATIONAL_B6), x2), _mm256_set1_ps(TANH_RATIONAL_B4));
+    q = _mm256_add_ps(_mm256_mul_ps(q, x2), _mm256_set1_ps(TANH_RATIONAL_B2));
+    q = _mm256_add_ps(_mm256_mul_ps(q, x2), _mm256_set1_ps(TANH_RATIONAL_B0));
+    y = _mm256_div_ps(_mm256_mul_ps(xf, p), q);
+
+    y = _mm256_add_ps(_mm256_mul_ps(y, _mm256_set1_ps(32768.0f)), _mm256_set1_ps(32768.5f));
+    x = _mm256_sub_epi32(_mm256_cvttps_epi32(y), _mm256_set1_epi32(32768));
+    return _mm256_min_epi32(x, _mm256_set1_epi32(32767));
+}
+
+JMPNN_TARGET_AVX2 static inline __m256i tanh_approx_S16_avx2(__m256i x)
+{
+#ifdef USE_FAST_ACTIVATIONS
+    return tanh_rational_S16_avx2(x);
+#else
+    return tanh_table_approx_S16_avx2(x);
+#endif
+}
+
+JMPNN_TARGET_AVX2 static void vec_tanh_S16_avx2(int16_t *output, const int32_t *input, JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&input[i]);
+        store_epi32_as_S16_avx2(&output[i], tanh_approx_S16_avx2(x));
+    }
+    for (; i < N; i++)
+        output[i] = tanh_approx_S16(input[i]);
+}
+
+JMPNN_TARGET_AVX2 static void vec_sigmoid_S16_avx2(int16_t *output, const int32_t *input, JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&input[i]);
+        __m256i y = tanh_approx_S16_avx2(_mm256_srai_epi32(x, 1));
+        y = _mm256_add_epi32(_mm256_set1_epi32(0x4000), _mm256_srai_epi32(y, 1));
+        store_epi32_as_S16_avx2(&output[i], trunc16_epi32_avx2(y));
+    }
+    for (; i < N; i++)
+        output[i] = sigmoid_approx_S16(input[i]);
+}
+
+JMPNN_TARGET_AVX2 static void vec_relu_S16_avx2(int16_t *output, const int32_t *input, JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&input[i]);
+        x = _mm256_max_epi32(x, _mm256_setzero_si256());
+        store_epi32_as_S16_avx2(&output[i], trunc16_epi32_avx2(x));
+    }
+    for (; i < N; i++)
+        output[i] = relu_S16(input[i]);
+}
+
+JMPNN_TARGET_AVX2 static void vec_linear_S16_avx2(int16_t *output, const int32_t *input, JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+        store_epi32_as_S16_avx2(&output[i], _mm256_loadu_si256((const __m256i *)&input[i]));   // saturating pack
+    for (; i < N; i++)
+        output[i] = SLIMIT(input[i], 16);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_apply_activation_S16_avx2(int16_t * __restrict__ output, int32_t * __restrict__ input, JMPDSP_Length N, JMPNN_ActivationType actType)
+{
+    if (actType == ACTIVATION_SIGMOID)
+    {
+        vec_sigmoid_S16_avx2(output, input, N);
+    }
+    else if (actType == ACTIVATION_TANH)
+    {
+        vec_tanh_S16_avx2(output, input, N);
+    }
+    else if (actType == ACTIVATION_RELU)
+    {
+        vec_relu_S16_avx2(output, input, N);
+    }
+    else if (actType == ACTIVATION_LINEAR)
+    {
+        vec_linear_S16_avx2(output, input, N);
+    }
+    else
+    {
+        // ERROR
+    }
+}
+
+JMPNN_ActivationFn_S16 JMPNN_get_activation_S16_avx2(JMPNN_ActivationType actType)
+{
+    switch (actType)
+    {
+        case ACTIVATION_SIGMOID: return vec_sigmoid_S16_avx2;
+        case ACTIVATION_TANH:    return vec_tanh_S16_avx2;
+        case ACTIVATION_RELU:    return vec_relu_S16_avx2;
+        case ACTIVATION_LINEAR:  return vec_linear_S16_avx2;
+        default:                 return NULL;
+    }
+}
+
+// output = SLIMIT((output + bias<<bias_left_shift) >> output_right_shift, 19)
+JMPNN_TARGET_AVX2 static void linear_bias_shift_avx2(int32_t * __restrict__ output, const int8_t * __restrict__ bias, JMPDSP_Length output_len,
+                                                     uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int i;
+    const __m128i bls = _mm_cvtsi32_si128(bias_left_shift);
+    const __m128i ors = _mm_cvtsi32_si128(output_right_shift);
+    const __m256i maxv = _mm256_set1_epi32((1 << 18) - 1);
+    const __m256i minv = _mm256_set1_epi32(-(1 << 18));
+
+    for (i = 0; i + 8 <= (int)output_len; i += 8)
+    {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)&output[i]);
+        __m256i b = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&bias[i]));
+        acc = _mm256_add_epi32(acc, _mm256_sll_epi32(b, bls));
+        acc = _mm256_sra_epi32(acc, ors);
+        acc = _mm256_max_epi32(minv, _mm256_min_epi32(maxv, acc));  //15 fractional bits, 3 integer bits
+        _mm256_storeu_si256((__m256i *)&output[i], acc);
+    }
+    for (; i < output_len; i++)
+    {
+        int acc = output[i] + ((int32_t)(bias[i]) << bias_left_shift);
+        output[i] = SLIMIT(acc >> output_right_shift, 15+4);
+    }
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_linear_matXvec_S8xS16_S32_avx2(const int8_t * __restrict__ W, const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                                            int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                            uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    matXvec_S8xS16_S32_raw_avx2(W, input, output, input_len, output_len);
+    linear_bias_shift_avx2(output, bias, output_len, bias_left_shift, output_right_shift);
+}
+
+// Combines the input and recurrent products of a GRU gate:
+// out = SLIMIT(((acci + Bi<<s) >> s) + ((acch + Bh<<s) [*r] >> s), 19)
+JMPNN_TARGET_AVX2 static void gru_gate_combine_avx2(int32_t * __restrict__ acci, const int32_t * __restrict__ acch,
+                                                    const int8_t * __restrict__ Bi, const int8_t * __restrict__ Bh, const int16_t * __restrict__ r,
+                                                    JMPDSP_Length N,
+                                                    uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift)
+{
+    int i;
+    const __m128i bils = _mm_cvtsi32_si128(Bi_left_shift);
+    const __m128i oirs = _mm_cvtsi32_si128(outi_right_shift);
+    const __m128i bhls = _mm_cvtsi32_si128(Bh_left_shift);
+    const __m128i ohrs = _mm_cvtsi32_si128(outh_right_shift);
+    const __m256i maxv = _mm256_set1_epi32((1 << 18) - 1);
+    const __m256i minv = _mm256_set1_epi32(-(1 << 18));
+
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        __m256i ai = _mm256_loadu_si256((const __m256i *)&acci[i]);
+        __m256i ah = _mm256_loadu_si256((const __m256i *)&acch[i]);
+        ai = _mm256_add_epi32(ai, _mm256_sll_epi32(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&Bi[i])), bils));
+        ah = _mm256_add_epi32(ah, _mm256_sll_epi32(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&Bh[i])), bhls));
+        if (r)
+            ah = mulhi_shift_epi32_avx2(ah, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&r[i])), 15);  // Q22*Q15=Q22
+        ai = _mm256_add_epi32(_mm256_sra_epi32(ai, oirs), _mm256_sra_epi32(ah, ohrs));
+        ai = _mm256_max_epi32(minv, _mm256_min_epi32(maxv, ai));  //Q3.15
+        _mm256_storeu_si256((__m256i *)&acci[i], ai);
+    }
+    for (; i < N; i++)
+    {
+        int ai = acci[i] + ((int32_t)(Bi[i]) << Bi_left_shift);
+        int ah = acch[i] + ((int32_t)(Bh[i]) << Bh_left_shift);
+        if (r)
+            ah = FMUL32x16(ah, r[i]);
+        acci[i] = SLIMIT((ai >> outi_right_shift) + (ah >> outh_right_shift), 15+4);
+    }
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_matXvec_S8xS16_S16_act_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                             const int8_t * __restrict__ Wh, const int16_t * __restrict__ prev_state, const int8_t * __restrict__ Bh,
+                                                             int16_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                             uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                             JMPNN_ActivationType actType)
+{
+    int32_t acci[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xS16_S32_raw_avx2(Wi, input, acci, input_len, output_len);
+    matXvec_S8xS16_S32_raw_avx2(Wh, prev_state, acch, output_len, output_len);
+    gru_gate_combine_avx2(acci, acch, Bi, Bh, NULL, output_len,
+                          Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+    JMPNN_apply_activation_S16_avx2(output, acci, output_len, actType);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_newGate_S8xS16_S16_act_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                             const int8_t * __restrict__ Wh, const int16_t * __restrict__ prev_state, const int8_t * __restrict__ Bh, const int16_t * __restrict__ r,
+                                                             int16_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                             uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                             JMPNN_ActivationType actType)
+{
+    int32_t acci[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xS16_S32_raw_avx2(Wi, input, acci, input_len, output_len);
+    matXvec_S8xS16_S32_raw_avx2(Wh, prev_state, acch, output_len, output_len);
+    gru_gate_combine_avx2(acci, acch, Bi, Bh, r, output_len,
+                          Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+    JMPNN_apply_activation_S16_avx2(output, acci, output_len, actType);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_vec_interpolation_S16_avx2(int16_t *output, const int16_t *interp_vec,
+                                                        const int16_t *input1, const int16_t *input2,
+                                                        JMPDSP_Length N)
+{
+    int i;
+    const __m256i one_Q15 = _mm256_set1_epi32(0x7FFF);
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        __m256i z = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&interp_vec[i]));
+        __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&input1[i]));
+        __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&input2[i]));
+        __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(z, a), _mm256_mullo_epi32(_mm256_sub_epi32(one_Q15, z), b));
+        store_epi32_as_S16_avx2(&output[i], trunc16_epi32_avx2(_mm256_srai_epi32(sum, 15)));
+    }
+    for (; i < N; i++)
+    {
+        int sum = interp_vec[i]*input1[i] + (0x7FFF-interp_vec[i])*input2[i];
+        output[i] = sum >> 15;
+    }
+}
+
+// Gates and state update of the fused GRU cell from the raw stacked products
+// acci/acch [3N] (r, z, n blocks). acci is used as scratch.
+JMPNN_TARGET_AVX2 static void gru_cell_update_avx2(int32_t * __restrict__ acci, const int32_t * __restrict__ acch,
+                                                   const int8_t * __restrict__ Bi, const int8_t * __restrict__ Bh,
+                                                   int16_t * __restrict__ state, JMPDSP_Length N,
+                                                   uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                   JMPNN_ActivationType actType)
+{
+    int16_t r[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int16_t z[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int16_t n[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    // r and z gates are adjacent in the stacked layout: combine both at once
+    gru_gate_combine_avx2(acci, acch, Bi, Bh, NULL, 2 * N,
+                          Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+    vec_sigmoid_S16_avx2(r, acci, N);
+    vec_sigmoid_S16_avx2(z, &acci[N], N);
+    gru_gate_combine_avx2(&acci[2 * N], &acch[2 * N], &Bi[2 * N], &Bh[2 * N], r, N,
+                          Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+    JMPNN_apply_activation_S16_avx2(n, &acci[2 * N], N, actType);
+    JMPNN_vec_interpolation_S16_avx2(state, z, state, n, N);
+}
+
+// Fused GRU cell: the stacked r/z/n weights are swept once per input vector
+// (3N rows each), then the gates and state update are finalized 8 lanes at a time.
+JMPNN_TARGET_AVX2 void JMPNN_gru_cell_S8xS16_S16_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                      const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                      uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                      JMPNN_ActivationType actType)
+{
+    int32_t acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xS16_S32_raw_avx2(Wi, input, acci, input_len, 3 * hidden_len);
+    matXvec_S8xS16_S32_raw_avx2(Wh, state, acch, hidden_len, 3 * hidden_len);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, state, hidden_len,
+                         Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+// Gates of units [unit_begin, unit_end): the r, z and n row blocks of the range
+// are swept separately, then combined as in gru_cell_update_avx2.
+JMPNN_TARGET_AVX2 void JMPNN_gru_gates_S8xS16_S16_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                       const int8_t * __restrict__ Wh, const int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                       int16_t * __restrict__ z, int16_t * __restrict__ n,
+                                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                       JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                       JMPNN_ActivationType actType)
+{
+    int32_t acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int16_t r[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int N = hidden_len, U = unit_end - unit_begin, g;
+
+    for (g = 0; g < 3; g++)
+    {
+        matXvec_S8xS16_S32_raw_avx2(&Wi[(g * N + unit_begin) * input_len], input, &acci[g * U], input_len, U);
+        matXvec_S8xS16_S32_raw_avx2(&Wh[(g * N + unit_begin) * N], state, &acch[g * U], N, U);
+    }
+    for (g = 0; g < 2; g++)
+        gru_gate_combine_avx2(&acci[g * U], &acch[g * U], &Bi[g * N + unit_begin], &Bh[g * N + unit_begin], NULL, U,
+                              Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+    vec_sigmoid_S16_avx2(r, acci, U);
+    vec_sigmoid_S16_avx2(&z[unit_begin], &acci[U], U);
+    gru_gate_combine_avx2(&acci[2 * U], &acch[2 * U], &Bi[2 * N + unit_begin], &Bh[2 * N + unit_begin], r, U,
+                          Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift);
+    JMPNN_apply_activation_S16_avx2(&n[unit_begin], &acci[2 * U], U, actType);
+}
+
+// TILED4x16 layout (see nnlib_types.h): the 4 rows of a tile share each 16-element
+// input load and the weights are read as one contiguous stream.
+JMPNN_TARGET_AVX2 static void matXvec_S8xS16_S32_tiled_raw_avx2(const int8_t * __restrict__ W, const int16_t * __restrict__ input,
+                                                                int32_t * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    int i, j, k;
+    int Kp = JMPNN_TILED4x16_COLS(input_len);
+    int nvec = input_len & ~15U;
+
+    for (i = 0; i < (int)output_len; i += 4)
+    {
+        const int8_t *w = &W[i * Kp];
+        __m256i a0 = _mm256_setzero_si256();
+        __m256i a1 = _mm256_setzero_si256();
+        __m256i a2 = _mm256_setzero_si256();
+        __m256i a3 = _mm256_setzero_si256();
+        int32_t s[4] __attribute__((aligned(16)));
+
+        for (j = 0; j < nvec; j += 16, w += 64)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)&input[j]);
+            __m256i w01 = _mm256_loadu_si256((const __m256i *)w);
+            __m256i w23 = _mm256_loadu_si256((const __m256i *)(w + 32));
+            a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_castsi256_si128(w01)), x));
+            a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_extracti128_si256(w01, 1)), x));
+            a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_castsi256_si128(w23)), x));
+            a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_extracti128_si256(w23, 1)), x));
+        }
+
+        __m256i h = _mm256_hadd_epi32(_mm256_hadd_epi32(a0, a1), _mm256_hadd_epi32(a2, a3));
+        _mm_store_si128((__m128i *)s, _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1)));
+
+        // Last (zero padded) column block
+        for (k = 0; j + k < (int)input_len; k++)
+        {
+            s[0] += w[k] * input[j + k];
+            s[1] += w[16 + k] * input[j + k];
+            s[2] += w[32 + k] * input[j + k];
+            s[3] += w[48 + k] * input[j + k];
+        }
+
+        for (k = 0; k < 4 && i + k < (int)output_len; k++)
+            acc[i + k] = s[k];
+    }
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_linear_matXvec_S8xS16_S32_tiled_avx2(const int8_t * __restrict__ W, const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                                                  int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                  uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    matXvec_S8xS16_S32_tiled_raw_avx2(W, input, output, input_len, output_len);
+    linear_bias_shift_avx2(output, bias, output_len, bias_left_shift, output_right_shift);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_cell_S8xS16_S16_tiled_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                            const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                            JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                            uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                            JMPNN_ActivationType actType)
+{
+    int32_t acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xS16_S32_tiled_raw_avx2(Wi, input, acci, input_len, 3 * hidden_len);
+    matXvec_S8xS16_S32_tiled_raw_avx2(Wh, state, acch, hidden_len, 3 * hidden_len);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, state, hidden_len,
+                         Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+// BSR4x16 layout (see nnlib_types.h): same inner step as the TILED4x16 kernel, only
+// over the stored (non-zero) tiles of each row group.
+JMPNN_TARGET_AVX2 static void matXvec_S8xS16_S32_bsr_raw_avx2(const int8_t * __restrict__ W, const uint16_t * __restrict__ index,
+                                                              const int16_t * __restrict__ input, int32_t * __restrict__ acc,
+                                                              JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    const uint16_t *col = &index[JMPNN_BSR4x16_GROUPS(output_len) + 1];
+    int i, j, k, t;
+    int nvec = input_len & ~15U;
+
+    for (i = 0; i < (int)output_len; i += 4)
+    {
+        __m256i a0 = _mm256_setzero_si256();
+        __m256i a1 = _mm256_setzero_si256();
+        __m256i a2 = _mm256_setzero_si256();
+        __m256i a3 = _mm256_setzero_si256();
+        int32_t s[4] __attribute__((aligned(16)));
+        int t_end = index[(i >> 2) + 1];
+
+        // A partial (zero padded) column block can only be the last tile of the group
+        t = index[i >> 2];
+        if (t < t_end && col[t_end - 1] * 16 >= nvec)
+            t_end--;
+        for (; t < t_end; t++)
+        {
+            const int8_t *w = &W[t * 64];
+            __m256i x = _mm256_loadu_si256((const __m256i *)&input[col[t] * 16]);
+            __m256i w01 = _mm256_loadu_si256((const __m256i *)w);
+            __m256i w23 = _mm256_loadu_si256((const __m256i *)(w + 32));
+            a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_castsi256_si128(w01)), x));
+            a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_extracti128_si256(w01, 1)), x));
+            a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_castsi256_si128(w23)), x));
+            a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm256_extracti128_si256(w23, 1)), x));
+        }
+
+        __m256i h = _mm256_hadd_epi32(_mm256_hadd_epi32(a0, a1), _mm256_hadd_epi32(a2, a3));
+        _mm_store_si128((__m128i *)s, _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1)));
+
+        if (t < index[(i >> 2) + 1])
+        {
+            const int8_t *w = &W[t * 64];
+            j = col[t] * 16;
+            for (k = 0; j + k < (int)input_len; k++)
+            {
+                s[0] += w[k] * input[j + k];
+                s[1] += w[16 + k] * input[j + k];
+                s[2] += w[32 + k] * input[j + k];
+                s[3] += w[48 + k] * input[j + k];
+            }
+        }
+
+        for (k = 0; k < 4 && i + k < (int)output_len; k++)
+            acc[i + k] = s[k];
+    }
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_linear_matXvec_S8xS16_S32_bsr_avx2(const int8_t * __restrict__ W, const uint16_t * __restrict__ W_index,
+                                                                const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                                                int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    matXvec_S8xS16_S32_bsr_raw_avx2(W, W_index, input, output, input_len, output_len);
+    linear_bias_shift_avx2(output, bias, output_len, bias_left_shift, output_right_shift);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_cell_S8xS16_S16_bsr_avx2(const int8_t * __restrict__ Wi, const uint16_t * __restrict__ Wi_index,
+                                                          const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                          const int8_t * __restrict__ Wh, const uint16_t * __restrict__ Wh_index,
+                                                          int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                          JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                          uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                          JMPNN_ActivationType actType)
+{
+    int32_t acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xS16_S32_bsr_raw_avx2(Wi, Wi_index, input, acci, input_len, 3 * hidden_len);
+    matXvec_S8xS16_S32_bsr_raw_avx2(Wh, Wh_index, state, acch, hidden_len, 3 * hidden_len);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, state, hidden_len,
+                         Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+// Delta matvec on column-pair interleaved weights (see nnlib_fixedpt.h). A column pair is
+// applied if either of its inputs moved (the other one with a zero delta): 16 bytes of the
+// pair widen to the (w_a, w_b) words of 8 rows, one madd against the broadcast (d_a, d_b).
+// A delta outside the int16 range is applied in up to three steps (65535 = 2*32767 + 1).
+JMPNN_TARGET_AVX2 static int delta_matXvec_S8xS16_S32_raw_avx2(const int8_t * __restrict__ Wt, const int16_t * __restrict__ input,
+                                                               int16_t * __restrict__ input_ref, int32_t * __restrict__ acc,
+                                                               JMPDSP_Length input_len, JMPDSP_Length output_len, int16_t threshold)
+{
+    const int8_t *wpair[3 * (JMPNN_MAX_WIDTH / 2 + 1)];
+    int32_t dpair[3 * (JMPNN_MAX_WIDTH / 2 + 1)];
+    int i, j, k, n = 0, m = 0;
+
+    for (j = 0; j < (int)input_len; j += 2)
+    {
+        int32_t d[2] = {0, 0};
+        int16_t part[2];
+        for (k = 0; k < 2 && j + k < (int)input_len; k++)
+        {
+            int32_t dk = input[j + k] - input_ref[j + k];
+            if (dk > threshold || dk < -threshold)
+            {
+                d[k] = dk;
+                input_ref[j + k] = input[j + k];
+                n++;
+            }
+        }
+        while (d[0] | d[1])
+        {
+            part[0] = (int16_t)MAX(-32768, MIN(32767, d[0]));
+            part[1] = (int16_t)MAX(-32768, MIN(32767, d[1]));
+            wpair[m] = &Wt[JMPNN_COLPAIR_INDEX(0, j, output_len)];
+            dpair[m++] = (uint16_t)part[0] | ((uint32_t)(uint16_t)part[1] << 16);
+            d[0] -= part[0];
+            d[1] -= part[1];
+        }
+    }
+
+    for (i = 0; i + 32 <= (int)output_len; i += 32)
+    {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)&acc[i]);
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)&acc[i + 8]);
+        __m256i a2 = _mm256_loadu_si256((const __m256i *)&acc[i + 16]);
+        __m256i a3 = _mm256_loadu_si256((const __m256i *)&acc[i + 24]);
+        for (k = 0; k < m; k++)
+        {
+            const int8_t *w = &wpair[k][2 * i];
+            __m256i dd = _mm256_set1_epi32(dpair[k]);
+            a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[0])), dd));
+            a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[16])), dd));
+            a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[32])), dd));
+            a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[48])), dd));
+        }
+        _mm256_storeu_si256((__m256i *)&acc[i], a0);
+        _mm256_storeu_si256((__m256i *)&acc[i + 8], a1);
+        _mm256_storeu_si256((__m256i *)&acc[i + 16], a2);
+        _mm256_storeu_si256((__m256i *)&acc[i + 24], a3);
+    }
+    for (; i + 8 <= (int)output_len; i += 8)
+    {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)&acc[i]);
+        for (k = 0; k < m; k++)
+            a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&wpair[k][2 * i])),
+                                                        _mm256_set1_epi32(dpair[k])));
+        _mm256_storeu_si256((__m256i *)&acc[i], a0);
+    }
+    for (; i < (int)output_len; i++)
+        for (k = 0; k < m; k++)
+            acc[i] += wpair[k][2 * i] * (int16_t)dpair[k] + wpair[k][2 * i + 1] * (int16_t)(dpair[k] >> 16);
+    return n;
+}
+
+JMPNN_TARGET_AVX2 int JMPNN_linear_matXvec_delta_S8xS16_S32_avx2(const int8_t * __restrict__ Wt, const int16_t * __restrict__ input,
+                                                                 int16_t * __restrict__ input_ref, int32_t * __restrict__ acc,
+                                                                 const int8_t * __restrict__ bias, int32_t * __restrict__ output,
+                                                                 JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                 int16_t threshold, uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int n = delta_matXvec_S8xS16_S32_raw_avx2(Wt, input, input_ref, acc, input_len, output_len, threshold);
+    memcpy(output, acc, output_len * sizeof(int32_t));
+    linear_bias_shift_avx2(output, bias, output_len, bias_left_shift, output_right_shift);
+    return n;
+}
+
+JMPNN_TARGET_AVX2 int JMPNN_gru_cell_delta_S8xS16_S16_avx2(const int8_t * __restrict__ Wi_t, const int16_t * __restrict__ input,
+                                                           int16_t * __restrict__ input_ref, int32_t * __restrict__ acci, const int8_t * __restrict__ Bi,
+                                                           const int8_t * __restrict__ Wh_t, int16_t * __restrict__ state,
+                                                           int16_t * __restrict__ state_ref, int32_t * __restrict__ acch, const int8_t * __restrict__ Bh,
+                                                           JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                           int16_t input_threshold, int16_t state_threshold,
+                                                           uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                           JMPNN_ActivationType actType)
+{
+    int32_t scratch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int n;
+
+    n  = delta_matXvec_S8xS16_S32_raw_avx2(Wi_t, input, input_ref, acci, input_len, 3 * hidden_len, input_threshold);
+    n += delta_matXvec_S8xS16_S32_raw_avx2(Wh_t, state, state_ref, acch, hidden_len, 3 * hidden_len, state_threshold);
+    memcpy(scratch, acci, 3 * hidden_len * sizeof(int32_t));
+    gru_cell_update_avx2(scratch, acch, Bi, Bh, state, hidden_len,
+                         Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+    return n;
+}
+
+// BATCHED (K streams): acc[k*acc_stride + i] = W[i,:]*X[k*x_stride + :].
+// A block of 4 weight rows is widened once per 16 columns and applied to two
+// streams at a time; the block stays in L1 while the remaining streams reuse it,
+// so the weights are streamed from memory once per batch.
+JMPNN_TARGET_AVX2 static void matXmat_S8xS16_S32_raw_avx2(const int8_t * __restrict__ W, const int16_t * __restrict__ X, int32_t * __restrict__ acc,
+                                                          JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                                          JMPDSP_Stride x_stride, JMPDSP_Stride acc_stride)
+{
+    int i, j, k, r;
+    int nvec = input_len & ~15U;
+
+    for (i = 0; i + 4 <= (int)output_len; i += 4)
+    {
+        const int8_t *w = &W[i * input_len];
+        for (k = 0; k + 2 <= (int)num_streams; k += 2)
+        {
+            const int16_t *x0 = &X[k * x_stride];
+            const int16_t *x1 = &X[(k + 1) * x_stride];
+            __m256i a00 = _mm256_setzero_si256(), a01 = _mm256_setzero_si256();
+            __m256i a02 = _mm256_setzero_si256(), a03 = _mm256_setzero_si256();
+            __m256i a10 = _mm256_setzero_si256(), a11 = _mm256_setzero_si256();
+            __m256i a12 = _mm256_setzero_si256(), a13 = _mm256_setzero_si256();
+            int32_t s0[4] __attribute__((aligned(16)));
+            int32_t s1[4] __attribute__((aligned(16)));
+
+            for (j = 0; j < nvec; j += 16)
+            {
+                __m256i w0 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[j]));
+                __m256i w1 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[input_len + j]));
+                __m256i w2 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[2 * input_len + j]));
+                __m256i w3 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w[3 * input_len + j]));
+                __m256i xv0 = _mm256_loadu_si256((const __m256i *)&x0[j]);
+                __m256i xv1 = _mm256_loadu_si256((const __m256i *)&x1[j]);
+                a00 = _mm256_add_epi32(a00, _mm256_madd_epi16(w0, xv0));
+                a01 = _mm256_add_epi32(a01, _mm256_madd_epi16(w1, xv0));
+                a02 = _mm256_add_epi32(a02, _mm256_madd_epi16(w2, xv0));
+                a03 = _mm256_add_epi32(a03, _mm256_madd_epi16(w3, xv0));
+                a10 = _mm256_add_epi32(a10, _mm256_madd_epi16(w0, xv1));
+                a11 = _mm256_add_epi32(a11, _mm256_madd_epi16(w1, xv1));
+                a12 = _mm256_add_epi32(a12, _mm256_madd_epi16(w2, xv1));
+                a13 = _mm256_add_epi32(a13, _mm256_madd_epi16(w3, xv1));
+            }
+
+            __m256i h0 = _mm256_hadd_epi32(_mm256_hadd_epi32(a00, a01), _mm256_hadd_epi32(a02, a03));
+            __m256i h1 = _mm256_hadd_epi32(_mm256_hadd_epi32(a10, a11), _mm256_hadd_epi32(a12, a13));
+            _mm_store_si128((__m128i *)s0, _mm_add_epi32(_mm256_castsi256_si128(h0), _mm256_extracti128_si256(h0, 1)));
+            _mm_store_si128((__m128i *)s1, _mm_add_epi32(_mm256_castsi256_si128(h1), _mm256_extracti128_si256(h1, 1)));
+            for (j = nvec; j < input_len; j++)
+            {
+                for (r = 0; r < 4; r++)
+                {
+                    s0[r] += w[r * input_len + j] * x0[j];
+                    s1[r] += w[r * input_len + j] * x1[j];
+                }
+            }
+            for (r = 0; r < 4; r++)
+            {
+                acc[k * acc_stride + i + r] = s0[r];
+                acc[(k + 1) * acc_stride + i + r] = s1[r];
+            }
+        }
+        if (k < (int)num_streams)
+            matXvec_S8xS16_S32_raw_avx2(w, &X[k * x_stride], &acc[k * acc_stride + i], input_len, 4);
+    }
+    if (i < (int)output_len)
+    {
+        for (k = 0; k < (int)num_streams; k++)
+            matXvec_S8xS16_S32_raw_avx2(&W[i * input_len], &X[k * x_stride], &acc[k * acc_stride + i], input_len, output_len - i);
+    }
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_linear_matXmat_S8xS16_S32_avx2(const int8_t * __restrict__ W, const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                                            int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                                            JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                                            uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int k;
+    matXmat_S8xS16_S32_raw_avx2(W, input, output, input_len, output_len, num_streams, input_stride, output_stride);
+    for (k = 0; k < (int)num_streams; k++)
+        linear_bias_shift_avx2(&output[k * output_stride], bias, output_len, bias_left_shift, output_right_shift);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_cell_batch_S8xS16_S16_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                            const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                            JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_streams,
+                                                            JMPDSP_Stride input_stride, JMPDSP_Stride state_stride,
+                                                            uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                            JMPNN_ActivationType actType)
+{
+    int32_t acci[JMPNN_MAX_BATCH * 3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[JMPNN_MAX_BATCH * 3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int k, k0, K;
+    int N = hidden_len;
+
+    for (k0 = 0; k0 < (int)num_streams; k0 += JMPNN_MAX_BATCH)
+    {
+        K = MIN(JMPNN_MAX_BATCH, (int)num_streams - k0);
+        matXmat_S8xS16_S32_raw_avx2(Wi, &input[k0 * input_stride], acci, input_len, 3 * N, K, input_stride, 3 * N);
+        matXmat_S8xS16_S32_raw_avx2(Wh, &state[k0 * state_stride], acch, N, 3 * N, K, state_stride, 3 * N);
+        for (k = 0; k < K; k++)
+            gru_cell_update_avx2(&acci[k * 3 * N], &acch[k * 3 * N], Bi, Bh, &state[(k0 + k) * state_stride], N,
+                                 Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+    }
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_seq_S8xS16_S16_avx2(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                     const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                     int16_t * __restrict__ output,
+                                                     JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_frames,
+                                                     JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                                     uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                     JMPNN_ActivationType actType)
+{
+    int32_t acci[JMPNN_SEQ_BLOCK * 3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int t, t0, T;
+    int N = hidden_len;
+
+    for (t0 = 0; t0 < (int)num_frames; t0 += JMPNN_SEQ_BLOCK)
+    {
+        T = MIN(JMPNN_SEQ_BLOCK, (int)num_frames - t0);
+        matXmat_S8xS16_S32_raw_avx2(Wi, &input[t0 * input_stride], acci, input_len, 3 * N, T, input_stride, 3 * N);
+        for (t = 0; t < T; t++)
+        {
+            matXvec_S8xS16_S32_raw_avx2(Wh, state, acch, N, 3 * N);
+            gru_cell_update_avx2(&acci[t * 3 * N], acch, Bi, Bh, state, N,
+                                 Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+            memcpy(&output[(t0 + t) * output_stride], state, N * sizeof(int16_t));
+        }
+    }
+}
+
+// RUNTIME DISPATCH
+// INT8 ACTIVATIONS. There is no signed x signed byte multiply in AVX2, so w*x is formed as
+// |w| (unsigned) * (x with the sign of w) with vpmaddubsw. Activations are kept in
+// [-127, 127], which bounds each int16 pair sum by 2*128*127 and avoids saturation.
+JMPNN_TARGET_AVX2 static inline __m256i dot_S8xS8_epi32_avx2(__m256i w, __m256i x)
+{
+    __m256i p = _mm256_maddubs_epi16(_mm256_abs_epi8(w), _mm256_sign_epi8(x, w));
+    return _mm256_madd_epi16(p, _mm256_set1_epi16(1));
+}
+
+// acc[i] = (W[i,:]*input) << acc_left_shift, 32 columns per step, four rows share each input load
+JMPNN_TARGET_AVX2 static void matXvec_S8xS8_S32_raw_avx2(const int8_t * __restrict__ W, const int8_t * __restrict__ input,
+                                                         int32_t * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                         uint16_t acc_left_shift)
+{
+    int i, j;
+    int nvec = input_len & ~31U;
+    __m128i cnt = _mm_cvtsi32_si128(acc_left_shift);
+
+    for (i = 0; i + 4 <= (int)output_len; i += 4)
+    {
+        const int8_t *w0 = &W[(i + 0) * input_len];
+        const int8_t *w1 = &W[(i + 1) * input_len];
+        const int8_t *w2 = &W[(i + 2) * input_len];
+        const int8_t *w3 = &W[(i + 3) * input_len];
+        __m256i a0 = _mm256_setzero_si256();
+        __m256i a1 = _mm256_setzero_si256();
+        __m256i a2 = _mm256_setzero_si256();
+        __m256i a3 = _mm256_setzero_si256();
+
+        for (j = 0; j < nvec; j += 32)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)&input[j]);
+            a0 = _mm256_add_epi32(a0, dot_S8xS8_epi32_avx2(_mm256_loadu_si256((const __m256i *)&w0[j]), x));
+            a1 = _mm256_add_epi32(a1, dot_S8xS8_epi32_avx2(_mm256_loadu_si256((const __m256i *)&w1[j]), x));
+            a2 = _mm256_add_epi32(a2, dot_S8xS8_epi32_avx2(_mm256_loadu_si256((const __m256i *)&w2[j]), x));
+            a3 = _mm256_add_epi32(a3, dot_S8xS8_epi32_avx2(_mm256_loadu_si256((const __m256i *)&w3[j]), x));
+        }
+
+        __m256i s = _mm256_hadd_epi32(_mm256_hadd_epi32(a0, a1), _mm256_hadd_epi32(a2, a3));
+        __m128i r = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+
+        if (j < input_len)
+        {
+            int32_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+            for (; j < input_len; j++)
+            {
+                t0 += w0[j] * input[j];
+                t1 += w1[j] * input[j];
+                t2 += w2[j] * input[j];
+                t3 += w3[j] * input[j];
+            }
+            r = _mm_add_epi32(r, _mm_setr_epi32(t0, t1, t2, t3));
+        }
+        _mm_storeu_si128((__m128i *)&acc[i], _mm_sll_epi32(r, cnt));
+    }
+
+    for (; i < output_len; i++)
+    {
+        const int8_t *w = &W[i * input_len];
+        __m256i a = _mm256_setzero_si256();
+        int32_t t;
+        for (j = 0; j < nvec; j += 32)
+            a = _mm256_add_epi32(a, dot_S8xS8_epi32_avx2(_mm256_loadu_si256((const __m256i *)&w[j]),
+                                                         _mm256_loadu_si256((const __m256i *)&input[j])));
+        t = hsum_epi32_avx2(a);
+        for (; j < input_len; j++)
+            t += w[j] * input[j];
+        acc[i] = t << acc_left_shift;
+    }
+}
+
+// Same as matXvec_S8xS8_S32_raw_avx2() using AVX-VNNI: vpdpbusd accumulates the four
+// |w| * (x with the sign of w) products of each lane straight into int32.
+JMPNN_TARGET_AVXVNNI static void matXvec_S8xS8_S32_raw_vnni(const int8_t * __restrict__ W, const int8_t * __restrict__ input,
+                                                           int32_t * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                           uint16_t acc_left_shift)
+{
+    int i, j;
+    int nvec = input_len & ~31U;
+    __m128i cnt = _mm_cvtsi32_si128(acc_left_shift);
+
+    for (i = 0; i + 4 <= (int)output_len; i += 4)
+    {
+        const int8_t *w0 = &W[(i + 0) * input_len];
+        const int8_t *w1 = &W[(i + 1) * input_len];
+        const int8_t *w2 = &W[(i + 2) * input_len];
+        const int8_t *w3 = &W[(i + 3) * input_len];
+        __m256i a0 = _mm256_setzero_si256();
+        __m256i a1 = _mm256_setzero_si256();
+        __m256i a2 = _mm256_setzero_si256();
+        __m256i a3 = _mm256_setzero_si256();
+        __m256i v;
+
+        for (j = 0; j < nvec; j += 32)
+        {
+            __m256i x = _mm256_loadu_si256((const __m256i *)&input[j]);
+            v = _mm256_loadu_si256((const __m256i *)&w0[j]);
+            a0 = _mm256_dpbusd_avx_epi32(a0, _mm256_abs_epi8(v), _mm256_sign_epi8(x, v));
+            v = _mm256_loadu_si256((const __m256i *)&w1[j]);
+            a1 = _mm256_dpbusd_avx_epi32(a1, _mm256_abs_epi8(v), _mm256_sign_epi8(x, v));
+            v = _mm256_loadu_si256((const __m256i *)&w2[j]);
+            a2 = _mm256_dpbusd_avx_epi32(a2, _mm256_abs_epi8(v), _mm256_sign_epi8(x, v));
+            v = _mm256_loadu_si256((const __m256i *)&w3[j]);
+            a3 = _mm256_dpbusd_avx_epi32(a3, _mm256_abs_epi8(v), _mm256_sign_epi8(x, v));
+        }
+
+        __m256i s = _mm256_hadd_epi32(_mm256_hadd_epi32(a0, a1), _mm256_hadd_epi32(a2, a3));
+        __m128i r = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+
+        if (j < input_len)
+        {
+            int32_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+            for (; j < input_len; j++)
+            {
+                t0 += w0[j] * input[j];
+                t1 += w1[j] * input[j];
+                t2 += w2[j] * input[j];
+                t3 += w3[j] * input[j];
+            }
+            r = _mm_add_epi32(r, _mm_setr_epi32(t0, t1, t2, t3));
+        }
+        _mm_storeu_si128((__m128i *)&acc[i], _mm_sll_epi32(r, cnt));
+    }
+
+    for (; i < output_len; i++)
+    {
+        const int8_t *w = &W[i * input_len];
+        __m256i a = _mm256_setzero_si256();
+        int32_t t;
+        for (j = 0; j < nvec; j += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)&w[j]);
+            a = _mm256_dpbusd_avx_epi32(a, _mm256_abs_epi8(v),
+                                        _mm256_sign_epi8(_mm256_loadu_si256((const __m256i *)&input[j]), v));
+        }
+        t = hsum_epi32_avx2(a);
+        for (; j < input_len; j++)
+            t += w[j] * input[j];
+        acc[i] = t << acc_left_shift;
+    }
+}
+
+// Set by JMPNN_select_kernels_S16() when the CPU has AVX-VNNI
+static int s8_use_vnni = 0;
+
+static inline void matXvec_S8xS8_S32_raw_x86(const int8_t *W, const int8_t *input, int32_t *acc,
+                                             JMPDSP_Length input_len, JMPDSP_Length output_len, uint16_t acc_left_shift)
+{
+    if (s8_use_vnni)
+        matXvec_S8xS8_S32_raw_vnni(W, input, acc, input_len, output_len, acc_left_shift);
+    else
+        matXvec_S8xS8_S32_raw_avx2(W, input, acc, input_len, output_len, acc_left_shift);
+}
+
+// h = state << (15 - frac_bits) (Q15)
+JMPNN_TARGET_AVX2 static void vec_S8toS15_avx2(int16_t * __restrict__ h, const int8_t * __restrict__ state,
+                                               JMPDSP_Length N, uint16_t frac_bits)
+{
+    int i;
+    __m128i cnt = _mm_cvtsi32_si128(15 - frac_bits);
+    for (i = 0; i + 16 <= (int)N; i += 16)
+    {
+        __m256i x = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&state[i]));
+        _mm256_storeu_si256((__m256i *)&h[i], _mm256_sll_epi16(x, cnt));
+    }
+    for (; i < N; i++)
+        h[i] = state[i] << (15 - frac_bits);
+}
+
+// Vector form of quantize_S15toS8(): rounding shift, saturation to [-127, 127]
+JMPNN_TARGET_AVX2 static void vec_quantize_S15toS8_avx2(int8_t * __restrict__ state, const int16_t * __restrict__ h,
+                                                        JMPDSP_Length N, uint16_t frac_bits)
+{
+    int i;
+    int shift = 15 - frac_bits;
+    __m128i cnt = _mm_cvtsi32_si128(shift);
+    __m256i rnd = _mm256_set1_epi32(1 << (shift - 1));
+    __m128i lo = _mm_set1_epi8(-127);
+    for (i = 0; i + 16 <= (int)N; i += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)&h[i]);
+        __m256i x0 = _mm256_sra_epi32(_mm256_add_epi32(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)), rnd), cnt);
+        __m256i x1 = _mm256_sra_epi32(_mm256_add_epi32(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)), rnd), cnt);
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(x0, x1), 0xD8);
+        __m128i q = _mm_packs_epi16(_mm256_castsi256_si128(p), _mm256_extracti128_si256(p, 1));
+        _mm_storeu_si128((__m128i *)&state[i], _mm_max_epi8(q, lo));
+    }
+    for (; i < N; i++)
+        state[i] = quantize_S15toS8(h[i], frac_bits);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_linear_matXvec_S8xS8_S32_avx2(const int8_t * __restrict__ W, const int8_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                                           int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                           uint16_t input_frac_bits)
+{
+    matXvec_S8xS8_S32_raw_x86(W, input, output, input_len, output_len, 8 - input_frac_bits);
+    linear_bias_shift_avx2(output, bias, output_len, 8, 0);
+}
+
+JMPNN_TARGET_AVX2 void JMPNN_gru_cell_S8xS8_S8_avx2(const int8_t * __restrict__ Wi, const int8_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                    const int8_t * __restrict__ Wh, int8_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                    JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                    uint16_t input_frac_bits, uint16_t state_frac_bits,
+                                                    JMPNN_ActivationType actType)
+{
+    int32_t acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int32_t acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int16_t h[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    int N = hidden_len;
+
+    matXvec_S8xS8_S32_raw_x86(Wi, input, acci, input_len, 3 * N, 8 - input_frac_bits);
+    matXvec_S8xS8_S32_raw_x86(Wh, state, acch, N, 3 * N, 8 - state_frac_bits);
+    vec_S8toS15_avx2(h, state, N, state_frac_bits);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, h, N, 8, 0, 8, 0, actType);
+    vec_quantize_S15toS8_avx2(state, h, N, state_frac_bits);
+}
+
+static void JMPNN_linear_matXvec_S8xS16_S32_resolve(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                                    int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                    uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_linear_matXvec_S8xS16_S32_ptr(W, input, bias, output, input_len, output_len, bias_left_shift, output_right_shift);
+}
+
+static void JMPNN_gru_matXvec_S8xS16_S16_act_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                                     const int8_t *Wh, const int16_t *prev_state, const int8_t *Bh,
+                                                     int16_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                     uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                     JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_matXvec_S8xS16_S16_act_ptr(Wi, input, Bi, Wh, prev_state, Bh, output, input_len, output_len,
+                                         Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_gru_newGate_S8xS16_S16_act_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                                     const int8_t *Wh, const int16_t *prev_state, const int8_t *Bh, const int16_t *r,
+                                                     int16_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                     uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                     JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_newGate_S8xS16_S16_act_ptr(Wi, input, Bi, Wh, prev_state, Bh, r, output, input_len, output_len,
+                                         Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_apply_activation_S16_resolve(int16_t *output, int32_t *input, JMPDSP_Length N, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_apply_activation_S16_ptr(output, input, N, actType);
+}
+
+static JMPNN_ActivationFn_S16 JMPNN_get_activation_S16_resolve(JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    return JMPNN_get_activation_S16_ptr(actType);
+}
+
+static void JMPNN_vec_interpolation_S16_resolve(int16_t *output, const int16_t *interp_vec,
+                                                const int16_t *input1, const int16_t *input2,
+                                                JMPDSP_Length N)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_vec_interpolation_S16_ptr(output, interp_vec, input1, input2, N);
+}
+
+static void JMPNN_gru_cell_S8xS16_S16_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                              const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                              JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                              uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                              JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_cell_S8xS16_S16_ptr(Wi, input, Bi, Wh, state, Bh, input_len, hidden_len,
+                                  Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_gru_gates_S8xS16_S16_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                               const int8_t *Wh, const int16_t *state, const int8_t *Bh,
+                                               int16_t *z, int16_t *n,
+                                               JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                               JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                               uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                               JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_gates_S8xS16_S16_ptr(Wi, input, Bi, Wh, state, Bh, z, n, input_len, hidden_len, unit_begin, unit_end,
+                                   Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_linear_matXvec_S8xS16_S32_tiled_resolve(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                                          int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                          uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_linear_matXvec_S8xS16_S32_tiled_ptr(W, input, bias, output, input_len, output_len, bias_left_shift, output_right_shift);
+}
+
+static void JMPNN_gru_cell_S8xS16_S16_tiled_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                                    const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                                    JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                    uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                    JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_cell_S8xS16_S16_tiled_ptr(Wi, input, Bi, Wh, state, Bh, input_len, hidden_len,
+                                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_linear_matXmat_S8xS16_S32_resolve(const int8_t *W, const int16_t *input, const int8_t *bias,
+                                                    int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                                    JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                                    uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_linear_matXmat_S8xS16_S32_ptr(W, input, bias, output, input_len, output_len, num_streams,
+                                        input_stride, output_stride, bias_left_shift, output_right_shift);
+}
+
+static void JMPNN_gru_cell_batch_S8xS16_S16_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                                    const int8_t *Wh, int16_t *state, const int8_t *Bh,
+                                                    JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_streams,
+                                                    JMPDSP_Stride input_stride, JMPDSP_Stride state_stride,
+                                                    uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                    JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_cell_batch_S8xS16_S16_ptr(Wi, input, Bi, Wh, state, Bh, input_len, hidden_len, num_streams,
+                                        input_stride, state_stride,
+                                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_gru_seq_S8xS16_S16_resolve(const int8_t *Wi, const int16_t *input, const int8_t *Bi,
+                                             const int8_t *Wh, int16_t *state, const int8_t *Bh, int16_t *output,
+                                             JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_frames,
+                                             JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                             uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                             JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_seq_S8xS16_S16_ptr(Wi, input, Bi, Wh, state, Bh, output, input_len, hidden_len, num_frames,
+                                 input_stride, output_stride,
+                                 Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_linear_matXvec_S8xS16_S32_bsr_resolve(const int8_t *W, const uint16_t *W_index, const int16_t *input, const int8_t *bias,
+                                                        int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                        uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_linear_matXvec_S8xS16_S32_bsr_ptr(W, W_index, input, bias, output, input_len, output_len, bias_left_shift, output_right_shift);
+}
+
+static void JMPNN_gru_cell_S8xS16_S16_bsr_resolve(const int8_t *Wi, const uint16_t *Wi_index, const int16_t *input, const int8_t *Bi,
+                                                  const int8_t *Wh, const uint16_t *Wh_index, int16_t *state, const int8_t *Bh,
+                                                  JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                  uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                  JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_cell_S8xS16_S16_bsr_ptr(Wi, Wi_index, input, Bi, Wh, Wh_index, state, Bh, input_len, hidden_len,
+                                      Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static int JMPNN_linear_matXvec_delta_S8xS16_S32_resolve(const int8_t *Wt, const int16_t *input, int16_t *input_ref, int32_t *acc,
+                                                         const int8_t *bias, int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                         int16_t threshold, uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    JMPNN_select_kernels_S16();
+    return JMPNN_linear_matXvec_delta_S8xS16_S32_ptr(Wt, input, input_ref, acc, bias, output, input_len, output_len,
+                                                     threshold, bias_left_shift, output_right_shift);
+}
+
+static int JMPNN_gru_cell_delta_S8xS16_S16_resolve(const int8_t *Wi_t, const int16_t *input, int16_t *input_ref, int32_t *acci, const int8_t *Bi,
+                                                   const int8_t *Wh_t, int16_t *state, int16_t *state_ref, int32_t *acch, const int8_t *Bh,
+                                                   JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                   int16_t input_threshold, int16_t state_threshold,
+                                                   uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                                   JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    return JMPNN_gru_cell_delta_S8xS16_S16_ptr(Wi_t, input, input_ref, acci, Bi, Wh_t, state, state_ref, acch, Bh,
+                                               input_len, hidden_len, input_threshold, state_threshold,
+                                               Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+static void JMPNN_linear_matXvec_S8xS8_S32_resolve(const int8_t *W, const int8_t *input, const int8_t *bias,
+                                                   int32_t *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                   uint16_t input_frac_bits)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_linear_matXvec_S8xS8_S32_ptr(W, input, bias, output, input_len, output_len, input_frac_bits);
+}
+
+static void JMPNN_gru_cell_S8xS8_S8_resolve(const int8_t *Wi, const int8_t *input, const int8_t *Bi,
+                                            const int8_t *Wh, int8_t *state, const int8_t *Bh,
+                                            JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                            uint16_t input_frac_bits, uint16_t state_frac_bits,
+                                            JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_S16();
+    JMPNN_gru_cell_S8xS8_S8_ptr(Wi, input, Bi, Wh, state, Bh, input_len, hidden_len,
+                                input_frac_bits, state_frac_bits, actType);
+}
+
+void (*JMPNN_linear_matXvec_S8xS16_S32_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                            int32_t *, JMPDSP_Length, JMPDSP_Length,
+                                            uint16_t, uint16_t) = JMPNN_linear_matXvec_S8xS16_S32_resolve;
+void (*JMPNN_gru_matXvec_S8xS16_S16_act_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                             const int8_t *, const int16_t *, const int8_t *,
+                                             int16_t *, JMPDSP_Length, JMPDSP_Length,
+                                             uint16_t, uint16_t, uint16_t, uint16_t,
+                                             JMPNN_ActivationType) = JMPNN_gru_matXvec_S8xS16_S16_act_resolve;
+void (*JMPNN_gru_newGate_S8xS16_S16_act_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                             const int8_t *, const int16_t *, const int8_t *, const int16_t *,
+                                             int16_t *, JMPDSP_Length, JMPDSP_Length,
+                                             uint16_t, uint16_t, uint16_t, uint16_t,
+                                             JMPNN_ActivationType) = JMPNN_gru_newGate_S8xS16_S16_act_resolve;
+void (*JMPNN_apply_activation_S16_ptr)(int16_t *, int32_t *, JMPDSP_Length, JMPNN_ActivationType) = JMPNN_apply_activation_S16_resolve;
+JMPNN_ActivationFn_S16 (*JMPNN_get_activation_S16_ptr)(JMPNN_ActivationType) = JMPNN_get_activation_S16_resolve;
+void (*JMPNN_vec_interpolation_S16_ptr)(int16_t *, const int16_t *, const int16_t *, const int16_t *,
+                                        JMPDSP_Length) = JMPNN_vec_interpolation_S16_resolve;
+void (*JMPNN_gru_cell_S8xS16_S16_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                      const int8_t *, int16_t *, const int8_t *,
+                                      JMPDSP_Length, JMPDSP_Length,
+                                      uint16_t, uint16_t, uint16_t, uint16_t,
+                                      JMPNN_ActivationType) = JMPNN_gru_cell_S8xS16_S16_resolve;
+void (*JMPNN_gru_gates_S8xS16_S16_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                       const int8_t *, const int16_t *, const int8_t *,
+                                       int16_t *, int16_t *,
+                                       JMPDSP_Length, JMPDSP_Length, JMPDSP_Length, JMPDSP_Length,
+                                       uint16_t, uint16_t, uint16_t, uint16_t,
+                                       JMPNN_ActivationType) = JMPNN_gru_gates_S8xS16_S16_resolve;
+void (*JMPNN_linear_matXvec_S8xS16_S32_tiled_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                                  int32_t *, JMPDSP_Length, JMPDSP_Length,
+                                                  uint16_t, uint16_t) = JMPNN_linear_matXvec_S8xS16_S32_tiled_resolve;
+void (*JMPNN_gru_cell_S8xS16_S16_tiled_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                            const int8_t *, int16_t *, const int8_t *,
+                                            JMPDSP_Length, JMPDSP_Length,
+                                            uint16_t, uint16_t, uint16_t, uint16_t,
+                                            JMPNN_ActivationType) = JMPNN_gru_cell_S8xS16_S16_tiled_resolve;
+void (*JMPNN_linear_matXmat_S8xS16_S32_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                            int32_t *, JMPDSP_Length, JMPDSP_Length, JMPDSP_Length,
+                                            JMPDSP_Stride, JMPDSP_Stride,
+                                            uint16_t, uint16_t) = JMPNN_linear_matXmat_S8xS16_S32_resolve;
+void (*JMPNN_gru_cell_batch_S8xS16_S16_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                            const int8_t *, int16_t *, const int8_t *,
+                                            JMPDSP_Length, JMPDSP_Length, JMPDSP_Length,
+                                            JMPDSP_Stride, JMPDSP_Stride,
+                                            uint16_t, uint16_t, uint16_t, uint16_t,
+                                            JMPNN_ActivationType) = JMPNN_gru_cell_batch_S8xS16_S16_resolve;
+void (*JMPNN_gru_seq_S8xS16_S16_ptr)(const int8_t *, const int16_t *, const int8_t *,
+                                     const int8_t *, int16_t *, const int8_t *, int16_t *,
+                                     JMPDSP_Length, JMPDSP_Length, JMPDSP_Length,
+                                     JMPDSP_Stride, JMPDSP_Stride,
+                                     uint16_t, uint16_t, uint16_t, uint16_t,
+                                     JMPNN_ActivationType) = JMPNN_gru_seq_S8xS16_S16_resolve;
+void (*JMPNN_linear_matXvec_S8xS16_S32_bsr_ptr)(const int8_t *, const uint16_t *, const int16_t *, const int8_t *,
+                                                int32_t *, JMPDSP_Length, JMPDSP_Length,
+                                                uint16_t, uint16_t) = JMPNN_linear_matXvec_S8xS16_S32_bsr_resolve;
+void (*JMPNN_gru_cell_S8xS16_S16_bsr_ptr)(const int8_t *, const uint16_t *, const int16_t *, const int8_t *,
+                                          const int8_t *, const uint16_t *, int16_t *, const int8_t *,
+                                          JMPDSP_Length, JMPDSP_Length,
+                                          uint16_t, uint16_t, uint16_t, uint16_t,
+                                          JMPNN_ActivationType) = JMPNN_gru_cell_S8xS16_S16_bsr_resolve;
+int (*JMPNN_linear_matXvec_delta_S8xS16_S32_ptr)(const int8_t *, const int16_t *, int16_t *, int32_t *,
+                                                 const int8_t *, int32_t *, JMPDSP_Length, JMPDSP_Length,
+                                                 int16_t, uint16_t, uint16_t) = JMPNN_linear_matXvec_delta_S8xS16_S32_resolve;
+int (*JMPNN_gru_cell_delta_S8xS16_S16_ptr)(const int8_t *, const int16_t *, int16_t *, int32_t *, const int8_t *,
+                                           const int8_t *, int16_t *, int16_t *, int32_t *, const int8_t *,
+                                           JMPDSP_Length, JMPDSP_Length, int16_t, int16_t,
+                                           uint16_t, uint16_t, uint16_t, uint16_t,
+                                           JMPNN_ActivationType) = JMPNN_gru_cell_delta_S8xS16_S16_resolve;
+void (*JMPNN_linear_matXvec_S8xS8_S32_ptr)(const int8_t *, const int8_t *, const int8_t *,
+                                           int32_t *, JMPDSP_Length, JMPDSP_Length,
+                                           uint16_t) = JMPNN_linear_matXvec_S8xS8_S32_resolve;
+void (*JMPNN_gru_cell_S8xS8_S8_ptr)(const int8_t *, const int8_t *, const int8_t *,
+                                    const int8_t *, int8_t *, const int8_t *,
+                                    JMPDSP_Length, JMPDSP_Length,
+                                    uint16_t, uint16_t,
+                                    JMPNN_ActivationType) = JMPNN_gru_cell_S8xS8_S8_resolve;
+
+// Returns 1 if the CPU (and OS) support AVX2. Setting JMPNN_DISABLE_AVX2 in the
+// environment forces the generic kernels, e.g. for A/B comparisons.
+int JMPNN_cpu_has_avx2(void)
+{
+    if (getenv("JMPNN_DISABLE_AVX2") != NULL)
+        return 0;
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? 1 : 0;
+}
+
+// Returns 1 if the CPU supports AVX-VNNI (vpdpbusd on ymm registers), used by
+// the int8-activation kernels. JMPNN_DISABLE_AVXVNNI forces the plain AVX2 ones.
+int JMPNN_cpu_has_avxvnni(void)
+{
+    if (getenv("JMPNN_DISABLE_AVXVNNI") != NULL)
+        return 0;
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avxvnni") ? 1 : 0;
+}
+
+static void select_kernels_S16(void)
+{
+    if (JMPNN_cpu_has_avx2())
+    {
+        JMPNN_linear_matXvec_S8xS16_S32_ptr  = JMPNN_linear_matXvec_S8xS16_S32_avx2;
+        JMPNN_gru_matXvec_S8xS16_S16_act_ptr = JMPNN_gru_matXvec_S8xS16_S16_act_avx2;
+        JMPNN_gru_newGate_S8xS16_S16_act_ptr = JMPNN_gru_newGate_S8xS16_S16_act_avx2;
+        JMPNN_apply_activation_S16_ptr       = JMPNN_apply_activation_S16_avx2;
+        JMPNN_get_activation_S16_ptr         = JMPNN_get_activation_S16_avx2;
+        JMPNN_vec_interpolation_S16_ptr      = JMPNN_vec_interpolation_S16_avx2;
+        JMPNN_gru_cell_S8xS16_S16_ptr        = JMPNN_gru_cell_S8xS16_S16_avx2;
+        JMPNN_gru_gates_S8xS16_S16_ptr       = JMPNN_gru_gates_S8xS16_S16_avx2;
+        JMPNN_linear_matXvec_S8xS16_S32_tiled_ptr = JMPNN_linear_matXvec_S8xS16_S32_tiled_avx2;
+        JMPNN_gru_cell_S8xS16_S16_tiled_ptr       = JMPNN_gru_cell_S8xS16_S16_tiled_avx2;
+        JMPNN_linear_matXmat_S8xS16_S32_ptr       = JMPNN_linear_matXmat_S8xS16_S32_avx2;
+        JMPNN_gru_cell_batch_S8xS16_S16_ptr       = JMPNN_gru_cell_batch_S8xS16_S16_avx2;
+        JMPNN_gru_seq_S8xS16_S16_ptr              = JMPNN_gru_seq_S8xS16_S16_avx2;
+        JMPNN_linear_matXvec_S8xS16_S32_bsr_ptr   = JMPNN_linear_matXvec_S8xS16_S32_bsr_avx2;
+        JMPNN_gru_cell_S8xS16_S16_bsr_ptr         = JMPNN_gru_cell_S8xS16_S16_bsr_avx2;
+        JMPNN_linear_matXvec_delta_S8xS16_S32_ptr = JMPNN_linear_matXvec_delta_S8xS16_S32_avx2;
+        JMPNN_gru_cell_delta_S8xS16_S16_ptr       = JMPNN_gru_cell_delta_S8xS16_S16_avx2;
+        JMPNN_linear_matXvec_S8xS8_S32_ptr        = JMPNN_linear_matXvec_S8xS8_S32_avx2;
+        JMPNN_gru_cell_S8xS8_S8_ptr               = JMPNN_gru_cell_S8xS8_S8_avx2;
+        s8_use_vnni = JMPNN_cpu_has_avxvnni();
+    }
+    else
+    {
+        JMPNN_linear_matXvec_S8xS16_S32_ptr  = JMPNN_linear_matXvec_S8xS16_S32_generic;
+        JMPNN_gru_matXvec_S8xS16_S16_act_ptr = JMPNN_gru_matXvec_S8xS16_S16_act_generic;
+        JMPNN_gru_newGate_S8xS16_S16_act_ptr = JMPNN_gru_newGate_S8xS16_S16_act_generic;
+        JMPNN_apply_activation_S16_ptr       = JMPNN_apply_activation_S16_generic;
+        JMPNN_get_activation_S16_ptr         = JMPNN_get_activation_S16_generic;
+        JMPNN_vec_interpolation_S16_ptr      = JMPNN_vec_interpolation_S16_generic;
+        JMPNN_gru_cell_S8xS16_S16_ptr        = JMPNN_gru_cell_S8xS16_S16_generic;
+        JMPNN_gru_gates_S8xS16_S16_ptr       = JMPNN_gru_gates_S8xS16_S16_generic;
+        JMPNN_linear_matXvec_S8xS16_S32_tiled_ptr = JMPNN_linear_matXvec_S8xS16_S32_tiled_generic;
+        JMPNN_gru_cell_S8xS16_S16_tiled_ptr       = JMPNN_gru_cell_S8xS16_S16_tiled_generic;
+        JMPNN_linear_matXmat_S8xS16_S32_ptr       = JMPNN_linear_matXmat_S8xS16_S32_generic;
+        JMPNN_gru_cell_batch_S8xS16_S16_ptr       = JMPNN_gru_cell_batch_S8xS16_S16_generic;
+        JMPNN_gru_seq_S8xS16_S16_ptr              = JMPNN_gru_seq_S8xS16_S16_generic;
+        JMPNN_linear_matXvec_S8xS16_S32_bsr_ptr   = JMPNN_linear_matXvec_S8xS16_S32_bsr_generic;
+        JMPNN_gru_cell_S8xS16_S16_bsr_ptr         = JMPNN_gru_cell_S8xS16_S16_bsr_generic;
+        JMPNN_linear_matXvec_delta_S8xS16_S32_ptr = JMPNN_linear_matXvec_delta_S8xS16_S32_generic;
+        JMPNN_gru_cell_delta_S8xS16_S16_ptr       = JMPNN_gru_cell_delta_S8xS16_S16_generic;
+        JMPNN_linear_matXvec_S8xS8_S32_ptr        = JMPNN_linear_matXvec_S8xS8_S32_generic;
+        JMPNN_gru_cell_S8xS8_S8_ptr               = JMPNN_gru_cell_S8xS8_S8_generic;
+    }
+}
+
+
+static pthread_once_t select_kernels_S16_once = PTHREAD_ONCE_INIT;
+
+// Picks the kernels once, whichever thread gets here first. It also runs as a
+// constructor, so the pointers are final before any thread can call them.
+__attribute__((constructor)) void JMPNN_select_kernels_S16(void)
+{
+    pthread_once(&select_kernels_S16_once, select_kernels_S16);
+}
+#endif // JMPNN_USE_X86_DISPATCH
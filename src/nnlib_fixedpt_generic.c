@@ -19,6 +19,7 @@
 //
 
 #include "nnlib_fixedpt.h"
+#include <string.h>
 
 void JMPNN_linear_matXvec_S8xS16_S32_generic(const int8_t * __restrict__ W, const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
                                      int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
@@ -41,7 +42,7 @@ void JMPNN_gru_matXvec_S8xS16_S16_act_generic(const int8_t * __restrict__ Wi, co
                                       JMPNN_ActivationType actType)
 {
     int i, j;
-    int32_t out_S32[MAX_NEURONS];
+    int32_t out_S32[JMPNN_MAX_WIDTH];
     
     for (i=0;i<output_len;i++)
     {
@@ -63,7 +64,7 @@ void JMPNN_gru_newGate_S8xS16_S16_act_generic(const int8_t * __restrict__ Wi, co
                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
                                       JMPNN_ActivationType actType)
 {
-    int32_t out_S32[MAX_NEURONS];
+    int32_t out_S32[JMPNN_MAX_WIDTH];
     int i, j;
     for (i=0;i<output_len;i++)
     {
@@ -94,6 +95,10 @@ void JMPNN_apply_activation_S16_generic(int16_t * __restrict__ output, int32_t *
     {
         vec_relu_S16(output, input, N);
     }
+    else if (actType == ACTIVATION_LINEAR)
+    {
+        vec_linear_S16(output, input, N);
+    }
     else
     {
         // ERROR
@@ -101,6 +106,18 @@ void JMPNN_apply_activation_S16_generic(int16_t * __restrict__ output, int32_t *
     
 }
 
+JMPNN_ActivationFn_S16 JMPNN_get_activation_S16_generic(JMPNN_ActivationType actType)
+{
+    switch (actType)
+    {
+        case ACTIVATION_SIGMOID: return vec_sigmoid_S16;
+        case ACTIVATION_TANH:    return vec_tanh_S16;
+        case ACTIVATION_RELU:    return vec_relu_S16;
+        case ACTIVATION_LINEAR:  return vec_linear_S16;
+        default:                 return NULL;
+    }
+}
+
 void JMPNN_vec_interpolation_S16_generic(int16_t *output, const int16_t *interp_vec,
                                  const int16_t *input1, const int16_t *input2,
                                  JMPDSP_Length N)
@@ -114,3 +131,444 @@ void JMPNN_vec_interpolation_S16_generic(int16_t *output, const int16_t *interp_
         output[i] = sum >> 15;
     }
 }
+
+static inline int16_t activation_S16(int32_t x, JMPNN_ActivationType actType)
+{
+    if (actType == ACTIVATION_SIGMOID)
+        return sigmoid_approx_S16(x);
+    else if (actType == ACTIVATION_TANH)
+        return tanh_approx_S16(x);
+    else if (actType == ACTIVATION_RELU)
+        return relu_S16(x);
+    return 0; // ERROR
+}
+
+/* Fused GRU cell: one sweep over the stacked [3N x In] / [3N x N] weights
+   (r, z, n row blocks) computes all three gate pre-activations of a neuron,
+   applies the activations and writes the convex state update. Bit-exact with
+   the gate-by-gate sequence in computeGRULayer_S16. state is updated in place.
+ */
+void JMPNN_gru_cell_S8xS16_S16_generic(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                       const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                       JMPNN_ActivationType actType)
+{
+    int16_t h_new[JMPNN_MAX_WIDTH];
+    int i, j;
+    int N = hidden_len;
+    for (i=0;i<N;i++)
+    {
+        const int8_t *wi_r = &Wi[i*input_len], *wi_z = &Wi[(N+i)*input_len], *wi_n = &Wi[(2*N+i)*input_len];
+        const int8_t *wh_r = &Wh[i*N], *wh_z = &Wh[(N+i)*N], *wh_n = &Wh[(2*N+i)*N];
+        int acci_r = ((int32_t)(Bi[i]) << Bi_left_shift);
+        int acci_z = ((int32_t)(Bi[N+i]) << Bi_left_shift);
+        int acci_n = ((int32_t)(Bi[2*N+i]) << Bi_left_shift);
+        int acch_r = ((int32_t)(Bh[i]) << Bh_left_shift);
+        int acch_z = ((int32_t)(Bh[N+i]) << Bh_left_shift);
+        int acch_n = ((int32_t)(Bh[2*N+i]) << Bh_left_shift);
+        int16_t r, z, n;
+        for (j=0;j<input_len;j++)
+        {
+            acci_r += wi_r[j]*input[j];
+            acci_z += wi_z[j]*input[j];
+            acci_n += wi_n[j]*input[j];
+        }
+        for (j=0;j<N;j++)
+        {
+            acch_r += wh_r[j]*state[j];
+            acch_z += wh_z[j]*state[j];
+            acch_n += wh_n[j]*state[j];
+        }
+        r = sigmoid_approx_S16(SLIMIT((acci_r >> outi_right_shift) + (acch_r >> outh_right_shift), 15+4));
+        z = sigmoid_approx_S16(SLIMIT((acci_z >> outi_right_shift) + (acch_z >> outh_right_shift), 15+4));
+        acch_n = FMUL32x16(acch_n, r); // Q22*Q15=Q22
+        n = activation_S16(SLIMIT((acci_n >> outi_right_shift) + (acch_n >> outh_right_shift), 15+4), actType);
+        h_new[i] = (z*state[i] + (0x7FFF-z)*n) >> 15;
+    }
+    memcpy(state, h_new, N * sizeof(int16_t));
+}
+
+// Gates of units [unit_begin, unit_end) of the fused cell (same arithmetic)
+void JMPNN_gru_gates_S8xS16_S16_generic(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                        const int8_t * __restrict__ Wh, const int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                        int16_t * __restrict__ z, int16_t * __restrict__ n,
+                                        JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                        JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                        uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                        JMPNN_ActivationType actType)
+{
+    int i, j;
+    int N = hidden_len;
+    for (i=unit_begin;i<unit_end;i++)
+    {
+        const int8_t *wi_r = &Wi[i*input_len], *wi_z = &Wi[(N+i)*input_len], *wi_n = &Wi[(2*N+i)*input_len];
+        const int8_t *wh_r = &Wh[i*N], *wh_z = &Wh[(N+i)*N], *wh_n = &Wh[(2*N+i)*N];
+        int acci_r = ((int32_t)(Bi[i]) << Bi_left_shift);
+        int acci_z = ((int32_t)(Bi[N+i]) << Bi_left_shift);
+        int acci_n = ((int32_t)(Bi[2*N+i]) << Bi_left_shift);
+        int acch_r = ((int32_t)(Bh[i]) << Bh_left_shift);
+        int acch_z = ((int32_t)(Bh[N+i]) << Bh_left_shift);
+        int acch_n = ((int32_t)(Bh[2*N+i]) << Bh_left_shift);
+        int16_t r;
+        for (j=0;j<input_len;j++)
+        {
+            acci_r += wi_r[j]*input[j];
+            acci_z += wi_z[j]*input[j];
+            acci_n += wi_n[j]*input[j];
+        }
+        for (j=0;j<N;j++)
+        {
+            acch_r += wh_r[j]*state[j];
+            acch_z += wh_z[j]*state[j];
+            acch_n += wh_n[j]*state[j];
+        }
+        r = sigmoid_approx_S16(SLIMIT((acci_r >> outi_right_shift) + (acch_r >> outh_right_shift), 15+4));
+        z[i] = sigmoid_approx_S16(SLIMIT((acci_z >> outi_right_shift) + (acch_z >> outh_right_shift), 15+4));
+        acch_n = FMUL32x16(acch_n, r); // Q22*Q15=Q22
+        n[i] = activation_S16(SLIMIT((acci_n >> outi_right_shift) + (acch_n >> outh_right_shift), 15+4), actType);
+    }
+}
+
+// TILED4x16 layout (see nnlib_types.h): each input load feeds 4 output rows
+static void matXvec_S8xS16_S32_tiled_raw(const int8_t * __restrict__ W, const int16_t * __restrict__ input,
+                                         int32_t * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    int i, j, k, nk;
+    int Kp = JMPNN_TILED4x16_COLS(input_len);
+    for (i=0;i<output_len;i+=4)
+    {
+        const int8_t *w = &W[i*Kp];
+        int32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+        for (j=0;j<input_len;j+=16, w+=64)
+        {
+            nk = MIN(16, input_len - j);
+            for (k=0;k<nk;k++)
+            {
+                int32_t x = input[j + k];
+                a0 += w[k]*x;
+                a1 += w[16 + k]*x;
+                a2 += w[32 + k]*x;
+                a3 += w[48 + k]*x;
+            }
+        }
+        acc[i] = a0;
+        if (i + 1 < output_len) acc[i + 1] = a1;
+        if (i + 2 < output_len) acc[i + 2] = a2;
+        if (i + 3 < output_len) acc[i + 3] = a3;
+    }
+}
+
+void JMPNN_linear_matXvec_S8xS16_S32_tiled_generic(const int8_t * __restrict__ W, const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                           int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                           uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int i;
+    matXvec_S8xS16_S32_tiled_raw(W, input, output, input_len, output_len);
+    for (i=0;i<output_len;i++)
+    {
+        int acc = output[i] + ((int32_t)(bias[i]) << bias_left_shift);
+        output[i] = SLIMIT(acc >> output_right_shift, 15+4);
+    }
+}
+
+// Gates and state update of the fused GRU cell from the raw stacked products acci/acch [3N]
+static void gru_cell_update_S16(const int32_t *acci, const int32_t *acch, const int8_t *Bi, const int8_t *Bh,
+                                int16_t *state, int N,
+                                uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                JMPNN_ActivationType actType)
+{
+    int16_t h_new[JMPNN_MAX_WIDTH];
+    int i;
+    for (i=0;i<N;i++)
+    {
+        int ai_r = acci[i] + ((int32_t)(Bi[i]) << Bi_left_shift);
+        int ai_z = acci[N+i] + ((int32_t)(Bi[N+i]) << Bi_left_shift);
+        int ai_n = acci[2*N+i] + ((int32_t)(Bi[2*N+i]) << Bi_left_shift);
+        int ah_r = acch[i] + ((int32_t)(Bh[i]) << Bh_left_shift);
+        int ah_z = acch[N+i] + ((int32_t)(Bh[N+i]) << Bh_left_shift);
+        int ah_n = acch[2*N+i] + ((int32_t)(Bh[2*N+i]) << Bh_left_shift);
+        int16_t r, z, n;
+        r = sigmoid_approx_S16(SLIMIT((ai_r >> outi_right_shift) + (ah_r >> outh_right_shift), 15+4));
+        z = sigmoid_approx_S16(SLIMIT((ai_z >> outi_right_shift) + (ah_z >> outh_right_shift), 15+4));
+        ah_n = FMUL32x16(ah_n, r); // Q22*Q15=Q22
+        n = activation_S16(SLIMIT((ai_n >> outi_right_shift) + (ah_n >> outh_right_shift), 15+4), actType);
+        h_new[i] = (z*state[i] + (0x7FFF-z)*n) >> 15;
+    }
+    memcpy(state, h_new, N * sizeof(int16_t));
+}
+
+void JMPNN_gru_cell_S8xS16_S16_tiled_generic(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                             const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                             JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                             uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                             JMPNN_ActivationType actType)
+{
+    int32_t acci[3*JMPNN_MAX_WIDTH];
+    int32_t acch[3*JMPNN_MAX_WIDTH];
+
+    matXvec_S8xS16_S32_tiled_raw(Wi, input, acci, input_len, 3*hidden_len);
+    matXvec_S8xS16_S32_tiled_raw(Wh, state, acch, hidden_len, 3*hidden_len);
+    gru_cell_update_S16(acci, acch, Bi, Bh, state, hidden_len,
+                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+// BSR4x16 layout (see nnlib_types.h): TILED4x16 without the all-zero tiles
+static void matXvec_S8xS16_S32_bsr_raw(const int8_t * __restrict__ W, const uint16_t * __restrict__ index,
+                                       const int16_t * __restrict__ input, int32_t * __restrict__ acc,
+                                       JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    const uint16_t *col = &index[JMPNN_BSR4x16_GROUPS(output_len) + 1];
+    int i, j, k, nk, t;
+    for (i=0;i<output_len;i+=4)
+    {
+        int32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+        for (t=index[i>>2];t<index[(i>>2) + 1];t++)
+        {
+            const int8_t *w = &W[t*64];
+            j = col[t]*16;
+            nk = MIN(16, input_len - j);
+            for (k=0;k<nk;k++)
+            {
+                int32_t x = input[j + k];
+                a0 += w[k]*x;
+                a1 += w[16 + k]*x;
+                a2 += w[32 + k]*x;
+                a3 += w[48 + k]*x;
+            }
+        }
+        acc[i] = a0;
+        if (i + 1 < output_len) acc[i + 1] = a1;
+        if (i + 2 < output_len) acc[i + 2] = a2;
+        if (i + 3 < output_len) acc[i + 3] = a3;
+    }
+}
+
+void JMPNN_linear_matXvec_S8xS16_S32_bsr_generic(const int8_t * __restrict__ W, const uint16_t * __restrict__ W_index,
+                                                 const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                                 int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                 uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int i;
+    matXvec_S8xS16_S32_bsr_raw(W, W_index, input, output, input_len, output_len);
+    for (i=0;i<output_len;i++)
+    {
+        int acc = output[i] + ((int32_t)(bias[i]) << bias_left_shift);
+        output[i] = SLIMIT(acc >> output_right_shift, 15+4);
+    }
+}
+
+void JMPNN_gru_cell_S8xS16_S16_bsr_generic(const int8_t * __restrict__ Wi, const uint16_t * __restrict__ Wi_index,
+                                           const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                           const int8_t * __restrict__ Wh, const uint16_t * __restrict__ Wh_index,
+                                           int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                           JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                           uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                           JMPNN_ActivationType actType)
+{
+    int32_t acci[3*JMPNN_MAX_WIDTH];
+    int32_t acch[3*JMPNN_MAX_WIDTH];
+
+    matXvec_S8xS16_S32_bsr_raw(Wi, Wi_index, input, acci, input_len, 3*hidden_len);
+    matXvec_S8xS16_S32_bsr_raw(Wh, Wh_index, state, acch, hidden_len, 3*hidden_len);
+    gru_cell_update_S16(acci, acch, Bi, Bh, state, hidden_len,
+                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+}
+
+// Delta matvec on column-pair interleaved weights (see nnlib_fixedpt.h)
+static int delta_matXvec_S8xS16_S32_raw(const int8_t * __restrict__ Wt, const int16_t * __restrict__ input,
+                                        int16_t * __restrict__ input_ref, int32_t * __restrict__ acc,
+                                        JMPDSP_Length input_len, JMPDSP_Length output_len, int16_t threshold)
+{
+    int i, j, n = 0;
+    for (j=0;j<input_len;j++)
+    {
+        int32_t d = input[j] - input_ref[j];
+        if (d > threshold || d < -threshold)
+        {
+            const int8_t *w = &Wt[JMPNN_COLPAIR_INDEX(0, j, output_len)];
+            for (i=0;i<output_len;i++)
+                acc[i] += w[2*i]*d;
+            input_ref[j] = input[j];
+            n++;
+        }
+    }
+    return n;
+}
+
+int JMPNN_linear_matXvec_delta_S8xS16_S32_generic(const int8_t * __restrict__ Wt, const int16_t * __restrict__ input,
+                                                  int16_t * __restrict__ input_ref, int32_t * __restrict__ acc,
+                                                  const int8_t * __restrict__ bias, int32_t * __restrict__ output,
+                                                  JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                  int16_t threshold, uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int i, n;
+    n = delta_matXvec_S8xS16_S32_raw(Wt, input, input_ref, acc, input_len, output_len, threshold);
+    for (i=0;i<output_len;i++)
+        output[i] = SLIMIT((acc[i] + ((int32_t)(bias[i]) << bias_left_shift)) >> output_right_shift, 15+4);
+    return n;
+}
+
+int JMPNN_gru_cell_delta_S8xS16_S16_generic(const int8_t * __restrict__ Wi_t, const int16_t * __restrict__ input,
+                                            int16_t * __restrict__ input_ref, int32_t * __restrict__ acci, const int8_t * __restrict__ Bi,
+                                            const int8_t * __restrict__ Wh_t, int16_t * __restrict__ state,
+                                            int16_t * __restrict__ state_ref, int32_t * __restrict__ acch, const int8_t * __restrict__ Bh,
+                                            JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                            int16_t input_threshold, int16_t state_threshold,
+                                            uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                            JMPNN_ActivationType actType)
+{
+    int n;
+    n  = delta_matXvec_S8xS16_S32_raw(Wi_t, input, input_ref, acci, input_len, 3*hidden_len, input_threshold);
+    n += delta_matXvec_S8xS16_S32_raw(Wh_t, state, state_ref, acch, hidden_len, 3*hidden_len, state_threshold);
+    gru_cell_update_S16(acci, acch, Bi, Bh, state, hidden_len,
+                        Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+    return n;
+}
+
+// BATCHED (K streams): acc[k*acc_stride + i] = W[i,:]*X[k*x_stride + :].
+// Each weight row is read from memory once and reused (from L1) for all K vectors.
+static void matXmat_S8xS16_S32_raw(const int8_t * __restrict__ W, const int16_t * __restrict__ X, int32_t * __restrict__ acc,
+                                   JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                   JMPDSP_Stride x_stride, JMPDSP_Stride acc_stride)
+{
+    int i, j, k;
+    for (i=0;i<output_len;i++)
+    {
+        const int8_t *w = &W[i*input_len];
+        for (k=0;k<num_streams;k++)
+        {
+            const int16_t *x = &X[k*x_stride];
+            int32_t a = 0;
+            for (j=0;j<input_len;j++)
+                a += w[j]*x[j];
+            acc[k*acc_stride + i] = a;
+        }
+    }
+}
+
+void JMPNN_linear_matXmat_S8xS16_S32_generic(const int8_t * __restrict__ W, const int16_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                             int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len, JMPDSP_Length num_streams,
+                                             JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                             uint16_t bias_left_shift, uint16_t output_right_shift)
+{
+    int i, k;
+    matXmat_S8xS16_S32_raw(W, input, output, input_len, output_len, num_streams, input_stride, output_stride);
+    for (k=0;k<num_streams;k++)
+    {
+        int32_t *out = &output[k*output_stride];
+        for (i=0;i<output_len;i++)
+        {
+            int acc = out[i] + ((int32_t)(bias[i]) << bias_left_shift);
+            out[i] = SLIMIT(acc >> output_right_shift, 15+4);
+        }
+    }
+}
+
+void JMPNN_gru_cell_batch_S8xS16_S16_generic(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                             const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                             JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_streams,
+                                             JMPDSP_Stride input_stride, JMPDSP_Stride state_stride,
+                                             uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                             JMPNN_ActivationType actType)
+{
+    int32_t acci[JMPNN_MAX_BATCH*3*JMPNN_MAX_WIDTH];
+    int32_t acch[JMPNN_MAX_BATCH*3*JMPNN_MAX_WIDTH];
+    int k, k0, K;
+    int N = hidden_len;
+
+    for (k0=0;k0<num_streams;k0+=JMPNN_MAX_BATCH)
+    {
+        K = MIN(JMPNN_MAX_BATCH, num_streams - k0);
+        matXmat_S8xS16_S32_raw(Wi, &input[k0*input_stride], acci, input_len, 3*N, K, input_stride, 3*N);
+        matXmat_S8xS16_S32_raw(Wh, &state[k0*state_stride], acch, N, 3*N, K, state_stride, 3*N);
+        for (k=0;k<K;k++)
+            gru_cell_update_S16(&acci[k*3*N], &acch[k*3*N], Bi, Bh, &state[(k0+k)*state_stride], N,
+                                Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+    }
+}
+
+void JMPNN_gru_seq_S8xS16_S16_generic(const int8_t * __restrict__ Wi, const int16_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                      const int8_t * __restrict__ Wh, int16_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                      int16_t * __restrict__ output,
+                                      JMPDSP_Length input_len, JMPDSP_Length hidden_len, JMPDSP_Length num_frames,
+                                      JMPDSP_Stride input_stride, JMPDSP_Stride output_stride,
+                                      uint16_t Bi_left_shift, uint16_t outi_right_shift, uint16_t Bh_left_shift, uint16_t outh_right_shift,
+                                      JMPNN_ActivationType actType)
+{
+    int32_t acci[JMPNN_SEQ_BLOCK*3*JMPNN_MAX_WIDTH];
+    int32_t acch[3*JMPNN_MAX_WIDTH];
+    int t, t0, T;
+    int N = hidden_len;
+
+    for (t0=0;t0<num_frames;t0+=JMPNN_SEQ_BLOCK)
+    {
+        T = MIN(JMPNN_SEQ_BLOCK, num_frames - t0);
+        matXmat_S8xS16_S32_raw(Wi, &input[t0*input_stride], acci, input_len, 3*N, T, input_stride, 3*N);
+        for (t=0;t<T;t++)
+        {
+            matXmat_S8xS16_S32_raw(Wh, state, acch, N, 3*N, 1, 0, 0);
+            gru_cell_update_S16(&acci[t*3*N], acch, Bi, Bh, state, N,
+                                Bi_left_shift, outi_right_shift, Bh_left_shift, outh_right_shift, actType);
+            memcpy(&output[(t0+t)*output_stride], state, N * sizeof(int16_t));
+        }
+    }
+}
+
+// INT8 ACTIVATIONS: raw dot products acc[i] = W[i,:]*input (Q7*Q(frac_bits))
+static void matXvec_S8xS8_S32_raw(const int8_t * __restrict__ W, const int8_t * __restrict__ input,
+                                  int32_t * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    int i, j;
+    for (i=0;i<output_len;i++)
+    {
+        const int8_t *w = &W[i*input_len];
+        int32_t a = 0;
+        for (j=0;j<input_len;j++)
+            a += w[j]*input[j];
+        acc[i] = a;
+    }
+}
+
+/* The raw Q(7+frac_bits) accumulators are moved to the Q22-equivalent domain of the
+   S16 kernels by << (8 - frac_bits); a Q7 bias then enters as bias << 8 and the
+   S16 helpers run with output shift 0, producing the same Q15 gate inputs.
+ */
+void JMPNN_linear_matXvec_S8xS8_S32_generic(const int8_t * __restrict__ W, const int8_t * __restrict__ input, const int8_t * __restrict__ bias,
+                                            int32_t * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                            uint16_t input_frac_bits)
+{
+    int i;
+    matXvec_S8xS8_S32_raw(W, input, output, input_len, output_len);
+    for (i=0;i<output_len;i++)
+    {
+        int acc = (output[i] << (8 - input_frac_bits)) + ((int32_t)(bias[i]) << 8);
+        output[i] = SLIMIT(acc, 15+4);
+    }
+}
+
+void JMPNN_gru_cell_S8xS8_S8_generic(const int8_t * __restrict__ Wi, const int8_t * __restrict__ input, const int8_t * __restrict__ Bi,
+                                     const int8_t * __restrict__ Wh, int8_t * __restrict__ state, const int8_t * __restrict__ Bh,
+                                     JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                     uint16_t input_frac_bits, uint16_t state_frac_bits,
+                                     JMPNN_ActivationType actType)
+{
+    int32_t acci[3*JMPNN_MAX_WIDTH];
+    int32_t acch[3*JMPNN_MAX_WIDTH];
+    int16_t h[JMPNN_MAX_WIDTH];
+    int i;
+    int N = hidden_len;
+
+    matXvec_S8xS8_S32_raw(Wi, input, acci, input_len, 3*N);
+    matXvec_S8xS8_S32_raw(Wh, state, acch, N, 3*N);
+    for (i=0;i<3*N;i++)
+    {
+        acci[i] <<= 8 - input_frac_bits;
+        acch[i] <<= 8 - state_frac_bits;
+    }
+    for (i=0;i<N;i++)
+        h[i] = state[i] << (15 - state_frac_bits);
+    gru_cell_update_S16(acci, acch, Bi, Bh, h, N, 8, 0, 8, 0, actType);
+    for (i=0;i<N;i++)
+        state[i] = quantize_S15toS8(h[i], state_frac_bits);
+}
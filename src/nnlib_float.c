@@ -19,9 +19,10 @@
 //
 
 #include "nnlib_float.h"
+#include "signalsifter_config.h"
+#include <string.h>
 
-#ifndef USE_NEON
-void JMPNN_linear_matXvec_S8xF32_F32(const int8_t * __restrict__ W, const float * __restrict__ input, const int8_t * __restrict__ bias,
+void JMPNN_linear_matXvec_S8xF32_F32_generic(const int8_t * __restrict__ W, const float * __restrict__ input, const int8_t * __restrict__ bias,
                                   float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
                                   float weightScale, float biasScale)
 {
@@ -35,7 +36,7 @@ void JMPNN_linear_matXvec_S8xF32_F32(const int8_t * __restrict__ W, const float
     }
     
 }
-void JMPNN_gru_matXvec_S8xF32_F32_act(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+void JMPNN_gru_matXvec_S8xF32_F32_act_generic(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
                                const int8_t * __restrict__ Wh, const float * __restrict__ prev_state, const int8_t * __restrict__ Bh,
                                float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
                                float weightScale, float biasScale, JMPNN_ActivationType actType)
@@ -50,10 +51,10 @@ void JMPNN_gru_matXvec_S8xF32_F32_act(const int8_t * __restrict__ Wi, const floa
             sum += Wh[i*output_len + j]*prev_state[j];
         output[i] = weightScale*sum + biasScale*(Bi[i] + Bh[i]);
     }
-    JMPNN_apply_activation_F32(output, output_len, actType);
+    JMPNN_apply_activation_F32_generic(output, output_len, actType);
 }
 
-void JMPNN_gru_newGate_S8xF32_F32_act(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+void JMPNN_gru_newGate_S8xF32_F32_act_generic(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
                                       const int8_t * __restrict__ Wh, const float * __restrict__ prev_state, const int8_t * __restrict__ Bh,
                                       const float * __restrict__ r, float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
                                       float weightScale, float biasScale, JMPNN_ActivationType actType)
@@ -71,11 +72,10 @@ void JMPNN_gru_newGate_S8xF32_F32_act(const int8_t * __restrict__ Wi, const floa
         sum = weightScale*sum + biasScale*Bi[i];
         output[i] = sum + rec_sum*r[i];
     }
-    JMPNN_apply_activation_F32(output, output_len, actType);
+    JMPNN_apply_activation_F32_generic(output, output_len, actType);
 }
-#endif  //#ifndef USE_NEON
 
-void JMPNN_apply_activation_F32(float *data, JMPDSP_Length N, JMPNN_ActivationType actType)
+void JMPNN_apply_activation_F32_generic(float *data, JMPDSP_Length N, JMPNN_ActivationType actType)
 {
     if (actType == ACTIVATION_SIGMOID)
     {
@@ -89,13 +89,29 @@ void JMPNN_apply_activation_F32(float *data, JMPDSP_Length N, JMPNN_ActivationTy
     {
         vec_relu_F32(data, data, N);
     }
+    else if (actType == ACTIVATION_LINEAR)
+    {
+        // identity
+    }
     else
     {
         // ERROR
     }
 }
 
-void JMPNN_vec_interpolation_F32(float *output, const float *interp_vec,
+JMPNN_ActivationFn_F32 JMPNN_get_activation_F32_generic(JMPNN_ActivationType actType)
+{
+    switch (actType)
+    {
+        case ACTIVATION_SIGMOID: return vec_sigmoid_F32;
+        case ACTIVATION_TANH:    return vec_tanh_F32;
+        case ACTIVATION_RELU:    return vec_relu_F32;
+        case ACTIVATION_LINEAR:  return vec_linear_F32;
+        default:                 return NULL;
+    }
+}
+
+void JMPNN_vec_interpolation_F32_generic(float *output, const float *interp_vec,
                                  const float *input1, const float *input2,
                                  JMPDSP_Length N)
 {
@@ -104,4 +120,210 @@ void JMPNN_vec_interpolation_F32(float *output, const float *interp_vec,
     {
         output[i] = interp_vec[i] * input1[i] + (1.0f - interp_vec[i]) * input2[i];
     }
-}
\ No newline at end of file
+}
+/* Fused GRU cell: one sweep over the stacked [3N x In] / [3N x N] weights
+   (r, z, n row blocks) computes all three gate pre-activations of a neuron,
+   applies the activations and writes the convex state update. The sums are
+   formed in the same order as the gate-by-gate kernels. state is updated in place.
+ */
+void JMPNN_gru_cell_S8xF32_F32_generic(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                       const int8_t * __restrict__ Wh, float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                       JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                       float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float h_new[JMPNN_MAX_WIDTH];
+    int i, j;
+    int N = hidden_len;
+    for (i=0;i<N;i++)
+    {
+        const int8_t *wi_r = &Wi[i*input_len], *wi_z = &Wi[(N+i)*input_len], *wi_n = &Wi[(2*N+i)*input_len];
+        const int8_t *wh_r = &Wh[i*N], *wh_z = &Wh[(N+i)*N], *wh_n = &Wh[(2*N+i)*N];
+        float sum_r = 0.0f, sum_z = 0.0f, sum_n = 0.0f, rec_n = 0.0f;
+        float r, z, n;
+        for (j=0;j<input_len;j++)
+        {
+            sum_r += wi_r[j]*input[j];
+            sum_z += wi_z[j]*input[j];
+            sum_n += wi_n[j]*input[j];
+        }
+        for (j=0;j<N;j++)
+        {
+            sum_r += wh_r[j]*state[j];
+            sum_z += wh_z[j]*state[j];
+            rec_n += wh_n[j]*state[j];
+        }
+        r = sigmoid_approx(weightScale*sum_r + biasScale*(Bi[i] + Bh[i]));
+        z = sigmoid_approx(weightScale*sum_z + biasScale*(Bi[N+i] + Bh[N+i]));
+        rec_n = weightScale*rec_n + biasScale*Bh[2*N+i];
+        n = weightScale*sum_n + biasScale*Bi[2*N+i] + rec_n*r;
+        JMPNN_apply_activation_F32_generic(&n, 1, actType);
+        h_new[i] = z*state[i] + (1.0f - z)*n;
+    }
+    memcpy(state, h_new, N * sizeof(float));
+}
+
+// Gates of units [unit_begin, unit_end) of the fused cell (same arithmetic)
+void JMPNN_gru_gates_S8xF32_F32_generic(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                        const int8_t * __restrict__ Wh, const float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                        float * __restrict__ z, float * __restrict__ n,
+                                        JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                        JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                        float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    int i, j;
+    int N = hidden_len;
+    for (i=unit_begin;i<unit_end;i++)
+    {
+        const int8_t *wi_r = &Wi[i*input_len], *wi_z = &Wi[(N+i)*input_len], *wi_n = &Wi[(2*N+i)*input_len];
+        const int8_t *wh_r = &Wh[i*N], *wh_z = &Wh[(N+i)*N], *wh_n = &Wh[(2*N+i)*N];
+        float sum_r = 0.0f, sum_z = 0.0f, sum_n = 0.0f, rec_n = 0.0f;
+        float r;
+        for (j=0;j<input_len;j++)
+        {
+            sum_r += wi_r[j]*input[j];
+            sum_z += wi_z[j]*input[j];
+            sum_n += wi_n[j]*input[j];
+        }
+        for (j=0;j<N;j++)
+        {
+            sum_r += wh_r[j]*state[j];
+            sum_z += wh_z[j]*state[j];
+            rec_n += wh_n[j]*state[j];
+        }
+        r = sigmoid_approx(weightScale*sum_r + biasScale*(Bi[i] + Bh[i]));
+        z[i] = sigmoid_approx(weightScale*sum_z + biasScale*(Bi[N+i] + Bh[N+i]));
+        rec_n = weightScale*rec_n + biasScale*Bh[2*N+i];
+        n[i] = weightScale*sum_n + biasScale*Bi[2*N+i] + rec_n*r;
+        JMPNN_apply_activation_F32_generic(&n[i], 1, actType);
+    }
+}
+
+// TILED4x16 layout (see nnlib_types.h): each input load feeds 4 output rows
+static void matXvec_S8xF32_tiled_raw(const int8_t * __restrict__ W, const float * __restrict__ input,
+                                     float * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    int i, j, k, nk;
+    int Kp = JMPNN_TILED4x16_COLS(input_len);
+    for (i=0;i<output_len;i+=4)
+    {
+        const int8_t *w = &W[i*Kp];
+        float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+        for (j=0;j<input_len;j+=16, w+=64)
+        {
+            nk = MIN(16, input_len - j);
+            for (k=0;k<nk;k++)
+            {
+                float x = input[j + k];
+                a0 += w[k]*x;
+                a1 += w[16 + k]*x;
+                a2 += w[32 + k]*x;
+                a3 += w[48 + k]*x;
+            }
+        }
+        acc[i] = a0;
+        if (i + 1 < output_len) acc[i + 1] = a1;
+        if (i + 2 < output_len) acc[i + 2] = a2;
+        if (i + 3 < output_len) acc[i + 3] = a3;
+    }
+}
+
+void JMPNN_linear_matXvec_S8xF32_F32_tiled_generic(const int8_t * __restrict__ W, const float * __restrict__ input, const int8_t * __restrict__ bias,
+                                                   float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                   float weightScale, float biasScale)
+{
+    int i;
+    matXvec_S8xF32_tiled_raw(W, input, output, input_len, output_len);
+    for (i=0;i<output_len;i++)
+        output[i] = weightScale*output[i] + biasScale*bias[i];
+}
+
+// Gates and state update of the fused GRU cell from the raw stacked products acci/acch [3N]
+static void gru_cell_update_F32(const float *acci, const float *acch, const int8_t *Bi, const int8_t *Bh,
+                                float *state, int N, float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float h_new[JMPNN_MAX_WIDTH];
+    int i;
+    for (i=0;i<N;i++)
+    {
+        float r, z, n, rec_n;
+        r = sigmoid_approx(weightScale*(acci[i] + acch[i]) + biasScale*(Bi[i] + Bh[i]));
+        z = sigmoid_approx(weightScale*(acci[N+i] + acch[N+i]) + biasScale*(Bi[N+i] + Bh[N+i]));
+        rec_n = weightScale*acch[2*N+i] + biasScale*Bh[2*N+i];
+        n = weightScale*acci[2*N+i] + biasScale*Bi[2*N+i] + rec_n*r;
+        JMPNN_apply_activation_F32_generic(&n, 1, actType);
+        h_new[i] = z*state[i] + (1.0f - z)*n;
+    }
+    memcpy(state, h_new, N * sizeof(float));
+}
+
+void JMPNN_gru_cell_S8xF32_F32_tiled_generic(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                             const int8_t * __restrict__ Wh, float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                             JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                             float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float acci[3*JMPNN_MAX_WIDTH];
+    float acch[3*JMPNN_MAX_WIDTH];
+    int N = hidden_len;
+
+    matXvec_S8xF32_tiled_raw(Wi, input, acci, input_len, 3*N);
+    matXvec_S8xF32_tiled_raw(Wh, state, acch, N, 3*N);
+    gru_cell_update_F32(acci, acch, Bi, Bh, state, N, weightScale, biasScale, actType);
+}
+
+// BSR4x16 layout (see nnlib_types.h): TILED4x16 without the all-zero tiles
+static void matXvec_S8xF32_bsr_raw(const int8_t * __restrict__ W, const uint16_t * __restrict__ index,
+                                   const float * __restrict__ input, float * __restrict__ acc,
+                                   JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    const uint16_t *col = &index[JMPNN_BSR4x16_GROUPS(output_len) + 1];
+    int i, j, k, nk, t;
+    for (i=0;i<output_len;i+=4)
+    {
+        float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+        for (t=index[i>>2];t<index[(i>>2) + 1];t++)
+        {
+            const int8_t *w = &W[t*64];
+            j = col[t]*16;
+            nk = MIN(16, input_len - j);
+            for (k=0;k<nk;k++)
+            {
+                float x = input[j + k];
+                a0 += w[k]*x;
+                a1 += w[16 + k]*x;
+                a2 += w[32 + k]*x;
+                a3 += w[48 + k]*x;
+            }
+        }
+        acc[i] = a0;
+        if (i + 1 < output_len) acc[i + 1] = a1;
+        if (i + 2 < output_len) acc[i + 2] = a2;
+        if (i + 3 < output_len) acc[i + 3] = a3;
+    }
+}
+
+void JMPNN_linear_matXvec_S8xF32_F32_bsr_generic(const int8_t * __restrict__ W, const uint16_t * __restrict__ W_index,
+                                                 const float * __restrict__ input, const int8_t * __restrict__ bias,
+                                                 float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                 float weightScale, float biasScale)
+{
+    int i;
+    matXvec_S8xF32_bsr_raw(W, W_index, input, output, input_len, output_len);
+    for (i=0;i<output_len;i++)
+        output[i] = weightScale*output[i] + biasScale*bias[i];
+}
+
+void JMPNN_gru_cell_S8xF32_F32_bsr_generic(const int8_t * __restrict__ Wi, const uint16_t * __restrict__ Wi_index,
+                                           const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                           const int8_t * __restrict__ Wh, const uint16_t * __restrict__ Wh_index,
+                                           float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                           JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                           float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float acci[3*JMPNN_MAX_WIDTH];
+    float acch[3*JMPNN_MAX_WIDTH];
+    int N = hidden_len;
+
+    matXvec_S8xF32_bsr_raw(Wi, Wi_index, input, acci, input_len, 3*N);
+    matXvec_S8xF32_bsr_raw(Wh, Wh_index, state, acch, N, 3*N);
+    gru_cell_update_F32(acci, acch, Bi, Bh, state, N, weightScale, biasScale, actType);
+}
@@ -0,0 +1,768 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  nnlib_float_avx2.c
+//
+//  AVX2+FMA versions of the S8xF32 kernels (x86 counterpart of nnlib_float_neon.c).
+//  int8 weights are widened 8 at a time and accumulated with FMA, so results
+//  differ from the generic kernels only by float rounding order.
+//
+
+#include "nnlib_float.h"
+#include "signalsifter_config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if JMPNN_USE_X86_DISPATCH
+#include <immintrin.h>
+#include <pthread.h>
+
+#define JMPNN_TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+
+JMPNN_TARGET_AVX2_FMA static inline __m256 load_S8_as_F32_avx2(const int8_t *w)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)w)));
+}
+
+JMPNN_TARGET_AVX2_FMA static inline float hsum_ps_avx2(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+// Raw dot products acc[i] (+)= sum_j W[i*input_len + j]*input[j], four rows at a time
+JMPNN_TARGET_AVX2_FMA static void matXvec_S8xF32_raw_avx2(const int8_t * __restrict__ W, const float * __restrict__ input,
+                                                          float * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                          int accumulate)
+{
+    int i, j;
+    int nvec = input_len & ~7U;
+
+    for (i = 0; i + 4 <= (int)output_len; i += 4)
+    {
+        const int8_t *w0 = &W[(i + 0) * input_len];
+        const int8_t *w1 = &W[(i + 1) * input_len];
+        const int8_t *w2 = &W[(i + 2) * input_len];
+        const int8_t *w3 = &W[(i + 3) * input_len];
+        __m256 a0 = _mm256_setzero_ps();
+        __m256 a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps();
+        __m256 a3 = _mm256_setzero_ps();
+        float s[4] __attribute__((aligned(16)));
+
+        for (j = 0; j < nvec; j += 8)
+        {
+            __m256 x = _mm256_loadu_ps(&input[j]);
+            a0 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w0[j]), x, a0);
+            a1 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w1[j]), x, a1);
+            a2 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w2[j]), x, a2);
+            a3 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w3[j]), x, a3);
+        }
+
+        // Transpose-reduce the 4 accumulators into [acc0 acc1 acc2 acc3]
+        __m256 h = _mm256_hadd_ps(_mm256_hadd_ps(a0, a1), _mm256_hadd_ps(a2, a3));
+        _mm_store_ps(s, _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1)));
+
+        for (; j < input_len; j++)
+        {
+            s[0] += w0[j] * input[j];
+            s[1] += w1[j] * input[j];
+            s[2] += w2[j] * input[j];
+            s[3] += w3[j] * input[j];
+        }
+        if (accumulate)
+        {
+            acc[i + 0] += s[0]; acc[i + 1] += s[1]; acc[i + 2] += s[2]; acc[i + 3] += s[3];
+        }
+        else
+        {
+            acc[i + 0] = s[0]; acc[i + 1] = s[1]; acc[i + 2] = s[2]; acc[i + 3] = s[3];
+        }
+    }
+
+    for (; i < output_len; i++)
+    {
+        const int8_t *w = &W[i * input_len];
+        __m256 a = _mm256_setzero_ps();
+        float sum;
+        for (j = 0; j < nvec; j += 8)
+            a = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[j]), _mm256_loadu_ps(&input[j]), a);
+        sum = hsum_ps_avx2(a);
+        for (; j < input_len; j++)
+            sum += w[j] * input[j];
+        acc[i] = accumulate ? acc[i] + sum : sum;
+    }
+}
+
+#ifdef USE_FAST_ACTIVATIONS
+// Vector version of tanh_rational(): Horner with FMA, one divide, no gather
+JMPNN_TARGET_AVX2_FMA static inline __m256 tanh_approx_avx2(__m256 x)
+{
+    __m256 x2, p, q;
+
+    x = _mm256_max_ps(_mm256_set1_ps(-TANH_RATIONAL_MAXX), _mm256_min_ps(_mm256_set1_ps(TANH_RATIONAL_MAXX), x));
+    x2 = _mm256_mul_ps(x, x);
+    p = _mm256_fmadd_ps(_mm256_set1_ps(TANH_RATIONAL_A13), x2, _mm256_set1_ps(TANH_RATIONAL_A11));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(TANH_RATIONAL_A9));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(TANH_RATIONAL_A7));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(TANH_RATIONAL_A5));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(TANH_RATIONAL_A3));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(TANH_RATIONAL_A1));
+    q = _mm256_fmadd_ps(_mm256_set1_ps(TANH_RATIONAL_B6), x2, _mm256_set1_ps(TANH_RATIONAL_B4));
+    q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(TANH_RATIONAL_B2));
+    q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(TANH_RATIONAL_B0));
+    return _mm256_div_ps(_mm256_mul_ps(x, p), q);
+}
+#else
+// Vector version of tanh_table_approx(); the table lookup uses a gather (index <= TANH_TABLE_MAXINDEX)
+JMPNN_TARGET_AVX2_FMA static inline __m256 tanh_approx_avx2(__m256 x)
+{
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 sign = _mm256_and_ps(x, sign_mask);
+    __m256 y, dy, fi;
+    __m256i i;
+
+    x = _mm256_andnot_ps(sign_mask, x);
+    fi = _mm256_floor_ps(_mm256_fmadd_ps(_mm256_set1_ps(TANH_SCALEFAC), x, _mm256_set1_ps(0.5f)));
+    fi = _mm256_min_ps(fi, _mm256_set1_ps(TANH_TABLE_MAXINDEX));
+    i = _mm256_cvttps_epi32(fi);
+    x = _mm256_fnmadd_ps(_mm256_set1_ps(TANH_DELTAX), fi, x);
+    y = _mm256_i32gather_ps(tanh_table, i, 4);
+    dy = _mm256_fnmadd_ps(y, y, one);                                   // 1 - y*y
+    y = _mm256_fmadd_ps(_mm256_mul_ps(x, dy), _mm256_fnmadd_ps(y, x, one), y);  // y + x*dy*(1 - y*x)
+    return _mm256_or_ps(y, sign);
+}
+#endif
+
+JMPNN_TARGET_AVX2_FMA static void vec_tanh_F32_avx2(float *output, const float *input, JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+        _mm256_storeu_ps(&output[i], tanh_approx_avx2(_mm256_loadu_ps(&input[i])));
+    for (; i < N; i++)
+        output[i] = tanh_approx(input[i]);
+}
+
+JMPNN_TARGET_AVX2_FMA static void vec_sigmoid_F32_avx2(float *output, const float *input, JMPDSP_Length N)
+{
+    int i;
+    const __m256 half = _mm256_set1_ps(0.5f);
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        __m256 t = tanh_approx_avx2(_mm256_mul_ps(half, _mm256_loadu_ps(&input[i])));
+        _mm256_storeu_ps(&output[i], _mm256_fmadd_ps(half, t, half));
+    }
+    for (; i < N; i++)
+        output[i] = sigmoid_approx(input[i]);
+}
+
+JMPNN_TARGET_AVX2_FMA static void vec_relu_F32_avx2(float *output, const float *input, JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+        _mm256_storeu_ps(&output[i], _mm256_max_ps(_mm256_loadu_ps(&input[i]), _mm256_setzero_ps()));
+    for (; i < N; i++)
+        output[i] = relu(input[i]);
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_apply_activation_F32_avx2(float *data, JMPDSP_Length N, JMPNN_ActivationType actType)
+{
+    if (actType == ACTIVATION_SIGMOID)
+    {
+        vec_sigmoid_F32_avx2(data, data, N);
+    }
+    else if (actType == ACTIVATION_TANH)
+    {
+        vec_tanh_F32_avx2(data, data, N);
+    }
+    else if (actType == ACTIVATION_RELU)
+    {
+        vec_relu_F32_avx2(data, data, N);
+    }
+    else if (actType == ACTIVATION_LINEAR)
+    {
+        // identity
+    }
+    else
+    {
+        // ERROR
+    }
+}
+
+JMPNN_ActivationFn_F32 JMPNN_get_activation_F32_avx2(JMPNN_ActivationType actType)
+{
+    switch (actType)
+    {
+        case ACTIVATION_SIGMOID: return vec_sigmoid_F32_avx2;
+        case ACTIVATION_TANH:    return vec_tanh_F32_avx2;
+        case ACTIVATION_RELU:    return vec_relu_F32_avx2;
+        case ACTIVATION_LINEAR:  return vec_linear_F32;
+        default:                 return NULL;
+    }
+}
+
+// output = weightScale*output + biasScale*bias
+JMPNN_TARGET_AVX2_FMA static void linear_scale_bias_avx2(float * __restrict__ output, const int8_t * __restrict__ bias, JMPDSP_Length output_len,
+                                                         float weightScale, float biasScale)
+{
+    int i;
+    const __m256 ws = _mm256_set1_ps(weightScale);
+    const __m256 bs = _mm256_set1_ps(biasScale);
+
+    for (i = 0; i + 8 <= (int)output_len; i += 8)
+    {
+        __m256 b = _mm256_mul_ps(bs, load_S8_as_F32_avx2(&bias[i]));
+        _mm256_storeu_ps(&output[i], _mm256_fmadd_ps(ws, _mm256_loadu_ps(&output[i]), b));
+    }
+    for (; i < output_len; i++)
+        output[i] = weightScale*output[i] + biasScale*bias[i];
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_linear_matXvec_S8xF32_F32_avx2(const int8_t * __restrict__ W, const float * __restrict__ input, const int8_t * __restrict__ bias,
+                                                                float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                float weightScale, float biasScale)
+{
+    matXvec_S8xF32_raw_avx2(W, input, output, input_len, output_len, 0);
+    linear_scale_bias_avx2(output, bias, output_len, weightScale, biasScale);
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_gru_matXvec_S8xF32_F32_act_avx2(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                                 const int8_t * __restrict__ Wh, const float * __restrict__ prev_state, const int8_t * __restrict__ Bh,
+                                                                 float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                 float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    int i;
+    const __m256 ws = _mm256_set1_ps(weightScale);
+    const __m256 bs = _mm256_set1_ps(biasScale);
+
+    matXvec_S8xF32_raw_avx2(Wi, input, output, input_len, output_len, 0);
+    matXvec_S8xF32_raw_avx2(Wh, prev_state, output, output_len, output_len, 1);
+    for (i = 0; i + 8 <= (int)output_len; i += 8)
+    {
+        __m256 b = _mm256_mul_ps(bs, _mm256_add_ps(load_S8_as_F32_avx2(&Bi[i]), load_S8_as_F32_avx2(&Bh[i])));
+        _mm256_storeu_ps(&output[i], _mm256_fmadd_ps(ws, _mm256_loadu_ps(&output[i]), b));
+    }
+    for (; i < output_len; i++)
+        output[i] = weightScale*output[i] + biasScale*(Bi[i] + Bh[i]);
+    JMPNN_apply_activation_F32_avx2(output, output_len, actType);
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_gru_newGate_S8xF32_F32_act_avx2(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                                 const int8_t * __restrict__ Wh, const float * __restrict__ prev_state, const int8_t * __restrict__ Bh,
+                                                                 const float * __restrict__ r, float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                 float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    int i;
+    float rec_sum[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    const __m256 ws = _mm256_set1_ps(weightScale);
+    const __m256 bs = _mm256_set1_ps(biasScale);
+
+    matXvec_S8xF32_raw_avx2(Wi, input, output, input_len, output_len, 0);
+    matXvec_S8xF32_raw_avx2(Wh, prev_state, rec_sum, output_len, output_len, 0);
+    for (i = 0; i + 8 <= (int)output_len; i += 8)
+    {
+        __m256 h = _mm256_fmadd_ps(ws, _mm256_loadu_ps(&rec_sum[i]), _mm256_mul_ps(bs, load_S8_as_F32_avx2(&Bh[i])));
+        __m256 x = _mm256_fmadd_ps(ws, _mm256_loadu_ps(&output[i]), _mm256_mul_ps(bs, load_S8_as_F32_avx2(&Bi[i])));
+        _mm256_storeu_ps(&output[i], _mm256_fmadd_ps(h, _mm256_loadu_ps(&r[i]), x));
+    }
+    for (; i < output_len; i++)
+    {
+        float h = weightScale*rec_sum[i] + biasScale*Bh[i];
+        output[i] = weightScale*output[i] + biasScale*Bi[i] + h*r[i];
+    }
+    JMPNN_apply_activation_F32_avx2(output, output_len, actType);
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_vec_interpolation_F32_avx2(float *output, const float *interp_vec,
+                                                            const float *input1, const float *input2,
+                                                            JMPDSP_Length N)
+{
+    int i;
+    for (i = 0; i + 8 <= (int)N; i += 8)
+    {
+        // z*a + (1-z)*b = b + z*(a - b)
+        __m256 z = _mm256_loadu_ps(&interp_vec[i]);
+        __m256 a = _mm256_loadu_ps(&input1[i]);
+        __m256 b = _mm256_loadu_ps(&input2[i]);
+        _mm256_storeu_ps(&output[i], _mm256_fmadd_ps(z, _mm256_sub_ps(a, b), b));
+    }
+    for (; i < N; i++)
+        output[i] = interp_vec[i] * input1[i] + (1.0f - interp_vec[i]) * input2[i];
+}
+
+// Gates and state update of the fused GRU cell from the raw stacked products
+// acci/acch [3N] (r, z, n blocks). acci is used as scratch.
+JMPNN_TARGET_AVX2_FMA static void gru_cell_update_avx2(float * __restrict__ acci, const float * __restrict__ acch,
+                                                       const int8_t * __restrict__ Bi, const int8_t * __restrict__ Bh,
+                                                       float * __restrict__ state, int N,
+                                                       float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    int i;
+    const __m256 ws = _mm256_set1_ps(weightScale);
+    const __m256 bs = _mm256_set1_ps(biasScale);
+
+    // r and z pre-activations (rows [0, 2N)), n pre-activation with r applied to the recurrent part
+    for (i = 0; i + 8 <= 2 * N; i += 8)
+    {
+        __m256 b = _mm256_mul_ps(bs, _mm256_add_ps(load_S8_as_F32_avx2(&Bi[i]), load_S8_as_F32_avx2(&Bh[i])));
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(&acci[i]), _mm256_loadu_ps(&acch[i]));
+        _mm256_storeu_ps(&acci[i], _mm256_fmadd_ps(ws, x, b));
+    }
+    for (; i < 2 * N; i++)
+        acci[i] = weightScale*(acci[i] + acch[i]) + biasScale*(Bi[i] + Bh[i]);
+    vec_sigmoid_F32_avx2(acci, acci, 2 * N);
+
+    for (i = 2 * N; i + 8 <= 3 * N; i += 8)
+    {
+        __m256 h = _mm256_fmadd_ps(ws, _mm256_loadu_ps(&acch[i]), _mm256_mul_ps(bs, load_S8_as_F32_avx2(&Bh[i])));
+        __m256 x = _mm256_fmadd_ps(ws, _mm256_loadu_ps(&acci[i]), _mm256_mul_ps(bs, load_S8_as_F32_avx2(&Bi[i])));
+        _mm256_storeu_ps(&acci[i], _mm256_fmadd_ps(h, _mm256_loadu_ps(&acci[i - 2 * N]), x));
+    }
+    for (; i < 3 * N; i++)
+    {
+        float h = weightScale*acch[i] + biasScale*Bh[i];
+        acci[i] = weightScale*acci[i] + biasScale*Bi[i] + h*acci[i - 2 * N];
+    }
+    JMPNN_apply_activation_F32_avx2(&acci[2 * N], N, actType);
+
+    JMPNN_vec_interpolation_F32_avx2(state, &acci[N], state, &acci[2 * N], N);
+}
+
+// Fused GRU cell: the stacked r/z/n weights are swept once per input vector
+// (3N rows each), then the gates and state update are finalized 8 lanes at a time.
+JMPNN_TARGET_AVX2_FMA void JMPNN_gru_cell_S8xF32_F32_avx2(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                          const int8_t * __restrict__ Wh, float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                          JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                          float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    float acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xF32_raw_avx2(Wi, input, acci, input_len, 3 * hidden_len, 0);
+    matXvec_S8xF32_raw_avx2(Wh, state, acch, hidden_len, 3 * hidden_len, 0);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, state, hidden_len, weightScale, biasScale, actType);
+}
+
+// Gates of units [unit_begin, unit_end): the r, z and n row blocks of the range are
+// swept separately, then finalized with the lane arithmetic of gru_cell_update_avx2.
+JMPNN_TARGET_AVX2_FMA void JMPNN_gru_gates_S8xF32_F32_avx2(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                           const int8_t * __restrict__ Wh, const float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                           float * __restrict__ z, float * __restrict__ n,
+                                                           JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                           JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                                           float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    float acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    const __m256 ws = _mm256_set1_ps(weightScale);
+    const __m256 bs = _mm256_set1_ps(biasScale);
+    int N = hidden_len, U = unit_end - unit_begin, g, i;
+
+    for (g = 0; g < 3; g++)
+    {
+        matXvec_S8xF32_raw_avx2(&Wi[(g * N + unit_begin) * input_len], input, &acci[g * U], input_len, U, 0);
+        matXvec_S8xF32_raw_avx2(&Wh[(g * N + unit_begin) * N], state, &acch[g * U], N, U, 0);
+    }
+    for (g = 0; g < 2; g++)
+    {
+        const int8_t *bi = &Bi[g * N + unit_begin], *bh = &Bh[g * N + unit_begin];
+        float *ai = &acci[g * U];
+        const float *ah = &acch[g * U];
+        for (i = 0; i + 8 <= U; i += 8)
+        {
+            __m256 b = _mm256_mul_ps(bs, _mm256_add_ps(load_S8_as_F32_avx2(&bi[i]), load_S8_as_F32_avx2(&bh[i])));
+            __m256 x = _mm256_add_ps(_mm256_loadu_ps(&ai[i]), _mm256_loadu_ps(&ah[i]));
+            _mm256_storeu_ps(&ai[i], _mm256_fmadd_ps(ws, x, b));
+        }
+        for (; i < U; i++)
+            ai[i] = weightScale*(ai[i] + ah[i]) + biasScale*(bi[i] + bh[i]);
+    }
+    vec_sigmoid_F32_avx2(acci, acci, 2 * U);
+
+    {
+        const int8_t *bi = &Bi[2 * N + unit_begin], *bh = &Bh[2 * N + unit_begin];
+        float *out = &n[unit_begin];
+        for (i = 0; i + 8 <= U; i += 8)
+        {
+            __m256 h = _mm256_fmadd_ps(ws, _mm256_loadu_ps(&acch[2 * U + i]), _mm256_mul_ps(bs, load_S8_as_F32_avx2(&bh[i])));
+            __m256 x = _mm256_fmadd_ps(ws, _mm256_loadu_ps(&acci[2 * U + i]), _mm256_mul_ps(bs, load_S8_as_F32_avx2(&bi[i])));
+            _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(h, _mm256_loadu_ps(&acci[i]), x));
+        }
+        for (; i < U; i++)
+        {
+            float h = weightScale*acch[2 * U + i] + biasScale*bh[i];
+            out[i] = weightScale*acci[2 * U + i] + biasScale*bi[i] + h*acci[i];
+        }
+        JMPNN_apply_activation_F32_avx2(out, U, actType);
+    }
+    memcpy(&z[unit_begin], &acci[U], U * sizeof(float));
+}
+
+// TILED4x16 layout (see nnlib_types.h): the 4 rows of a tile share each 16-element
+// input load and the weights are read as one contiguous stream.
+JMPNN_TARGET_AVX2_FMA static void matXvec_S8xF32_tiled_raw_avx2(const int8_t * __restrict__ W, const float * __restrict__ input,
+                                                                float * __restrict__ acc, JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    int i, j, k;
+    int Kp = JMPNN_TILED4x16_COLS(input_len);
+    int nvec = input_len & ~15U;
+
+    for (i = 0; i < (int)output_len; i += 4)
+    {
+        const int8_t *w = &W[i * Kp];
+        __m256 a0 = _mm256_setzero_ps();
+        __m256 a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps();
+        __m256 a3 = _mm256_setzero_ps();
+        float s[4] __attribute__((aligned(16)));
+
+        for (j = 0; j < nvec; j += 16, w += 64)
+        {
+            __m256 xl = _mm256_loadu_ps(&input[j]);
+            __m256 xh = _mm256_loadu_ps(&input[j + 8]);
+            a0 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[0]), xl, a0);
+            a0 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[8]), xh, a0);
+            a1 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[16]), xl, a1);
+            a1 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[24]), xh, a1);
+            a2 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[32]), xl, a2);
+            a2 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[40]), xh, a2);
+            a3 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[48]), xl, a3);
+            a3 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[56]), xh, a3);
+        }
+
+        __m256 h = _mm256_hadd_ps(_mm256_hadd_ps(a0, a1), _mm256_hadd_ps(a2, a3));
+        _mm_store_ps(s, _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1)));
+
+        // Last (zero padded) column block
+        for (k = 0; j + k < (int)input_len; k++)
+        {
+            s[0] += w[k] * input[j + k];
+            s[1] += w[16 + k] * input[j + k];
+            s[2] += w[32 + k] * input[j + k];
+            s[3] += w[48 + k] * input[j + k];
+        }
+
+        for (k = 0; k < 4 && i + k < (int)output_len; k++)
+            acc[i + k] = s[k];
+    }
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_linear_matXvec_S8xF32_F32_tiled_avx2(const int8_t * __restrict__ W, const float * __restrict__ input, const int8_t * __restrict__ bias,
+                                                                      float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                      float weightScale, float biasScale)
+{
+    matXvec_S8xF32_tiled_raw_avx2(W, input, output, input_len, output_len);
+    linear_scale_bias_avx2(output, bias, output_len, weightScale, biasScale);
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_gru_cell_S8xF32_F32_tiled_avx2(const int8_t * __restrict__ Wi, const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                                const int8_t * __restrict__ Wh, float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                                JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                                float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    float acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xF32_tiled_raw_avx2(Wi, input, acci, input_len, 3 * hidden_len);
+    matXvec_S8xF32_tiled_raw_avx2(Wh, state, acch, hidden_len, 3 * hidden_len);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, state, hidden_len, weightScale, biasScale, actType);
+}
+
+// BSR4x16 layout (see nnlib_types.h): same inner step as the TILED4x16 kernel, only
+// over the stored (non-zero) tiles of each row group.
+JMPNN_TARGET_AVX2_FMA static void matXvec_S8xF32_bsr_raw_avx2(const int8_t * __restrict__ W, const uint16_t * __restrict__ index,
+                                                              const float * __restrict__ input, float * __restrict__ acc,
+                                                              JMPDSP_Length input_len, JMPDSP_Length output_len)
+{
+    const uint16_t *col = &index[JMPNN_BSR4x16_GROUPS(output_len) + 1];
+    int i, j, k, t;
+    int nvec = input_len & ~15U;
+
+    for (i = 0; i < (int)output_len; i += 4)
+    {
+        __m256 a0 = _mm256_setzero_ps();
+        __m256 a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps();
+        __m256 a3 = _mm256_setzero_ps();
+        float s[4] __attribute__((aligned(16)));
+        int t_end = index[(i >> 2) + 1];
+
+        // A partial (zero padded) column block can only be the last tile of the group
+        t = index[i >> 2];
+        if (t < t_end && col[t_end - 1] * 16 >= nvec)
+            t_end--;
+        for (; t < t_end; t++)
+        {
+            const int8_t *w = &W[t * 64];
+            __m256 xl = _mm256_loadu_ps(&input[col[t] * 16]);
+            __m256 xh = _mm256_loadu_ps(&input[col[t] * 16 + 8]);
+            a0 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[0]), xl, a0);
+            a0 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[8]), xh, a0);
+            a1 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[16]), xl, a1);
+            a1 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[24]), xh, a1);
+            a2 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[32]), xl, a2);
+            a2 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[40]), xh, a2);
+            a3 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[48]), xl, a3);
+            a3 = _mm256_fmadd_ps(load_S8_as_F32_avx2(&w[56]), xh, a3);
+        }
+
+        __m256 h = _mm256_hadd_ps(_mm256_hadd_ps(a0, a1), _mm256_hadd_ps(a2, a3));
+        _mm_store_ps(s, _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1)));
+
+        if (t < index[(i >> 2) + 1])
+        {
+            const int8_t *w = &W[t * 64];
+            j = col[t] * 16;
+            for (k = 0; j + k < (int)input_len; k++)
+            {
+                s[0] += w[k] * input[j + k];
+                s[1] += w[16 + k] * input[j + k];
+                s[2] += w[32 + k] * input[j + k];
+                s[3] += w[48 + k] * input[j + k];
+            }
+        }
+
+        for (k = 0; k < 4 && i + k < (int)output_len; k++)
+            acc[i + k] = s[k];
+    }
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_linear_matXvec_S8xF32_F32_bsr_avx2(const int8_t * __restrict__ W, const uint16_t * __restrict__ W_index,
+                                                                    const float * __restrict__ input, const int8_t * __restrict__ bias,
+                                                                    float * __restrict__ output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                                    float weightScale, float biasScale)
+{
+    matXvec_S8xF32_bsr_raw_avx2(W, W_index, input, output, input_len, output_len);
+    linear_scale_bias_avx2(output, bias, output_len, weightScale, biasScale);
+}
+
+JMPNN_TARGET_AVX2_FMA void JMPNN_gru_cell_S8xF32_F32_bsr_avx2(const int8_t * __restrict__ Wi, const uint16_t * __restrict__ Wi_index,
+                                                              const float * __restrict__ input, const int8_t * __restrict__ Bi,
+                                                              const int8_t * __restrict__ Wh, const uint16_t * __restrict__ Wh_index,
+                                                              float * __restrict__ state, const int8_t * __restrict__ Bh,
+                                                              JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                              float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    float acci[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+    float acch[3 * JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+
+    matXvec_S8xF32_bsr_raw_avx2(Wi, Wi_index, input, acci, input_len, 3 * hidden_len);
+    matXvec_S8xF32_bsr_raw_avx2(Wh, Wh_index, state, acch, hidden_len, 3 * hidden_len);
+    gru_cell_update_avx2(acci, acch, Bi, Bh, state, hidden_len, weightScale, biasScale, actType);
+}
+
+// RUNTIME DISPATCH
+static void JMPNN_linear_matXvec_S8xF32_F32_resolve(const int8_t *W, const float *input, const int8_t *bias,
+                                                    float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                    float weightScale, float biasScale)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_linear_matXvec_S8xF32_F32_ptr(W, input, bias, output, input_len, output_len, weightScale, biasScale);
+}
+
+static void JMPNN_gru_matXvec_S8xF32_F32_act_resolve(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                                     const int8_t *Wh, const float *prev_state, const int8_t *Bh,
+                                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                     float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_gru_matXvec_S8xF32_F32_act_ptr(Wi, input, Bi, Wh, prev_state, Bh, output, input_len, output_len,
+                                         weightScale, biasScale, actType);
+}
+
+static void JMPNN_gru_newGate_S8xF32_F32_act_resolve(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                                     const int8_t *Wh, const float *prev_state, const int8_t *Bh, const float *r,
+                                                     float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                     float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_gru_newGate_S8xF32_F32_act_ptr(Wi, input, Bi, Wh, prev_state, Bh, r, output, input_len, output_len,
+                                         weightScale, biasScale, actType);
+}
+
+static void JMPNN_apply_activation_F32_resolve(float *data, JMPDSP_Length N, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_apply_activation_F32_ptr(data, N, actType);
+}
+
+static JMPNN_ActivationFn_F32 JMPNN_get_activation_F32_resolve(JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    return JMPNN_get_activation_F32_ptr(actType);
+}
+
+static void JMPNN_vec_interpolation_F32_resolve(float *output, const float *interp_vec,
+                                                const float *input1, const float *input2,
+                                                JMPDSP_Length N)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_vec_interpolation_F32_ptr(output, interp_vec, input1, input2, N);
+}
+
+static void JMPNN_gru_cell_S8xF32_F32_resolve(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                              const int8_t *Wh, float *state, const int8_t *Bh,
+                                              JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                              float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_gru_cell_S8xF32_F32_ptr(Wi, input, Bi, Wh, state, Bh, input_len, hidden_len,
+                                  weightScale, biasScale, actType);
+}
+
+static void JMPNN_gru_gates_S8xF32_F32_resolve(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                               const int8_t *Wh, const float *state, const int8_t *Bh,
+                                               float *z, float *n,
+                                               JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                               JMPDSP_Length unit_begin, JMPDSP_Length unit_end,
+                                               float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_gru_gates_S8xF32_F32_ptr(Wi, input, Bi, Wh, state, Bh, z, n, input_len, hidden_len, unit_begin, unit_end,
+                                   weightScale, biasScale, actType);
+}
+
+static void JMPNN_linear_matXvec_S8xF32_F32_tiled_resolve(const int8_t *W, const float *input, const int8_t *bias,
+                                                          float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                          float weightScale, float biasScale)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_linear_matXvec_S8xF32_F32_tiled_ptr(W, input, bias, output, input_len, output_len, weightScale, biasScale);
+}
+
+static void JMPNN_gru_cell_S8xF32_F32_tiled_resolve(const int8_t *Wi, const float *input, const int8_t *Bi,
+                                                    const int8_t *Wh, float *state, const int8_t *Bh,
+                                                    JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                    float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_gru_cell_S8xF32_F32_tiled_ptr(Wi, input, Bi, Wh, state, Bh, input_len, hidden_len,
+                                        weightScale, biasScale, actType);
+}
+
+static void JMPNN_linear_matXvec_S8xF32_F32_bsr_resolve(const int8_t *W, const uint16_t *W_index, const float *input, const int8_t *bias,
+                                                        float *output, JMPDSP_Length input_len, JMPDSP_Length output_len,
+                                                        float weightScale, float biasScale)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_linear_matXvec_S8xF32_F32_bsr_ptr(W, W_index, input, bias, output, input_len, output_len, weightScale, biasScale);
+}
+
+static void JMPNN_gru_cell_S8xF32_F32_bsr_resolve(const int8_t *Wi, const uint16_t *Wi_index, const float *input, const int8_t *Bi,
+                                                  const int8_t *Wh, const uint16_t *Wh_index, float *state, const int8_t *Bh,
+                                                  JMPDSP_Length input_len, JMPDSP_Length hidden_len,
+                                                  float weightScale, float biasScale, JMPNN_ActivationType actType)
+{
+    JMPNN_select_kernels_F32();
+    JMPNN_gru_cell_S8xF32_F32_bsr_ptr(Wi, Wi_index, input, Bi, Wh, Wh_index, state, Bh, input_len, hidden_len,
+                                      weightScale, biasScale, actType);
+}
+
+void (*JMPNN_linear_matXvec_S8xF32_F32_ptr)(const int8_t *, const float *, const int8_t *,
+                                            float *, JMPDSP_Length, JMPDSP_Length,
+                                            float, float) = JMPNN_linear_matXvec_S8xF32_F32_resolve;
+void (*JMPNN_gru_matXvec_S8xF32_F32_act_ptr)(const int8_t *, const float *, const int8_t *,
+                                             const int8_t *, const float *, const int8_t *,
+                                             float *, JMPDSP_Length, JMPDSP_Length,
+                                             float, float, JMPNN_ActivationType) = JMPNN_gru_matXvec_S8xF32_F32_act_resolve;
+void (*JMPNN_gru_newGate_S8xF32_F32_act_ptr)(const int8_t *, const float *, const int8_t *,
+                                             const int8_t *, const float *, const int8_t *, const float *,
+                                             float *, JMPDSP_Length, JMPDSP_Length,
+                                             float, float, JMPNN_ActivationType) = JMPNN_gru_newGate_S8xF32_F32_act_resolve;
+void (*JMPNN_apply_activation_F32_ptr)(float *, JMPDSP_Length, JMPNN_ActivationType) = JMPNN_apply_activation_F32_resolve;
+JMPNN_ActivationFn_F32 (*JMPNN_get_activation_F32_ptr)(JMPNN_ActivationType) = JMPNN_get_activation_F32_resolve;
+void (*JMPNN_vec_interpolation_F32_ptr)(float *, const float *, const float *, const float *,
+                                        JMPDSP_Length) = JMPNN_vec_interpolation_F32_resolve;
+void (*JMPNN_gru_cell_S8xF32_F32_ptr)(const int8_t *, const float *, const int8_t *,
+                                      const int8_t *, float *, const int8_t *,
+                                      JMPDSP_Length, JMPDSP_Length,
+                                      float, float, JMPNN_ActivationType) = JMPNN_gru_cell_S8xF32_F32_resolve;
+void (*JMPNN_gru_gates_S8xF32_F32_ptr)(const int8_t *, const float *, const int8_t *,
+                                       const int8_t *, const float *, const int8_t *,
+                                       float *, float *,
+                                       JMPDSP_Length, JMPDSP_Length, JMPDSP_Length, JMPDSP_Length,
+                                       float, float, JMPNN_ActivationType) = JMPNN_gru_gates_S8xF32_F32_resolve;
+void (*JMPNN_linear_matXvec_S8xF32_F32_tiled_ptr)(const int8_t *, const float *, const int8_t *,
+                                                  float *, JMPDSP_Length, JMPDSP_Length,
+                                                  float, float) = JMPNN_linear_matXvec_S8xF32_F32_tiled_resolve;
+void (*JMPNN_gru_cell_S8xF32_F32_tiled_ptr)(const int8_t *, const float *, const int8_t *,
+                                            const int8_t *, float *, const int8_t *,
+                                            JMPDSP_Length, JMPDSP_Length,
+                                            float, float, JMPNN_ActivationType) = JMPNN_gru_cell_S8xF32_F32_tiled_resolve;
+
+void (*JMPNN_linear_matXvec_S8xF32_F32_bsr_ptr)(const int8_t *, const uint16_t *, const float *, const int8_t *,
+                                                float *, JMPDSP_Length, JMPDSP_Length,
+                                                float, float) = JMPNN_linear_matXvec_S8xF32_F32_bsr_resolve;
+void (*JMPNN_gru_cell_S8xF32_F32_bsr_ptr)(const int8_t *, const uint16_t *, const float *, const int8_t *,
+                                          const int8_t *, const uint16_t *, float *, const int8_t *,
+                                          JMPDSP_Length, JMPDSP_Length,
+                                          float, float, JMPNN_ActivationType) = JMPNN_gru_cell_S8xF32_F32_bsr_resolve;
+// Returns 1 if the CPU (and OS) support AVX2 and FMA. JMPNN_DISABLE_AVX2 in the
+// environment forces the generic kernels.
+int JMPNN_cpu_has_avx2_fma(void)
+{
+    if (getenv("JMPNN_DISABLE_AVX2") != NULL)
+        return 0;
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? 1 : 0;
+}
+
+static void select_kernels_F32(void)
+{
+    if (JMPNN_cpu_has_avx2_fma())
+    {
+        JMPNN_linear_matXvec_S8xF32_F32_ptr  = JMPNN_linear_matXvec_S8xF32_F32_avx2;
+        JMPNN_gru_matXvec_S8xF32_F32_act_ptr = JMPNN_gru_matXvec_S8xF32_F32_act_avx2;
+        JMPNN_gru_newGate_S8xF32_F32_act_ptr = JMPNN_gru_newGate_S8xF32_F32_act_avx2;
+        JMPNN_apply_activation_F32_ptr       = JMPNN_apply_activation_F32_avx2;
+        JMPNN_get_activation_F32_ptr         = JMPNN_get_activation_F32_avx2;
+        JMPNN_vec_interpolation_F32_ptr      = JMPNN_vec_interpolation_F32_avx2;
+        JMPNN_gru_cell_S8xF32_F32_ptr        = JMPNN_gru_cell_S8xF32_F32_avx2;
+        JMPNN_gru_gates_S8xF32_F32_ptr       = JMPNN_gru_gates_S8xF32_F32_avx2;
+        JMPNN_linear_matXvec_S8xF32_F32_tiled_ptr = JMPNN_linear_matXvec_S8xF32_F32_tiled_avx2;
+        JMPNN_gru_cell_S8xF32_F32_tiled_ptr       = JMPNN_gru_cell_S8xF32_F32_tiled_avx2;
+        JMPNN_linear_matXvec_S8xF32_F32_bsr_ptr   = JMPNN_linear_matXvec_S8xF32_F32_bsr_avx2;
+        JMPNN_gru_cell_S8xF32_F32_bsr_ptr         = JMPNN_gru_cell_S8xF32_F32_bsr_avx2;
+    }
+    else
+    {
+        JMPNN_linear_matXvec_S8xF32_F32_ptr  = JMPNN_linear_matXvec_S8xF32_F32_generic;
+        JMPNN_gru_matXvec_S8xF32_F32_act_ptr = JMPNN_gru_matXvec_S8xF32_F32_act_generic;
+        JMPNN_gru_newGate_S8xF32_F32_act_ptr = JMPNN_gru_newGate_S8xF32_F32_act_generic;
+        JMPNN_apply_activation_F32_ptr       = JMPNN_apply_activation_F32_generic;
+        JMPNN_get_activation_F32_ptr         = JMPNN_get_activation_F32_generic;
+        JMPNN_vec_interpolation_F32_ptr      = JMPNN_vec_interpolation_F32_generic;
+        JMPNN_gru_cell_S8xF32_F32_ptr        = JMPNN_gru_cell_S8xF32_F32_generic;
+        JMPNN_gru_gates_S8xF32_F32_ptr       = JMPNN_gru_gates_S8xF32_F32_generic;
+        JMPNN_linear_matXvec_S8xF32_F32_tiled_ptr = JMPNN_linear_matXvec_S8xF32_F32_tiled_generic;
+        JMPNN_gru_cell_S8xF32_F32_tiled_ptr       = JMPNN_gru_cell_S8xF32_F32_tiled_generic;
+        JMPNN_linear_matXvec_S8xF32_F32_bsr_ptr   = JMPNN_linear_matXvec_S8xF32_F32_bsr_generic;
+        JMPNN_gru_cell_S8xF32_F32_bsr_ptr         = JMPNN_gru_cell_S8xF32_F32_bsr_generic;
+    }
+}
+
+
+static pthread_once_t select_kernels_F32_once = PTHREAD_ONCE_INIT;
+
+// Picks the kernels once, whichever thread gets here first. It also runs as a
+// constructor, so the pointers are final before any thread can call them.
+__attribute__((constructor)) void JMPNN_select_kernels_F32(void)
+{
+    pthread_once(&select_kernels_F32_once, select_kernels_F32);
+}
+#endif // JMPNN_USE_X86_DISPATCH
@@ -3,7 +3,7 @@
 #ifdef USE_NEON  // NEON kernels are 4x faster than generic kernels on M1
 #include <arm_neon.h>
 
-void JMPNN_linear_matXvec_S8xF32_F32(const int8_t * restrict W, 
+void JMPNN_linear_matXvec_S8xF32_F32_neon(const int8_t * restrict W, 
                                      const float * restrict input, 
                                      const int8_t * restrict bias,
                                      float * restrict output, 
@@ -39,7 +39,7 @@ void JMPNN_linear_matXvec_S8xF32_F32(const int8_t * restrict W,
     }
 }
 
-void JMPNN_gru_matXvec_S8xF32_F32_act(const int8_t * restrict Wi, 
+void JMPNN_gru_matXvec_S8xF32_F32_act_neon(const int8_t * restrict Wi, 
                                       const float * restrict input, 
                                       const int8_t * restrict Bi,
                                       const int8_t * restrict Wh, 
@@ -97,7 +97,7 @@ void JMPNN_gru_matXvec_S8xF32_F32_act(const int8_t * restrict Wi,
     JMPNN_apply_activation_F32(output, output_len, actType);
 }
 
-void JMPNN_gru_newGate_S8xF32_F32_act(const int8_t * restrict Wi, 
+void JMPNN_gru_newGate_S8xF32_F32_act_neon(const int8_t * restrict Wi, 
                                       const float * restrict input, 
                                       const int8_t * restrict Bi,
                                       const int8_t * restrict Wh, 
@@ -19,38 +19,246 @@
 //
 
 #include "noise_reduction.h"
+#include "noise_reduction_worker.h"
 #include "utils.h"
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <syslog.h>
 
+extern const SignalSifterModel ss_model;
+
 void create_noise_reduction(NoiseReductionState *nr, float naturalness, float min_gain)
+{
+    create_noise_reduction_geometry(nr, naturalness, min_gain, FFT_SIZE, HOP_LENGTH);
+}
+
+/* NR instance with an STFT of fft_size points and hop_length samples per frame, e.g.
+   the geometry a model file was trained for. The NN features are the first bins of the
+   log spectrum: the compiled-in model needs IO_SIZE of them, a smaller geometry needs a
+   graph or model that fits (noise_reduction_set_graph/set_model) before processing.
+   Returns -1 if the STFT does not support the geometry (stft_geometry_supported()),
+   or if the delta build could not allocate its model.
+ */
+int create_noise_reduction_geometry(NoiseReductionState *nr, float naturalness, float min_gain,
+                                    unsigned int fft_size, unsigned int hop_length)
 {
 // #if PRINT_JUMPML_NR_MEMORY_STATS 
 //     printf("NR State Memory Requirements = %lu bytes\n", NR_STATE_SIZE);
 // #endif
-    create_stft(&nr->STFT);
-#ifdef USE_FLOAT32_SIGNALSIFTER
+    if (create_stft_geometry(&nr->STFT, fft_size, hop_length))
+        return -1;
+#if defined(USE_FLOAT32_SIGNALSIFTER)
     createSignalSifterModel(&nr->SS);
+#elif defined(USE_INT8_SIGNALSIFTER)
+    createSignalSifterModel_S8(&nr->SS);
+#elif defined(USE_DELTA_SIGNALSIFTER)
+    if (createSignalSifterModelDelta_S16(&nr->SS))
+        return -1;
 #else
     createSignalSifterModel_S16(&nr->SS);
 #endif
 //    for (int i=0; i < nr->STFT.numBins; i++)
 //        nr->gains[i] = 1.0f;
+    JMPDSP_vclr(nr->gains, 1, STFT_MAX_NUM_BINS);
     // Tuning parameter
     nr->alphaReverb = NR_ALPHA_REVERB;
     nr->alphaLowLev = naturalness;
     nr->minGain = min_gain;
     nr->gainBoost = NR_GAIN_BOOST;
-    nr->speechBandStartBin =  SPEECH_BAND_START / FREQ_RESOLUTION;
-    nr->speechBandEndBin = SPEECH_BAND_END / FREQ_RESOLUTION;
+    nr->speechBandStartBin = SPEECH_BAND_START * fft_size / SAMPLE_RATE;
+    nr->speechBandEndBin = SPEECH_BAND_END * fft_size / SAMPLE_RATE;
+    nr->graph = NULL;
+    nr->graphStateOwned = 0;
+    memset(&nr->graphState, 0, sizeof(NRGraphState));
+    memset(&nr->gate, 0, sizeof(NRGate));
+    nr->team = NULL;
+    nr->pipeline = NULL;
+    nr->worker = NULL;
+    noise_reduction_set_gate(nr, NR_GATE_ENABLE, NR_GATE_THRESHOLD_DB, NR_GATE_STATE_DECAY);
+    return 0;
+}
+
+/* Energy gate configuration (see NR_GATE_*). state_decay in [0, 1] scales the GRU
+   states on every bypassed frame (1: the states are kept as they are).
+ */
+void noise_reduction_set_gate(NoiseReductionState *nr, int enable, float threshold_db, float state_decay)
+{
+    nr->gate.enabled = enable;
+    nr->gate.thresholdDb = threshold_db;
+    nr->gate.stateDecay = fmaxf(fminf(state_decay, 1.0f), 0.0f);
+}
+
+/* Delta build: changes smaller than input_threshold (Q9, NN input) and state_threshold
+   (Q15, GRU states and layer outputs) since a column was last applied are skipped, see
+   DELTA_*_THRESHOLD_*; 0/0 gives the dense output. Kept across noise_reduction_set_model;
+   -1 in the other builds or for a threshold outside [0, INT16_MAX].
+ */
+int noise_reduction_set_delta_thresholds(NoiseReductionState *nr, int input_threshold, int state_threshold)
+{
+    if (input_threshold < 0 || input_threshold > INT16_MAX || state_threshold < 0 || state_threshold > INT16_MAX)
+        return -1;
+#if defined(USE_DELTA_SIGNALSIFTER)
+    nr->SS.input_threshold = (int16_t)input_threshold;
+    nr->SS.state_threshold = (int16_t)state_threshold;
+    return 0;
+#else
+    (void)nr;
+    return -1;
+#endif
+}
+
+/* Splits the GRU layers of noise_reduction_process() across team (nn_team.h, NULL:
+   serial); the output is unchanged. The team must outlive its use and serves one
+   instance at a time. The batched paths (noise_reduction_process_batch/_frames) and
+   the int8-activation and delta builds do not use it (-1 in those builds).
+ */
+int noise_reduction_set_team(NoiseReductionState *nr, NNTeam *team)
+{
+#if defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    if (team)
+        return -1;
+#endif
+    nr->team = team;
+    return 0;
+}
+
+/* Runs the NN of noise_reduction_process_frames() on pipeline (signalsifter_pipeline.h,
+   NULL: in the caller's thread); the output is unchanged. Fixed-point build only (-1
+   otherwise); an instance running a graph or with the energy gate enabled does not use
+   it. The pipeline serves one instance at a time and must outlive its use.
+ */
+int noise_reduction_set_pipeline(NoiseReductionState *nr, SignalSifterPipeline_S16 *pipeline)
+{
+#if defined(USE_FLOAT32_SIGNALSIFTER) || defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    if (pipeline)
+        return -1;
+#endif
+    nr->pipeline = pipeline;
+    return 0;
+}
+
+/* Switches the NN to model (NULL: the compiled-in one), e.g. one loaded with
+   loadSignalSifterModelFile(), and resets the NN state. The model must outlive
+   the instance and its input must fit the STFT bins (-1 otherwise). The delta build only runs the compiled-in model (its column-pair
+   weight copies are built once per process) and returns -1 for any other.
+ */
+int noise_reduction_set_model(NoiseReductionState *nr, const SignalSifterModel *model)
+{
+    if (model == NULL)
+        model = &ss_model;
+    if (model->gru1_gru->input_size > nr->STFT.numBins)
+        return -1;
+    noise_reduction_set_graph(nr, NULL);
+#if defined(USE_FLOAT32_SIGNALSIFTER)
+    destroySignalSifterModel(&nr->SS);
+    createSignalSifterModel(&nr->SS);
+    nr->SS.model = model;
+#elif defined(USE_INT8_SIGNALSIFTER)
+    destroySignalSifterModel_S8(&nr->SS);
+    createSignalSifterModel_S8(&nr->SS);
+    nr->SS.model = model;
+#elif defined(USE_DELTA_SIGNALSIFTER)
+    int16_t input_threshold = nr->SS.input_threshold, state_threshold = nr->SS.state_threshold;
+    if (model != nr->SS.dmodel->model)
+        return -1;
+    destroySignalSifterModelDelta_S16(&nr->SS);
+    createSignalSifterModelDelta_S16(&nr->SS);     // cannot fail: dmodel is already built
+    nr->SS.input_threshold = input_threshold;
+    nr->SS.state_threshold = state_threshold;
+#else
+    destroySignalSifterModel_S16(&nr->SS);
+    createSignalSifterModel_S16(&nr->SS);
+    nr->SS.model = model;
+#endif
+    return 0;
+}
+
+/* Bytes of per-stream graph state noise_reduction_set_graph_state() needs for graph
+   (0 in the int8-activation and delta builds, which cannot run graphs).
+ */
+size_t noise_reduction_graph_state_size(const NNGraph *graph)
+{
+#if defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    return 0;
+#elif defined(USE_FLOAT32_SIGNALSIFTER)
+    return getNNGraphStateSize(graph);
+#else
+    return getNNGraphStateSize_S16(graph);
+#endif
+}
+
+// Switches to graph (NULL: the model) with its state in mem, freed later if owned
+static int set_graph(NoiseReductionState *nr, const NNGraph *graph, void *mem, int owned)
+{
+#if defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    return graph ? -1 : 0;
+#else
+    if (graph && (graph->input_size > nr->STFT.numBins || graph->output_size > nr->STFT.numBins))
+        return -1;
+    if (nr->graphStateOwned)
+        free(nr->graphState.state);
+    memset(&nr->graphState, 0, sizeof(NRGraphState));
+    nr->graph = graph;
+    nr->graphStateOwned = graph && owned;
+    if (graph)
+    {
+#if defined(USE_FLOAT32_SIGNALSIFTER)
+        createNNGraphState(&nr->graphState, graph, mem);
+#else
+        createNNGraphState_S16(&nr->graphState, graph, mem);
+#endif
+    }
+    return 0;
+#endif
+}
+
+/* Runs graph (e.g. the graph of a model file, which need not have the SignalSifter
+   shape) instead of the model from the next frame on, with a fresh state sized from the
+   graph; NULL goes back to the model. The graph maps the first input_size bins of the
+   log spectrum to the gains of the first output_size bins (the others get none), so
+   neither may exceed the STFT bins; it must outlive the instance. The int8-activation
+   and delta builds have no graph executor and return -1 for any graph.
+ */
+int noise_reduction_set_graph(NoiseReductionState *nr, const NNGraph *graph)
+{
+    size_t size;
+    void *mem = NULL;
+
+    if (graph)
+    {
+        size = noise_reduction_graph_state_size(graph);
+        mem = malloc(size ? size : 1);
+        if (mem == NULL)
+            return -1;
+    }
+    if (set_graph(nr, graph, mem, 1))
+    {
+        free(mem);
+        return -1;
+    }
+    return 0;
+}
+
+// Same with the state in caller memory of noise_reduction_graph_state_size() bytes
+// (e.g. next to the instance), which must outlive the graph's use
+int noise_reduction_set_graph_state(NoiseReductionState *nr, const NNGraph *graph, void *mem)
+{
+    return set_graph(nr, graph, mem, 0);
 }
 
 void destroy_noise_reduction(NoiseReductionState *nr)
 {
+    noise_reduction_stop_worker(nr);
     destroy_stft(&nr->STFT);
-#ifdef USE_FLOAT32_SIGNALSIFTER
+    set_graph(nr, NULL, NULL, 0);
+#if defined(USE_FLOAT32_SIGNALSIFTER)
     destroySignalSifterModel(&nr->SS);
+#elif defined(USE_INT8_SIGNALSIFTER)
+    destroySignalSifterModel_S8(&nr->SS);
+#elif defined(USE_DELTA_SIGNALSIFTER)
+    destroySignalSifterModelDelta_S16(&nr->SS);
 #else
     destroySignalSifterModel_S16(&nr->SS);
 #endif
@@ -87,34 +295,179 @@ void postprocess_gains(float *gainsIn, float *gainsState, int numBins, NoiseRedu
     }
 }
 
+// Gain post-processing, masking and ISTFT of one frame (raw NN gains in gains)
+static void noise_reduction_synthesis(NoiseReductionState *nr, float *gains, float *output, unsigned int R)
+{
+    postprocess_gains(gains, nr->gains, nr->STFT.numBins, nr);
+//    print_vector(nr->gains, nr->STFT.numBins, "NR Gains");
+    mask_process(&nr->STFT, nr->gains);
+    istft_process(&nr->STFT, output, R);
+}
+
+static void decay_signalsifter_state(NRSignalSifterState *ss, float decay)
+{
+#if defined(USE_FLOAT32_SIGNALSIFTER)
+    JMPDSP_vsmul(ss->gru1_gru_state, 1, &decay, ss->gru1_gru_state, 1, GRU_STATE_SIZE);
+    JMPDSP_vsmul(ss->gru2_gru_state, 1, &decay, ss->gru2_gru_state, 1, GRU_STATE_SIZE);
+    JMPDSP_vsmul(ss->gru3_gru_state, 1, &decay, ss->gru3_gru_state, 1, GRU_STATE_SIZE);
+#else
+    // int16 (Q15) or int8 states
+    int32_t decay_Q15 = (int32_t)(decay * 32767.0f);
+    int i;
+    for (i = 0; i < GRU_STATE_SIZE; i++)
+    {
+        ss->gru1_gru_state[i] = (ss->gru1_gru_state[i] * decay_Q15) >> 15;
+        ss->gru2_gru_state[i] = (ss->gru2_gru_state[i] * decay_Q15) >> 15;
+        ss->gru3_gru_state[i] = (ss->gru3_gru_state[i] * decay_Q15) >> 15;
+    }
+#endif
+}
+
+static void decay_graph_state(NRGraphState *st, float decay)
+{
+#if defined(USE_FLOAT32_SIGNALSIFTER)
+    JMPDSP_vsmul(st->state, 1, &decay, st->state, 1, st->graph->state_len);
+#else
+    int32_t decay_Q15 = (int32_t)(decay * 32767.0f);
+    int i;
+    for (i = 0; i < st->graph->state_len; i++)
+        st->state[i] = (st->state[i] * decay_Q15) >> 15;
+#endif
+}
+
+static int is_digital_zero(const float *input, unsigned int R)
+{
+    unsigned int i;
+    for (i = 0; i < R; i++)
+        if (input[i] != 0.0f)
+            return 0;
+    return 1;
+}
+
+/* STFT of one frame and the energy gate. Returns 1 if the gate handled the frame
+   without the NN (output written), 0 if the NN and synthesis are still to run.
+ */
+static int noise_reduction_analysis(NoiseReductionState *nr, const float *input, float *output, unsigned int R)
+{
+    NRGate *g = &nr->gate;
+    float level;
+    int i;
+
+    if (!g->enabled)
+    {
+        stft_process(&nr->STFT, input, R);
+        return 0;
+    }
+    g->framesTotal++;
+    g->zeroRun = is_digital_zero(input, R) ? g->zeroRun + 1 : 0;
+    if (g->zeroRun * R >= nr->STFT.NFFT)
+    {
+        stft_zero_frame(&nr->STFT, output, R);
+        g->closed = 1;
+        g->framesZero++;
+    }
+    else
+    {
+        stft_process(&nr->STFT, input, R);
+        level = 10.0f * log10f(nr->STFT.energy + LOGMAG_EPSILON);
+        if (level < g->thresholdDb)
+        {
+            if (++g->belowCount >= NR_GATE_HANGOVER)
+                g->closed = 1;
+        }
+        else
+        {
+            g->belowCount = 0;
+            if (level > g->thresholdDb + NR_GATE_HYSTERESIS_DB)
+                g->closed = 0;
+        }
+        if (!g->closed)
+            return 0;
+    }
+
+    g->framesBypassed++;
+    for (i = 0; i < nr->STFT.numBins; i++)
+        nr->gains[i] = fmaxf(nr->gains[i] * NR_GATE_GAIN_DECAY, nr->minGain);
+    if (g->stateDecay < 1.0f)
+    {
+        if (nr->graph)
+            decay_graph_state(&nr->graphState, g->stateDecay);
+        else
+            decay_signalsifter_state(&nr->SS, g->stateDecay);
+    }
+    if (g->zeroRun * R < nr->STFT.NFFT)
+    {
+        mask_process(&nr->STFT, nr->gains);
+        istft_process(&nr->STFT, output, R);
+    }
+    return 1;
+}
+
+/* Number of log-spectrum bins converted for the NN: all bins, or IO_SIZE if the STFT has
+   fewer bins than the compiled-in model reads (the rest of Xmag is zero).
+ */
+static unsigned int nn_feature_bins(const NoiseReductionState *nr)
+{
+    return MAX(nr->STFT.numBins, IO_SIZE);
+}
+
+/* Raw NN gains of one frame from its log-spectrum features (nr->STFT.Xmag, or a copy of
+   it made by the NN worker); advances the NN state.
+ */
+void noise_reduction_nn(NoiseReductionState *nr, const float *features, float *gains)
+{
+    unsigned int n = nn_feature_bins(nr);
+#if defined(USE_INT8_SIGNALSIFTER)
+    int16_t gains_S16[STFT_MAX_NUM_BINS];
+    int8_t Xmag_S8[STFT_MAX_NUM_BINS];
+    JMPDSP_vclr_S16(gains_S16, 1, n);
+#elif !defined(USE_FLOAT32_SIGNALSIFTER)
+    int16_t gains_S16[STFT_MAX_NUM_BINS], Xmag_S16[STFT_MAX_NUM_BINS];
+    JMPDSP_vclr_S16(gains_S16, 1, n);
+#endif
+    JMPDSP_vclr(gains, 1, n);
+    setNNLayerTeam(nr->team);
+
+#if defined(USE_FLOAT32_SIGNALSIFTER)
+    if (nr->graph)
+        computeNNGraph(&nr->graphState, gains, features);
+    else
+        computeSignalSifterModel(&nr->SS, gains, features);
+#elif defined(USE_INT8_SIGNALSIFTER)
+    convert_F32toS8_Q(features, Xmag_S8, n, INPUT_S8_FRAC_BITS);
+    computeSignalSifterModel_S8(&nr->SS, gains_S16, Xmag_S8);
+    convert_S16toF32(gains_S16, gains, n, GRU_NUM_FRAC_BITS);
+#else
+    convert_F32toS16(features, Xmag_S16, n, INPUT_NUM_FRAC_BITS);
+#if defined(USE_DELTA_SIGNALSIFTER)
+    computeSignalSifterModelDelta_S16(&nr->SS, gains_S16, Xmag_S16);
+#else
+    if (nr->graph)
+        computeNNGraph_S16(&nr->graphState, gains_S16, Xmag_S16);
+    else
+        computeSignalSifterModel_S16(&nr->SS, gains_S16, Xmag_S16);
+#endif
+    convert_S16toF32(gains_S16, gains, n, GRU_NUM_FRAC_BITS);
+#endif
+    setNNLayerTeam(NULL);
+}
+
 void noise_reduction_process(NoiseReductionState *nr, const float *input, float *output, unsigned int R)
 {
-    float gains[NUM_BINS] __attribute__((aligned(16)));
+    float gains[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
 
 #if defined(ENABLE_PROFILING)
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
 #endif 
 
-#ifndef USE_FLOAT32_SIGNALSIFTER
-    int16_t gains_S16[NUM_BINS], Xmag_S16[NUM_BINS];
-    JMPDSP_vclr_S16(gains_S16, 1, NUM_BINS);
-#endif
-    assert(NUM_BINS == nr->STFT.numBins);
-    JMPDSP_vclr(gains, 1, NUM_BINS);
-    
-    stft_process(&nr->STFT, input, R);
-#ifdef USE_FLOAT32_SIGNALSIFTER
-    computeSignalSifterModel(&nr->SS, gains, nr->STFT.Xmag);
-#else
-    convert_F32toS16(nr->STFT.Xmag, Xmag_S16, NUM_BINS, INPUT_NUM_FRAC_BITS);
-    computeSignalSifterModel_S16(&nr->SS, gains_S16, Xmag_S16);
-    convert_S16toF32(gains_S16, gains, NUM_BINS, GRU_NUM_FRAC_BITS);
-#endif
-    postprocess_gains(gains, nr->gains, nr->STFT.numBins, nr);
-//    print_vector(nr->gains, nr->STFT.numBins, "NR Gains");
-    mask_process(&nr->STFT, nr->gains);
-    istft_process(&nr->STFT, output, R);
+    if (nr->worker)
+        noise_reduction_process_decoupled(nr, input, output, R);
+    else if (!noise_reduction_analysis(nr, input, output, R))
+    {
+        noise_reduction_nn(nr, nr->STFT.Xmag, gains);
+        noise_reduction_synthesis(nr, gains, output, R);
+    }
     
 #if defined(ENABLE_PROFILING)
     clock_gettime(CLOCK_MONOTONIC, &end);
@@ -124,6 +477,232 @@ void noise_reduction_process(NoiseReductionState *nr, const float *input, float
 
 }
 
+/* Processes one frame of num_streams independent NR instances. The result of
+   every stream is identical to noise_reduction_process(); in the fixed-point
+   build the NN of up to JMPNN_MAX_BATCH streams runs as one batched pass so
+   the weights are read once per batch instead of once per stream. The float,
+   int8-activation and delta builds, and streams with the energy gate enabled,
+   with different models, running a graph or an NN worker, are processed one
+   after another.
+ */
+void noise_reduction_process_batch(NoiseReductionState * const *nr, const float * const *input, float * const *output,
+                                   int num_streams, unsigned int R)
+{
+#if defined(USE_FLOAT32_SIGNALSIFTER) || defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    int k;
+    for (k = 0; k < num_streams; k++)
+        noise_reduction_process(nr[k], input[k], output[k], R);
+#else
+    SignalSifterBatchState_S16 batch;
+    SignalSifterState_S16 *ss[JMPNN_MAX_BATCH];
+    int16_t gains_S16[JMPNN_MAX_BATCH * STFT_MAX_NUM_BINS], Xmag_S16[JMPNN_MAX_BATCH * STFT_MAX_NUM_BINS];
+    float gains[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    unsigned int n;
+    int k, k0, K, gated = 0;
+
+    for (k = 0; k < num_streams; k++)
+        gated |= nr[k]->gate.enabled || nr[k]->SS.model != nr[0]->SS.model || nr[k]->graph || nr[k]->worker;
+    if (gated)
+    {
+        for (k = 0; k < num_streams; k++)
+            noise_reduction_process(nr[k], input[k], output[k], R);
+        return;
+    }
+    for (k0 = 0; k0 < num_streams; k0 += JMPNN_MAX_BATCH)
+    {
+        K = MIN(JMPNN_MAX_BATCH, num_streams - k0);
+        for (k = 0; k < K; k++)
+        {
+            n = nn_feature_bins(nr[k0 + k]);
+            stft_process(&nr[k0 + k]->STFT, input[k0 + k], R);
+            convert_F32toS16(nr[k0 + k]->STFT.Xmag, &Xmag_S16[k * STFT_MAX_NUM_BINS], n, INPUT_NUM_FRAC_BITS);
+            JMPDSP_vclr_S16(&gains_S16[k * STFT_MAX_NUM_BINS], 1, n);
+            ss[k] = &nr[k0 + k]->SS;
+        }
+        gatherSignalSifterBatch_S16(&batch, ss, K);
+        computeSignalSifterModelBatch_S16(&batch, gains_S16, STFT_MAX_NUM_BINS, Xmag_S16, STFT_MAX_NUM_BINS);
+        scatterSignalSifterBatch_S16(&batch, ss);
+        for (k = 0; k < K; k++)
+        {
+            convert_S16toF32(&gains_S16[k * STFT_MAX_NUM_BINS], gains, nn_feature_bins(nr[k0 + k]), GRU_NUM_FRAC_BITS);
+            noise_reduction_synthesis(nr[k0 + k], gains, output[k0 + k], R);
+        }
+    }
+#endif
+}
+
+
+/* Linked gains need the NN state of the first channel on the caller's thread: not with
+   a decoupled NN worker (which owns it), and only for the SignalSifter model (not a graph).
+ */
+int noise_reduction_linked_supported(const NoiseReductionState *nr)
+{
+    return nr->worker == NULL && nr->graph == NULL;
+}
+
+/* One frame of num_channels channels of a shared noise field (stereo, close-spaced mics)
+   with linked gains: the NN of nr[0] runs once on the log spectrum of a combined channel
+   (NR_LINK_MID or NR_LINK_MAX), and the gains post-processed with the history of nr[0]
+   mask the spectrum of every channel before its ISTFT. The other instances only keep their
+   STFT buffers; their NN state and gains are not used. One channel gives the output of
+   noise_reduction_process(); the energy gate is not used here. Returns -1 without
+   processing if nr[0] is not noise_reduction_linked_supported(), else 0.
+ */
+int noise_reduction_process_linked(NoiseReductionState * const *nr, const float * const *input, float * const *output,
+                                   int num_channels, int link_mode, unsigned int R)
+{
+    float features[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    float gains[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    kiss_fft_cpx mid[STFT_MAX_NUM_BINS];
+    unsigned int numBins = nr[0]->STFT.numBins, n;
+    float scale = 1.0f / num_channels;
+    int k;
+
+    if (!noise_reduction_linked_supported(nr[0]))
+        return -1;
+    for (k = 0; k < num_channels; k++)
+        stft_process(&nr[k]->STFT, input[k], R);
+    memcpy(features, nr[0]->STFT.Xmag, sizeof(features));
+    if (link_mode == NR_LINK_MAX)
+    {
+        // the log is monotonic: the largest log power is the log of the largest power
+        for (k = 1; k < num_channels; k++)
+            for (n = 0; n < numBins; n++)
+                features[n] = fmaxf(features[n], nr[k]->STFT.Xmag[n]);
+    }
+    else if (num_channels > 1)
+    {
+        // the FFT is linear: the spectrum of the mid channel is the mean of the spectra
+        memcpy(mid, nr[0]->STFT.Xk, numBins * sizeof(kiss_fft_cpx));
+        for (k = 1; k < num_channels; k++)
+            for (n = 0; n < numBins; n++)
+            {
+                mid[n].r += nr[k]->STFT.Xk[n].r;
+                mid[n].i += nr[k]->STFT.Xk[n].i;
+            }
+        for (n = 0; n < numBins; n++)
+        {
+            mid[n].r *= scale;
+            mid[n].i *= scale;
+        }
+        compute_magSquared(mid, features, numBins);
+        compute_logMag(features, features, numBins, 10.0f);
+    }
+
+    noise_reduction_nn(nr[0], features, gains);
+    postprocess_gains(gains, nr[0]->gains, numBins, nr[0]);
+    for (k = 0; k < num_channels; k++)
+    {
+        mask_process(&nr[k]->STFT, nr[0]->gains);
+        istft_process(&nr[k]->STFT, output[k], R);
+    }
+    return 0;
+}
+
+#if !defined(USE_FLOAT32_SIGNALSIFTER) && !defined(USE_INT8_SIGNALSIFTER) && !defined(USE_DELTA_SIGNALSIFTER)
+/* noise_reduction_process_frames() on the layer pipeline: the features of frame t are
+   pushed, then the gains of frame t - SSPIPE_DEPTH are popped and synthesized, so the
+   STFT, linear1 and the synthesis on this thread overlap the GRUs of later frames.
+ */
+static void noise_reduction_process_frames_pipelined(NoiseReductionState *nr, const float *input, float *output,
+                                                     int num_frames, unsigned int R)
+{
+    kiss_fft_cpx Xk[SSPIPE_DEPTH + 1][STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    float gains[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    int16_t gains_S16[STFT_MAX_NUM_BINS], Xmag_S16[STFT_MAX_NUM_BINS];
+    unsigned int numBins = nr->STFT.numBins, n = nn_feature_bins(nr);
+    int t, s;
+
+    for (t = 0; t < num_frames + SSPIPE_DEPTH; t++)
+    {
+        if (t < num_frames)
+        {
+            stft_process(&nr->STFT, &input[t * R], R);
+            memcpy(Xk[t % (SSPIPE_DEPTH + 1)], nr->STFT.Xk, numBins * sizeof(kiss_fft_cpx));
+            convert_F32toS16(nr->STFT.Xmag, Xmag_S16, n, INPUT_NUM_FRAC_BITS);
+            pushSignalSifterPipeline_S16(nr->pipeline, &nr->SS, Xmag_S16);
+        }
+        s = t - SSPIPE_DEPTH;
+        if (s >= 0)
+        {
+            JMPDSP_vclr_S16(gains_S16, 1, n);
+            popSignalSifterPipeline_S16(nr->pipeline, gains_S16);
+            convert_S16toF32(gains_S16, gains, n, GRU_NUM_FRAC_BITS);
+            memcpy(nr->STFT.Xk, Xk[s % (SSPIPE_DEPTH + 1)], numBins * sizeof(kiss_fft_cpx));
+            noise_reduction_synthesis(nr, gains, &output[s * R], R);
+        }
+    }
+}
+#endif
+
+/* Offline processing of num_frames consecutive frames (input/output hold
+   num_frames*R samples). Output is identical to num_frames calls of
+   noise_reduction_process(). Within each block of JMPNN_SEQ_BLOCK frames the
+   STFT features of all frames are computed first, then the NN runs layer by
+   layer over the block (input projections as GEMMs, fixed-point build), then
+   gains, masking and ISTFT/OLA run frame by frame. The int8-activation and
+   delta builds have no sequence kernels and run frame by frame, as does an
+   instance with the energy gate enabled, running a graph or an NN worker (its
+   gains lag a frame, see noise_reduction_worker.h). With a layer pipeline
+   (noise_reduction_set_pipeline) the NN layers run on their own threads instead.
+ */
+void noise_reduction_process_frames(NoiseReductionState *nr, const float *input, float *output,
+                                    int num_frames, unsigned int R)
+{
+#if defined(USE_INT8_SIGNALSIFTER) || defined(USE_DELTA_SIGNALSIFTER)
+    int t;
+    for (t = 0; t < num_frames; t++)
+        noise_reduction_process(nr, &input[t * R], &output[t * R], R);
+#else
+    kiss_fft_cpx Xk[JMPNN_SEQ_BLOCK][STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    float gains[JMPNN_SEQ_BLOCK][STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+#ifndef USE_FLOAT32_SIGNALSIFTER
+    int16_t gains_S16[JMPNN_SEQ_BLOCK * STFT_MAX_NUM_BINS], Xmag_S16[JMPNN_SEQ_BLOCK * STFT_MAX_NUM_BINS];
+#endif
+    unsigned int numBins = nr->STFT.numBins, n = nn_feature_bins(nr);
+    int t, t0, T;
+
+    if (nr->gate.enabled || nr->graph || nr->worker)
+    {
+        for (t = 0; t < num_frames; t++)
+            noise_reduction_process(nr, &input[t * R], &output[t * R], R);
+        return;
+    }
+#ifndef USE_FLOAT32_SIGNALSIFTER
+    if (nr->pipeline)
+    {
+        noise_reduction_process_frames_pipelined(nr, input, output, num_frames, R);
+        return;
+    }
+#endif
+    for (t0 = 0; t0 < num_frames; t0 += JMPNN_SEQ_BLOCK)
+    {
+        T = MIN(JMPNN_SEQ_BLOCK, num_frames - t0);
+        for (t = 0; t < T; t++)
+        {
+            stft_process(&nr->STFT, &input[(t0 + t) * R], R);
+            memcpy(Xk[t], nr->STFT.Xk, numBins * sizeof(kiss_fft_cpx));
+#ifdef USE_FLOAT32_SIGNALSIFTER
+            JMPDSP_vclr(gains[t], 1, n);
+            computeSignalSifterModel(&nr->SS, gains[t], nr->STFT.Xmag);
+#else
+            convert_F32toS16(nr->STFT.Xmag, &Xmag_S16[t * STFT_MAX_NUM_BINS], n, INPUT_NUM_FRAC_BITS);
+            JMPDSP_vclr_S16(&gains_S16[t * STFT_MAX_NUM_BINS], 1, n);
+#endif
+        }
+#ifndef USE_FLOAT32_SIGNALSIFTER
+        computeSignalSifterModelSeq_S16(&nr->SS, gains_S16, STFT_MAX_NUM_BINS, Xmag_S16, STFT_MAX_NUM_BINS, T);
+        for (t = 0; t < T; t++)
+            convert_S16toF32(&gains_S16[t * STFT_MAX_NUM_BINS], gains[t], n, GRU_NUM_FRAC_BITS);
+#endif
+        for (t = 0; t < T; t++)
+        {
+            memcpy(nr->STFT.Xk, Xk[t], numBins * sizeof(kiss_fft_cpx));
+            noise_reduction_synthesis(nr, gains[t], &output[(t0 + t) * R], R);
+        }
+    }
+#endif
+}
 
 void noise_reduction_monitor(NoiseReductionState *nr)
 {
@@ -131,7 +710,13 @@ void noise_reduction_monitor(NoiseReductionState *nr)
 #if ENABLE_SS_MONITOR
     printSignalSifterStats(nr->SS.monitor);
 #endif
+#elif defined(USE_DELTA_SIGNALSIFTER)
+    printf("Delta inference: %.1f%% of the weight MACs skipped\n", 100.0f * getSignalSifterDeltaSkipRatio(&nr->SS));
 #endif
+    if (nr->gate.enabled)
+        printf("Energy gate: %llu of %llu frames bypassed the NN (%llu digital zero)\n",
+               (unsigned long long)nr->gate.framesBypassed, (unsigned long long)nr->gate.framesTotal,
+               (unsigned long long)nr->gate.framesZero);
 }
 
 
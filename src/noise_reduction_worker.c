@@ -0,0 +1,210 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  noise_reduction_worker.c
+//
+//  The worker owns the NN state of the instance and its own copy of the post-processed
+//  gains (the postprocess_gains() recursion); the audio thread owns the STFT and
+//  nr->gains, the gains it applies. Every queued vector carries its frame number, so the
+//  audio thread takes only gains of earlier frames and the lag is one frame whenever the
+//  worker keeps up.
+//
+#include "noise_reduction_worker.h"
+#include "jmpnn_thread.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int64_t frame;
+    float data[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+} NRWorkerSlot;
+
+typedef struct {
+    JMPNN_SPSCRing ring;
+    NRWorkerSlot slots[NRWORKER_QUEUE_SLOTS] __attribute__((aligned(JMPNN_CACHE_LINE)));
+} NRWorkerQueue;
+
+struct NRWorker {
+    NRWorkerQueue features;         // audio thread -> worker
+    NRWorkerQueue gains;            // worker -> audio thread, post-processed
+    NoiseReductionState *nr;
+    float gainsState[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));   // worker side of postprocess_gains()
+    int64_t frames;                 // audio thread: frames processed
+    int64_t applied;                // audio thread: frame of the gains in nr->gains (-1: none yet)
+    atomic_ullong statFrames;
+    atomic_ullong statNNFrames;
+    atomic_ullong statLate;
+    atomic_ullong statDropped;
+    atomic_ullong statMaxNNns;
+    atomic_int stop;
+    pthread_t thread;
+};
+
+// Slot to fill, or NULL if the queue is full
+static NRWorkerSlot *queue_space(NRWorkerQueue *q)
+{
+    int i = jmpnn_spsc_space(&q->ring, NRWORKER_QUEUE_SLOTS);
+
+    return i < 0 ? NULL : &q->slots[i];
+}
+
+// Oldest slot written, or NULL if the queue is empty
+static NRWorkerSlot *queue_data(NRWorkerQueue *q)
+{
+    int i = jmpnn_spsc_data(&q->ring, NRWORKER_QUEUE_SLOTS);
+
+    return i < 0 ? NULL : &q->slots[i];
+}
+
+static void *worker_main(void *arg)
+{
+    struct NRWorker *w = arg;
+    NoiseReductionState *nr = w->nr;
+    float gains[STFT_MAX_NUM_BINS] __attribute__((aligned(16)));
+    NRWorkerSlot *src, *dst;
+    uint64_t t0, ns;
+    int64_t frame;
+    int waits;
+
+    while (!atomic_load_explicit(&w->stop, memory_order_relaxed))
+    {
+        waits = 0;
+        while ((src = queue_data(&w->features)) == NULL && !atomic_load_explicit(&w->stop, memory_order_relaxed))
+            jmpnn_backoff(&waits);
+        if (src == NULL)
+            break;
+        t0 = jmpnn_now_ns();
+        noise_reduction_nn(nr, src->data, gains);
+        frame = src->frame;
+        jmpnn_spsc_pop(&w->features.ring);
+        postprocess_gains(gains, w->gainsState, nr->STFT.numBins, nr);
+
+        waits = 0;
+        while ((dst = queue_space(&w->gains)) == NULL && !atomic_load_explicit(&w->stop, memory_order_relaxed))
+            jmpnn_backoff(&waits);
+        if (dst == NULL)
+            break;
+        dst->frame = frame;
+        memcpy(dst->data, w->gainsState, nr->STFT.numBins * sizeof(float));
+        jmpnn_spsc_push(&w->gains.ring);
+        ns = jmpnn_now_ns() - t0;
+        if (ns > atomic_load_explicit(&w->statMaxNNns, memory_order_relaxed))
+            atomic_store_explicit(&w->statMaxNNns, ns, memory_order_relaxed);
+        atomic_fetch_add_explicit(&w->statNNFrames, 1, memory_order_release);
+    }
+    return NULL;
+}
+
+int noise_reduction_start_worker(NoiseReductionState *nr, int cpu)
+{
+    struct NRWorker *w;
+
+    if (nr->worker)
+        return -1;
+    if (posix_memalign((void **)&w, JMPNN_CACHE_LINE, sizeof(struct NRWorker)))
+        return -1;
+    memset(w, 0, sizeof(struct NRWorker));
+    jmpnn_spsc_init(&w->features.ring);
+    jmpnn_spsc_init(&w->gains.ring);
+    atomic_init(&w->statFrames, 0);
+    atomic_init(&w->statNNFrames, 0);
+    atomic_init(&w->statLate, 0);
+    atomic_init(&w->statDropped, 0);
+    atomic_init(&w->statMaxNNns, 0);
+    atomic_init(&w->stop, 0);
+    w->nr = nr;
+    w->applied = -1;
+    memcpy(w->gainsState, nr->gains, sizeof(w->gainsState));
+    if (pthread_create(&w->thread, NULL, worker_main, w))
+    {
+        free(w);
+        return -1;
+    }
+    jmpnn_pin_thread(w->thread, cpu);
+    nr->worker = w;
+    return 0;
+}
+
+void noise_reduction_stop_worker(NoiseReductionState *nr)
+{
+    struct NRWorker *w = nr->worker;
+
+    if (w == NULL)
+        return;
+    atomic_store_explicit(&w->stop, 1, memory_order_relaxed);
+    pthread_join(w->thread, NULL);
+    free(w);
+    nr->worker = NULL;
+}
+
+void noise_reduction_worker_wait(NoiseReductionState *nr)
+{
+    struct NRWorker *w = nr->worker;
+    int waits = 0;
+
+    if (w == NULL)
+        return;
+    while (atomic_load_explicit(&w->statNNFrames, memory_order_acquire) +
+           atomic_load_explicit(&w->statDropped, memory_order_relaxed) < (uint64_t)w->frames)
+        jmpnn_backoff(&waits);
+}
+
+void noise_reduction_worker_stats(const NoiseReductionState *nr, NRWorkerStats *stats)
+{
+    struct NRWorker *w = nr->worker;
+
+    memset(stats, 0, sizeof(NRWorkerStats));
+    if (w == NULL)
+        return;
+    stats->frames = atomic_load_explicit(&w->statFrames, memory_order_relaxed);
+    stats->nn_frames = atomic_load_explicit(&w->statNNFrames, memory_order_relaxed);
+    stats->late = atomic_load_explicit(&w->statLate, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&w->statDropped, memory_order_relaxed);
+    stats->max_nn_ns = atomic_load_explicit(&w->statMaxNNns, memory_order_relaxed);
+}
+
+void noise_reduction_process_decoupled(NoiseReductionState *nr, const float *input, float *output, unsigned int R)
+{
+    struct NRWorker *w = nr->worker;
+    NRWorkerSlot *slot;
+
+    stft_process(&nr->STFT, input, R);
+    slot = queue_space(&w->features);
+    if (slot)
+    {
+        slot->frame = w->frames;
+        memcpy(slot->data, nr->STFT.Xmag, sizeof(slot->data));
+        jmpnn_spsc_push(&w->features.ring);
+    }
+    else
+        atomic_fetch_add_explicit(&w->statDropped, 1, memory_order_relaxed);
+
+    // newest gains of an earlier frame; those of this frame are left for the next one
+    while ((slot = queue_data(&w->gains)) != NULL && slot->frame < w->frames)
+    {
+        memcpy(nr->gains, slot->data, nr->STFT.numBins * sizeof(float));
+        w->applied = slot->frame;
+        jmpnn_spsc_pop(&w->gains.ring);
+    }
+    if (w->frames > 0 && w->applied < w->frames - 1)
+        atomic_fetch_add_explicit(&w->statLate, 1, memory_order_relaxed);
+    w->frames++;
+    atomic_fetch_add_explicit(&w->statFrames, 1, memory_order_relaxed);
+
+    mask_process(&nr->STFT, nr->gains);
+    istft_process(&nr->STFT, output, R);
+}
@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <float.h>
 #include <string.h>
+#include <assert.h>
+#include <pthread.h>
 extern const SignalSifterModel ss_model;
 
 void createSignalSifterModel(SignalSifterState *ss)
@@ -58,6 +60,62 @@ void createSignalSifterModel_S16(SignalSifterState_S16 *ss)
     JMPDSP_vclr_S16(ss->gru3_gru_state, 1, ss->model->gru3_hidden_size);
 }
 
+// Built once on first use (pthread_once, so concurrent first calls are safe) and kept
+// for the lifetime of the process; model stays NULL if an allocation failed.
+static SignalSifterDeltaModel ss_delta_model;
+static pthread_once_t ss_delta_model_once = PTHREAD_ONCE_INIT;
+
+static void create_delta_model(void)
+{
+    SignalSifterDeltaModel *dm = &ss_delta_model;
+
+    if (createDeltaGRULayer(&dm->gru1_gru, ss_model.gru1_gru) ||
+        createDeltaGRULayer(&dm->gru2_gru, ss_model.gru2_gru) ||
+        createDeltaGRULayer(&dm->gru3_gru, ss_model.gru3_gru) ||
+        createDeltaLinearLayer(&dm->linear1_linear, ss_model.linear1_linear))
+    {
+        // the layers not created hold NULL pointers (zero-initialized or cleared on failure)
+        destroyDeltaGRULayer(&dm->gru1_gru);
+        destroyDeltaGRULayer(&dm->gru2_gru);
+        destroyDeltaGRULayer(&dm->gru3_gru);
+        destroyDeltaLinearLayer(&dm->linear1_linear);
+        return;
+    }
+    dm->model = &ss_model;
+}
+
+const SignalSifterDeltaModel *getSignalSifterDeltaModel(void)
+{
+    pthread_once(&ss_delta_model_once, create_delta_model);
+    return ss_delta_model.model ? &ss_delta_model : NULL;
+}
+
+// Returns -1 if the delta model could not be built (allocation failure)
+int createSignalSifterModelDelta_S16(SignalSifterDeltaState_S16 *ss)
+{
+    ss->dmodel = getSignalSifterDeltaModel();
+    if (ss->dmodel == NULL)
+        return -1;
+    JMPDSP_vclr_S16(ss->gru1_gru_state, 1, GRU_STATE_SIZE);
+    JMPDSP_vclr_S16(ss->gru2_gru_state, 1, GRU_STATE_SIZE);
+    JMPDSP_vclr_S16(ss->gru3_gru_state, 1, GRU_STATE_SIZE);
+    resetDeltaGRUState_S16(&ss->gru1_delta);
+    resetDeltaGRUState_S16(&ss->gru2_delta);
+    resetDeltaGRUState_S16(&ss->gru3_delta);
+    resetDeltaLinearState_S16(&ss->linear1_delta);
+    ss->input_threshold = DELTA_INPUT_THRESHOLD_Q9;
+    ss->state_threshold = DELTA_STATE_THRESHOLD_Q15;
+    return 0;
+}
+
+void createSignalSifterModel_S8(SignalSifterState_S8 *ss)
+{
+    ss->model = &ss_model;
+    memset(ss->gru1_gru_state, 0, ss->model->gru1_hidden_size * sizeof(int8_t));
+    memset(ss->gru2_gru_state, 0, ss->model->gru2_hidden_size * sizeof(int8_t));
+    memset(ss->gru3_gru_state, 0, ss->model->gru3_hidden_size * sizeof(int8_t));
+}
+
 void destroySignalSifterModel(SignalSifterState *ss)
 {
 #if ENABLE_SS_MONITOR
@@ -73,6 +131,17 @@ void destroySignalSifterModel_S16(SignalSifterState_S16 *ss)
 
 }
 
+void destroySignalSifterModel_S8(SignalSifterState_S8 *ss)
+{
+
+}
+
+// The shared delta model stays; the stream drops it and its references
+void destroySignalSifterModelDelta_S16(SignalSifterDeltaState_S16 *ss)
+{
+    memset(ss, 0, sizeof(SignalSifterDeltaState_S16));
+}
+
 void computeSignalSifterModel_simS16(SignalSifterState *ss, float *gains, const float *input)
 {
     float quantized_input[MAX_NEURONS];
@@ -142,6 +211,123 @@ void computeSignalSifterModel_S16(SignalSifterState_S16 *ss, int16_t *gains, con
                            LIN_NUM_FRAC_BITS, WAB_FRAC_BITS);
 }
 
+// Same as computeSignalSifterModel_S16 with thresholds of 0
+void computeSignalSifterModelDelta_S16(SignalSifterDeltaState_S16 *ss, int16_t *gains, const int16_t *input)
+{
+    const SignalSifterDeltaModel *dm = ss->dmodel;
+
+    computeDeltaGRULayer_S16(&dm->gru1_gru, &ss->gru1_delta, ss->gru1_gru_state, input,
+                             ss->input_threshold, ss->state_threshold,
+                             INPUT_NUM_FRAC_BITS, INPUTLAYER_SHIFT_RIGHT, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    computeDeltaGRULayer_S16(&dm->gru2_gru, &ss->gru2_delta, ss->gru2_gru_state, ss->gru1_gru_state,
+                             ss->state_threshold, ss->state_threshold,
+                             GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    computeDeltaGRULayer_S16(&dm->gru3_gru, &ss->gru3_delta, ss->gru3_gru_state, ss->gru2_gru_state,
+                             ss->state_threshold, ss->state_threshold,
+                             GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    computeDeltaLinearLayer_S16(&dm->linear1_linear, &ss->linear1_delta, gains, ss->gru3_gru_state,
+                                ss->state_threshold, LIN_NUM_FRAC_BITS, WAB_FRAC_BITS);
+}
+
+// Fraction of the weight MACs skipped so far, over all layers (columns weighted by their length)
+float getSignalSifterDeltaSkipRatio(const SignalSifterDeltaState_S16 *ss)
+{
+    const SignalSifterModel *m = ss->dmodel->model;
+    uint64_t total, applied;
+
+    total = 3 * (ss->gru1_delta.cols_total * m->gru1_hidden_size + ss->gru2_delta.cols_total * m->gru2_hidden_size +
+                 ss->gru3_delta.cols_total * m->gru3_hidden_size) + ss->linear1_delta.cols_total * m->linear1_hidden_size;
+    applied = 3 * (ss->gru1_delta.cols_applied * m->gru1_hidden_size + ss->gru2_delta.cols_applied * m->gru2_hidden_size +
+                   ss->gru3_delta.cols_applied * m->gru3_hidden_size) + ss->linear1_delta.cols_applied * m->linear1_hidden_size;
+    return total ? 1.0f - (float)applied / total : 0.0f;
+}
+
+void computeSignalSifterModel_S8(SignalSifterState_S8 *ss, int16_t *gains, const int8_t *input)
+{
+    computeGRULayer_S8(ss->model->gru1_gru, ss->gru1_gru_state, input, INPUT_S8_FRAC_BITS, GRU1_S8_FRAC_BITS);
+    computeGRULayer_S8(ss->model->gru2_gru, ss->gru2_gru_state, ss->gru1_gru_state, GRU1_S8_FRAC_BITS, GRU2_S8_FRAC_BITS);
+    computeGRULayer_S8(ss->model->gru3_gru, ss->gru3_gru_state, ss->gru2_gru_state, GRU2_S8_FRAC_BITS, GRU3_S8_FRAC_BITS);
+    computeLinearLayer_S8(ss->model->linear1_linear, gains, ss->gru3_gru_state, GRU3_S8_FRAC_BITS);
+}
+
+void createSignalSifterBatch_S16(SignalSifterBatchState_S16 *sb, int num_streams)
+{
+    assert(num_streams > 0 && num_streams <= JMPNN_MAX_BATCH);
+    sb->model = &ss_model;
+    sb->num_streams = num_streams;
+    JMPDSP_vclr_S16(sb->gru1_gru_state, 1, JMPNN_MAX_BATCH * GRU_STATE_SIZE);
+    JMPDSP_vclr_S16(sb->gru2_gru_state, 1, JMPNN_MAX_BATCH * GRU_STATE_SIZE);
+    JMPDSP_vclr_S16(sb->gru3_gru_state, 1, JMPNN_MAX_BATCH * GRU_STATE_SIZE);
+}
+
+// Copies the GRU states of num_streams single-stream states into the batch
+void gatherSignalSifterBatch_S16(SignalSifterBatchState_S16 *sb, SignalSifterState_S16 * const *ss, int num_streams)
+{
+    int k;
+    assert(num_streams > 0 && num_streams <= JMPNN_MAX_BATCH);
+    sb->model = ss[0]->model;
+    sb->num_streams = num_streams;
+    for (k = 0; k < num_streams; k++)
+    {
+        assert(ss[k]->model == sb->model);
+        memcpy(&sb->gru1_gru_state[k * GRU_STATE_SIZE], ss[k]->gru1_gru_state, sb->model->gru1_hidden_size * sizeof(int16_t));
+        memcpy(&sb->gru2_gru_state[k * GRU_STATE_SIZE], ss[k]->gru2_gru_state, sb->model->gru2_hidden_size * sizeof(int16_t));
+        memcpy(&sb->gru3_gru_state[k * GRU_STATE_SIZE], ss[k]->gru3_gru_state, sb->model->gru3_hidden_size * sizeof(int16_t));
+    }
+}
+
+void scatterSignalSifterBatch_S16(const SignalSifterBatchState_S16 *sb, SignalSifterState_S16 * const *ss)
+{
+    int k;
+    for (k = 0; k < sb->num_streams; k++)
+    {
+        memcpy(ss[k]->gru1_gru_state, &sb->gru1_gru_state[k * GRU_STATE_SIZE], sb->model->gru1_hidden_size * sizeof(int16_t));
+        memcpy(ss[k]->gru2_gru_state, &sb->gru2_gru_state[k * GRU_STATE_SIZE], sb->model->gru2_hidden_size * sizeof(int16_t));
+        memcpy(ss[k]->gru3_gru_state, &sb->gru3_gru_state[k * GRU_STATE_SIZE], sb->model->gru3_hidden_size * sizeof(int16_t));
+    }
+}
+
+// Same as computeSignalSifterModel_S16 for every stream of the batch (bit-exact),
+// but each layer's weights are read once for all streams.
+void computeSignalSifterModelBatch_S16(SignalSifterBatchState_S16 *sb, int16_t *gains, JMPDSP_Stride gains_stride,
+                                       const int16_t *input, JMPDSP_Stride input_stride)
+{
+    int K = sb->num_streams;
+    computeGRULayerBatch_S16(sb->model->gru1_gru, sb->gru1_gru_state, GRU_STATE_SIZE, input, input_stride, K,
+                             INPUT_NUM_FRAC_BITS, INPUTLAYER_SHIFT_RIGHT, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    computeGRULayerBatch_S16(sb->model->gru2_gru, sb->gru2_gru_state, GRU_STATE_SIZE, sb->gru1_gru_state, GRU_STATE_SIZE, K,
+                             GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    computeGRULayerBatch_S16(sb->model->gru3_gru, sb->gru3_gru_state, GRU_STATE_SIZE, sb->gru2_gru_state, GRU_STATE_SIZE, K,
+                             GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    computeLinearLayerBatch_S16(sb->model->linear1_linear, gains, gains_stride, sb->gru3_gru_state, GRU_STATE_SIZE, K,
+                                LIN_NUM_FRAC_BITS, WAB_FRAC_BITS);
+}
+
+// Offline (layer-major) inference over num_frames consecutive frames of one stream.
+// Each block of JMPNN_SEQ_BLOCK frames runs gru1 over all its frames, then gru2, gru3
+// and linear1, so the input projections are GEMMs; bit-exact with num_frames calls
+// of computeSignalSifterModel_S16.
+void computeSignalSifterModelSeq_S16(SignalSifterState_S16 *ss, int16_t *gains, JMPDSP_Stride gains_stride,
+                                     const int16_t *input, JMPDSP_Stride input_stride, int num_frames)
+{
+    int16_t h1[JMPNN_SEQ_BLOCK * GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int16_t h2[JMPNN_SEQ_BLOCK * GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int16_t h3[JMPNN_SEQ_BLOCK * GRU_STATE_SIZE] __attribute__((aligned(16)));
+    int t0, T;
+
+    for (t0 = 0; t0 < num_frames; t0 += JMPNN_SEQ_BLOCK)
+    {
+        T = MIN(JMPNN_SEQ_BLOCK, num_frames - t0);
+        computeGRULayerSeq_S16(ss->model->gru1_gru, ss->gru1_gru_state, h1, GRU_STATE_SIZE, &input[t0 * input_stride], input_stride, T,
+                               INPUT_NUM_FRAC_BITS, INPUTLAYER_SHIFT_RIGHT, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeGRULayerSeq_S16(ss->model->gru2_gru, ss->gru2_gru_state, h2, GRU_STATE_SIZE, h1, GRU_STATE_SIZE, T,
+                               GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeGRULayerSeq_S16(ss->model->gru3_gru, ss->gru3_gru_state, h3, GRU_STATE_SIZE, h2, GRU_STATE_SIZE, T,
+                               GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeLinearLayerBatch_S16(ss->model->linear1_linear, &gains[t0 * gains_stride], gains_stride, h3, GRU_STATE_SIZE, T,
+                                    LIN_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    }
+}
 
 #if ENABLE_SS_MONITOR
 void printSignalSifterStats(SignalSifterMonitor *sm)
@@ -0,0 +1,523 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  signalsifter_model_file.c
+//
+#include "signalsifter_model_file.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define JMPNN_MODEL_USE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define JMPNN_MODEL_USE_MMAP 0
+#endif
+
+_Static_assert(sizeof(JMPNN_ModelFileHeader) == 96, "model file header layout");
+_Static_assert(sizeof(JMPNN_ModelFileLayer) == 120, "model file layer record layout");
+
+#define MODEL_FILE_CHECKSUM_OFFSET  offsetof(JMPNN_ModelFileHeader, checksum)
+#define MODEL_FILE_ALIGN_UP(x)      (((x) + JMPNN_MODEL_FILE_ALIGN - 1) & ~(uint64_t)(JMPNN_MODEL_FILE_ALIGN - 1))
+
+static uint32_t crc32_table[256];
+static pthread_once_t crc32_table_once = PTHREAD_ONCE_INIT;
+
+static void build_crc32_table(void)
+{
+    uint32_t c;
+    int i, k;
+
+    for (i = 0; i < 256; i++)
+    {
+        c = (uint32_t)i;
+        for (k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc32_table[i] = c;
+    }
+}
+
+// CRC-32 (reflected, polynomial 0xEDB88320), same as zlib.crc32()
+static uint32_t model_file_crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    size_t i;
+
+    pthread_once(&crc32_table_once, build_crc32_table);
+    crc = ~crc;
+    for (i = 0; i < size; i++)
+        crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// CRC of the file image with the checksum field read as 0
+static uint32_t model_file_checksum(const uint8_t *data, size_t size)
+{
+    static const uint8_t zero[sizeof(uint32_t)];
+    uint32_t crc;
+
+    crc = model_file_crc32(0, data, MODEL_FILE_CHECKSUM_OFFSET);
+    crc = model_file_crc32(crc, zero, sizeof(zero));
+    return model_file_crc32(crc, data + MODEL_FILE_CHECKSUM_OFFSET + sizeof(uint32_t),
+                            size - MODEL_FILE_CHECKSUM_OFFSET - sizeof(uint32_t));
+}
+
+// Bytes of a [rows x cols] weight matrix in the given layout; for BSR4x16 the number
+// of tiles comes from the index (index[JMPNN_BSR4x16_GROUPS(rows)]).
+static uint64_t weights_bytes(int layout, int rows, int cols, const uint16_t *index)
+{
+    switch (layout)
+    {
+        case WEIGHTS_LAYOUT_ROWMAJOR:
+            return (uint64_t)rows * cols * sizeof(nnWeight);
+        case WEIGHTS_LAYOUT_TILED4x16:
+            return (uint64_t)JMPNN_TILED4x16_ROWS(rows) * JMPNN_TILED4x16_COLS(cols) * sizeof(nnWeight);
+        default:
+            return (uint64_t)index[JMPNN_BSR4x16_GROUPS(rows)] * 64 * sizeof(nnWeight);
+    }
+}
+
+static uint64_t index_bytes(int layout, int rows, const uint16_t *index)
+{
+    if (layout != WEIGHTS_LAYOUT_BSR4x16)
+        return 0;
+    return (uint64_t)JMPNN_BSR4x16_INDEX_LEN(rows, index[JMPNN_BSR4x16_GROUPS(rows)]) * sizeof(uint16_t);
+}
+
+// Checks the weight (and BSR4x16 index) arrays of a [rows x cols] matrix, so that the
+// kernels never read outside of them
+static int check_weights(const uint8_t *data, int layout, int rows, int cols,
+                         const JMPNN_ModelFileArray *w, const JMPNN_ModelFileArray *idx)
+{
+    const uint16_t *index;
+    int g, t, G = JMPNN_BSR4x16_GROUPS(rows), num_tiles;
+
+    if (layout != WEIGHTS_LAYOUT_BSR4x16)
+        return (w->size == weights_bytes(layout, rows, cols, NULL) && idx->size == 0) ? 0 : JMPNN_MODEL_ERR_FORMAT;
+
+    if (idx->size < (uint64_t)(G + 1) * sizeof(uint16_t))
+        return JMPNN_MODEL_ERR_FORMAT;
+    index = (const uint16_t *)(data + idx->offset);
+    num_tiles = index[G];
+    if (index[0] != 0 || idx->size != index_bytes(layout, rows, index) ||
+        w->size != weights_bytes(layout, rows, cols, index))
+        return JMPNN_MODEL_ERR_FORMAT;
+    for (g = 0; g < G; g++)
+        if (index[g + 1] < index[g])
+            return JMPNN_MODEL_ERR_FORMAT;
+    for (t = 0; t < num_tiles; t++)
+        if (index[G + 1 + t] >= JMPNN_TILED4x16_COLS(cols) / 16)
+            return JMPNN_MODEL_ERR_FORMAT;
+    return 0;
+}
+
+// Layer l of the chain, input_size: output size of layer l-1 (or the model input)
+static int parse_layer(SignalSifterModelFile *mf, const JMPNN_ModelFileLayer *rec, int l, uint32_t input_size)
+{
+    const JMPNN_ModelFileArray *a = rec->arrays;
+    const uint8_t *data = mf->data;
+    int rows, ret;
+
+    if (rec->type > JMPNN_MODEL_LAYER_LINEAR || rec->activation > ACTIVATION_LINEAR ||
+        rec->layout > WEIGHTS_LAYOUT_BSR4x16 || rec->input_size != input_size || rec->hidden_size == 0)
+        return JMPNN_MODEL_ERR_FORMAT;
+    if (rec->hidden_size > JMPNN_MAX_WIDTH)
+        return JMPNN_MODEL_ERR_CONFIG;
+
+    if (rec->type == JMPNN_MODEL_LAYER_GRU)
+    {
+        GRULayer *gru = &mf->grus[l];
+
+        rows = 3 * rec->hidden_size;
+        // Stacked gates must start on a tile row
+        if (rec->layout != WEIGHTS_LAYOUT_ROWMAJOR && rec->hidden_size % 4)
+            return JMPNN_MODEL_ERR_FORMAT;
+        if (a[JMPNN_MODEL_ARRAY_BIAS].size != rows * sizeof(nnBias) ||
+            a[JMPNN_MODEL_ARRAY_RECURRENT_BIAS].size != rows * sizeof(nnBias))
+            return JMPNN_MODEL_ERR_FORMAT;
+        if ((ret = check_weights(data, rec->layout, rows, rec->input_size,
+                                 &a[JMPNN_MODEL_ARRAY_WEIGHTS], &a[JMPNN_MODEL_ARRAY_WEIGHTS_INDEX])) ||
+            (ret = check_weights(data, rec->layout, rows, rec->hidden_size,
+                                 &a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS], &a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS_INDEX])))
+            return ret;
+        gru->bias = (const nnBias *)(data + a[JMPNN_MODEL_ARRAY_BIAS].offset);
+        gru->recurrent_bias = (const nnBias *)(data + a[JMPNN_MODEL_ARRAY_RECURRENT_BIAS].offset);
+        gru->input_weights = (const nnWeight *)(data + a[JMPNN_MODEL_ARRAY_WEIGHTS].offset);
+        gru->recurrent_weights = (const nnWeight *)(data + a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS].offset);
+        gru->input_size = rec->input_size;
+        gru->hidden_size = rec->hidden_size;
+        gru->activation = rec->activation;
+        gru->layout = rec->layout;
+        gru->input_weights_index = rec->layout == WEIGHTS_LAYOUT_BSR4x16 ?
+            (const uint16_t *)(data + a[JMPNN_MODEL_ARRAY_WEIGHTS_INDEX].offset) : NULL;
+        gru->recurrent_weights_index = rec->layout == WEIGHTS_LAYOUT_BSR4x16 ?
+            (const uint16_t *)(data + a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS_INDEX].offset) : NULL;
+    }
+    else
+    {
+        LinearLayer *ll = &mf->linears[l];
+
+        if (a[JMPNN_MODEL_ARRAY_BIAS].size != rec->hidden_size * sizeof(nnBias) ||
+            a[JMPNN_MODEL_ARRAY_RECURRENT_BIAS].size || a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS].size ||
+            a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS_INDEX].size)
+            return JMPNN_MODEL_ERR_FORMAT;
+        if ((ret = check_weights(data, rec->layout, rec->hidden_size, rec->input_size,
+                                 &a[JMPNN_MODEL_ARRAY_WEIGHTS], &a[JMPNN_MODEL_ARRAY_WEIGHTS_INDEX])))
+            return ret;
+        ll->bias = (const nnBias *)(data + a[JMPNN_MODEL_ARRAY_BIAS].offset);
+        ll->weights = (const nnWeight *)(data + a[JMPNN_MODEL_ARRAY_WEIGHTS].offset);
+        ll->input_size = rec->input_size;
+        ll->hidden_size = rec->hidden_size;
+        ll->activation = rec->activation;
+        ll->layout = rec->layout;
+        ll->weights_index = rec->layout == WEIGHTS_LAYOUT_BSR4x16 ?
+            (const uint16_t *)(data + a[JMPNN_MODEL_ARRAY_WEIGHTS_INDEX].offset) : NULL;
+    }
+    return 0;
+}
+
+// Sets up mf->model if the graph has the SignalSifter shape
+static void setup_signalsifter_model(SignalSifterModelFile *mf)
+{
+    const NNGraph *g = &mf->graph;
+    int l;
+
+    if (g->num_layers != 4 || g->layers[3].type != NNGRAPH_LAYER_LINEAR)
+        return;
+    for (l = 0; l < 3; l++)
+        if (g->layers[l].type != NNGRAPH_LAYER_GRU || g->layers[l].output_size > GRU_STATE_SIZE)
+            return;
+    mf->model.gru1_hidden_size = mf->grus[0].hidden_size;
+    mf->model.gru1_gru = &mf->grus[0];
+    mf->model.gru2_hidden_size = mf->grus[1].hidden_size;
+    mf->model.gru2_gru = &mf->grus[1];
+    mf->model.gru3_hidden_size = mf->grus[2].hidden_size;
+    mf->model.gru3_gru = &mf->grus[2];
+    mf->model.linear1_hidden_size = mf->linears[3].hidden_size;
+    mf->model.linear1_linear = &mf->linears[3];
+    mf->has_model = 1;
+}
+
+static int parse_model_file(SignalSifterModelFile *mf, int flags)
+{
+    const JMPNN_ModelFileHeader *hdr = (const JMPNN_ModelFileHeader *)mf->data;
+    const JMPNN_ModelFileLayer *rec;
+    int i, k, ret;
+
+    if (mf->size < sizeof(JMPNN_ModelFileHeader) || memcmp(hdr->magic, JMPNN_MODEL_FILE_MAGIC, 8) ||
+        hdr->byte_order != JMPNN_MODEL_FILE_BYTE_ORDER || hdr->version != JMPNN_MODEL_FILE_VERSION ||
+        hdr->num_layers == 0 || hdr->num_layers > NNGRAPH_MAX_LAYERS || hdr->file_size != mf->size ||
+        hdr->header_size != sizeof(JMPNN_ModelFileHeader) + hdr->num_layers * sizeof(JMPNN_ModelFileLayer) ||
+        hdr->header_size > mf->size)
+        return JMPNN_MODEL_ERR_FORMAT;
+    if ((flags & JMPNN_MODEL_VERIFY) && hdr->checksum != model_file_checksum(mf->data, mf->size))
+        return JMPNN_MODEL_ERR_CHECKSUM;
+
+    // The shifts of the fixed-point layers are compile-time constants
+    if (hdr->weight_bits != 8 * sizeof(nnWeight) || hdr->bias_bits != 8 * sizeof(nnBias) ||
+        hdr->wab_frac_bits != WAB_FRAC_BITS || hdr->input_num_frac_bits != INPUT_NUM_FRAC_BITS ||
+        hdr->gru_num_frac_bits != GRU_NUM_FRAC_BITS || hdr->lin_num_frac_bits != LIN_NUM_FRAC_BITS)
+        return JMPNN_MODEL_ERR_CONFIG;
+#ifdef USE_INT8_SIGNALSIFTER
+    // So are the int8 activation scales; the other builds ignore the calibration
+    if (hdr->s8_frac_bits[0] != INPUT_S8_FRAC_BITS || hdr->s8_frac_bits[1] != GRU1_S8_FRAC_BITS ||
+        hdr->s8_frac_bits[2] != GRU2_S8_FRAC_BITS || hdr->s8_frac_bits[3] != GRU3_S8_FRAC_BITS)
+        return JMPNN_MODEL_ERR_CONFIG;
+#endif
+    // The STFT is set up at run time for the geometry of the model
+    if (!stft_geometry_supported(hdr->fft_size, hdr->hop_length) || hdr->io_size == 0 ||
+        hdr->io_size > (hdr->fft_size >> 1) + 1)
+        return JMPNN_MODEL_ERR_CONFIG;
+
+    rec = (const JMPNN_ModelFileLayer *)(mf->data + sizeof(JMPNN_ModelFileHeader));
+    for (i = 0; i < hdr->num_layers; i++)
+        for (k = 0; k < JMPNN_MODEL_NUM_ARRAYS; k++)
+        {
+            const JMPNN_ModelFileArray *a = &rec[i].arrays[k];
+            if (a->size && (a->offset % JMPNN_MODEL_FILE_ALIGN || a->offset < hdr->header_size ||
+                            a->offset > mf->size || a->size > mf->size - a->offset))
+                return JMPNN_MODEL_ERR_FORMAT;
+        }
+
+    // The model maps the io_size input features to io_size gains
+    initNNGraph(&mf->graph);
+    for (i = 0; i < hdr->num_layers; i++)
+    {
+        if ((ret = parse_layer(mf, &rec[i], i, i ? rec[i - 1].hidden_size : hdr->io_size)))
+            return ret;
+        ret = rec[i].type == JMPNN_MODEL_LAYER_GRU ? addNNGraphGRULayer(&mf->graph, &mf->grus[i]) :
+                                                     addNNGraphLinearLayer(&mf->graph, &mf->linears[i]);
+        if (ret)
+            return JMPNN_MODEL_ERR_CONFIG;
+    }
+    if (mf->graph.output_size != hdr->io_size)
+        return JMPNN_MODEL_ERR_FORMAT;
+    mf->fft_size = hdr->fft_size;
+    mf->hop_length = hdr->hop_length;
+    mf->io_size = hdr->io_size;
+    if (mf->io_size == IO_SIZE)
+        setup_signalsifter_model(mf);
+    return 0;
+}
+
+int openSignalSifterModelBuffer(SignalSifterModelFile *mf, const void *data, size_t size, int flags)
+{
+    int ret;
+
+    memset(mf, 0, sizeof(SignalSifterModelFile));
+    mf->data = (const uint8_t *)data;
+    mf->size = size;
+    mf->storage = JMPNN_MODEL_STORAGE_BUFFER;
+    if ((ret = parse_model_file(mf, flags)))
+        memset(mf, 0, sizeof(SignalSifterModelFile));
+    return ret;
+}
+
+#if JMPNN_MODEL_USE_MMAP
+// Reads one byte per page unless the kernel can populate the mapping by itself
+static void prefault_pages(const uint8_t *data, size_t size)
+{
+    volatile uint8_t sink = 0;
+    size_t i, page = (size_t)sysconf(_SC_PAGESIZE);
+
+#ifdef MADV_POPULATE_READ
+    if (madvise((void *)data, size, MADV_POPULATE_READ) == 0)
+        return;
+#endif
+    madvise((void *)data, size, MADV_WILLNEED);
+    for (i = 0; i < size; i += page)
+        sink += data[i];
+    (void)sink;
+}
+#endif
+
+/* Maps the model file read-only; the weights are used in place (no copy), so the
+   page cache copy is shared by all instances and processes using the same file.
+   JMPNN_MODEL_HUGEPAGES is a hint: it takes effect only if the kernel supports huge
+   pages for file mappings.
+ */
+int loadSignalSifterModelFile(SignalSifterModelFile *mf, const char *path, int flags)
+{
+    uint8_t *data;
+    size_t size;
+    int ret;
+#if JMPNN_MODEL_USE_MMAP
+    struct stat st;
+    int fd;
+
+    memset(mf, 0, sizeof(SignalSifterModelFile));
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return JMPNN_MODEL_ERR_IO;
+    if (fstat(fd, &st))
+    {
+        close(fd);
+        return JMPNN_MODEL_ERR_IO;
+    }
+    if (st.st_size < (off_t)sizeof(JMPNN_ModelFileHeader))
+    {
+        close(fd);
+        return JMPNN_MODEL_ERR_FORMAT;
+    }
+    size = (size_t)st.st_size;
+    data = (uint8_t *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return JMPNN_MODEL_ERR_IO;
+#ifdef MADV_HUGEPAGE
+    if (flags & JMPNN_MODEL_HUGEPAGES)
+        madvise(data, size, MADV_HUGEPAGE);
+#endif
+    if (flags & JMPNN_MODEL_PREFAULT)
+        prefault_pages(data, size);
+    mf->storage = JMPNN_MODEL_STORAGE_MMAP;
+#else
+    FILE *f;
+    long len;
+
+    memset(mf, 0, sizeof(SignalSifterModelFile));
+    f = fopen(path, "rb");
+    if (f == NULL)
+        return JMPNN_MODEL_ERR_IO;
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len < (long)sizeof(JMPNN_ModelFileHeader))
+    {
+        fclose(f);
+        return len < 0 ? JMPNN_MODEL_ERR_IO : JMPNN_MODEL_ERR_FORMAT;
+    }
+    size = (size_t)len;
+    data = (uint8_t *)malloc(size);
+    if (data == NULL || fread(data, 1, size, f) != size)
+    {
+        free(data);
+        fclose(f);
+        return JMPNN_MODEL_ERR_IO;
+    }
+    fclose(f);
+    mf->storage = JMPNN_MODEL_STORAGE_HEAP;
+#endif
+    mf->data = data;
+    mf->size = size;
+    if ((ret = parse_model_file(mf, flags)))
+        unloadSignalSifterModelFile(mf);
+    return ret;
+}
+
+void unloadSignalSifterModelFile(SignalSifterModelFile *mf)
+{
+#if JMPNN_MODEL_USE_MMAP
+    if (mf->storage == JMPNN_MODEL_STORAGE_MMAP && mf->data)
+        munmap((void *)mf->data, mf->size);
+#endif
+    if (mf->storage == JMPNN_MODEL_STORAGE_HEAP)
+        free((void *)mf->data);
+    memset(mf, 0, sizeof(SignalSifterModelFile));
+}
+
+// Appends one array at the next aligned offset of the image (or only counts its size if image is NULL)
+static void put_array(uint8_t *image, uint64_t *pos, JMPNN_ModelFileArray *a, const void *src, uint64_t size)
+{
+    a->offset = size ? MODEL_FILE_ALIGN_UP(*pos) : 0;
+    a->size = size;
+    if (size)
+    {
+        if (image)
+            memcpy(image + a->offset, src, size);
+        *pos = a->offset + size;
+    }
+}
+
+static uint64_t put_graph(uint8_t *image, const NNGraph *graph)
+{
+    JMPNN_ModelFileLayer rec[NNGRAPH_MAX_LAYERS];
+    uint64_t pos = sizeof(JMPNN_ModelFileHeader) + graph->num_layers * sizeof(JMPNN_ModelFileLayer);
+    int i, rows;
+
+    memset(rec, 0, sizeof(rec));
+    for (i = 0; i < graph->num_layers; i++)
+    {
+        JMPNN_ModelFileArray *a = rec[i].arrays;
+
+        if (graph->layers[i].type == NNGRAPH_LAYER_GRU)
+        {
+            const GRULayer *gru = graph->layers[i].gru;
+
+            rows = 3 * gru->hidden_size;
+            rec[i].type = JMPNN_MODEL_LAYER_GRU;
+            rec[i].activation = gru->activation;
+            rec[i].layout = gru->layout;
+            rec[i].input_size = gru->input_size;
+            rec[i].hidden_size = gru->hidden_size;
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_WEIGHTS], gru->input_weights,
+                      weights_bytes(gru->layout, rows, gru->input_size, gru->input_weights_index));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS], gru->recurrent_weights,
+                      weights_bytes(gru->layout, rows, gru->hidden_size, gru->recurrent_weights_index));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_BIAS], gru->bias, rows * sizeof(nnBias));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_RECURRENT_BIAS], gru->recurrent_bias, rows * sizeof(nnBias));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_WEIGHTS_INDEX], gru->input_weights_index,
+                      index_bytes(gru->layout, rows, gru->input_weights_index));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS_INDEX], gru->recurrent_weights_index,
+                      index_bytes(gru->layout, rows, gru->recurrent_weights_index));
+        }
+        else
+        {
+            const LinearLayer *ll = graph->layers[i].linear;
+
+            rec[i].type = JMPNN_MODEL_LAYER_LINEAR;
+            rec[i].activation = ll->activation;
+            rec[i].layout = ll->layout;
+            rec[i].input_size = ll->input_size;
+            rec[i].hidden_size = ll->hidden_size;
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_WEIGHTS], ll->weights,
+                      weights_bytes(ll->layout, ll->hidden_size, ll->input_size, ll->weights_index));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_BIAS], ll->bias, ll->hidden_size * sizeof(nnBias));
+            put_array(image, &pos, &a[JMPNN_MODEL_ARRAY_WEIGHTS_INDEX], ll->weights_index,
+                      index_bytes(ll->layout, ll->hidden_size, ll->weights_index));
+        }
+    }
+
+    if (image)
+        memcpy(image + sizeof(JMPNN_ModelFileHeader), rec, graph->num_layers * sizeof(JMPNN_ModelFileLayer));
+    return pos;
+}
+
+int writeNNGraphFile(const NNGraph *graph, const char *path)
+{
+    return writeNNGraphFileGeometry(graph, FFT_SIZE, HOP_LENGTH, path);
+}
+
+int writeNNGraphFileGeometry(const NNGraph *graph, unsigned int fft_size, unsigned int hop_length, const char *path)
+{
+    JMPNN_ModelFileHeader hdr;
+    uint8_t *image;
+    uint64_t size;
+    FILE *f;
+    int ret = 0;
+
+    if (graph->num_layers == 0 || graph->input_size != graph->output_size ||
+        !stft_geometry_supported(fft_size, hop_length) || graph->input_size > (fft_size >> 1) + 1)
+        return JMPNN_MODEL_ERR_CONFIG;
+    size = put_graph(NULL, graph);
+    image = (uint8_t *)calloc(1, size);
+    if (image == NULL)
+        return JMPNN_MODEL_ERR_IO;
+    put_graph(image, graph);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, JMPNN_MODEL_FILE_MAGIC, 8);
+    hdr.version = JMPNN_MODEL_FILE_VERSION;
+    hdr.header_size = sizeof(JMPNN_ModelFileHeader) + graph->num_layers * sizeof(JMPNN_ModelFileLayer);
+    hdr.byte_order = JMPNN_MODEL_FILE_BYTE_ORDER;
+    hdr.num_layers = graph->num_layers;
+    hdr.weight_bits = 8 * sizeof(nnWeight);
+    hdr.bias_bits = 8 * sizeof(nnBias);
+    hdr.wab_frac_bits = WAB_FRAC_BITS;
+    hdr.input_num_frac_bits = INPUT_NUM_FRAC_BITS;
+    hdr.gru_num_frac_bits = GRU_NUM_FRAC_BITS;
+    hdr.lin_num_frac_bits = LIN_NUM_FRAC_BITS;
+    hdr.s8_frac_bits[0] = INPUT_S8_FRAC_BITS;
+    hdr.s8_frac_bits[1] = GRU1_S8_FRAC_BITS;
+    hdr.s8_frac_bits[2] = GRU2_S8_FRAC_BITS;
+    hdr.s8_frac_bits[3] = GRU3_S8_FRAC_BITS;
+    hdr.io_size = graph->input_size;
+    hdr.fft_size = fft_size;
+    hdr.hop_length = hop_length;
+    hdr.file_size = size;
+    memcpy(image, &hdr, sizeof(hdr));
+    hdr.checksum = model_file_checksum(image, size);
+    memcpy(image, &hdr, sizeof(hdr));
+
+    f = fopen(path, "wb");
+    if (f == NULL || fwrite(image, 1, size, f) != size)
+        ret = JMPNN_MODEL_ERR_IO;
+    if (f && fclose(f))
+        ret = JMPNN_MODEL_ERR_IO;
+    free(image);
+    return ret;
+}
+
+int writeSignalSifterModelFile(const SignalSifterModel *model, const char *path)
+{
+    NNGraph graph;
+
+    if (createNNGraphFromSignalSifterModel(&graph, model))
+        return JMPNN_MODEL_ERR_CONFIG;
+    return writeNNGraphFile(&graph, path);
+}
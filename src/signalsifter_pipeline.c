@@ -0,0 +1,181 @@
+//  JumpML Rocketship - Neural Network Inference with Audio Processing
+//
+//  Copyright 2020-2024 JUMPML
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+//  signalsifter_pipeline.c
+//
+//  queues[0] carries the inputs from the caller to gru1, queues[k] the output of stage k
+//  (gru k) to the next stage, queues[SSPIPE_STAGES] the gru3 output back to the caller.
+//  A slot names the state it belongs to, so stages need no per-stream setup. A stage owns
+//  its layer's GRU state while it holds a frame; the release/acquire on the queue indices
+//  orders the state updates of consecutive frames across threads.
+//
+#include "signalsifter_pipeline.h"
+#include "jmpnn_thread.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a caller pushing SSPIPE_DEPTH frames ahead of its pops must never block on a full pipeline
+_Static_assert(SSPIPE_DEPTH < (SSPIPE_STAGES + 1) * SSPIPE_QUEUE_SLOTS, "SSPIPE_DEPTH exceeds the queue capacity");
+
+typedef struct {
+    SignalSifterState_S16 *ss;
+    int16_t data[JMPNN_MAX_WIDTH] __attribute__((aligned(32)));
+} SSPipeSlot;
+
+typedef struct {
+    JMPNN_SPSCRing ring;
+    SSPipeSlot slots[SSPIPE_QUEUE_SLOTS] __attribute__((aligned(JMPNN_CACHE_LINE)));
+} SSPipeQueue;
+
+typedef struct {
+    SignalSifterPipeline_S16 *pipe;
+    int index;
+    pthread_t thread;
+} SSPipeStage;
+
+struct SignalSifterPipeline_S16 {
+    SSPipeQueue queues[SSPIPE_STAGES + 1];
+    SSPipeStage stages[SSPIPE_STAGES];
+    int num_started;
+    atomic_int stop;
+};
+
+// Returns the slot to fill, or NULL if the pipeline stops
+static SSPipeSlot *queue_wait_space(SignalSifterPipeline_S16 *p, SSPipeQueue *q)
+{
+    int i, waits = 0;
+
+    while ((i = jmpnn_spsc_space(&q->ring, SSPIPE_QUEUE_SLOTS)) < 0)
+    {
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+            return NULL;
+        jmpnn_backoff(&waits);
+    }
+    return &q->slots[i];
+}
+
+static SSPipeSlot *queue_wait_data(SignalSifterPipeline_S16 *p, SSPipeQueue *q)
+{
+    int i, waits = 0;
+
+    while ((i = jmpnn_spsc_data(&q->ring, SSPIPE_QUEUE_SLOTS)) < 0)
+    {
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+            return NULL;
+        jmpnn_backoff(&waits);
+    }
+    return &q->slots[i];
+}
+
+static void *pipeline_stage(void *arg)
+{
+    SSPipeStage *st = arg;
+    SignalSifterPipeline_S16 *p = st->pipe;
+    SSPipeQueue *in = &p->queues[st->index], *out = &p->queues[st->index + 1];
+    SSPipeSlot *src, *dst;
+
+    while ((src = queue_wait_data(p, in)) != NULL && (dst = queue_wait_space(p, out)) != NULL)
+    {
+        SignalSifterState_S16 *ss = src->ss;
+        const GRULayer *gru;
+        int16_t *state;
+
+        if (st->index == 0)
+        {
+            gru = ss->model->gru1_gru;
+            state = ss->gru1_gru_state;
+            computeGRULayer_S16(gru, state, src->data,
+                                INPUT_NUM_FRAC_BITS, INPUTLAYER_SHIFT_RIGHT, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        }
+        else
+        {
+            gru = st->index == 1 ? ss->model->gru2_gru : ss->model->gru3_gru;
+            state = st->index == 1 ? ss->gru2_gru_state : ss->gru3_gru_state;
+            computeGRULayer_S16(gru, state, src->data,
+                                GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        }
+        jmpnn_spsc_pop(&in->ring);
+        dst->ss = ss;
+        memcpy(dst->data, state, gru->hidden_size * sizeof(int16_t));
+        jmpnn_spsc_push(&out->ring);
+    }
+    return NULL;
+}
+
+int createSignalSifterPipeline_S16(SignalSifterPipeline_S16 **pipe, const int *cpus)
+{
+    SignalSifterPipeline_S16 *p;
+    int i;
+
+    *pipe = NULL;
+    if (posix_memalign((void **)&p, JMPNN_CACHE_LINE, sizeof(SignalSifterPipeline_S16)))
+        return -1;
+    memset(p, 0, sizeof(SignalSifterPipeline_S16));
+    for (i = 0; i <= SSPIPE_STAGES; i++)
+    {
+        jmpnn_spsc_init(&p->queues[i].ring);
+    }
+    atomic_init(&p->stop, 0);
+    for (i = 0; i < SSPIPE_STAGES; i++)
+    {
+        SSPipeStage *st = &p->stages[i];
+        st->pipe = p;
+        st->index = i;
+        if (pthread_create(&st->thread, NULL, pipeline_stage, st))
+        {
+            destroySignalSifterPipeline_S16(p);
+            return -1;
+        }
+        p->num_started = i + 1;
+        if (cpus)
+            jmpnn_pin_thread(st->thread, cpus[i]);
+    }
+    *pipe = p;
+    return 0;
+}
+
+void destroySignalSifterPipeline_S16(SignalSifterPipeline_S16 *pipe)
+{
+    int i;
+
+    if (!pipe)
+        return;
+    atomic_store_explicit(&pipe->stop, 1, memory_order_relaxed);
+    for (i = 0; i < pipe->num_started; i++)
+        pthread_join(pipe->stages[i].thread, NULL);
+    free(pipe);
+}
+
+void pushSignalSifterPipeline_S16(SignalSifterPipeline_S16 *pipe, SignalSifterState_S16 *ss, const int16_t *input)
+{
+    SSPipeQueue *q = &pipe->queues[0];
+    SSPipeSlot *slot = queue_wait_space(pipe, q);
+
+    slot->ss = ss;
+    memcpy(slot->data, input, ss->model->gru1_gru->input_size * sizeof(int16_t));
+    jmpnn_spsc_push(&q->ring);
+}
+
+void popSignalSifterPipeline_S16(SignalSifterPipeline_S16 *pipe, int16_t *gains)
+{
+    SSPipeQueue *q = &pipe->queues[SSPIPE_STAGES];
+    SSPipeSlot *slot = queue_wait_data(pipe, q);
+
+    computeLinearLayer_S16(slot->ss->model->linear1_linear, gains, slot->data,
+                           LIN_NUM_FRAC_BITS, WAB_FRAC_BITS);
+    jmpnn_spsc_pop(&q->ring);
+}
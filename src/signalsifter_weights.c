@@ -41320,7 +41320,8 @@ static const GRULayer gru1_gru = {
    gru1_gru_recurrent_bias, 
    gru1_gru_weights, 
    gru1_gru_recurrent_weights, 
-   160, 128, ACTIVATION_TANH
+   160, 128, ACTIVATION_TANH, WEIGHTS_LAYOUT_ROWMAJOR,
+   NULL, NULL
 };
 
 static const GRULayer gru2_gru = {
@@ -41328,7 +41329,8 @@ static const GRULayer gru2_gru = {
    gru2_gru_recurrent_bias, 
    gru2_gru_weights, 
    gru2_gru_recurrent_weights, 
-   128, 128, ACTIVATION_TANH
+   128, 128, ACTIVATION_TANH, WEIGHTS_LAYOUT_ROWMAJOR,
+   NULL, NULL
 };
 
 static const GRULayer gru3_gru = {
@@ -41336,13 +41338,15 @@ static const GRULayer gru3_gru = {
    gru3_gru_recurrent_bias, 
    gru3_gru_weights, 
    gru3_gru_recurrent_weights, 
-   128, 128, ACTIVATION_TANH
+   128, 128, ACTIVATION_TANH, WEIGHTS_LAYOUT_ROWMAJOR,
+   NULL, NULL
 };
 
 static const LinearLayer linear1_linear = {
    linear1_linear_bias,
    linear1_linear_weights,
-   128, 160, ACTIVATION_SIGMOID
+   128, 160, ACTIVATION_SIGMOID, WEIGHTS_LAYOUT_ROWMAJOR,
+   NULL
 };
 
 const SignalSifterModel ss_model = {
@@ -138,6 +138,20 @@ void convert_F32toS8(const float *A, int8_t *B, unsigned int N)
     JMPDSP_vfix8(temp, 1, B, 1, N);
 }
 
+// Round to nearest with numFracBits and saturate symmetrically to [-127, 127]
+void convert_F32toS8_Q(const float *A, int8_t *B, unsigned int N, int numFracBits)
+{
+    float scale = (float)(1 << numFracBits);
+    int32_t val;
+    int i;
+
+    for (i=0; i<N; i++)
+    {
+        val = (int32_t) lrintf(A[i] * scale);
+        B[i] = MIN(MAX(val, -127), 127);
+    }
+}
+
 void print_vector(float *vector, unsigned int N, char *vec_name)
 {
     int i;
@@ -269,6 +283,21 @@ float check_vec_S16(int16_t *x, float *ref, int N, int Qn)
     return mse;
 }
 
+float check_vec_S8(int8_t *x, float *ref, int N, int Qn)
+{
+    int i;
+    float mse = 0.0f;
+    float scale = powf(2, -Qn);
+    float x_val;
+    for (i=0; i<N; i++)
+    {
+        x_val = (float) x[i] * scale;
+        mse += (x_val - ref[i]) * (x_val - ref[i]);
+    }
+    mse = mse / (float) N;
+    return mse;
+}
+
 float check_vec_S16_S16(int16_t *x, int16_t *ref, int N)
 {
     int i;
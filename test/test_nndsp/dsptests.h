@@ -11,6 +11,13 @@
 #include "dsplib.h"
 #include "utils.h"
 #include "dsp_processing.h"
+#include "noise_reduction.h"
+#include "jumpml_nr.h"
+#include "jumpml_nr_engine.h"
+#include "jumpml_nr_chunked.h"
+#include "noise_reduction_worker.h"
+#include "signalsifter_model_file.h"
+#include <poll.h>
 
 #define NUM_INT_BITS 2
 #define NUM_PTS 128
@@ -102,11 +109,660 @@ void DOTPROD_TEST(void)
     printf("dot(w,x) = %f dotS16(w_S8,x_S16)=%f  dotS32(w_S8,x_S16)=%f\n", res, res_S16/powf(2,15-NUM_INT_BITS), res_S32/powf(2,22));
 }
 
+// Energy gate: noise, digital zero, noise. Until the gate reopens the output must match
+// the ungated instance exactly (the gate only skips work whose result is not audible
+// here: the NN while the input is below threshold, the FFTs once the buffer is zero).
+void NR_GATE_TEST(void)
+{
+    static NoiseReductionState nr, nr_gated;
+    float input[HOP_LENGTH], output[HOP_LENGTH], output_gated[HOP_LENGTH];
+    int t, i, mismatches = 0;
+
+    create_noise_reduction(&nr, 0.5f, 0.01f);
+    create_noise_reduction(&nr_gated, 0.5f, 0.01f);
+    noise_reduction_set_gate(&nr_gated, 1, NR_GATE_THRESHOLD_DB, 1.0f);
+    for (t = 0; t < 100; t++)
+    {
+        if (t < 40 || t >= 80)
+            gen_randvec(input, HOP_LENGTH, 15);
+        else
+            JMPDSP_vclr(input, 1, HOP_LENGTH);
+        noise_reduction_process(&nr, input, output, HOP_LENGTH);
+        noise_reduction_process(&nr_gated, input, output_gated, HOP_LENGTH);
+        if (t < 80)
+            for (i = 0; i < HOP_LENGTH; i++)
+                mismatches += output[i] != output_gated[i];
+    }
+    printf("NR GATE mismatches = %d, bypassed %llu of %llu frames (%llu digital zero)\n", mismatches,
+           (unsigned long long)nr_gated.gate.framesBypassed, (unsigned long long)nr_gated.gate.framesTotal,
+           (unsigned long long)nr_gated.gate.framesZero);
+    destroy_noise_reduction(&nr);
+    destroy_noise_reduction(&nr_gated);
+}
+
+#define DSPTEST_GEOMETRY_FRAMES 20
+#define DSPTEST_GEOMETRY_FILE "dsptest_geometry.jmpnn"
+// Runtime STFT geometry: a unit mask reconstructs the input one hop later for the
+// compiled-in geometry and for n_fft 256 / hop 128 (one plan per geometry), an instance
+// of the second geometry running a 128-bin graph leaves a default instance in the same
+// process bit-exact and matches the same graph written to and loaded from a model file,
+// and NNs or geometries that do not fit are rejected.
+void NR_STFT_GEOMETRY_TEST(void)
+{
+    static const unsigned int geometry[2][2] = {{2 * HOP_LENGTH, HOP_LENGTH}, {256, 128}};
+    static STFTStruct stft, stft2;
+    static NoiseReductionState nr, nr_ref, nr_256, nr_file;
+    static DSP_JMPNR_ST_STRU jmpnr;
+    float input[DSPTEST_GEOMETRY_FRAMES][HOP_LENGTH], output[HOP_LENGTH], output_ref[HOP_LENGTH];
+    float output_256[128], output_file[128], ones[HOP_LENGTH + 1], err[2] = {0.0f, 0.0f};
+    LinearLayer lin = *ss_model.linear1_linear;
+    NNGraph g;
+    SignalSifterModelFile mf;
+    int i, t, k, shared, mismatches = 0, mismatches_file = -1, frame_size = 0, rejected = 0;
+
+    for (t = 0; t < DSPTEST_GEOMETRY_FRAMES; t++)
+        gen_randvec(input[t], HOP_LENGTH, 15);
+    for (i = 0; i <= HOP_LENGTH; i++)
+        ones[i] = 1.0f;
+    for (k = 0; k < 2; k++)
+    {
+        unsigned int R = geometry[k][1];
+        create_stft_geometry(&stft, geometry[k][0], R);
+        for (t = 0; t < DSPTEST_GEOMETRY_FRAMES; t++)
+        {
+            stft_process(&stft, input[t], R);
+            mask_process(&stft, ones);
+            istft_process(&stft, output, R);
+            for (i = 0; t > 0 && i < R; i++)
+                err[k] = fmaxf(err[k], fabsf(output[i] - input[t - 1][i]));
+        }
+    }
+    create_stft_geometry(&stft2, 256, 128);
+    shared = stft.plan == stft2.plan && stft.plan == get_stft_plan(256) && get_stft_plan(2 * HOP_LENGTH) != stft.plan;
+
+    // gru2 and the first 128 rows of linear1: 128 bins in, 128 gains out
+    lin.hidden_size = 128;
+    initNNGraph(&g);
+    addNNGraphGRULayer(&g, ss_model.gru2_gru);
+    addNNGraphLinearLayer(&g, &lin);
+    create_noise_reduction(&nr, 0.5f, 0.01f);
+    create_noise_reduction(&nr_ref, 0.5f, 0.01f);
+    create_noise_reduction_geometry(&nr_256, 0.5f, 0.01f, 256, 128);
+    create_noise_reduction_geometry(&nr_file, 0.5f, 0.01f, 256, 128);
+    memset(&mf, 0, sizeof(mf));
+    if (noise_reduction_set_graph(&nr_256, &g) == 0 &&
+        writeNNGraphFileGeometry(&g, 256, 128, DSPTEST_GEOMETRY_FILE) == 0 &&
+        loadSignalSifterModelFile(&mf, DSPTEST_GEOMETRY_FILE, JMPNN_MODEL_VERIFY) == 0 &&
+        noise_reduction_set_graph(&nr_file, &mf.graph) == 0)
+    {
+        mismatches_file = (mf.fft_size != 256) + (mf.hop_length != 128) + (mf.io_size != 128) + mf.has_model;
+        jumpml_nr_init_geometry(&jmpnr, 0.5f, 0.01f, mf.fft_size, mf.hop_length);
+        frame_size = jumpml_nr_frame_size(&jmpnr);
+        destroy_noise_reduction(jmpnr.NR_Ptr);
+    }
+    for (t = 0; t < DSPTEST_GEOMETRY_FRAMES; t++)
+    {
+        noise_reduction_process(&nr, input[t], output, HOP_LENGTH);
+        noise_reduction_process(&nr_256, input[t], output_256, 128);
+        noise_reduction_process(&nr_ref, input[t], output_ref, HOP_LENGTH);
+        for (i = 0; i < HOP_LENGTH; i++)
+            mismatches += output[i] != output_ref[i];
+        if (mismatches_file >= 0)
+        {
+            noise_reduction_process(&nr_file, input[t], output_file, 128);
+            for (i = 0; i < 128; i++)
+                mismatches_file += output_256[i] != output_file[i];
+        }
+    }
+
+    // hop other than n_fft/2, odd n_fft, larger than STFT_MAX_FFT_SIZE; the compiled-in
+    // model (IO_SIZE inputs) and a graph wider than the 129 bins on the 256/128 instance
+    rejected += create_stft_geometry(&stft2, 256, 64) != 0;
+    rejected += create_stft_geometry(&stft2, 255, 127) != 0;
+    rejected += create_noise_reduction_geometry(&nr_file, 0.5f, 0.01f, 16 * HOP_LENGTH, 8 * HOP_LENGTH) != 0;
+    rejected += noise_reduction_set_model(&nr_256, NULL) != 0;
+    createNNGraphFromSignalSifterModel(&g, &ss_model);
+    rejected += noise_reduction_set_graph(&nr_256, &g) != 0;
+
+    printf("STFT GEOMETRY: reconstruction error %u/%u = %e 256/128 = %e, plans shared = %d, default instance "
+           "mismatches = %d, 256/128 instance: model file mismatches = %d, frame size = %d, rejected = %d/5\n",
+           geometry[0][0], geometry[0][1], err[0], err[1], shared, mismatches, mismatches_file, frame_size, rejected);
+    if (mf.data)
+        unloadSignalSifterModelFile(&mf);
+    remove(DSPTEST_GEOMETRY_FILE);
+    destroy_noise_reduction(&nr);
+    destroy_noise_reduction(&nr_ref);
+    destroy_noise_reduction(&nr_256);
+    destroy_noise_reduction(&nr_file);
+}
+
+#define DSPTEST_CONTEXT_STREAMS 3
+// Engine context: streams sized by jumpml_nr_state_size() and initialized from a shared
+// context (256/128 with a graph, or the compiled-in model in builds without graphs) match
+// a standalone instance, also after the creator dropped its reference to the context.
+void NR_CONTEXT_TEST(void)
+{
+    static DSP_JMPNR_ST_STRU ref;
+    void *ctx, *st[DSPTEST_CONTEXT_STREAMS];
+    int16_t input[HOP_LENGTH], output[HOP_LENGTH], output_ref[HOP_LENGTH];
+    LinearLayer lin = *ss_model.linear1_linear;
+    const NNGraph *graph = NULL;
+    NNGraph g;
+    size_t size;
+    int i, t, k, N, ret, mismatches = 0;
+
+    lin.hidden_size = 128;
+    initNNGraph(&g);
+    addNNGraphGRULayer(&g, ss_model.gru2_gru);
+    addNNGraphLinearLayer(&g, &lin);
+    if (jumpml_nr_context_create(&ctx, 256, 128, NULL, &g) == 0)
+        graph = &g;
+    else
+        jumpml_nr_context_create(&ctx, 2 * HOP_LENGTH, HOP_LENGTH, NULL, NULL);
+    size = jumpml_nr_state_size(ctx);
+    ret = 0;
+    for (k = 0; k < DSPTEST_CONTEXT_STREAMS; k++)
+    {
+        st[k] = malloc(size);
+        ret |= jumpml_nr_init_context(st[k], ctx, 0.5f, 0.01f);
+    }
+    jumpml_nr_context_release(ctx);
+    N = jumpml_nr_frame_size(st[0]);
+    jumpml_nr_init_geometry(&ref, 0.5f, 0.01f, 2 * N, N);
+    jumpml_nr_set_graph(&ref, graph);
+    for (t = 0; t < 20; t++)
+    {
+        for (i = 0; i < N; i++)
+            input[i] = (int16_t)(rand() % 8192 - 4096);
+        jumpml_nr_proc(output_ref, input, &ref, 16000);
+        for (k = 0; k < DSPTEST_CONTEXT_STREAMS; k++)
+        {
+            jumpml_nr_proc(output, input, st[k], 16000);
+            for (i = 0; i < N; i++)
+                mismatches += output[i] != output_ref[i];
+        }
+    }
+    for (k = 0; k < DSPTEST_CONTEXT_STREAMS; k++)
+    {
+        jumpml_nr_release(st[k]);
+        free(st[k]);
+    }
+    jumpml_nr_release(&ref);
+    printf("NR CONTEXT mismatches (%d streams, %s) = %d, init %s, stream state = %zu bytes (%zu without NN state)\n",
+           DSPTEST_CONTEXT_STREAMS, graph ? "256/128 graph" : "compiled-in model", mismatches, ret ? "FAIL" : "PASS",
+           size, sizeof(DSP_JMPNR_ST_STRU));
+}
+
+#define DSPTEST_ENGINE_STREAMS 24
+#define DSPTEST_ENGINE_FRAMES 30
+static void engine_frame_done(void *user, int stream_id, int16_t *output)
+{
+    ((int *)user)[stream_id]++;
+}
+
+// Multi-stream engine on 4 workers matches each stream processed on its own; every frame
+// gets its callback and the worker and stream counters add up to the frames submitted.
+void NR_ENGINE_TEST(void)
+{
+    typedef int16_t StreamFrames[DSPTEST_ENGINE_FRAMES][HOP_LENGTH];
+    JMPNR_EngineConfig cfg = {4, DSPTEST_ENGINE_STREAMS, 0, 0, NULL, 0, 0};
+    DSP_JMPNR_ST_STRU *st = malloc(2 * DSPTEST_ENGINE_STREAMS * sizeof(DSP_JMPNR_ST_STRU));
+    DSP_JMPNR_ST_STRU *ref = st + DSPTEST_ENGINE_STREAMS;
+    StreamFrames *output = malloc(2 * DSPTEST_ENGINE_STREAMS * sizeof(StreamFrames));
+    StreamFrames *output_ref = output + DSPTEST_ENGINE_STREAMS;
+    int16_t input[HOP_LENGTH];
+    int done[DSPTEST_ENGINE_STREAMS] = {0}, id[DSPTEST_ENGINE_STREAMS];
+    uint64_t worker_frames = 0, stream_frames = 0, steals = 0, dropped = 0;
+    JMPNR_WorkerStats ws;
+    JMPNR_StreamStats ss;
+    void *engine;
+    int i, t, k, mismatches = 0, callbacks = 0;
+
+    if (jumpml_nr_engine_create(&engine, &cfg))
+    {
+        printf("NR ENGINE: create FAIL\n");
+        return;
+    }
+    for (k = 0; k < DSPTEST_ENGINE_STREAMS; k++)
+    {
+        jumpml_nr_init(&st[k], 0.5f, 0.01f);
+        jumpml_nr_init(&ref[k], 0.5f, 0.01f);
+        id[k] = jumpml_nr_engine_add_stream(engine, &st[k], 16000, engine_frame_done, done);
+    }
+    for (t = 0; t < DSPTEST_ENGINE_FRAMES; t++)
+        for (k = 0; k < DSPTEST_ENGINE_STREAMS; k++)
+        {
+            for (i = 0; i < HOP_LENGTH; i++)
+                input[i] = (int16_t)(rand() % 8192 - 4096);
+            while (jumpml_nr_engine_submit(engine, id[k], input, output[k][t]))
+                jumpml_nr_engine_wait(engine);
+            jumpml_nr_proc(output_ref[k][t], input, &ref[k], 16000);
+        }
+    jumpml_nr_engine_wait(engine);
+
+    for (k = 0; k < DSPTEST_ENGINE_STREAMS; k++)
+    {
+        for (t = 0; t < DSPTEST_ENGINE_FRAMES; t++)
+            for (i = 0; i < HOP_LENGTH; i++)
+                mismatches += output[k][t][i] != output_ref[k][t][i];
+        callbacks += done[k];
+        jumpml_nr_engine_stream_stats(engine, id[k], &ss);
+        stream_frames += ss.frames;
+        dropped += ss.dropped;
+        jumpml_nr_engine_remove_stream(engine, id[k]);
+    }
+    for (k = 0; k < jumpml_nr_engine_num_workers(engine); k++)
+    {
+        jumpml_nr_engine_worker_stats(engine, k, &ws);
+        worker_frames += ws.frames;
+        steals += ws.steals;
+    }
+    jumpml_nr_engine_destroy(engine);
+    for (k = 0; k < DSPTEST_ENGINE_STREAMS; k++)
+    {
+        jumpml_nr_release(&st[k]);
+        jumpml_nr_release(&ref[k]);
+    }
+    printf("NR ENGINE mismatches (%d streams x %d frames, %d workers) = %d, callbacks = %d, frames per worker sum = %llu, "
+           "per stream sum = %llu, steals = %llu, full queue retries = %llu\n",
+           DSPTEST_ENGINE_STREAMS, DSPTEST_ENGINE_FRAMES, cfg.num_workers, mismatches, callbacks,
+           (unsigned long long)worker_frames, (unsigned long long)stream_frames, (unsigned long long)steals,
+           (unsigned long long)dropped);
+    free(output);
+    free(st);
+}
+
+#define DSPTEST_ASYNC_STREAMS 8
+#define DSPTEST_ASYNC_SLOTS 12
+// Asynchronous submit/poll on 3 workers with fewer completion slots than frames in flight:
+// refused submits are retried after a poll, completions of every stream come back in
+// submission order with their tags and outputs matching each stream processed on its own,
+// and the eventfd is readable exactly while completions are queued.
+void NR_ENGINE_ASYNC_TEST(void)
+{
+    typedef int16_t StreamFrames[DSPTEST_ENGINE_FRAMES][HOP_LENGTH];
+    JMPNR_EngineConfig cfg = {3, DSPTEST_ASYNC_STREAMS, 4, 0, NULL, DSPTEST_ASYNC_SLOTS, 1};
+    DSP_JMPNR_ST_STRU *st = malloc(2 * DSPTEST_ASYNC_STREAMS * sizeof(DSP_JMPNR_ST_STRU));
+    DSP_JMPNR_ST_STRU *ref = st + DSPTEST_ASYNC_STREAMS;
+    StreamFrames *output = malloc(2 * DSPTEST_ASYNC_STREAMS * sizeof(StreamFrames));
+    StreamFrames *output_ref = output + DSPTEST_ASYNC_STREAMS;
+    JMPNR_Completion c[DSPTEST_ASYNC_SLOTS];
+    int16_t input[HOP_LENGTH], extra[HOP_LENGTH];
+    int next[DSPTEST_ASYNC_STREAMS] = {0}, id[DSPTEST_ASYNC_STREAMS];
+    int i, t, k, n, completed = 0, refused = 0, misordered = 0, mismatches = 0, readable_queued, readable_empty = 0;
+    struct pollfd pfd;
+    void *engine;
+
+    if (jumpml_nr_engine_create(&engine, &cfg))
+    {
+        printf("NR ENGINE ASYNC: create FAIL\n");
+        return;
+    }
+    pfd.fd = jumpml_nr_engine_eventfd(engine);
+    pfd.events = POLLIN;
+    for (k = 0; k < DSPTEST_ASYNC_STREAMS; k++)
+    {
+        jumpml_nr_init(&st[k], 0.5f, 0.01f);
+        jumpml_nr_init(&ref[k], 0.5f, 0.01f);
+        id[k] = jumpml_nr_engine_add_stream(engine, &st[k], 16000, NULL, NULL);
+    }
+    for (t = 0; t < DSPTEST_ENGINE_FRAMES + 1; t++)
+        for (k = 0; k < DSPTEST_ASYNC_STREAMS; k++)
+        {
+            if (t < DSPTEST_ENGINE_FRAMES)
+            {
+                for (i = 0; i < HOP_LENGTH; i++)
+                    input[i] = (int16_t)(rand() % 8192 - 4096);
+                jumpml_nr_proc(output_ref[k][t], input, &ref[k], 16000);
+            }
+            // the last round only drains
+            while (t == DSPTEST_ENGINE_FRAMES ? completed < DSPTEST_ASYNC_STREAMS * DSPTEST_ENGINE_FRAMES :
+                   jumpml_nr_engine_submit_tagged(engine, id[k], input, output[k][t], ((uint64_t)k << 32) | t) != 0)
+            {
+                refused += t < DSPTEST_ENGINE_FRAMES;
+                n = jumpml_nr_engine_wait_completions(engine, c, DSPTEST_ASYNC_SLOTS, 1000);
+                for (i = 0; i < n; i++)
+                {
+                    int ck = (int)(c[i].tag >> 32), ct = (int)(c[i].tag & 0xffffffffu);
+                    misordered += c[i].stream_id != id[ck] || ct != next[ck]++ || c[i].output != output[ck][ct];
+                }
+                completed += n;
+                if (n == 0)
+                    break;
+            }
+        }
+    readable_empty += poll(&pfd, 1, 0) != 0;
+    jumpml_nr_engine_submit(engine, id[0], input, extra);
+    jumpml_nr_engine_wait(engine);
+    readable_queued = poll(&pfd, 1, 0) == 1;
+    completed += jumpml_nr_engine_poll(engine, c, DSPTEST_ASYNC_SLOTS) - 1;
+    readable_empty += poll(&pfd, 1, 0) != 0;
+
+    for (k = 0; k < DSPTEST_ASYNC_STREAMS; k++)
+        for (t = 0; t < DSPTEST_ENGINE_FRAMES; t++)
+            for (i = 0; i < HOP_LENGTH; i++)
+                mismatches += output[k][t][i] != output_ref[k][t][i];
+    for (k = 0; k < DSPTEST_ASYNC_STREAMS; k++)
+    {
+        jumpml_nr_engine_remove_stream(engine, id[k]);
+        jumpml_nr_release(&st[k]);
+        jumpml_nr_release(&ref[k]);
+    }
+    jumpml_nr_engine_destroy(engine);
+    printf("NR ENGINE ASYNC (%d streams x %d frames, %d completion slots) mismatches = %d, completions = %d, "
+           "misordered = %d, refused submits = %d, eventfd %s\n", DSPTEST_ASYNC_STREAMS, DSPTEST_ENGINE_FRAMES,
+           DSPTEST_ASYNC_SLOTS, mismatches, completed, misordered, refused,
+           readable_queued && !readable_empty ? "PASS" : "FAIL");
+    free(output);
+    free(st);
+}
+
+// Delta thresholds: set per instance and kept across jumpml_nr_set_model (delta build),
+// refused in the other builds and out of range.
+void NR_DELTA_THRESHOLDS_TEST(void)
+{
+    DSP_JMPNR_ST_STRU st;
+    int set, kept = 1, bad, expected = 0;
+
+    jumpml_nr_init(&st, 0.5f, 0.01f);
+    set = jumpml_nr_set_delta_thresholds(&st, 3, 5) == 0;
+    bad = jumpml_nr_set_delta_thresholds(&st, -1, 0) && jumpml_nr_set_delta_thresholds(&st, 0, 40000);
+#if defined(USE_DELTA_SIGNALSIFTER)
+    jumpml_nr_set_model(&st, NULL);
+    kept = st.NR_Ptr->SS.input_threshold == 3 && st.NR_Ptr->SS.state_threshold == 5;
+    expected = 1;
+#endif
+    jumpml_nr_release(&st);
+    printf("NR DELTA THRESHOLDS: set = %d (delta build %d), kept = %d, out of range rejected = %d %s\n",
+           set, expected, kept, bad, set == expected && kept && bad ? "PASS" : "FAIL");
+}
+
+#define DSPTEST_STREAM_FRAMES 80
+// Streaming with any block length: blocks of 320 samples have no latency, random block
+// lengths the default frame_size - 1; either way the output is the frame-by-frame output
+// delayed by the reported latency.
+void NR_STREAM_TEST(void)
+{
+    int16_t *input = malloc(3 * DSPTEST_STREAM_FRAMES * HOP_LENGTH * sizeof(int16_t));
+    int16_t *output = input + DSPTEST_STREAM_FRAMES * HOP_LENGTH;
+    int16_t *output_ref = output + DSPTEST_STREAM_FRAMES * HOP_LENGTH;
+    int total = DSPTEST_STREAM_FRAMES * HOP_LENGTH;
+    DSP_JMPNR_ST_STRU st;
+    int i, n, pos, run, latency[2], mismatches = 0;
+
+    for (i = 0; i < total; i++)
+        input[i] = (int16_t)(rand() % 8192 - 4096);
+    jumpml_nr_init(&st, 0.5f, 0.01f);
+    for (i = 0; i < DSPTEST_STREAM_FRAMES; i++)
+        jumpml_nr_proc(&output_ref[i * HOP_LENGTH], &input[i * HOP_LENGTH], &st, 16000);
+    jumpml_nr_release(&st);
+
+    for (run = 0; run < 2; run++)
+    {
+        jumpml_nr_init(&st, 0.5f, 0.01f);
+        if (run == 0)
+            jumpml_nr_stream_reset(&st, 2 * HOP_LENGTH);
+        for (pos = 0; pos < total; pos += n)
+        {
+            n = run == 0 ? 2 * HOP_LENGTH : 1 + rand() % (3 * HOP_LENGTH);
+            n = MIN(n, total - pos);
+            jumpml_nr_proc_stream(&output[pos], &input[pos], n, &st, 16000);
+        }
+        latency[run] = jumpml_nr_stream_latency(&st);
+        for (i = 0; i < total; i++)
+            mismatches += output[i] != (i < latency[run] ? 0 : output_ref[i - latency[run]]);
+        jumpml_nr_release(&st);
+    }
+    printf("NR STREAM mismatches = %d, latency: blocks of %d = %d, random blocks = %d %s\n", mismatches,
+           2 * HOP_LENGTH, latency[0], latency[1],
+           mismatches == 0 && latency[0] == 0 && latency[1] == HOP_LENGTH - 1 ? "PASS" : "FAIL");
+    free(input);
+}
+
+#define DSPTEST_MULTI_FRAMES 40
+#define DSPTEST_MULTI_CHANNELS 3
+// Interleaved channels (stride DSPTEST_MULTI_CHANNELS + 1, the last element untouched): int16
+// in place and float out of place against jumpml_nr_proc per channel.
+void NR_MULTI_TEST(void)
+{
+    enum { C = DSPTEST_MULTI_CHANNELS, S = DSPTEST_MULTI_CHANNELS + 1 };
+    int total = DSPTEST_MULTI_FRAMES * HOP_LENGTH;
+    int16_t *input = malloc(total * (2 + C + S) * sizeof(int16_t));
+    int16_t *channel = input + total;
+    int16_t *output_ref = channel + total;                  // C channels, one after the other
+    int16_t *buffer = output_ref + C * total;               // interleaved, in place
+    float *input_f = malloc(2 * total * S * sizeof(float));
+    float *output_f = input_f + total * S;
+    DSP_JMPNR_ST_STRU st[2][C];
+    void *st_ptrs[2][C];
+    int i, k, t, mismatches_S16 = 0, mismatches_F32 = 0, untouched = 1;
+
+    for (i = 0; i < total; i++)
+        input[i] = (int16_t)(rand() % 8192 - 4096);
+    for (k = 0; k < C; k++)
+    {
+        // channel k is the input scaled by 1/(k+1)
+        jumpml_nr_init(&st[0][k], 0.5f, 0.01f);
+        for (i = 0; i < total; i++)
+        {
+            channel[i] = input[i] / (k + 1);
+            buffer[i * S + k] = channel[i];
+            input_f[i * S + k] = channel[i] / 32768.0f;
+        }
+        for (t = 0; t < DSPTEST_MULTI_FRAMES; t++)
+            jumpml_nr_proc(&output_ref[k * total + t * HOP_LENGTH], &channel[t * HOP_LENGTH], &st[0][k], 16000);
+        jumpml_nr_release(&st[0][k]);
+    }
+    for (i = 0; i < total; i++)
+    {
+        buffer[i * S + C] = 0x5a5a;
+        output_f[i * S + C] = 2.0f;
+    }
+
+    for (i = 0; i < 2; i++)
+        for (k = 0; k < C; k++)
+        {
+            jumpml_nr_init(&st[i][k], 0.5f, 0.01f);
+            st_ptrs[i][k] = &st[i][k];
+        }
+    for (t = 0; t < DSPTEST_MULTI_FRAMES; t++)
+    {
+        jumpml_nr_proc_multi(&buffer[t * HOP_LENGTH * S], &buffer[t * HOP_LENGTH * S], JUMPML_NR_FORMAT_S16,
+                             C, S, st_ptrs[0], 16000);
+        jumpml_nr_proc_multi(&output_f[t * HOP_LENGTH * S], &input_f[t * HOP_LENGTH * S], JUMPML_NR_FORMAT_F32,
+                             C, S, st_ptrs[1], 16000);
+    }
+    for (i = 0; i < total; i++)
+    {
+        for (k = 0; k < C; k++)
+        {
+            mismatches_S16 += buffer[i * S + k] != output_ref[k * total + i];
+            mismatches_F32 += (int16_t)(output_f[i * S + k] * INT16_MAX) != output_ref[k * total + i];
+        }
+        untouched &= buffer[i * S + C] == 0x5a5a && output_f[i * S + C] == 2.0f;
+    }
+    for (i = 0; i < 2; i++)
+        for (k = 0; k < C; k++)
+            jumpml_nr_release(&st[i][k]);
+    printf("NR MULTI (%d channels, stride %d) mismatches: S16 in place = %d, F32 = %d, padding untouched = %d %s\n",
+           C, S, mismatches_S16, mismatches_F32, untouched,
+           mismatches_S16 == 0 && mismatches_F32 == 0 && untouched ? "PASS" : "FAIL");
+    free(input);
+    free(input_f);
+}
+
+// Linked gains of 2 channels against jumpml_nr_proc: identical channels give the mono output
+// in both modes; with channel 1 = channel 0 / 2 the max mode keeps channel 0 and halves channel 1.
+void NR_LINKED_TEST(void)
+{
+    int total = DSPTEST_MULTI_FRAMES * HOP_LENGTH;
+    int16_t *input = malloc(4 * total * sizeof(int16_t));
+    int16_t *output_ref = input + total;
+    int16_t *buffer = output_ref + total;                   // 2 interleaved channels
+    DSP_JMPNR_ST_STRU st[2];
+    void *st_ptrs[2] = { &st[0], &st[1] };
+    int i, t, mode, mismatches = 0, max_error = 0, refused;
+
+    for (i = 0; i < total; i++)
+        input[i] = (int16_t)(rand() % 8192 - 4096) * 2;
+    jumpml_nr_init(&st[0], 0.5f, 0.01f);
+    for (t = 0; t < DSPTEST_MULTI_FRAMES; t++)
+        jumpml_nr_proc(&output_ref[t * HOP_LENGTH], &input[t * HOP_LENGTH], &st[0], 16000);
+    jumpml_nr_release(&st[0]);
+
+    for (mode = 0; mode < 3; mode++)
+    {
+        for (i = 0; i < total; i++)
+        {
+            buffer[2 * i] = input[i];
+            buffer[2 * i + 1] = mode == 2 ? input[i] / 2 : input[i];
+        }
+        jumpml_nr_init(&st[0], 0.5f, 0.01f);
+        jumpml_nr_init(&st[1], 0.5f, 0.01f);
+        for (t = 0; t < DSPTEST_MULTI_FRAMES; t++)
+            jumpml_nr_proc_linked(&buffer[2 * t * HOP_LENGTH], &buffer[2 * t * HOP_LENGTH], JUMPML_NR_FORMAT_S16, 2, 2,
+                                  st_ptrs, mode == 0 ? NR_LINK_MID : NR_LINK_MAX, 16000);
+        for (i = 0; i < total; i++)
+        {
+            mismatches += buffer[2 * i] != output_ref[i];
+            if (mode < 2)
+                mismatches += buffer[2 * i + 1] != output_ref[i];
+            else
+                max_error = MAX(max_error, abs(2 * buffer[2 * i + 1] - buffer[2 * i]));
+        }
+        jumpml_nr_release(&st[0]);
+        jumpml_nr_release(&st[1]);
+    }
+    // a decoupled NN worker owns the NN state of channel 0
+    jumpml_nr_init(&st[0], 0.5f, 0.01f);
+    jumpml_nr_init(&st[1], 0.5f, 0.01f);
+    refused = jumpml_nr_worker_start(&st[0], -1) == 0 &&
+              jumpml_nr_proc_linked(buffer, buffer, JUMPML_NR_FORMAT_S16, 2, 2, st_ptrs, NR_LINK_MID, 16000) == 1;
+    jumpml_nr_release(&st[0]);
+    jumpml_nr_release(&st[1]);
+    printf("NR LINKED mismatches (mid, max, max with a -6 dB channel) = %d, -6 dB channel error = %d LSB, "
+           "refused with an NN worker = %d %s\n", mismatches, max_error, refused,
+           mismatches == 0 && max_error <= 1 && refused ? "PASS" : "FAIL");
+    free(input);
+}
+
+#define DSPTEST_CHUNKED_FRAMES 120
+// Time-chunked denoising on 3 threads: with the warm-up reaching back to frame 0 every
+// chunk is exact; without warm-up the first chunk still is, and the report counts the
+// samples that differ from the sequential run.
+void NR_CHUNKED_TEST(void)
+{
+    JMPNR_ChunkedConfig cfg = {3, 4, DSPTEST_CHUNKED_FRAMES, 1, 0, NULL};
+    JMPNR_ChunkedReport report, report_cold;
+    int16_t *input = malloc(3 * DSPTEST_CHUNKED_FRAMES * HOP_LENGTH * sizeof(int16_t));
+    int16_t *output = input + DSPTEST_CHUNKED_FRAMES * HOP_LENGTH;
+    int16_t *output_ref = output + DSPTEST_CHUNKED_FRAMES * HOP_LENGTH;
+    DSP_JMPNR_ST_STRU st;
+    int i, mismatches = 0, mismatches_cold = 0, first_chunk = DSPTEST_CHUNKED_FRAMES / 4 * HOP_LENGTH;
+    uint32_t ret;
+
+    for (i = 0; i < DSPTEST_CHUNKED_FRAMES * HOP_LENGTH; i++)
+        input[i] = (int16_t)(rand() % 8192 - 4096);
+    jumpml_nr_init(&st, 0.5f, 0.01f);
+    jumpml_nr_proc_batch(output_ref, input, DSPTEST_CHUNKED_FRAMES, &st, 16000);
+    jumpml_nr_release(&st);
+
+    ret = jumpml_nr_proc_chunked(output, input, DSPTEST_CHUNKED_FRAMES, NULL, 0.5f, 0.01f, 16000, &cfg, &report);
+    for (i = 0; i < DSPTEST_CHUNKED_FRAMES * HOP_LENGTH; i++)
+        mismatches += output[i] != output_ref[i];
+    cfg.warmup_frames = 0;
+    ret |= jumpml_nr_proc_chunked(output, input, DSPTEST_CHUNKED_FRAMES, NULL, 0.5f, 0.01f, 16000, &cfg, &report_cold);
+    for (i = 0; i < DSPTEST_CHUNKED_FRAMES * HOP_LENGTH; i++)
+        mismatches_cold += output[i] != output_ref[i];
+    for (i = 0; i < first_chunk; i++)
+        mismatches += output[i] != output_ref[i];
+
+    printf("NR CHUNKED (%d chunks, %d threads) mismatches = %d (report %llu), no warm-up: %d samples differ (report %llu, "
+           "max %d LSB) %s\n", report.num_chunks, report.num_threads, mismatches,
+           (unsigned long long)report.mismatched_samples, mismatches_cold,
+           (unsigned long long)report_cold.mismatched_samples, report_cold.max_abs_error,
+           ret == 0 && mismatches == 0 && report.mismatched_samples == 0 &&
+           report_cold.mismatched_samples == (uint64_t)mismatches_cold ? "PASS" : "FAIL");
+    free(input);
+}
+
+// Chunked processing as the first call of the process: the worker threads are the first to
+// initialize instances, so the STFT plan, kernel selection (and delta model) caches are built
+// concurrently. Run it under ThreadSanitizer to check them.
+void NR_CHUNKED_COLD_START_TEST(void)
+{
+    JMPNR_ChunkedConfig cfg = {4, 4, DSPTEST_CHUNKED_FRAMES, 1, 0, NULL};
+    JMPNR_ChunkedReport report;
+    int16_t *input = malloc(2 * DSPTEST_CHUNKED_FRAMES * HOP_LENGTH * sizeof(int16_t));
+    int16_t *output = input + DSPTEST_CHUNKED_FRAMES * HOP_LENGTH;
+    uint32_t ret;
+    int i;
+
+    for (i = 0; i < DSPTEST_CHUNKED_FRAMES * HOP_LENGTH; i++)
+        input[i] = (int16_t)(rand() % 8192 - 4096);
+    ret = jumpml_nr_proc_chunked(output, input, DSPTEST_CHUNKED_FRAMES, NULL, 0.5f, 0.01f, 16000, &cfg, &report);
+    printf("NR CHUNKED COLD START (%d threads) mismatches = %llu %s\n", report.num_threads,
+           (unsigned long long)report.mismatched_samples, ret == 0 && report.mismatched_samples == 0 ? "PASS" : "FAIL");
+    free(input);
+}
+
+#define DSPTEST_WORKER_FRAMES 60
+// Decoupled NN worker, waited for after every frame (no deadline misses): frame t is the
+// STFT of the input masked with the post-processed gains of frame t-1 of a regular instance.
+void NR_WORKER_TEST(void)
+{
+    static NoiseReductionState nr, ref, lag;
+    static float gains_prev[sizeof(ref.gains) / sizeof(float)] __attribute__((aligned(16)));
+    float input[HOP_LENGTH], output[HOP_LENGTH], output_ref[HOP_LENGTH], output_seq[HOP_LENGTH];
+    NRWorkerStats stats;
+    int t, i, mismatches = 0, ret;
+
+    create_noise_reduction(&nr, 0.5f, 0.01f);
+    create_noise_reduction(&ref, 0.5f, 0.01f);
+    create_noise_reduction(&lag, 0.5f, 0.01f);
+    memcpy(gains_prev, ref.gains, sizeof(gains_prev));
+    ret = noise_reduction_start_worker(&nr, -1);
+    ret |= noise_reduction_start_worker(&nr, -1) == 0;
+    for (t = 0; t < DSPTEST_WORKER_FRAMES; t++)
+    {
+        gen_randvec(input, HOP_LENGTH, 15);
+        noise_reduction_process(&nr, input, output, HOP_LENGTH);
+        noise_reduction_worker_wait(&nr);
+
+        stft_process(&lag.STFT, input, HOP_LENGTH);
+        mask_process(&lag.STFT, gains_prev);
+        istft_process(&lag.STFT, output_ref, HOP_LENGTH);
+        noise_reduction_process(&ref, input, output_seq, HOP_LENGTH);
+        memcpy(gains_prev, ref.gains, sizeof(gains_prev));
+        for (i = 0; i < HOP_LENGTH; i++)
+            mismatches += output[i] != output_ref[i];
+    }
+    noise_reduction_worker_stats(&nr, &stats);
+    printf("NR WORKER (one frame gain lag) mismatches = %d, %llu frames, %llu NN frames, %llu late, %llu dropped %s\n",
+           mismatches, (unsigned long long)stats.frames, (unsigned long long)stats.nn_frames,
+           (unsigned long long)stats.late, (unsigned long long)stats.dropped,
+           ret == 0 && mismatches == 0 && stats.nn_frames == DSPTEST_WORKER_FRAMES && stats.late == 0 ? "PASS" : "FAIL");
+    destroy_noise_reduction(&nr);
+    destroy_noise_reduction(&ref);
+    destroy_noise_reduction(&lag);
+}
+
 void RUN_DSPTESTS(void)
 {
 //    DOTPROD_TEST();
 //    DSPPROCESSING_TEST();
 //    MEAN_TEST();
+    NR_GATE_TEST();
+    NR_STFT_GEOMETRY_TEST();
+    NR_CONTEXT_TEST();
+    NR_ENGINE_TEST();
+    NR_ENGINE_ASYNC_TEST();
+    NR_DELTA_THRESHOLDS_TEST();
+    NR_STREAM_TEST();
+    NR_MULTI_TEST();
+    NR_LINKED_TEST();
+    NR_CHUNKED_TEST();
+    NR_WORKER_TEST();
 }
 
 
@@ -28,6 +28,7 @@ void SLIMIT_TEST(void)
 
 
 int main(int argc, const char * argv[]) {
+    NR_CHUNKED_COLD_START_TEST();   // first: no instance initialized before its threads start
     RUN_NNTESTS();
     RUN_DSPTESTS(); 
     return 0;
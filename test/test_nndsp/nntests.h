@@ -13,6 +13,11 @@
 
 #include "utils.h"
 #include "signalsifter.h"
+#include "nn_layers_tools.h"
+#include "signalsifter_model_file.h"
+#include "nn_graph.h"
+#include "nn_team.h"
+#include "signalsifter_pipeline.h"
 #include "dsplib.h"
 #define NUM_PTS 128
 
@@ -77,6 +82,28 @@ void ACTIVATION_TEST(JMPNN_ActivationType actType)
 
 }
 
+// Max abs error of the table and rational tanh/sigmoid vs libm over the whole Q3.15 range
+void ACTIVATION_ERROR_TEST(void)
+{
+    float err_table = 0, err_rational = 0, err_table_S16 = 0, err_rational_S16 = 0, err_sigmoid = 0;
+    float x, ref;
+    int32_t x_S32;
+
+    for (x_S32 = -(1 << 18); x_S32 < (1 << 18); x_S32 += 7)
+    {
+        x = x_S32 / 32768.0f;
+        ref = tanhf(x);
+        err_table = MAX(err_table, fabsf(tanh_table_approx(x) - ref));
+        err_rational = MAX(err_rational, fabsf(tanh_rational(x) - ref));
+        err_table_S16 = MAX(err_table_S16, fabsf(tanh_table_approx_S16(x_S32) - 32768.0f * ref));
+        err_rational_S16 = MAX(err_rational_S16, fabsf(tanh_rational_S16(x_S32) - 32768.0f * ref));
+        err_sigmoid = MAX(err_sigmoid, fabsf(sigmoid_approx(x) - 1.0f / (1.0f + expf(-x))));
+    }
+    printf("TANH max error: table = %e rational = %e %s, S16 (LSB): table = %.2f rational = %.2f %s, sigmoid = %e\n",
+           err_table, err_rational, err_rational < 1e-6f ? "PASS" : "FAIL",
+           err_table_S16, err_rational_S16, err_rational_S16 <= err_table_S16 ? "PASS" : "FAIL", err_sigmoid);
+}
+
 void NNLIB_MATXVEC_TEST(void)
 {
     const LinearLayer *ll;
@@ -254,11 +281,986 @@ void NNLAYERS_GRU_TEST(void)
     
 }
 
+// The TILED4x16 kernels must match the row-major ones (bit-exact for S16)
+void NNLAYERS_TILED_TEST(void)
+{
+    static nnWeight Wi_tiled[3*MAX_NEURONS*MAX_NEURONS], Wh_tiled[3*MAX_NEURONS*MAX_NEURONS];
+    static nnWeight Wl_tiled[MAX_NEURONS*MAX_NEURONS];
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    GRULayer gru_tiled = *gru;
+    LinearLayer ll_tiled = *ll;
+    int N = gru->hidden_size;
+    float input[MAX_NEURONS], state[MAX_NEURONS], state_tiled[MAX_NEURONS];
+    float out[MAX_NEURONS], out_tiled[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS], state_tiled_S16[MAX_NEURONS];
+    int16_t out_S16[MAX_NEURONS], out_tiled_S16[MAX_NEURONS];
+    int i, mismatches = 0;
+    float mse_gru, mse_lin;
+
+    packWeightsTiled4x16(Wi_tiled, gru->input_weights, 3*N, gru->input_size);
+    packWeightsTiled4x16(Wh_tiled, gru->recurrent_weights, 3*N, N);
+    packWeightsTiled4x16(Wl_tiled, ll->weights, ll->hidden_size, ll->input_size);
+    gru_tiled.input_weights = Wi_tiled;
+    gru_tiled.recurrent_weights = Wh_tiled;
+    gru_tiled.layout = WEIGHTS_LAYOUT_TILED4x16;
+    ll_tiled.weights = Wl_tiled;
+    ll_tiled.layout = WEIGHTS_LAYOUT_TILED4x16;
+
+    gen_randvec(input, gru->input_size, 15);
+    gen_randvec(state, N, 15);
+    convert_F32toS16(input, input_S16, gru->input_size, 15);
+    convert_F32toS16(state, state_S16, N, 15);
+    memcpy(state_tiled, state, N * sizeof(float));
+    memcpy(state_tiled_S16, state_S16, N * sizeof(int16_t));
+
+    computeGRULayer_S16(gru, state_S16, input_S16, 9, 1, 15, 7);
+    computeGRULayer_S16(&gru_tiled, state_tiled_S16, input_S16, 9, 1, 15, 7);
+    computeGRULayer(gru, state, input);
+    computeGRULayer(&gru_tiled, state_tiled, input);
+    for (i=0; i<N; i++)
+        mismatches += state_S16[i] != state_tiled_S16[i];
+    mse_gru = check_vectors(state_tiled, state, N);
+
+    computeLinearLayer_S16(ll, out_S16, state_S16, 15, 7);
+    computeLinearLayer_S16(&ll_tiled, out_tiled_S16, state_S16, 15, 7);
+    computeLinearLayer(ll, out, state);
+    computeLinearLayer(&ll_tiled, out_tiled, state);
+    for (i=0; i<ll->hidden_size; i++)
+        mismatches += out_S16[i] != out_tiled_S16[i];
+    mse_lin = check_vectors(out_tiled, out, ll->hidden_size);
+
+    printf("TILED4x16 mismatches (S16) = %d MSE (F32): gru = %e linear = %e\n", mismatches, mse_gru, mse_lin);
+}
+
+// The BSR4x16 kernels must match the row-major ones on the same block-pruned weights (bit-exact for S16)
+void NNLAYERS_BSR_TEST(void)
+{
+    static nnWeight Wi_pruned[3*MAX_NEURONS*MAX_NEURONS], Wh_pruned[3*MAX_NEURONS*MAX_NEURONS];
+    static nnWeight Wl_pruned[MAX_NEURONS*MAX_NEURONS];
+    static nnWeight Wi_bsr[3*MAX_NEURONS*MAX_NEURONS], Wh_bsr[3*MAX_NEURONS*MAX_NEURONS];
+    static nnWeight Wl_bsr[MAX_NEURONS*MAX_NEURONS];
+    static uint16_t Wi_index[3*MAX_NEURONS*MAX_NEURONS/64 + 3*MAX_NEURONS/4 + 1];
+    static uint16_t Wh_index[3*MAX_NEURONS*MAX_NEURONS/64 + 3*MAX_NEURONS/4 + 1];
+    static uint16_t Wl_index[MAX_NEURONS*MAX_NEURONS/64 + MAX_NEURONS/4 + 1];
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    GRULayer gru_pruned = *gru, gru_bsr = *gru;
+    LinearLayer ll_pruned = *ll, ll_bsr = *ll;
+    int N = gru->hidden_size;
+    float input[MAX_NEURONS], state[MAX_NEURONS], state_bsr[MAX_NEURONS];
+    float out[MAX_NEURONS], out_bsr[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS], state_bsr_S16[MAX_NEURONS];
+    int16_t out_S16[MAX_NEURONS], out_bsr_S16[MAX_NEURONS];
+    int i, num_tiles, mismatches = 0;
+    float mse_gru, mse_lin;
+
+    memcpy(Wi_pruned, gru->input_weights, 3 * N * gru->input_size * sizeof(nnWeight));
+    memcpy(Wh_pruned, gru->recurrent_weights, 3 * N * N * sizeof(nnWeight));
+    memcpy(Wl_pruned, ll->weights, ll->hidden_size * ll->input_size * sizeof(nnWeight));
+    pruneWeightsBlocks4x16(Wi_pruned, 3*N, gru->input_size, 0.6f);
+    pruneWeightsBlocks4x16(Wh_pruned, 3*N, N, 0.6f);
+    pruneWeightsBlocks4x16(Wl_pruned, ll->hidden_size, ll->input_size, 0.6f);
+    num_tiles  = packWeightsBSR4x16(Wi_bsr, Wi_index, Wi_pruned, 3*N, gru->input_size);
+    num_tiles += packWeightsBSR4x16(Wh_bsr, Wh_index, Wh_pruned, 3*N, N);
+    num_tiles += packWeightsBSR4x16(Wl_bsr, Wl_index, Wl_pruned, ll->hidden_size, ll->input_size);
+
+    gru_pruned.input_weights = Wi_pruned;
+    gru_pruned.recurrent_weights = Wh_pruned;
+    ll_pruned.weights = Wl_pruned;
+    gru_bsr.input_weights = Wi_bsr;
+    gru_bsr.input_weights_index = Wi_index;
+    gru_bsr.recurrent_weights = Wh_bsr;
+    gru_bsr.recurrent_weights_index = Wh_index;
+    gru_bsr.layout = WEIGHTS_LAYOUT_BSR4x16;
+    ll_bsr.weights = Wl_bsr;
+    ll_bsr.weights_index = Wl_index;
+    ll_bsr.layout = WEIGHTS_LAYOUT_BSR4x16;
+
+    gen_randvec(input, gru->input_size, 15);
+    gen_randvec(state, N, 15);
+    convert_F32toS16(input, input_S16, gru->input_size, 15);
+    convert_F32toS16(state, state_S16, N, 15);
+    memcpy(state_bsr, state, N * sizeof(float));
+    memcpy(state_bsr_S16, state_S16, N * sizeof(int16_t));
+
+    computeGRULayer_S16(&gru_pruned, state_S16, input_S16, 9, 1, 15, 7);
+    computeGRULayer_S16(&gru_bsr, state_bsr_S16, input_S16, 9, 1, 15, 7);
+    computeGRULayer(&gru_pruned, state, input);
+    computeGRULayer(&gru_bsr, state_bsr, input);
+    for (i=0; i<N; i++)
+        mismatches += state_S16[i] != state_bsr_S16[i];
+    mse_gru = check_vectors(state_bsr, state, N);
+
+    computeLinearLayer_S16(&ll_pruned, out_S16, state_S16, 15, 7);
+    computeLinearLayer_S16(&ll_bsr, out_bsr_S16, state_S16, 15, 7);
+    computeLinearLayer(&ll_pruned, out, state);
+    computeLinearLayer(&ll_bsr, out_bsr, state);
+    for (i=0; i<ll->hidden_size; i++)
+        mismatches += out_S16[i] != out_bsr_S16[i];
+    mse_lin = check_vectors(out_bsr, out, ll->hidden_size);
+
+#if JMPNN_USE_X86_DISPATCH
+    if (JMPNN_cpu_has_avx2())
+    {
+        // Odd shape so that the partial last column block of the AVX2 kernel is exercised
+        int32_t out_S32_ref[MAX_NEURONS], out_S32_avx2[MAX_NEURONS];
+        int rows = MAX_NEURONS - 5, cols = gru->input_size - 9;
+        packWeightsBSR4x16(Wi_bsr, Wi_index, Wi_pruned, rows, cols);
+        JMPNN_linear_matXvec_S8xS16_S32_bsr_generic(Wi_bsr, Wi_index, input_S16, gru->bias, out_S32_ref,
+                                                    cols, rows, 9, 1);
+        JMPNN_linear_matXvec_S8xS16_S32_bsr_avx2(Wi_bsr, Wi_index, input_S16, gru->bias, out_S32_avx2,
+                                                 cols, rows, 9, 1);
+        for (i=0; i<rows; i++)
+            mismatches += out_S32_ref[i] != out_S32_avx2[i];
+    }
+#endif
+
+    printf("BSR4x16 (%d tiles) mismatches (S16) = %d MSE (F32): gru = %e linear = %e\n",
+           num_tiles, mismatches, mse_gru, mse_lin);
+}
+
+// Delta layers: bit-exact with the dense S16 layers at zero thresholds over a slowly
+// varying sequence (with a few full-scale jumps); skipped fraction and error otherwise
+void NNLAYERS_DELTA_TEST(void)
+{
+    static DeltaGRUState_S16 ds;
+    static DeltaLinearState_S16 dls;
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    DeltaGRULayer dgru;
+    DeltaLinearLayer dll;
+    int N = gru->hidden_size;
+    float tmp[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS], state_delta_S16[MAX_NEURONS];
+    int16_t out_S16[MAX_NEURONS], out_delta_S16[MAX_NEURONS];
+    int thresholds[2][2] = {{0, 0}, {16, 128}};
+    int i, t, p, mismatches = 0;
+    int maxdiff = 0;
+    float skip = 0.0f;
+
+    if (createDeltaGRULayer(&dgru, gru) != 0 || createDeltaLinearLayer(&dll, ll) != 0)
+    {
+        printf("DELTA: allocation failed\n");
+        return;
+    }
+    for (p = 0; p < 2; p++)
+    {
+        srand(1);
+        gen_randvec(tmp, gru->input_size, 15);
+        convert_F32toS16(tmp, input_S16, gru->input_size, 15);
+        memset(state_S16, 0, sizeof(state_S16));
+        memset(state_delta_S16, 0, sizeof(state_delta_S16));
+        resetDeltaGRUState_S16(&ds);
+        resetDeltaLinearState_S16(&dls);
+        for (t = 0; t < 16; t++)
+        {
+            gen_randvec(tmp, gru->input_size, 15);
+            for (i = 0; i < gru->input_size; i++)
+                input_S16[i] = (int16_t)MAX(-32768, MIN(32767, input_S16[i] + (int32_t)(tmp[i] * 256)));
+            if (t == 5)
+                input_S16[3] = -32768;
+            if (t == 6)
+                input_S16[3] = 32767;   // delta of 65535
+            computeGRULayer_S16(gru, state_S16, input_S16, 9, 1, 15, 7);
+            computeLinearLayer_S16(ll, out_S16, state_S16, 15, 7);
+            computeDeltaGRULayer_S16(&dgru, &ds, state_delta_S16, input_S16, thresholds[p][0], thresholds[p][1], 9, 1, 15, 7);
+            computeDeltaLinearLayer_S16(&dll, &dls, out_delta_S16, state_delta_S16, thresholds[p][1], 15, 7);
+            for (i = 0; i < ll->hidden_size; i++)
+            {
+                if (p == 0)
+                    mismatches += out_S16[i] != out_delta_S16[i];
+                else
+                    maxdiff = MAX(maxdiff, abs(out_S16[i] - out_delta_S16[i]));
+            }
+        }
+        if (p == 0)
+            for (i = 0; i < N; i++)
+                mismatches += state_S16[i] != state_delta_S16[i];
+    }
+    skip = 1.0f - (float)(ds.cols_applied + dls.cols_applied) / (ds.cols_total + dls.cols_total);
+
+#if JMPNN_USE_X86_DISPATCH
+    if (JMPNN_cpu_has_avx2())
+    {
+        // Odd shape: an odd number of columns (padded last pair) and the 8-row and scalar row tails
+        static nnWeight Wt[MAX_NEURONS * JMPNN_COLPAIR_COLS(MAX_NEURONS)];
+        int16_t ref_generic[MAX_NEURONS], ref_avx2[MAX_NEURONS];
+        int32_t acc_generic[MAX_NEURONS], acc_avx2[MAX_NEURONS];
+        int32_t out_S32_generic[MAX_NEURONS], out_S32_avx2[MAX_NEURONS];
+        int rows = MAX_NEURONS - 5, cols = gru->input_size - 9;
+        int n_generic, n_avx2;
+
+        packWeightsColumnPairs(Wt, gru->input_weights, rows, cols);
+        gen_randvec(tmp, cols, 15);
+        convert_F32toS16(tmp, ref_generic, cols, 15);
+        ref_generic[0] = -32768;
+        input_S16[0] = 32767;
+        ref_generic[cols - 1] = 32767;
+        input_S16[cols - 1] = -32768;
+        memcpy(ref_avx2, ref_generic, cols * sizeof(int16_t));
+        for (i = 0; i < rows; i++)
+            acc_generic[i] = acc_avx2[i] = i * 1000;
+        n_generic = JMPNN_linear_matXvec_delta_S8xS16_S32_generic(Wt, input_S16, ref_generic, acc_generic, gru->bias, out_S32_generic,
+                                                                  cols, rows, 100, 9, 1);
+        n_avx2 = JMPNN_linear_matXvec_delta_S8xS16_S32_avx2(Wt, input_S16, ref_avx2, acc_avx2, gru->bias, out_S32_avx2,
+                                                            cols, rows, 100, 9, 1);
+        mismatches += n_generic != n_avx2;
+        for (i = 0; i < rows; i++)
+            mismatches += (acc_generic[i] != acc_avx2[i]) + (out_S32_generic[i] != out_S32_avx2[i]);
+        for (i = 0; i < cols; i++)
+            mismatches += ref_generic[i] != ref_avx2[i];
+    }
+#endif
+
+    destroyDeltaGRULayer(&dgru);
+    destroyDeltaLinearLayer(&dll);
+    printf("DELTA mismatches (S16, thresholds 0) = %d; thresholds %d/%d: skipped %.1f%% of columns, max output error = %d LSB\n",
+           mismatches, thresholds[1][0], thresholds[1][1], 100.0f * skip, maxdiff);
+}
+
+// The fused GRU cell must match the gate-by-gate sequence (bit-exact for S16)
+void NNLIB_GRU_CELL_TEST(void)
+{
+    const GRULayer *gru = ss_model.gru1_gru;
+    int Ni = gru->hidden_size * gru->input_size;
+    int Nh = gru->hidden_size * gru->hidden_size;
+    int N = gru->hidden_size;
+    float input[MAX_NEURONS], state[MAX_NEURONS], state_ref[MAX_NEURONS];
+    float r[MAX_NEURONS], z[MAX_NEURONS], h[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS], state_ref_S16[MAX_NEURONS];
+    int16_t r_S16[MAX_NEURONS], z_S16[MAX_NEURONS], h_S16[MAX_NEURONS];
+    int i, mismatches = 0;
+    float mse;
+
+    gen_randvec(input, gru->input_size, 15);
+    gen_randvec(state, gru->hidden_size, 15);
+    convert_F32toS16(input, input_S16, gru->input_size, 15);
+    convert_F32toS16(state, state_S16, gru->hidden_size, 15);
+    memcpy(state_ref, state, N * sizeof(float));
+    memcpy(state_ref_S16, state_S16, N * sizeof(int16_t));
+
+    JMPNN_gru_matXvec_S8xS16_S16_act_generic(gru->input_weights, input_S16, gru->bias,
+                                             gru->recurrent_weights, state_ref_S16, gru->recurrent_bias,
+                                             r_S16, gru->input_size, N, 9, 1, 15, 7, ACTIVATION_SIGMOID);
+    JMPNN_gru_matXvec_S8xS16_S16_act_generic(&gru->input_weights[Ni], input_S16, &gru->bias[N],
+                                             &gru->recurrent_weights[Nh], state_ref_S16, &gru->recurrent_bias[N],
+                                             z_S16, gru->input_size, N, 9, 1, 15, 7, ACTIVATION_SIGMOID);
+    JMPNN_gru_newGate_S8xS16_S16_act_generic(&gru->input_weights[2*Ni], input_S16, &gru->bias[2*N],
+                                             &gru->recurrent_weights[2*Nh], state_ref_S16, &gru->recurrent_bias[2*N], r_S16,
+                                             h_S16, gru->input_size, N, 9, 1, 15, 7, gru->activation);
+    JMPNN_vec_interpolation_S16_generic(state_ref_S16, z_S16, state_ref_S16, h_S16, N);
+
+    JMPNN_gru_cell_S8xS16_S16(gru->input_weights, input_S16, gru->bias,
+                              gru->recurrent_weights, state_S16, gru->recurrent_bias,
+                              gru->input_size, N, 9, 1, 15, 7, gru->activation);
+    for (i=0; i<N; i++)
+        mismatches += state_ref_S16[i] != state_S16[i];
+
+    JMPNN_gru_matXvec_S8xF32_F32_act_generic(gru->input_weights, input, gru->bias,
+                                             gru->recurrent_weights, state_ref, gru->recurrent_bias,
+                                             r, gru->input_size, N, WEIGHTS_SCALE, BIAS_SCALE, ACTIVATION_SIGMOID);
+    JMPNN_gru_matXvec_S8xF32_F32_act_generic(&gru->input_weights[Ni], input, &gru->bias[N],
+                                             &gru->recurrent_weights[Nh], state_ref, &gru->recurrent_bias[N],
+                                             z, gru->input_size, N, WEIGHTS_SCALE, BIAS_SCALE, ACTIVATION_SIGMOID);
+    JMPNN_gru_newGate_S8xF32_F32_act_generic(&gru->input_weights[2*Ni], input, &gru->bias[2*N],
+                                             &gru->recurrent_weights[2*Nh], state_ref, &gru->recurrent_bias[2*N], r,
+                                             h, gru->input_size, N, WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+    JMPNN_vec_interpolation_F32_generic(state_ref, z, state_ref, h, N);
+
+    JMPNN_gru_cell_S8xF32_F32(gru->input_weights, input, gru->bias,
+                              gru->recurrent_weights, state, gru->recurrent_bias,
+                              gru->input_size, N, WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+    mse = check_vectors(state, state_ref, N);
+    printf("GRU CELL mismatches (S16) = %d MSE (F32) = %e\n", mismatches, mse);
+}
+
+// Batched layers must match per-stream calls bit-exactly, including a partial last chunk
+#define NNTEST_BATCH_STREAMS (JMPNN_MAX_BATCH + 3)
+void NNLAYERS_BATCH_TEST(void)
+{
+    static int16_t input_S16[NNTEST_BATCH_STREAMS * MAX_NEURONS];
+    static int16_t state_S16[NNTEST_BATCH_STREAMS * MAX_NEURONS], state_ref_S16[NNTEST_BATCH_STREAMS * MAX_NEURONS];
+    static int16_t out_S16[NNTEST_BATCH_STREAMS * MAX_NEURONS], out_ref_S16[NNTEST_BATCH_STREAMS * MAX_NEURONS];
+    static int16_t state_gen_S16[NNTEST_BATCH_STREAMS * MAX_NEURONS];
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    int N = gru->hidden_size;
+    float tmp[MAX_NEURONS];
+    int i, k, mismatches = 0;
+
+    for (k=0; k<NNTEST_BATCH_STREAMS; k++)
+    {
+        gen_randvec(tmp, gru->input_size, 15);
+        convert_F32toS16(tmp, &input_S16[k * MAX_NEURONS], gru->input_size, 15);
+        gen_randvec(tmp, N, 15);
+        convert_F32toS16(tmp, &state_S16[k * MAX_NEURONS], N, 15);
+    }
+    memcpy(state_ref_S16, state_S16, sizeof(state_S16));
+    memcpy(state_gen_S16, state_S16, sizeof(state_S16));
+
+    for (k=0; k<NNTEST_BATCH_STREAMS; k++)
+        computeGRULayer_S16(gru, &state_ref_S16[k * MAX_NEURONS], &input_S16[k * MAX_NEURONS], 9, 1, 15, 7);
+    computeGRULayerBatch_S16(gru, state_S16, MAX_NEURONS, input_S16, MAX_NEURONS, NNTEST_BATCH_STREAMS, 9, 1, 15, 7);
+    JMPNN_gru_cell_batch_S8xS16_S16_generic(gru->input_weights, input_S16, gru->bias,
+                                            gru->recurrent_weights, state_gen_S16, gru->recurrent_bias,
+                                            gru->input_size, N, NNTEST_BATCH_STREAMS, MAX_NEURONS, MAX_NEURONS,
+                                            9, 1, 15, 7, gru->activation);
+    for (k=0; k<NNTEST_BATCH_STREAMS; k++)
+        for (i=0; i<N; i++)
+        {
+            mismatches += state_S16[k * MAX_NEURONS + i] != state_ref_S16[k * MAX_NEURONS + i];
+            mismatches += state_gen_S16[k * MAX_NEURONS + i] != state_ref_S16[k * MAX_NEURONS + i];
+        }
+
+    for (k=0; k<NNTEST_BATCH_STREAMS; k++)
+        computeLinearLayer_S16(ll, &out_ref_S16[k * MAX_NEURONS], &state_ref_S16[k * MAX_NEURONS], 15, 7);
+    computeLinearLayerBatch_S16(ll, out_S16, MAX_NEURONS, state_ref_S16, MAX_NEURONS, NNTEST_BATCH_STREAMS, 15, 7);
+    for (k=0; k<NNTEST_BATCH_STREAMS; k++)
+        for (i=0; i<ll->hidden_size; i++)
+            mismatches += out_S16[k * MAX_NEURONS + i] != out_ref_S16[k * MAX_NEURONS + i];
+
+    printf("BATCH (%d streams) mismatches (S16) = %d\n", NNTEST_BATCH_STREAMS, mismatches);
+}
+
+// The sequence (offline) GRU must match frame-by-frame calls bit-exactly, including a partial last block
+#define NNTEST_SEQ_FRAMES (2 * JMPNN_SEQ_BLOCK + 5)
+void NNLAYERS_SEQ_TEST(void)
+{
+    static int16_t input_S16[NNTEST_SEQ_FRAMES * MAX_NEURONS];
+    static int16_t out_S16[NNTEST_SEQ_FRAMES * MAX_NEURONS], out_gen_S16[NNTEST_SEQ_FRAMES * MAX_NEURONS];
+    const GRULayer *gru = ss_model.gru1_gru;
+    int N = gru->hidden_size;
+    float tmp[MAX_NEURONS];
+    int16_t state_S16[MAX_NEURONS], state_ref_S16[MAX_NEURONS], state_gen_S16[MAX_NEURONS];
+    int i, t, mismatches = 0;
+
+    for (t=0; t<NNTEST_SEQ_FRAMES; t++)
+    {
+        gen_randvec(tmp, gru->input_size, 15);
+        convert_F32toS16(tmp, &input_S16[t * MAX_NEURONS], gru->input_size, 15);
+    }
+    gen_randvec(tmp, N, 15);
+    convert_F32toS16(tmp, state_S16, N, 15);
+    memcpy(state_ref_S16, state_S16, N * sizeof(int16_t));
+    memcpy(state_gen_S16, state_S16, N * sizeof(int16_t));
+
+    computeGRULayerSeq_S16(gru, state_S16, out_S16, MAX_NEURONS, input_S16, MAX_NEURONS, NNTEST_SEQ_FRAMES, 9, 1, 15, 7);
+    JMPNN_gru_seq_S8xS16_S16_generic(gru->input_weights, input_S16, gru->bias,
+                                     gru->recurrent_weights, state_gen_S16, gru->recurrent_bias, out_gen_S16,
+                                     gru->input_size, N, NNTEST_SEQ_FRAMES, MAX_NEURONS, MAX_NEURONS,
+                                     9, 1, 15, 7, gru->activation);
+    for (t=0; t<NNTEST_SEQ_FRAMES; t++)
+    {
+        computeGRULayer_S16(gru, state_ref_S16, &input_S16[t * MAX_NEURONS], 9, 1, 15, 7);
+        for (i=0; i<N; i++)
+        {
+            mismatches += out_S16[t * MAX_NEURONS + i] != state_ref_S16[i];
+            mismatches += out_gen_S16[t * MAX_NEURONS + i] != state_ref_S16[i];
+        }
+    }
+    for (i=0; i<N; i++)
+        mismatches += (state_S16[i] != state_ref_S16[i]) + (state_gen_S16[i] != state_ref_S16[i]);
+
+    printf("SEQ (%d frames) mismatches (S16) = %d\n", NNTEST_SEQ_FRAMES, mismatches);
+}
+
+// GRU layers split across a team must match the serial layers bit-exactly (S16 and float),
+// as must the generic gates kernels over unit ranges and the generic fused cells
+#define NNTEST_TEAM_THREADS 3
+#define NNTEST_TEAM_FRAMES 20
+void NNLAYERS_TEAM_TEST(void)
+{
+    const GRULayer *grus[3] = { ss_model.gru1_gru, ss_model.gru2_gru, ss_model.gru3_gru };
+    NNTeam *team;
+    float tmp[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS], state_ref_S16[MAX_NEURONS], state_gen_S16[MAX_NEURONS];
+    int16_t z_S16[MAX_NEURONS], n_S16[MAX_NEURONS];
+    float input[MAX_NEURONS], state[MAX_NEURONS], state_ref[MAX_NEURONS], state_gen[MAX_NEURONS], state_fused[MAX_NEURONS];
+    float z[MAX_NEURONS], n[MAX_NEURONS];
+    int i, l, t, k, begin, end, mismatches = 0, mismatches_F32 = 0;
+
+    if (createNNTeam(&team, NNTEST_TEAM_THREADS, NULL))
+    {
+        printf("TEAM create failed\n");
+        return;
+    }
+    for (l=0; l<3; l++)
+    {
+        const GRULayer *gru = grus[l];
+        int N = gru->hidden_size;
+
+        gen_randvec(tmp, N, 15);
+        convert_F32toS16(tmp, state_S16, N, 15);
+        memcpy(state_ref_S16, state_S16, N * sizeof(int16_t));
+        memcpy(state_gen_S16, state_S16, N * sizeof(int16_t));
+        gen_randvec(state, N, 15);
+        memcpy(state_ref, state, N * sizeof(float));
+        memcpy(state_gen, state, N * sizeof(float));
+        memcpy(state_fused, state, N * sizeof(float));
+        for (t=0; t<NNTEST_TEAM_FRAMES; t++)
+        {
+            gen_randvec(input, gru->input_size, 15);
+            convert_F32toS16(input, input_S16, gru->input_size, 15);
+
+            setNNLayerTeam(team);
+            computeGRULayer_S16(gru, state_S16, input_S16, 9, 1, 15, 7);
+            computeGRULayer(gru, state, input);
+            setNNLayerTeam(NULL);
+            computeGRULayer_S16(gru, state_ref_S16, input_S16, 9, 1, 15, 7);
+            computeGRULayer(gru, state_ref, input);
+
+            for (k=0; k<NNTEST_TEAM_THREADS; k++)
+            {
+                getNNTeamRange(N, k, NNTEST_TEAM_THREADS, &begin, &end);
+                JMPNN_gru_gates_S8xS16_S16_generic(gru->input_weights, input_S16, gru->bias,
+                                                   gru->recurrent_weights, state_gen_S16, gru->recurrent_bias, z_S16, n_S16,
+                                                   gru->input_size, N, begin, end, 9, 1, 15, 7, gru->activation);
+                JMPNN_gru_gates_S8xF32_F32_generic(gru->input_weights, input, gru->bias,
+                                                   gru->recurrent_weights, state_gen, gru->recurrent_bias, z, n,
+                                                   gru->input_size, N, begin, end, WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+            }
+            JMPNN_vec_interpolation_S16_generic(state_gen_S16, z_S16, state_gen_S16, n_S16, N);
+            JMPNN_vec_interpolation_F32_generic(state_gen, z, state_gen, n, N);
+            JMPNN_gru_cell_S8xF32_F32_generic(gru->input_weights, input, gru->bias,
+                                              gru->recurrent_weights, state_fused, gru->recurrent_bias,
+                                              gru->input_size, N, WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+
+            for (i=0; i<N; i++)
+            {
+                mismatches += (state_S16[i] != state_ref_S16[i]) + (state_gen_S16[i] != state_ref_S16[i]);
+                mismatches_F32 += (state[i] != state_ref[i]) + (state_gen[i] != state_fused[i]);
+            }
+        }
+    }
+    destroyNNTeam(team);
+
+    printf("TEAM (%d threads) mismatches: S16 = %d, F32 = %d\n", NNTEST_TEAM_THREADS, mismatches, mismatches_F32);
+}
+
+// Two SignalSifter states interleaved through the layer pipeline, SSPIPE_DEPTH frames in
+// flight, against computeSignalSifterModel_S16 frame by frame (bit-exact gains and states)
+#define NNTEST_PIPE_FRAMES 40
+void NNLAYERS_PIPELINE_TEST(void)
+{
+    static int16_t input_S16[NNTEST_PIPE_FRAMES][2][MAX_NEURONS];
+    static SignalSifterState_S16 ss[2], ss_ref[2];
+    SignalSifterPipeline_S16 *pipe;
+    float tmp[MAX_NEURONS];
+    int16_t gains[MAX_NEURONS], gains_ref[MAX_NEURONS];
+    int i, k, t, s, n = ss_model.linear1_hidden_size, mismatches = 0;
+
+    if (createSignalSifterPipeline_S16(&pipe, NULL))
+    {
+        printf("PIPELINE create failed\n");
+        return;
+    }
+    for (k=0; k<2; k++)
+    {
+        createSignalSifterModel_S16(&ss[k]);
+        createSignalSifterModel_S16(&ss_ref[k]);
+    }
+    for (t=0; t<NNTEST_PIPE_FRAMES; t++)
+        for (k=0; k<2; k++)
+        {
+            gen_randvec(tmp, ss_model.gru1_gru->input_size, 15);
+            convert_F32toS16(tmp, input_S16[t][k], ss_model.gru1_gru->input_size, 9);
+        }
+    // frame t of both states goes in, then the gains of t - SSPIPE_DEPTH/2 (two vectors a frame) come out
+    for (t=0; t<NNTEST_PIPE_FRAMES + SSPIPE_DEPTH / 2; t++)
+    {
+        if (t < NNTEST_PIPE_FRAMES)
+            for (k=0; k<2; k++)
+                pushSignalSifterPipeline_S16(pipe, &ss[k], input_S16[t][k]);
+        s = t - SSPIPE_DEPTH / 2;
+        if (s < 0)
+            continue;
+        for (k=0; k<2; k++)
+        {
+            popSignalSifterPipeline_S16(pipe, gains);
+            computeSignalSifterModel_S16(&ss_ref[k], gains_ref, input_S16[s][k]);
+            for (i=0; i<n; i++)
+                mismatches += gains[i] != gains_ref[i];
+        }
+    }
+    for (k=0; k<2; k++)
+        for (i=0; i<ss_model.gru3_hidden_size; i++)
+            mismatches += (ss[k].gru1_gru_state[i] != ss_ref[k].gru1_gru_state[i]) +
+                          (ss[k].gru2_gru_state[i] != ss_ref[k].gru2_gru_state[i]) +
+                          (ss[k].gru3_gru_state[i] != ss_ref[k].gru3_gru_state[i]);
+    destroySignalSifterPipeline_S16(pipe);
+
+    printf("PIPELINE (%d stages, 2 states x %d frames) mismatches (S16) = %d\n", SSPIPE_STAGES, NNTEST_PIPE_FRAMES, mismatches);
+}
+
+// Int8-activation GRU layer against the S16 one on the same (int8-representable) input
+void NNLAYERS_S8_TEST(void)
+{
+    const GRULayer *gru = ss_model.gru1_gru;
+    int N = gru->hidden_size;
+    float input[MAX_NEURONS], state[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS];
+    int8_t input_S8[MAX_NEURONS], state_S8[MAX_NEURONS];
+    int i;
+    float mse;
+
+    gen_randvec(input, gru->input_size, 7);
+    gen_randvec(state, N, 7);
+    convert_F32toS8_Q(input, input_S8, gru->input_size, 7);
+    convert_F32toS8_Q(state, state_S8, N, 7);
+    for (i=0; i<gru->input_size; i++)
+        input_S16[i] = input_S8[i] << 8;
+    for (i=0; i<N; i++)
+        state_S16[i] = state_S8[i] << 8;
+
+    computeGRULayer_S16(gru, state_S16, input_S16, 15, 7, 15, 7);
+    computeGRULayer_S8(gru, state_S8, input_S8, 7, 7);
+    convert_S16toF32(state_S16, state, N, 15);
+    mse = check_vec_S8(state_S8, state, N, 7);
+    printf("GRU S8 vs S16 MSE = %e %s\n", mse, check_mse(mse) ? "PASS" : "FAIL");
+}
+
+#if JMPNN_USE_X86_DISPATCH
+// The AVX2 kernels must be bit-exact with the generic ones
+void NNLIB_AVX2_BITEXACT_TEST(void)
+{
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    int Ni = gru->hidden_size * gru->input_size;
+    int Nh = gru->hidden_size * gru->hidden_size;
+    int N = gru->hidden_size;
+    float input[MAX_NEURONS], state[MAX_NEURONS], r[MAX_NEURONS];
+    int16_t input_S16[MAX_NEURONS], state_S16[MAX_NEURONS], r_S16[MAX_NEURONS];
+    int16_t out_ref[MAX_NEURONS], out_avx2[MAX_NEURONS];
+    int32_t out_S32_ref[MAX_NEURONS], out_S32_avx2[MAX_NEURONS];
+    int32_t act_in[NUM_PTS * 8];
+    int16_t act_ref[NUM_PTS * 8], act_avx2[NUM_PTS * 8];
+    int i, act, mismatches = 0;
+
+    if (!JMPNN_cpu_has_avx2())
+    {
+        printf("AVX2 BITEXACT: skipped (no AVX2)\n");
+        return;
+    }
+
+    gen_randvec(input, gru->input_size, 15);
+    gen_randvec(state, gru->hidden_size, 15);
+    gen_randvec(r, gru->hidden_size, 15);
+    convert_F32toS16(input, input_S16, gru->input_size, 15);
+    convert_F32toS16(state, state_S16, gru->hidden_size, 15);
+    convert_F32toS16(r, r_S16, gru->hidden_size, 15);
+
+    JMPNN_linear_matXvec_S8xS16_S32_generic(ll->weights, state_S16, ll->bias, out_S32_ref,
+                                            ll->input_size, ll->hidden_size, 15, 7);
+    JMPNN_linear_matXvec_S8xS16_S32_avx2(ll->weights, state_S16, ll->bias, out_S32_avx2,
+                                         ll->input_size, ll->hidden_size, 15, 7);
+    for (i=0; i<ll->hidden_size; i++)
+        mismatches += out_S32_ref[i] != out_S32_avx2[i];
+
+    JMPNN_gru_matXvec_S8xS16_S16_act_generic(gru->input_weights, input_S16, gru->bias,
+                                             gru->recurrent_weights, state_S16, gru->recurrent_bias,
+                                             out_ref, gru->input_size, gru->hidden_size,
+                                             9, 1, 15, 7, ACTIVATION_SIGMOID);
+    JMPNN_gru_matXvec_S8xS16_S16_act_avx2(gru->input_weights, input_S16, gru->bias,
+                                          gru->recurrent_weights, state_S16, gru->recurrent_bias,
+                                          out_avx2, gru->input_size, gru->hidden_size,
+                                          9, 1, 15, 7, ACTIVATION_SIGMOID);
+    for (i=0; i<N; i++)
+        mismatches += out_ref[i] != out_avx2[i];
+
+    JMPNN_gru_newGate_S8xS16_S16_act_generic(&gru->input_weights[2*Ni], input_S16, &gru->bias[2*N],
+                                             &gru->recurrent_weights[2*Nh], state_S16, &gru->recurrent_bias[2*N], r_S16,
+                                             out_ref, gru->input_size, gru->hidden_size,
+                                             9, 1, 15, 7, gru->activation);
+    JMPNN_gru_newGate_S8xS16_S16_act_avx2(&gru->input_weights[2*Ni], input_S16, &gru->bias[2*N],
+                                          &gru->recurrent_weights[2*Nh], state_S16, &gru->recurrent_bias[2*N], r_S16,
+                                          out_avx2, gru->input_size, gru->hidden_size,
+                                          9, 1, 15, 7, gru->activation);
+    for (i=0; i<N; i++)
+        mismatches += out_ref[i] != out_avx2[i];
+
+    JMPNN_vec_interpolation_S16_generic(out_ref, r_S16, input_S16, state_S16, N);
+    JMPNN_vec_interpolation_S16_avx2(out_avx2, r_S16, input_S16, state_S16, N);
+    for (i=0; i<N; i++)
+        mismatches += out_ref[i] != out_avx2[i];
+
+    memcpy(out_ref, state_S16, N * sizeof(int16_t));
+    memcpy(out_avx2, state_S16, N * sizeof(int16_t));
+    JMPNN_gru_cell_S8xS16_S16_generic(gru->input_weights, input_S16, gru->bias,
+                                      gru->recurrent_weights, out_ref, gru->recurrent_bias,
+                                      gru->input_size, gru->hidden_size, 9, 1, 15, 7, gru->activation);
+    JMPNN_gru_cell_S8xS16_S16_avx2(gru->input_weights, input_S16, gru->bias,
+                                   gru->recurrent_weights, out_avx2, gru->recurrent_bias,
+                                   gru->input_size, gru->hidden_size, 9, 1, 15, 7, gru->activation);
+    for (i=0; i<N; i++)
+        mismatches += out_ref[i] != out_avx2[i];
+
+    // Int8-activation kernels (AVX-VNNI inner loop when the CPU has it), extremes included
+    {
+        int8_t input_S8[MAX_NEURONS], state_ref_S8[MAX_NEURONS], state_avx2_S8[MAX_NEURONS];
+        JMPNN_select_kernels_S16();
+        convert_F32toS8_Q(input, input_S8, gru->input_size, 7);
+        convert_F32toS8_Q(state, state_ref_S8, N, 7);
+        input_S8[0] = -127;
+        input_S8[1] = 127;
+        memcpy(state_avx2_S8, state_ref_S8, N);
+        JMPNN_linear_matXvec_S8xS8_S32_generic(ll->weights, state_ref_S8, ll->bias, out_S32_ref,
+                                               ll->input_size, ll->hidden_size, 7);
+        JMPNN_linear_matXvec_S8xS8_S32_avx2(ll->weights, state_ref_S8, ll->bias, out_S32_avx2,
+                                            ll->input_size, ll->hidden_size, 7);
+        for (i=0; i<ll->hidden_size; i++)
+            mismatches += out_S32_ref[i] != out_S32_avx2[i];
+        JMPNN_gru_cell_S8xS8_S8_generic(gru->input_weights, input_S8, gru->bias,
+                                        gru->recurrent_weights, state_ref_S8, gru->recurrent_bias,
+                                        gru->input_size, N, 7, 7, gru->activation);
+        JMPNN_gru_cell_S8xS8_S8_avx2(gru->input_weights, input_S8, gru->bias,
+                                     gru->recurrent_weights, state_avx2_S8, gru->recurrent_bias,
+                                     gru->input_size, N, 7, 7, gru->activation);
+        for (i=0; i<N; i++)
+            mismatches += state_ref_S8[i] != state_avx2_S8[i];
+    }
+
+    // Activations over the whole Q3.15 (SLIMIT 19-bit) range, odd length for the scalar tail
+    for (i=0; i<NUM_PTS * 8; i++)
+        act_in[i] = (i * 521) % (1 << 19) - (1 << 18);
+    for (act=ACTIVATION_TANH; act<=ACTIVATION_RELU; act++)
+    {
+        JMPNN_apply_activation_S16_generic(act_ref, act_in, NUM_PTS * 8 - 3, act);
+        JMPNN_apply_activation_S16_avx2(act_avx2, act_in, NUM_PTS * 8 - 3, act);
+        for (i=0; i<NUM_PTS * 8 - 3; i++)
+            mismatches += act_ref[i] != act_avx2[i];
+    }
+    printf("AVX2 BITEXACT mismatches = %d\n", mismatches);
+}
+
+// The AVX2+FMA kernels only differ from the generic ones by float rounding
+void NNLIB_AVX2_FLOAT_TEST(void)
+{
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    int Ni = gru->hidden_size * gru->input_size;
+    int Nh = gru->hidden_size * gru->hidden_size;
+    int N = gru->hidden_size;
+    float input[MAX_NEURONS], state[MAX_NEURONS], r[MAX_NEURONS];
+    float out_ref[MAX_NEURONS], out_avx2[MAX_NEURONS];
+    float act_ref[NUM_PTS], act_avx2[NUM_PTS];
+    float mse_lin, mse_gate, mse_new, mse_int, mse_cell, mse_act = 0.0f;
+    int act;
+
+    if (!JMPNN_cpu_has_avx2_fma())
+    {
+        printf("AVX2 FLOAT: skipped (no AVX2/FMA)\n");
+        return;
+    }
+
+    gen_randvec(input, gru->input_size, 15);
+    gen_randvec(state, gru->hidden_size, 15);
+    gen_randvec(r, gru->hidden_size, 15);
+
+    JMPNN_linear_matXvec_S8xF32_F32_generic(ll->weights, state, ll->bias, out_ref,
+                                            ll->input_size, ll->hidden_size, WEIGHTS_SCALE, BIAS_SCALE);
+    JMPNN_linear_matXvec_S8xF32_F32_avx2(ll->weights, state, ll->bias, out_avx2,
+                                         ll->input_size, ll->hidden_size, WEIGHTS_SCALE, BIAS_SCALE);
+    mse_lin = check_vectors(out_avx2, out_ref, ll->hidden_size);
+
+    JMPNN_gru_matXvec_S8xF32_F32_act_generic(gru->input_weights, input, gru->bias,
+                                             gru->recurrent_weights, state, gru->recurrent_bias,
+                                             out_ref, gru->input_size, gru->hidden_size,
+                                             WEIGHTS_SCALE, BIAS_SCALE, ACTIVATION_SIGMOID);
+    JMPNN_gru_matXvec_S8xF32_F32_act_avx2(gru->input_weights, input, gru->bias,
+                                          gru->recurrent_weights, state, gru->recurrent_bias,
+                                          out_avx2, gru->input_size, gru->hidden_size,
+                                          WEIGHTS_SCALE, BIAS_SCALE, ACTIVATION_SIGMOID);
+    mse_gate = check_vectors(out_avx2, out_ref, N);
+
+    JMPNN_gru_newGate_S8xF32_F32_act_generic(&gru->input_weights[2*Ni], input, &gru->bias[2*N],
+                                             &gru->recurrent_weights[2*Nh], state, &gru->recurrent_bias[2*N], r,
+                                             out_ref, gru->input_size, gru->hidden_size,
+                                             WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+    JMPNN_gru_newGate_S8xF32_F32_act_avx2(&gru->input_weights[2*Ni], input, &gru->bias[2*N],
+                                          &gru->recurrent_weights[2*Nh], state, &gru->recurrent_bias[2*N], r,
+                                          out_avx2, gru->input_size, gru->hidden_size,
+                                          WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+    mse_new = check_vectors(out_avx2, out_ref, N);
+
+    JMPNN_vec_interpolation_F32_generic(out_ref, r, input, state, N);
+    JMPNN_vec_interpolation_F32_avx2(out_avx2, r, input, state, N);
+    mse_int = check_vectors(out_avx2, out_ref, N);
+
+    memcpy(out_ref, state, N * sizeof(float));
+    memcpy(out_avx2, state, N * sizeof(float));
+    JMPNN_gru_cell_S8xF32_F32_generic(gru->input_weights, input, gru->bias,
+                                      gru->recurrent_weights, out_ref, gru->recurrent_bias,
+                                      gru->input_size, gru->hidden_size, WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+    JMPNN_gru_cell_S8xF32_F32_avx2(gru->input_weights, input, gru->bias,
+                                   gru->recurrent_weights, out_avx2, gru->recurrent_bias,
+                                   gru->input_size, gru->hidden_size, WEIGHTS_SCALE, BIAS_SCALE, gru->activation);
+    mse_cell = check_vectors(out_avx2, out_ref, N);
+
+    for (act=ACTIVATION_TANH; act<=ACTIVATION_RELU; act++)
+    {
+        gen_linspace(act_ref, -10, 10, NUM_PTS - 3);
+        gen_linspace(act_avx2, -10, 10, NUM_PTS - 3);
+        JMPNN_apply_activation_F32_generic(act_ref, NUM_PTS - 3, act);
+        JMPNN_apply_activation_F32_avx2(act_avx2, NUM_PTS - 3, act);
+        mse_act += check_vectors(act_avx2, act_ref, NUM_PTS - 3);
+    }
+    printf("AVX2 FLOAT MSE: linear = %e gate = %e newgate = %e vecint = %e cell = %e act = %e\n",
+           mse_lin, mse_gate, mse_new, mse_int, mse_cell, mse_act);
+}
+#endif
+
+// Model files: the compiled-in model (and a BSR4x16 variant) written, mapped back and run
+// bit-exactly; corrupted or mismatching images must be rejected
+#define NNTEST_MODEL_FILE "nntest_model.jmpnn"
+#define NNTEST_MODEL_FRAMES 8
+static int run_model_file_frames(const SignalSifterModel *ref, const SignalSifterModel *loaded)
+{
+    SignalSifterState_S16 ss_ref, ss_loaded;
+    int16_t input_S16[MAX_NEURONS], gains_ref[MAX_NEURONS], gains_loaded[MAX_NEURONS];
+    float tmp[MAX_NEURONS];
+    int i, t, mismatches = 0;
+
+    createSignalSifterModel_S16(&ss_ref);
+    createSignalSifterModel_S16(&ss_loaded);
+    ss_ref.model = ref;
+    ss_loaded.model = loaded;
+    for (t=0; t<NNTEST_MODEL_FRAMES; t++)
+    {
+        gen_randvec(tmp, IO_SIZE, 15);
+        for (i=0; i<IO_SIZE; i++)
+            tmp[i] *= 8.0f;
+        convert_F32toS16(tmp, input_S16, IO_SIZE, INPUT_NUM_FRAC_BITS);
+        computeSignalSifterModel_S16(&ss_ref, gains_ref, input_S16);
+        computeSignalSifterModel_S16(&ss_loaded, gains_loaded, input_S16);
+        for (i=0; i<IO_SIZE; i++)
+            mismatches += gains_ref[i] != gains_loaded[i];
+    }
+    return mismatches;
+}
+
+void NNMODEL_FILE_TEST(void)
+{
+    static nnWeight Wi_bsr[3*MAX_NEURONS*MAX_NEURONS], Wh_bsr[3*MAX_NEURONS*MAX_NEURONS];
+    static nnWeight Wl_bsr[MAX_NEURONS*MAX_NEURONS];
+    static uint16_t Wi_index[3*MAX_NEURONS*MAX_NEURONS/64 + 3*MAX_NEURONS/4 + 1];
+    static uint16_t Wh_index[3*MAX_NEURONS*MAX_NEURONS/64 + 3*MAX_NEURONS/4 + 1];
+    static uint16_t Wl_index[MAX_NEURONS*MAX_NEURONS/64 + MAX_NEURONS/4 + 1];
+    const GRULayer *gru = ss_model.gru1_gru;
+    const LinearLayer *ll = ss_model.linear1_linear;
+    GRULayer gru_bsr = *gru;
+    LinearLayer ll_bsr = *ll;
+    SignalSifterModel model_bsr = ss_model;
+    SignalSifterModelFile mf;
+    JMPNN_ModelFileHeader *hdr;
+    JMPNN_ModelFileLayer *rec;
+    uint8_t *image;
+    size_t size;
+    FILE *f;
+    int ret, mismatches = 0, rejected = 0;
+
+    ret = writeSignalSifterModelFile(&ss_model, NNTEST_MODEL_FILE);
+    if (ret == 0)
+        ret = loadSignalSifterModelFile(&mf, NNTEST_MODEL_FILE,
+                                        JMPNN_MODEL_PREFAULT | JMPNN_MODEL_HUGEPAGES | JMPNN_MODEL_VERIFY);
+    if (ret)
+    {
+        printf("MODEL FILE: write/load failed (error %d) FAIL\n", ret);
+        return;
+    }
+    mismatches += run_model_file_frames(&ss_model, &mf.model);
+    size = mf.size;
+    unloadSignalSifterModelFile(&mf);
+
+    // Corrupt copies of the image, checked in memory
+    image = (uint8_t *) malloc(size);
+    f = fopen(NNTEST_MODEL_FILE, "rb");
+    fread(image, 1, size, f);
+    fclose(f);
+    hdr = (JMPNN_ModelFileHeader *) image;
+    rec = (JMPNN_ModelFileLayer *) (image + sizeof(JMPNN_ModelFileHeader));
+    mismatches += openSignalSifterModelBuffer(&mf, image, size, JMPNN_MODEL_VERIFY) != 0;
+    image[size - 1] ^= 1;
+    rejected += openSignalSifterModelBuffer(&mf, image, size, JMPNN_MODEL_VERIFY) == JMPNN_MODEL_ERR_CHECKSUM;
+    image[size - 1] ^= 1;
+    hdr->gru_num_frac_bits++;
+    rejected += openSignalSifterModelBuffer(&mf, image, size, 0) == JMPNN_MODEL_ERR_CONFIG;
+    hdr->gru_num_frac_bits--;
+    // The int8 calibration only has to match in the int8 build
+    hdr->s8_frac_bits[1]++;
+#ifdef USE_INT8_SIGNALSIFTER
+    mismatches += openSignalSifterModelBuffer(&mf, image, size, 0) != JMPNN_MODEL_ERR_CONFIG;
+#else
+    mismatches += openSignalSifterModelBuffer(&mf, image, size, 0) != 0;
+#endif
+    hdr->s8_frac_bits[1]--;
+    rec[1].arrays[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS].size--;
+    rejected += openSignalSifterModelBuffer(&mf, image, size, 0) == JMPNN_MODEL_ERR_FORMAT;
+    rec[1].arrays[JMPNN_MODEL_ARRAY_RECURRENT_WEIGHTS].size++;
+    rejected += openSignalSifterModelBuffer(&mf, image, size - 1, 0) == JMPNN_MODEL_ERR_FORMAT;
+    free(image);
+
+    // Block-sparse gru1 and linear1
+    packWeightsBSR4x16(Wi_bsr, Wi_index, gru->input_weights, 3*gru->hidden_size, gru->input_size);
+    packWeightsBSR4x16(Wh_bsr, Wh_index, gru->recurrent_weights, 3*gru->hidden_size, gru->hidden_size);
+    packWeightsBSR4x16(Wl_bsr, Wl_index, ll->weights, ll->hidden_size, ll->input_size);
+    gru_bsr.input_weights = Wi_bsr;
+    gru_bsr.input_weights_index = Wi_index;
+    gru_bsr.recurrent_weights = Wh_bsr;
+    gru_bsr.recurrent_weights_index = Wh_index;
+    gru_bsr.layout = WEIGHTS_LAYOUT_BSR4x16;
+    ll_bsr.weights = Wl_bsr;
+    ll_bsr.weights_index = Wl_index;
+    ll_bsr.layout = WEIGHTS_LAYOUT_BSR4x16;
+    model_bsr.gru1_gru = &gru_bsr;
+    model_bsr.linear1_linear = &ll_bsr;
+    ret = writeSignalSifterModelFile(&model_bsr, NNTEST_MODEL_FILE);
+    if (ret == 0)
+        ret = loadSignalSifterModelFile(&mf, NNTEST_MODEL_FILE, JMPNN_MODEL_VERIFY);
+    if (ret == 0)
+    {
+        mismatches += !mf.has_model || mf.model.gru1_gru->layout != WEIGHTS_LAYOUT_BSR4x16;
+        mismatches += run_model_file_frames(&model_bsr, &mf.model);
+        unloadSignalSifterModelFile(&mf);
+    }
+    remove(NNTEST_MODEL_FILE);
+
+    printf("MODEL FILE (%zu bytes) mismatches (S16) = %d, BSR4x16 %s, corrupted images rejected = %d/4\n",
+           size, mismatches, ret ? "FAIL" : "loaded", rejected);
+}
+
+// Graph executor: the SignalSifter graph against computeSignalSifterModel[_S16], a 5-layer
+// chain (GRU, GRU, linear without activation, GRU, linear) against the layers called one
+// by one and through a model file, plus the LINEAR activation and the layer checks
+#define NNTEST_GRAPH_FRAMES 8
+static int run_graph_chain_frames(const NNGraph *g, const GRULayer *gru1, const GRULayer *gru2,
+                                  const LinearLayer *lin, const LinearLayer *ll)
+{
+    NNGraphState_S16 st;
+    int16_t *mem = (int16_t *) malloc(getNNGraphStateSize_S16(g));
+    int16_t h1[MAX_NEURONS] = {0}, h2[MAX_NEURONS] = {0}, h3[MAX_NEURONS] = {0};
+    int16_t input_S16[MAX_NEURONS], y[MAX_NEURONS], out_ref[MAX_NEURONS], out[MAX_NEURONS];
+    int32_t y_S32[MAX_NEURONS];
+    float tmp[MAX_NEURONS];
+    int i, t, mismatches = 0;
+
+    createNNGraphState_S16(&st, g, mem);
+    for (t=0; t<NNTEST_GRAPH_FRAMES; t++)
+    {
+        gen_randvec(tmp, IO_SIZE, 15);
+        for (i=0; i<IO_SIZE; i++)
+            tmp[i] *= 8.0f;
+        convert_F32toS16(tmp, input_S16, IO_SIZE, INPUT_NUM_FRAC_BITS);
+        computeGRULayer_S16(gru1, h1, input_S16, INPUT_NUM_FRAC_BITS, INPUTLAYER_SHIFT_RIGHT, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeGRULayer_S16(gru2, h2, h1, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeLinearLayerPreact_S16(lin, y_S32, h2, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        for (i=0; i<lin->hidden_size; i++)
+            y[i] = SLIMIT(y_S32[i], 16);
+        computeGRULayer_S16(gru1, h3, y, LIN_NUM_FRAC_BITS, WAB_FRAC_BITS, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeLinearLayer_S16(ll, out_ref, h3, GRU_NUM_FRAC_BITS, WAB_FRAC_BITS);
+        computeNNGraph_S16(&st, out, input_S16);
+        for (i=0; i<IO_SIZE; i++)
+            mismatches += out[i] != out_ref[i];
+    }
+    free(mem);
+    return mismatches;
+}
+
+void NNGRAPH_TEST(void)
+{
+    NNGraph g, g_chain;
+    NNGraphState_S16 st_S16;
+    NNGraphState st;
+    SignalSifterState_S16 ss_S16;
+    SignalSifterState ss;
+    SignalSifterModelFile mf;
+    LinearLayer lin = *ss_model.linear1_linear, wide = *ss_model.linear1_linear;
+    int16_t input_S16[MAX_NEURONS], gains_ref_S16[MAX_NEURONS], gains_S16[MAX_NEURONS];
+    float input[MAX_NEURONS], gains_ref[MAX_NEURONS], gains[MAX_NEURONS];
+    int32_t x_S32[NUM_PTS];
+    int16_t y_S16[NUM_PTS], y_ref_S16[NUM_PTS];
+    void *mem_S16, *mem;
+    int i, t, ret, mismatches_S16 = 0, mismatches_F32 = 0, mismatches_chain, mismatches_file = -1;
+    int mismatches_linear = 0, rejected = 0;
+
+    // SignalSifter graph, fixed point and float
+    createNNGraphFromSignalSifterModel(&g, &ss_model);
+    mem_S16 = malloc(getNNGraphStateSize_S16(&g));
+    mem = malloc(getNNGraphStateSize(&g));
+    createNNGraphState_S16(&st_S16, &g, mem_S16);
+    createNNGraphState(&st, &g, mem);
+    createSignalSifterModel_S16(&ss_S16);
+    createSignalSifterModel(&ss);
+    for (t=0; t<NNTEST_GRAPH_FRAMES; t++)
+    {
+        gen_randvec(input, IO_SIZE, 15);
+        for (i=0; i<IO_SIZE; i++)
+            input[i] *= 8.0f;
+        convert_F32toS16(input, input_S16, IO_SIZE, INPUT_NUM_FRAC_BITS);
+        computeSignalSifterModel_S16(&ss_S16, gains_ref_S16, input_S16);
+        computeNNGraph_S16(&st_S16, gains_S16, input_S16);
+        computeSignalSifterModel(&ss, gains_ref, input);
+        computeNNGraph(&st, gains, input);
+        for (i=0; i<IO_SIZE; i++)
+        {
+            mismatches_S16 += gains_S16[i] != gains_ref_S16[i];
+            mismatches_F32 += gains[i] != gains_ref[i];
+        }
+    }
+    destroySignalSifterModel(&ss);
+    destroySignalSifterModel_S16(&ss_S16);
+    free(mem);
+    free(mem_S16);
+
+    // 5-layer chain with a linear layer between GRUs
+    lin.activation = ACTIVATION_LINEAR;
+    initNNGraph(&g_chain);
+    ret = addNNGraphGRULayer(&g_chain, ss_model.gru1_gru) | addNNGraphGRULayer(&g_chain, ss_model.gru2_gru) |
+          addNNGraphLinearLayer(&g_chain, &lin) | addNNGraphGRULayer(&g_chain, ss_model.gru1_gru) |
+          addNNGraphLinearLayer(&g_chain, ss_model.linear1_linear);
+    mismatches_chain = run_graph_chain_frames(&g_chain, ss_model.gru1_gru, ss_model.gru2_gru, &lin, ss_model.linear1_linear);
+    if (ret == 0 && writeNNGraphFile(&g_chain, NNTEST_MODEL_FILE) == 0 &&
+        loadSignalSifterModelFile(&mf, NNTEST_MODEL_FILE, JMPNN_MODEL_VERIFY) == 0)
+    {
+        mismatches_file = mf.has_model + (mf.graph.num_layers != 5) +
+            run_graph_chain_frames(&mf.graph, &mf.grus[0], &mf.grus[1], &mf.linears[2], &mf.linears[4]);
+        unloadSignalSifterModelFile(&mf);
+    }
+    remove(NNTEST_MODEL_FILE);
+
+    // LINEAR activation: Q3.15 saturated to Q15, resolved and per-call
+    for (i=0; i<NUM_PTS; i++)
+        x_S32[i] = (i - NUM_PTS/2) * ((1 << 19) / NUM_PTS);
+    for (i=0; i<NUM_PTS; i++)
+        y_ref_S16[i] = MAX(-32768, MIN(32767, x_S32[i]));
+    JMPNN_get_activation_S16(ACTIVATION_LINEAR)(y_S16, x_S32, NUM_PTS);
+    for (i=0; i<NUM_PTS; i++)
+        mismatches_linear += y_S16[i] != y_ref_S16[i];
+    JMPNN_apply_activation_S16(y_S16, x_S32, NUM_PTS, ACTIVATION_LINEAR);
+    for (i=0; i<NUM_PTS; i++)
+        mismatches_linear += y_S16[i] != y_ref_S16[i];
+
+    // Invalid layers: input size off the chain, wider than JMPNN_MAX_WIDTH, unknown activation
+    rejected += addNNGraphLinearLayer(&g_chain, ss_model.linear1_linear) != 0;
+    wide.input_size = IO_SIZE;
+    wide.hidden_size = JMPNN_MAX_WIDTH + 1;
+    rejected += addNNGraphLinearLayer(&g_chain, &wide) != 0;
+    wide.hidden_size = IO_SIZE;
+    wide.activation = ACTIVATION_LINEAR + 1;
+    rejected += addNNGraphLinearLayer(&g_chain, &wide) != 0;
+    rejected += g_chain.num_layers == 5;
+
+    printf("NN GRAPH mismatches: SignalSifter (S16) = %d (F32) = %d, 5-layer chain = %d (model file %d), "
+           "LINEAR activation = %d, invalid layers rejected = %d/4\n",
+           mismatches_S16, mismatches_F32, mismatches_chain, mismatches_file, mismatches_linear, rejected);
+}
+
 void RUN_NNTESTS(void)
 {
     ACTIVATION_TEST(ACTIVATION_TANH);
     ACTIVATION_TEST(ACTIVATION_SIGMOID);
     ACTIVATION_TEST(ACTIVATION_RELU);
+    ACTIVATION_ERROR_TEST();
     
     NNLIB_MATXVEC_TEST();
     NNLAYERS_LINEAR_TEST();
@@ -266,6 +1268,21 @@ void RUN_NNTESTS(void)
     NNLIB_GRU_NEWGATE_TEST();
     NNLIB_VECINT_TEST();
     NNLAYERS_GRU_TEST();
+    NNLIB_GRU_CELL_TEST();
+    NNLAYERS_TILED_TEST();
+    NNLAYERS_BSR_TEST();
+    NNLAYERS_DELTA_TEST();
+    NNLAYERS_BATCH_TEST();
+    NNLAYERS_SEQ_TEST();
+    NNLAYERS_TEAM_TEST();
+    NNLAYERS_PIPELINE_TEST();
+    NNLAYERS_S8_TEST();
+    NNMODEL_FILE_TEST();
+    NNGRAPH_TEST();
+#if JMPNN_USE_X86_DISPATCH
+    NNLIB_AVX2_BITEXACT_TEST();
+    NNLIB_AVX2_FLOAT_TEST();
+#endif
 }
 
 #endif /* nntests_h */
@@ -22,8 +22,17 @@
 #include <math.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "jumpml_nr.h"
+#include "jumpml_nr_engine.h"
+#include "jumpml_nr_chunked.h"
 #include "jumpml_nr_tuning.h"
+#include "signalsifter_model_file.h"
+
+extern const SignalSifterModel ss_model;
+
+#define JUMPML_NR_CHUNK_WARMUP 500      // frames (5 s at 16 kHz)
 
 
 void usage(char* progname) {
@@ -34,9 +43,52 @@ void usage(char* progname) {
     "   -n naturalness: optional float number between 0 (max suppression) and 1 (most natural). Default: 0.5\n"
     "   -m min_gain:    optional minimum suppression gain floor in dB in [-60, 0] dB. Default: -40 dB\n"
     "   -r sample_rate: optional sample rate for input/output in {8000, 16000}. Default: 16000Hz\n"
-    "   -h:             print out this help message\n", progname);
+    "   -O:             offline mode: read the whole file and process it with one jumpml_nr_proc_batch call (same output)\n"
+    "   -b num_frames:  optional number of frames per jumpml_nr_proc_batch call (same output). Default: 1 (jumpml_nr_proc)\n"
+    "   -k block_size:  optional streaming with blocks of block_size samples (jumpml_nr_proc_stream); the output is\n"
+    "                   delayed by the printed latency. Default: 0 (frames of jumpml_nr_frame_size samples)\n"
+    "   -C num_channels: optional number of interleaved channels in the input/output files, denoised in place\n"
+    "                   with jumpml_nr_proc_multi (one instance per channel). Default: 1\n"
+    "   -l link:        with -C, linked gains (jumpml_nr_proc_linked): one NN run per frame on the combined\n"
+    "                   channel, link in {mid, max} (mean of the channels, largest power per bin). Default: off\n"
+    "   -s num_streams: optional number of instances run batched on the same input (stream 0 is written). Default: 1\n"
+    "   -t num_threads: optional number of worker threads: the streams run on the multi-stream engine (same output)\n"
+    "                   and the per-worker throughput is printed. Default: 0 (caller's thread)\n"
+    "   -q:             with -t, submit frames asynchronously and drain the completion queue (same output)\n"
+    "   -p team_threads: optional intra-frame parallel NN of stream 0: its GRU layers are split across team_threads\n"
+    "                   threads including the caller (same output). Default: 1 (serial)\n"
+    "   -c num_chunks:  time-chunked offline mode: the file is split into num_chunks chunks denoised in parallel\n"
+    "                   (one thread each) and the deviation from the sequential output is printed\n"
+    "   -u warmup:      optional warm-up frames run before each chunk (with -c). Default: %d\n"
+    "   -a:             decoupled NN worker: stream 0 runs its NN on a worker thread, gains one frame late; frames\n"
+    "                   are fed at real-time pace and the deadline misses are printed (output differs from the default)\n"
+    "   -L:             layer pipeline: gru1..gru3 of stream 0 run on their own threads (with -O or -b, same output)\n"
+    "   -g threshold:   optional energy gate: frames below threshold dB (frame level, NN input scale) bypass the NN. Default: off\n"
+    "   -d state_decay: optional GRU state decay per gated frame in [0,1] (with -g). Default: 1 (keep)\n"
+    "   -T in,state:    optional delta inference thresholds (delta build), NN input in Q9 and GRU states in Q15;\n"
+    "                   0,0 gives the dense output. Default: %d,%d\n"
+    "   -w model_file:  optional binary model file (.jmpnn) used instead of the compiled-in model (and its STFT geometry)\n"
+    "   -W model_file:  write the compiled-in model as a binary model file and exit\n"
+    "   -h:             print out this help message\n", progname, JUMPML_NR_CHUNK_WARMUP,
+    DELTA_INPUT_THRESHOLD_Q9, DELTA_STATE_THRESHOLD_Q15);
 }
 
+/* Moves the queued completions of the engine (waiting up to timeout_ms for the first one)
+   and writes those of stream 0 to fout; returns their number.
+ */
+static int drain_completions(void *engine, int *outstanding, FILE *fout, int frame_size, int timeout_ms)
+{
+    JMPNR_Completion c[JMPNR_ENGINE_QUEUE_FRAMES];
+    int i, n = jumpml_nr_engine_wait_completions(engine, c, JMPNR_ENGINE_QUEUE_FRAMES, timeout_ms);
+
+    for (i=0;i<n;i++)
+    {
+        outstanding[c[i].stream_id]--;
+        if (c[i].stream_id == 0)
+            fwrite(c[i].output, sizeof(short), frame_size, fout);
+    }
+    return n;
+}
 
 int main(int argc, char **argv)
 {
@@ -44,20 +96,51 @@ int main(int argc, char **argv)
     char *fname_in, *fname_out;
     int required_args = 0;
     int opt;
-    int16_t input_S16[JUMPML_NR_FRAME_SIZE];
-    int16_t output_S16[JUMPML_NR_FRAME_SIZE];
-    int8_t jmpnrStBuf[sizeof(DSP_JMPNR_ST_STRU)];
+    int16_t input_S16[JUMPML_NR_MAX_FRAME_SIZE];
+    int16_t output_S16[JUMPML_NR_MAX_FRAME_SIZE];
+    int frame_size = JUMPML_NR_FRAME_SIZE;
+    size_t state_size;
     
     float naturalness = JUMPML_NR_NATURALNESS;
     float min_gain = powf(10, JUMPML_NR_MIN_GAIN/10);
     int sample_rate = 16000; // Default sample rate
+    int num_streams = 1;
+    int offline = 0;
+    int batch_frames = 1;
+    int block_size = 0;
+    int num_channels = 1, link_mode = -1;
+    int delta_input_threshold = -1, delta_state_threshold = -1;
+    void **channel_st = NULL;
+    int gate = 0;
+    float gate_threshold = NR_GATE_THRESHOLD_DB;
+    float gate_state_decay = NR_GATE_STATE_DECAY;
+    int n;
+    long num_samples;
+    int16_t *file_in = NULL, *file_out = NULL;
+    int k;
+    int8_t *streamBufs = NULL;
+    void **stream_st = NULL;
+    int16_t **stream_in = NULL, **stream_out = NULL;
     float val;
+    char *fname_model = NULL;
+    void *jmpnr_ctx = NULL;
+    int num_threads = 0, team_threads = 1;
+    void *engine = NULL, *team = NULL, *pipeline = NULL;
+    int use_pipeline = 0, use_worker = 0;
+    NRWorkerStats worker_nn_stats;
+    struct timespec frame_deadline;
+    JMPNR_ChunkedConfig chunk_cfg = {0, 0, JUMPML_NR_CHUNK_WARMUP, 1, 0, NULL};
+    JMPNR_ChunkedReport chunk_report;
+    JMPNR_EngineConfig engine_cfg = {0};
+    int async_engine = 0, *async_outstanding = NULL;
+    int16_t *async_out = NULL;
+    JMPNR_WorkerStats worker_stats;
     
 //    DSP_JMPNR_ST_STRU jmpNR;
     int frameCount = 0;
     
-    void* jmpnr_st_stru = (void *) jmpnrStBuf;
-    while( (opt = getopt(argc, argv, ":hn:m:i:o:r:")) != -1 )
+    void* jmpnr_st_stru;
+    while( (opt = getopt(argc, argv, ":haqOLn:m:i:o:r:s:b:k:C:l:t:p:c:u:g:d:T:w:W:")) != -1 )
     {
         switch(opt)
         {
@@ -109,6 +192,120 @@ int main(int argc, char **argv)
                     printf("Sample rate must be either 8000 or 16000 Hz. Using default: 16000 Hz\n");
                 }
                 break;
+            case 'O':
+                offline = 1;
+                break;
+            case 'b':
+                batch_frames = atoi(optarg);
+                if (batch_frames < 1)
+                {
+                    printf("Number of frames per batch must be at least 1. Using default: 1\n");
+                    batch_frames = 1;
+                }
+                break;
+            case 'k':
+                block_size = atoi(optarg);
+                if (block_size < 0)
+                {
+                    printf("Block size must be at least 1. Using default: 0 (frames)\n");
+                    block_size = 0;
+                }
+                break;
+            case 'C':
+                num_channels = atoi(optarg);
+                if (num_channels < 1)
+                {
+                    printf("Number of channels must be at least 1. Using default: 1\n");
+                    num_channels = 1;
+                }
+                break;
+            case 'l':
+                if (strcmp(optarg, "mid") == 0)
+                    link_mode = NR_LINK_MID;
+                else if (strcmp(optarg, "max") == 0)
+                    link_mode = NR_LINK_MAX;
+                else
+                    printf("Link must be mid or max. Using default: off\n");
+                break;
+            case 's':
+                num_streams = atoi(optarg);
+                if (num_streams < 1)
+                {
+                    printf("Number of streams must be at least 1. Using default: 1\n");
+                    num_streams = 1;
+                }
+                break;
+            case 't':
+                num_threads = atoi(optarg);
+                if (num_threads < 0 || num_threads > JMPNR_ENGINE_MAX_WORKERS)
+                {
+                    printf("Number of threads must be in [0,%d]. Using default: 0\n", JMPNR_ENGINE_MAX_WORKERS);
+                    num_threads = 0;
+                }
+                break;
+            case 'c':
+                chunk_cfg.num_chunks = atoi(optarg);
+                if (chunk_cfg.num_chunks < 1 || chunk_cfg.num_chunks > JMPNR_CHUNKED_MAX_THREADS)
+                {
+                    printf("Number of chunks must be in [1,%d]. Using default: off\n", JMPNR_CHUNKED_MAX_THREADS);
+                    chunk_cfg.num_chunks = 0;
+                }
+                break;
+            case 'u':
+                chunk_cfg.warmup_frames = atoi(optarg);
+                if (chunk_cfg.warmup_frames < 0)
+                {
+                    printf("Warm-up frames must be at least 0. Using default: %d\n", JUMPML_NR_CHUNK_WARMUP);
+                    chunk_cfg.warmup_frames = JUMPML_NR_CHUNK_WARMUP;
+                }
+                break;
+            case 'q':
+                async_engine = 1;
+                break;
+            case 'a':
+                use_worker = 1;
+                break;
+            case 'L':
+                use_pipeline = 1;
+                break;
+            case 'p':
+                team_threads = atoi(optarg);
+                if (team_threads < 1 || team_threads > NNTEAM_MAX_THREADS)
+                {
+                    printf("Number of team threads must be in [1,%d]. Using default: 1\n", NNTEAM_MAX_THREADS);
+                    team_threads = 1;
+                }
+                break;
+            case 'g':
+                gate = 1;
+                gate_threshold = atof(optarg);
+                break;
+            case 'd':
+                val = atof(optarg);
+                if (val >= 0.0f && val <= 1.0f)
+                {
+                    gate_state_decay = val;
+                }
+                else
+                {
+                    printf("State decay must be in [0,1]. Using default: %f\n", NR_GATE_STATE_DECAY);
+                }
+                break;
+            case 'T':
+                if (sscanf(optarg, "%d,%d", &delta_input_threshold, &delta_state_threshold) != 2)
+                {
+                    printf("Thresholds must be given as input,state. Using default\n");
+                    delta_input_threshold = -1;
+                }
+                break;
+            case 'w':
+                fname_model = optarg;
+                break;
+            case 'W':
+                n = writeSignalSifterModelFile(&ss_model, optarg);
+                if (n)
+                    printf("Could not write model file %s (error %d)\n", optarg, n);
+                return n ? 1 : 0;
             case ':':
                 printf("Option needs a value\n");
                 return 1;
@@ -117,28 +314,310 @@ int main(int argc, char **argv)
         }
     }
 
+    if (link_mode >= 0 && num_channels > JUMPML_NR_MAX_LINKED)
+    {
+        printf("Linked gains take at most %d channels\n", JUMPML_NR_MAX_LINKED);
+        return 1;
+    }
+
     if (required_args != 2) {
         printf("Input and output filenames are required.\n");
         usage(argv[0]);
         return 1;
     }
 
+    // The model file and its STFT geometry are shared by all instances (engine context)
+    if (fname_model && jumpml_nr_context_load(&jmpnr_ctx, fname_model, JMPNN_MODEL_PREFAULT | JMPNN_MODEL_VERIFY))
+    {
+        printf("Could not load model file %s, or this build cannot run it\n", fname_model);
+        return 1;
+    }
+    state_size = jumpml_nr_state_size(jmpnr_ctx);
+    jmpnr_st_stru = malloc(state_size);
+
     fin = fopen(fname_in, "rb");
     fout = fopen(fname_out, "wb");
 
-    jumpml_nr_init(jmpnr_st_stru, naturalness, min_gain);
+    if (jmpnr_ctx && jumpml_nr_init_context(jmpnr_st_stru, jmpnr_ctx, naturalness, min_gain))
+    {
+        printf("This build cannot run a model loaded from a file\n");
+        return 1;
+    }
+    if (jmpnr_ctx == NULL)
+        jumpml_nr_init(jmpnr_st_stru, naturalness, min_gain);
+    frame_size = jumpml_nr_frame_size(jmpnr_st_stru);
+    jumpml_nr_set_gate(jmpnr_st_stru, gate, gate_threshold, gate_state_decay);
+    if (delta_input_threshold >= 0 &&
+        jumpml_nr_set_delta_thresholds(jmpnr_st_stru, delta_input_threshold, delta_state_threshold))
+    {
+        printf("Invalid thresholds, or this build does not use delta inference\n");
+        return 1;
+    }
+    if (team_threads > 1)
+    {
+        if (jumpml_nr_team_create(&team, team_threads, NULL) || jumpml_nr_set_team(jmpnr_st_stru, team))
+        {
+            printf("Could not start %d team threads, or this build cannot use them\n", team_threads);
+            return 1;
+        }
+    }
+    if (use_pipeline)
+    {
+        if (jumpml_nr_pipeline_create(&pipeline, NULL) || jumpml_nr_set_pipeline(jmpnr_st_stru, pipeline))
+        {
+            printf("Could not start the layer pipeline, or this build cannot use it\n");
+            return 1;
+        }
+    }
+    if (use_worker && jumpml_nr_worker_start(jmpnr_st_stru, -1))
+    {
+        printf("Could not start the NN worker\n");
+        return 1;
+    }
+    if (num_streams > 1 || num_threads > 0)
+    {
+        // Stream 0 uses the regular instance; the others are extra copies fed the same input
+        streamBufs = (int8_t *) malloc((size_t)(num_streams - 1) * state_size);
+        stream_st = (void **) malloc(num_streams * sizeof(void *));
+        stream_in = (int16_t **) malloc(num_streams * sizeof(int16_t *));
+        stream_out = (int16_t **) malloc(num_streams * sizeof(int16_t *));
+        stream_st[0] = jmpnr_st_stru;
+        stream_out[0] = output_S16;
+        for (k=1;k<num_streams;k++)
+        {
+            stream_st[k] = (void *) &streamBufs[(k - 1) * state_size];
+            if (jmpnr_ctx)
+                jumpml_nr_init_context(stream_st[k], jmpnr_ctx, naturalness, min_gain);
+            else
+                jumpml_nr_init(stream_st[k], naturalness, min_gain);
+            jumpml_nr_set_gate(stream_st[k], gate, gate_threshold, gate_state_decay);
+            stream_out[k] = (int16_t *) malloc(frame_size * sizeof(int16_t));
+        }
+        for (k=0;k<num_streams;k++)
+            stream_in[k] = input_S16;
+    }
+    if (num_threads > 0)
+    {
+        engine_cfg.num_workers = num_threads;
+        engine_cfg.max_streams = num_streams;
+        if (async_engine)
+        {
+            // every stream keeps up to JMPNR_ENGINE_QUEUE_FRAMES frames (and output buffers) in flight
+            engine_cfg.completion_slots = num_streams * JMPNR_ENGINE_QUEUE_FRAMES;
+            async_outstanding = (int *) calloc(num_streams, sizeof(int));
+            async_out = (int16_t *) malloc((size_t)num_streams * JMPNR_ENGINE_QUEUE_FRAMES * frame_size * sizeof(int16_t));
+        }
+        if (jumpml_nr_engine_create(&engine, &engine_cfg))
+        {
+            printf("Could not start %d worker threads\n", num_threads);
+            return 1;
+        }
+        for (k=0;k<num_streams;k++)
+            jumpml_nr_engine_add_stream(engine, stream_st[k], sample_rate, NULL, NULL);
+    }
+    
+    if (chunk_cfg.num_chunks > 0)
+    {
+        fseek(fin, 0, SEEK_END);
+        num_samples = ftell(fin) / sizeof(short);
+        fseek(fin, 0, SEEK_SET);
+        frameCount = num_samples / frame_size;
+        file_in = (int16_t *) malloc((size_t)frameCount * frame_size * sizeof(int16_t));
+        file_out = (int16_t *) malloc((size_t)frameCount * frame_size * sizeof(int16_t));
+        frameCount = fread(file_in, sizeof(short) * frame_size, frameCount, fin);
+        chunk_cfg.num_threads = chunk_cfg.num_chunks;
+        if (jumpml_nr_proc_chunked(file_out, file_in, frameCount, jmpnr_ctx, naturalness, min_gain, sample_rate,
+                                   &chunk_cfg, &chunk_report))
+        {
+            printf("Could not run %d chunks\n", chunk_cfg.num_chunks);
+            return 1;
+        }
+        printf("Chunked: %d chunks on %d threads, warm-up %d frames: %.1f ms (sequential %.1f ms)\n"
+               "Deviation from sequential: max %d LSB, rms %.4f LSB, %llu of %ld samples differ, settled after %d frames\n",
+               chunk_report.num_chunks, chunk_report.num_threads, chunk_cfg.warmup_frames,
+               chunk_report.chunked_ns / 1e6, chunk_report.sequential_ns / 1e6, chunk_report.max_abs_error,
+               chunk_report.rms_error, (unsigned long long)chunk_report.mismatched_samples,
+               (long)frameCount * frame_size, chunk_report.settle_frames);
+        fwrite(file_out, sizeof(short) * frame_size, frameCount, fout);
+        free(file_in);
+        free(file_out);
+    }
+    else if (offline)
+    {
+        fseek(fin, 0, SEEK_END);
+        num_samples = ftell(fin) / sizeof(short);
+        fseek(fin, 0, SEEK_SET);
+        frameCount = num_samples / frame_size;
+        file_in = (int16_t *) malloc((size_t)frameCount * frame_size * sizeof(int16_t));
+        file_out = (int16_t *) malloc((size_t)frameCount * frame_size * sizeof(int16_t));
+        frameCount = fread(file_in, sizeof(short) * frame_size, frameCount, fin);
+        jumpml_nr_proc_batch(file_out, file_in, frameCount, jmpnr_st_stru, sample_rate);
+        fwrite(file_out, sizeof(short) * frame_size, frameCount, fout);
+        free(file_in);
+        free(file_out);
+    }
+    
+    if (num_channels > 1)
+    {
+        // Channel 0 uses the regular instance; the interleaved frames are denoised in place
+        channel_st = (void **) malloc(num_channels * sizeof(void *));
+        channel_st[0] = jmpnr_st_stru;
+        for (k=1;k<num_channels;k++)
+        {
+            channel_st[k] = malloc(state_size);
+            if (jmpnr_ctx)
+                jumpml_nr_init_context(channel_st[k], jmpnr_ctx, naturalness, min_gain);
+            else
+                jumpml_nr_init(channel_st[k], naturalness, min_gain);
+            jumpml_nr_set_gate(channel_st[k], gate, gate_threshold, gate_state_decay);
+        }
+        file_in = (int16_t *) malloc((size_t)num_channels * frame_size * sizeof(int16_t));
+        while (fread(file_in, sizeof(short) * num_channels, frame_size, fin) == (size_t)frame_size)
+        {
+            if (link_mode >= 0)
+                jumpml_nr_proc_linked(file_in, file_in, JUMPML_NR_FORMAT_S16, num_channels, num_channels,
+                                      channel_st, link_mode, sample_rate);
+            else
+                jumpml_nr_proc_multi(file_in, file_in, JUMPML_NR_FORMAT_S16, num_channels, num_channels,
+                                     channel_st, sample_rate);
+            fwrite(file_in, sizeof(short) * num_channels, frame_size, fout);
+            frameCount++;
+        }
+        for (k=1;k<num_channels;k++)
+        {
+            jumpml_nr_release(channel_st[k]);
+            free(channel_st[k]);
+        }
+        free(channel_st);
+        free(file_in);
+    }
+
+    if (!offline && chunk_cfg.num_chunks == 0 && num_channels == 1 && block_size > 0)
+    {
+        file_in = (int16_t *) malloc((size_t)block_size * sizeof(int16_t));
+        file_out = (int16_t *) malloc((size_t)block_size * sizeof(int16_t));
+        jumpml_nr_stream_reset(jmpnr_st_stru, block_size);
+        printf("Streaming: blocks of %d samples, latency %d samples\n", block_size, jumpml_nr_stream_latency(jmpnr_st_stru));
+        while ((n = fread(file_in, sizeof(short), block_size, fin)) > 0)
+        {
+            jumpml_nr_proc_stream(file_out, file_in, n, jmpnr_st_stru, sample_rate);
+            fwrite(file_out, sizeof(short), n, fout);
+        }
+        free(file_in);
+        free(file_out);
+    }
+
+    if (!offline && chunk_cfg.num_chunks == 0 && num_channels == 1 && block_size == 0 && batch_frames > 1)
+    {
+        file_in = (int16_t *) malloc((size_t)batch_frames * frame_size * sizeof(int16_t));
+        file_out = (int16_t *) malloc((size_t)batch_frames * frame_size * sizeof(int16_t));
+        while ((n = fread(file_in, sizeof(short) * frame_size, batch_frames, fin)) > 0)
+        {
+            jumpml_nr_proc_batch(file_out, file_in, n, jmpnr_st_stru, sample_rate);
+            fwrite(file_out, sizeof(short) * frame_size, n, fout);
+            frameCount += n;
+        }
+        free(file_in);
+        free(file_out);
+    }
     
-    while (1) {
-        fread(input_S16, sizeof(short), JUMPML_NR_FRAME_SIZE, fin);
+    while (!offline && chunk_cfg.num_chunks == 0 && num_channels == 1 && block_size == 0 && batch_frames == 1) {
+        fread(input_S16, sizeof(short), frame_size, fin);
         if (feof(fin)) break;
-        jumpml_nr_proc(output_S16, input_S16, jmpnr_st_stru, sample_rate);
+        if (engine && async_engine)
+        {
+            for (k=0;k<num_streams;k++)
+            {
+                while (async_outstanding[k] == JMPNR_ENGINE_QUEUE_FRAMES)
+                    drain_completions(engine, async_outstanding, fout, frame_size, -1);
+                jumpml_nr_engine_submit_tagged(engine, k, input_S16,
+                    &async_out[((size_t)k * JMPNR_ENGINE_QUEUE_FRAMES + frameCount % JMPNR_ENGINE_QUEUE_FRAMES) * frame_size],
+                    frameCount);
+                async_outstanding[k]++;
+            }
+            while (drain_completions(engine, async_outstanding, fout, frame_size, 0) > 0)
+                ;
+            frameCount = frameCount + 1;
+            continue;
+        }
+        else if (engine)
+        {
+            for (k=0;k<num_streams;k++)
+                jumpml_nr_engine_submit(engine, k, input_S16, stream_out[k]);
+            jumpml_nr_engine_wait(engine);
+        }
+        else if (num_streams > 1)
+            jumpml_nr_proc_streams(stream_out, stream_in, stream_st, num_streams, sample_rate);
+        else
+            jumpml_nr_proc(output_S16, input_S16, jmpnr_st_stru, sample_rate);
+        if (use_worker)
+        {
+            // an audio callback: the next frame arrives one frame period later
+            if (frameCount == 0)
+                clock_gettime(CLOCK_MONOTONIC, &frame_deadline);
+            frame_deadline.tv_nsec += 1000000000L / sample_rate * frame_size;
+            if (frame_deadline.tv_nsec >= 1000000000L)
+            {
+                frame_deadline.tv_sec++;
+                frame_deadline.tv_nsec -= 1000000000L;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &frame_deadline, NULL);
+        }
         frameCount = frameCount + 1;
 //        if (frameCount == 10)
 //        	break;
-        fwrite(output_S16, sizeof(short), JUMPML_NR_FRAME_SIZE, fout);
+        fwrite(output_S16, sizeof(short), frame_size, fout);
     }
     
+    if (engine && async_engine)
+    {
+        for (k=0;k<num_streams;k++)
+            while (async_outstanding[k] > 0)
+                drain_completions(engine, async_outstanding, fout, frame_size, -1);
+        jumpml_nr_engine_wait(engine);     // the workers' counters are final
+        free(async_outstanding);
+    }
     fclose(fin);
     fclose(fout);
+    if (engine)
+    {
+        for (k=0;k<jumpml_nr_engine_num_workers(engine);k++)
+        {
+            jumpml_nr_engine_worker_stats(engine, k, &worker_stats);
+            printf("Worker %d: %llu frames, %.1f us/frame, %llu steals\n", k, (unsigned long long)worker_stats.frames,
+                   worker_stats.frames ? worker_stats.busy_ns / 1000.0 / worker_stats.frames : 0.0,
+                   (unsigned long long)worker_stats.steals);
+        }
+        jumpml_nr_engine_destroy(engine);
+        free(async_out);
+    }
+    if (use_worker)
+    {
+        jumpml_nr_worker_stats(jmpnr_st_stru, &worker_nn_stats);
+        printf("NN worker: %llu frames, %llu NN frames, %llu late, %llu dropped, slowest NN frame %.1f us\n",
+               (unsigned long long)worker_nn_stats.frames, (unsigned long long)worker_nn_stats.nn_frames,
+               (unsigned long long)worker_nn_stats.late, (unsigned long long)worker_nn_stats.dropped,
+               worker_nn_stats.max_nn_ns / 1000.0);
+        jumpml_nr_worker_stop(jmpnr_st_stru);
+    }
+    jumpml_nr_team_destroy(team);
+    jumpml_nr_pipeline_destroy(pipeline);
+    if (gate)
+        noise_reduction_monitor(((DSP_JMPNR_ST_STRU *) jmpnr_st_stru)->NR_Ptr);
+    if (stream_st)
+    {
+        for (k=1;k<num_streams;k++)
+        {
+            jumpml_nr_release(stream_st[k]);
+            free(stream_out[k]);
+        }
+        free(stream_out);
+        free(stream_in);
+        free(stream_st);
+        free(streamBufs);
+    }
+    jumpml_nr_release(jmpnr_st_stru);
+    free(jmpnr_st_stru);
+    jumpml_nr_context_release(jmpnr_ctx);
     return 0;
 }
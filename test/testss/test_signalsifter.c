@@ -34,6 +34,11 @@ int main(int argc, char **argv) {
     
     SignalSifterState_S16 SS_S16;
     createSignalSifterModel_S16(&SS_S16);
+
+    int16_t gains_S8[IO_SIZE];
+    int8_t input_S8[IO_SIZE];
+    SignalSifterState_S8 SS_S8;
+    createSignalSifterModel_S8(&SS_S8);
     
     memcpy(SS.gru1_gru_state, test_state_in1, SS.model->gru1_hidden_size * sizeof(float));
     memcpy(SS.gru2_gru_state, test_state_in2, SS.model->gru2_hidden_size * sizeof(float));
@@ -43,8 +48,14 @@ int main(int argc, char **argv) {
     memcpy(SS_S16.gru2_gru_state, test_state_in2_S16, SS_S16.model->gru2_hidden_size * sizeof(int16_t));
     memcpy(SS_S16.gru3_gru_state, test_state_in3_S16, SS_S16.model->gru3_hidden_size * sizeof(int16_t));
     
+    convert_F32toS8_Q((float *) test_state_in1, SS_S8.gru1_gru_state, SS_S8.model->gru1_hidden_size, GRU1_S8_FRAC_BITS);
+    convert_F32toS8_Q((float *) test_state_in2, SS_S8.gru2_gru_state, SS_S8.model->gru2_hidden_size, GRU2_S8_FRAC_BITS);
+    convert_F32toS8_Q((float *) test_state_in3, SS_S8.gru3_gru_state, SS_S8.model->gru3_hidden_size, GRU3_S8_FRAC_BITS);
+    convert_F32toS8_Q((float *) test_input, input_S8, SS_S8.model->gru1_gru->input_size, INPUT_S8_FRAC_BITS);
+
     computeSignalSifterModel(&SS, gains, test_input);
     computeSignalSifterModel_S16(&SS_S16, gains_S16, test_input_S16);
+    computeSignalSifterModel_S8(&SS_S8, gains_S8, input_S8);
 #if ENABLE_SS_MONITOR
     printSignalSifterStats(SS.monitor);
 #endif
@@ -61,7 +72,14 @@ int main(int argc, char **argv) {
     float mse_state3_S16 = check_vec_S16(SS_S16.gru3_gru_state, (float *) test_state_out3, SS.model->gru3_hidden_size, 15);
     float mse_out_S16 = check_vec_S16(gains_S16,  (float *)test_output, IO_SIZE, 15);
     printf("Fixed-point 16-bit inference MSE:\n");
-    printf("\tMSE(h1) = %e\tMSE(h2) = %e\tMSE(h3) = %e\tMSE(out) = %e\n", mse_state1_S16, mse_state2_S16, mse_state3_S16, mse_out_S16);
+    printf("\tMSE(h1) = %e\tMSE(h2) = %e\tMSE(h3) = %e\tMSE(out) = %e\n\n", mse_state1_S16, mse_state2_S16, mse_state3_S16, mse_out_S16);
+
+    float mse_state1_S8 = check_vec_S8(SS_S8.gru1_gru_state, (float *) test_state_out1, SS.model->gru1_hidden_size, GRU1_S8_FRAC_BITS);
+    float mse_state2_S8 = check_vec_S8(SS_S8.gru2_gru_state, (float *) test_state_out2, SS.model->gru2_hidden_size, GRU2_S8_FRAC_BITS);
+    float mse_state3_S8 = check_vec_S8(SS_S8.gru3_gru_state, (float *) test_state_out3, SS.model->gru3_hidden_size, GRU3_S8_FRAC_BITS);
+    float mse_out_S8 = check_vec_S16(gains_S8,  (float *)test_output, IO_SIZE, 15);
+    printf("Fixed-point int8-activation inference MSE:\n");
+    printf("\tMSE(h1) = %e\tMSE(h2) = %e\tMSE(h3) = %e\tMSE(out) = %e\n", mse_state1_S8, mse_state2_S8, mse_state3_S8, mse_out_S8);
     
     /*
     print_vector(SS.gru1_gru_state, SS.model->gru1_hidden_size, "GRU1 State");
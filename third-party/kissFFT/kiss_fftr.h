@@ -46,6 +46,13 @@ void kiss_fftri(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *
  output timedata has nfft scalar points
 */
 
+/*
+ Same with a caller-provided scratch of nfft/2 complex points instead of the one in cfg:
+ threads can then share one cfg (it is only read)
+*/
+void kiss_fftr_tmp(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,kiss_fft_cpx *tmpbuf);
+void kiss_fftri_tmp(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata,kiss_fft_cpx *tmpbuf);
+
 #define kiss_fftr_free KISS_FFT_FREE
 
 #ifdef __cplusplus